@@ -275,6 +275,16 @@ enum RobotMiscSensors {
 //! number of endeffectors
 #define N_ENDEFFS  (N_ROBOT_ENDEFFECTORS-1)
 
+//! number of arms in the cell (one endeffector per arm)
+#define N_ARMS N_ENDEFFS
+
+//! number of DOFs of each Panda arm
+#define N_DOFS_PER_ROBOT 7
+
+//! number of endeffector orientation angles (same as N_CART, which is not
+//! yet defined when this file is included)
+#define N_EFF_ANGLES 3
+
 //! number of cameras used
 #define N_CAMERAS (N_VISION_CAMERAS-1)
 
@@ -288,6 +298,12 @@ enum RobotMiscSensors {
 //  servo rates of all other servos 
 #define  SERVO_BASE_RATE 1000
 
+//! the rate of the torque control loop of the Panda robots. SERVO_BASE_RATE
+//  can be an integer divisor of it (e.g., 500 or 250), in which case the
+//  motor servo runs at SERVO_BASE_RATE and the Panda servo interpolates its
+//  commands at the robot rate
+#define  PANDA_ROBOT_RATE 1000
+
 //! divisor to obtain task servo rate (task servo can run slower than
 //  base rate, but only in integer fractions */
 #define  TASK_SERVO_RATIO   R1TO1
@@ -307,10 +323,12 @@ extern "C" {
   void sendGripperGraspCommand(double width, double speed, double force,
 			       double eps_in, double eps_out) ;
   void sendGripperMoveCommand(double width, double speed);
+  void sendGripperStopCommand(void);
 
   void sendCalibrateFTCommand(void);
+  void sendFTContactCommand(int arm, int contact);
 
-// external variables
+  void endeffChanged(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,60 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_clock.h
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  alignment of the samples of the arms, which are clocked by the 1kHz
+  clocks of their own Franka controllers, to the monotonic clock of the
+  motor servo, with statistics of the sample ages and the drift of the
+  robot clocks relative to the master arm
+
+  ============================================================================*/
+
+#ifndef _panda4_clock_
+#define _panda4_clock_
+
+//! the arm whose robot clock is the reference of the clock offsets
+#define PANDA4_MASTER_ARM 1
+
+//! when the sample of an arm was taken
+typedef struct {
+  unsigned long t_mono;              //!< CLOCK_MONOTONIC time of the arm callback in ns
+  double        t_robot;             //!< libfranka RobotState::time in s
+} Panda4ArmStamp;
+
+//! the alignment of the samples of all arms in one tick of the motor servo
+typedef struct {
+  unsigned long t_mono;              //!< CLOCK_MONOTONIC time of the alignment in ns
+  int           n_arms;              //!< number of arms with a sample
+  int           valid[N_ARMS+1];     //!< the arm has published a sample
+  int           fresh[N_ARMS+1];     //!< the sample is new since the last tick
+  double        age[N_ARMS+1];       //!< age of the sample in s
+  double        t_robot[N_ARMS+1];   //!< libfranka time of the sample in s
+  double        offset[N_ARMS+1];    //!< robot clock offset to the master arm in s
+  double        spread;              //!< largest difference of the sample times in s
+} Panda4Alignment;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  // function prototypes
+  void panda4_alignArms(Panda4ArmStamp *stamps, int *valid);
+  void panda4_addClockVarsToCollect(void);
+  void panda4_printClockStats(void);
+  void panda4_resetClockStats(void);
+
+  // external variables
+  extern Panda4Alignment panda4_alignment;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _panda4_clock_ */
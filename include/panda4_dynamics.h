@@ -0,0 +1,81 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_dynamics.h
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  per-arm kinematics and dynamics kernels for the 4 Panda arms, which
+  complement the generated whole-body kernels in the math directory. All
+  kernels use the link parameters in links[] and the endeffector parameters
+  in eff[], and they assume that the base of the robot is fixed.
+
+  ============================================================================*/
+
+#ifndef _panda4_dynamics_
+#define _panda4_dynamics_
+
+//! number of configurations evaluated at once by the batched forward
+//! kinematics, which should match the SIMD width of the target (4 doubles
+//! for AVX2, 8 doubles for AVX-512)
+#ifndef N_FK_LANES
+#define N_FK_LANES 4
+#endif
+
+//! number of frames per arm returned by the batched forward kinematics:
+//! the 7 joint frames and the endeffector frame
+#define N_FK_FRAMES (N_DOFS_PER_ROBOT+1)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  // function prototypes
+  void panda4_armCoriolisMatrix(int arm, SL_Jstate *state, SL_endeff *eff,
+				double C[][N_DOFS_PER_ROBOT+1],
+				double M[][N_DOFS_PER_ROBOT+1]);
+  void panda4_CoriolisMatrix(SL_Jstate *state, SL_endeff *eff,
+			     double C[][N_DOFS_PER_ROBOT+1][N_DOFS_PER_ROBOT+1]);
+  void panda4_armCentroidal(int arm, SL_Jstate *state, SL_endeff *eff, double *mass,
+			    double *com, double Jcom[][N_DOFS_PER_ROBOT+1], double *hG);
+  void panda4_Centroidal(SL_Jstate *state, SL_endeff *eff, double *mass,
+			 double *com, double *hG, double acom[][N_CART+1]);
+  int  panda4_fixedBase(SL_Cstate *cbase, SL_quat *obase);
+  void panda4_InvDynNE(SL_Jstate *cstate, SL_DJstate *lstate, SL_endeff *eff,
+		       SL_Cstate *cbase, SL_quat *obase, double g);
+  void panda4_ForDynComp(SL_Jstate *state, SL_Cstate *cbase, SL_quat *obase,
+			 SL_uext *ux, SL_endeff *eff, Matrix rbdM, Vector rbdCG);
+  void panda4_armInvDyn(int arm, SL_Jstate *state, double *qdd, SL_endeff *eff,
+			double *tau);
+  void panda4_armForDyn(int arm, SL_Jstate *state, SL_endeff *eff);
+  void panda4_armGravity(int arm, double *q, SL_endeff *eff, double g, double *tau);
+  void panda4_InertiaMatrix(SL_Jstate *state, SL_Cstate *cbase, SL_quat *obase,
+			    SL_endeff *eff, Matrix M);
+  void panda4_linkInformation(SL_Jstate *state, SL_Cstate *basec, SL_quat *baseo,
+			      SL_endeff *eff, double **Xmcog, double **Xaxis,
+			      double **Xorigin, double **Xlink, double ***Ahmat,
+			      double ***Ahmatdof);
+  void panda4_Jacobian(SL_Jstate *state, SL_Cstate *basec, SL_quat *baseo,
+		       SL_endeff *eff, Matrix Jac);
+  void panda4_armFKBatch(int arm, double th[][N_FK_LANES], SL_endeff *eff,
+			 double pos[][N_CART+1][N_FK_LANES],
+			 double rot[][N_CART+1][N_CART+1][N_FK_LANES]);
+  void panda4_FKBatch(double th[][N_FK_LANES], SL_endeff *eff,
+		      double pos[][N_FK_FRAMES+1][N_CART+1][N_FK_LANES],
+		      double rot[][N_FK_FRAMES+1][N_CART+1][N_CART+1][N_FK_LANES]);
+  void panda4_sinCosBatch(double *x, double *s, double *c);
+
+  // the endeffector snapshots of SL_user_common.c
+  int  getEndeffectorSnapshot(SL_endeff *eff);
+  int  getEndeffectorRotation(int i, double *a, double R[][N_CART+1]);
+  int  getEndeffectorSinCos(SL_endeff *eff, double s[][N_CART+1], double c[][N_CART+1]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _panda4_dynamics_ */
@@ -0,0 +1,43 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_loadcell.h
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  acquisition of the Axia80 load cell in its own real-time thread, which
+  publishes the latest timestamped reading for a wait-free read by the
+  torque callback
+
+  ============================================================================*/
+
+#ifndef _panda4_loadcell_
+#define _panda4_loadcell_
+
+//! the sample rate that the Axia80 is configured to
+#define PANDA4_LOADCELL_RATE 3900
+
+//! maximal number of readings that are averaged into one sample
+#define N_LOADCELL_AVG 16
+
+//! the latest load cell sample
+typedef struct {
+  unsigned long t_mono;              //!< CLOCK_MONOTONIC time of the newest reading in ns
+  unsigned long seq;                 //!< number of readings since the start
+  int           n_avg;               //!< number of readings averaged into ft
+  double        ft[2*N_CART];        //!< force and torque in the sensor frame
+} Panda4LoadCellSample;
+
+// function prototypes
+int  panda4_startLoadCell(int loopback, int n_avg, int cpu);
+void panda4_stopLoadCell(void);
+int  panda4_readLoadCell(Panda4LoadCellSample *sample);
+void panda4_tareLoadCell(void);
+void panda4_setLoopbackWrench(double *ft);
+void panda4_printLoadCellStats(void);
+
+#endif  /* _panda4_loadcell_ */
@@ -0,0 +1,51 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_messages.h
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  hashed dispatch of the messages that the task sends to the simulation
+  and robot servos
+
+  ============================================================================*/
+
+#ifndef _panda4_messages_
+#define _panda4_messages_
+
+//! number of slots of a message table: a power of two, and at least twice
+//! the number of registered messages to keep the probe sequences short
+#define N_MESSAGE_SLOTS 64
+
+//! handlers get the payload of the message in place, as 0-based floats, and
+//! the argument that was given at registration, e.g., the arm ID
+typedef void (*Panda4MessageHandler)(const float *buf, int arg);
+
+typedef struct {
+  char                 name[N_MESSAGE_SLOTS][20];
+  unsigned int         hash[N_MESSAGE_SLOTS];
+  Panda4MessageHandler handler[N_MESSAGE_SLOTS];
+  int                  arg[N_MESSAGE_SLOTS];
+  int                  n_messages;
+} Panda4MessageTable;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  // function prototypes
+  void panda4_initMessages(Panda4MessageTable *t);
+  int  panda4_addMessage(Panda4MessageTable *t, const char *name,
+			 Panda4MessageHandler handler, int arg);
+  int  panda4_findMessage(Panda4MessageTable *t, const char *name);
+  int  panda4_dispatchMessage(Panda4MessageTable *t, const char *name, int k);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _panda4_messages_ */
@@ -0,0 +1,99 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_record.h
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  binary recording of the robot state and torque command of every tick of
+  the Panda servo, and of the commands that the servo received from the
+  motor servo, for the offline replay of the servo
+
+  ============================================================================*/
+
+#ifndef _panda4_record_
+#define _panda4_record_
+
+#include "panda4_shm.h"
+
+#define PANDA4_RECORD_MAGIC   "PANDA4REC"
+#define PANDA4_RECORD_VERSION 2
+
+//! number of records per arm that the ring holds before records are dropped
+#define N_RECORD_RING 4096
+
+//! the kinds of records
+enum Panda4RecordTypes {
+  PANDA4_RECORD_STATE=1,             //!< one tick of one arm
+  PANDA4_RECORD_COMMAND,             //!< the received commands of one arm
+};
+
+//! the file header
+typedef struct {
+  char   magic[12];
+  int    version;
+  int    record_size;                //!< sizeof(Panda4Record), as a check
+  int    first_arm;                  //!< the arms of the recording servo
+  int    last_arm;
+  int    servo_rate;
+} Panda4RecordHeader;
+
+//! a state record is one tick of one arm: the parts of franka::RobotState
+//! that the servo uses or that are useful for debugging, the Franka model
+//! gravity, the sensed F/T values, and the returned torque command. A
+//! command record holds what the servo read from the motor servo for one
+//! arm in one servo tick; it is stamped with the latest sample of the tick
+//! and written before the state record with this stamp, i.e., before the
+//! tick of the arm that triggered the servo.
+typedef struct {
+  int    type;                       //!< PANDA4_RECORD_STATE or _COMMAND
+  int    arm;
+  unsigned long t_mono;              //!< CLOCK_MONOTONIC stamp in ns, the file order
+  int    robot_mode;                 //!< franka::RobotMode
+  double time;                       //!< RobotState::time in s
+  double period;                     //!< time since the last tick in s
+  double q[N_DOFS_PER_ROBOT];
+  double dq[N_DOFS_PER_ROBOT];
+  double tau_J[N_DOFS_PER_ROBOT];
+  double dtau_J[N_DOFS_PER_ROBOT];
+  double q_d[N_DOFS_PER_ROBOT];
+  double dq_d[N_DOFS_PER_ROBOT];
+  double tau_ext_hat_filtered[N_DOFS_PER_ROBOT];
+  double K_F_ext_hat_K[2*N_CART];
+  double O_T_EE[16];
+  double control_command_success_rate;
+  double gravity[N_DOFS_PER_ROBOT];  //!< gravity torques of the Franka or, with panda_sl_gravity, the SL model
+  double ft[2*N_CART];               //!< sensed F/T, if there is a load cell
+  double tau_d[N_DOFS_PER_ROBOT];    //!< returned torque command
+  int    motion_finished;            //!< the control loop ended with this tick
+  int    cmd_ok;                     //!< complete commands could be read
+  double cmd_age;                    //!< servo time minus the command time in s
+  double u[N_DOFS_PER_ROBOT];        //!< received total command
+  double uff[N_DOFS_PER_ROBOT];      //!< received feedforward command
+  Panda4CmdTraj traj[N_DOFS_PER_ROBOT]; //!< received command trajectory
+} Panda4Record;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  // function prototypes
+  int  panda4_startRecording(char *fname, int first_arm, int last_arm, int servo_rate);
+  void panda4_stopRecording(void);
+  int  panda4_isRecording(void);
+  void panda4_record(Panda4Record *r);
+  long panda4_recordOverflows(void);
+
+  int  panda4_openReplay(char *fname, Panda4RecordHeader *h);
+  int  panda4_readRecord(Panda4Record *r);
+  void panda4_closeReplay(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _panda4_record_ */
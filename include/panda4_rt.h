@@ -0,0 +1,53 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_rt.h
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  the real-time profile of the servo processes: memory locking, stack
+  prefaulting, and the scheduling class, priority and CPU of every thread
+  role, configured in the parameter pool
+
+  ============================================================================*/
+
+#ifndef _panda4_rt_
+#define _panda4_rt_
+
+//! the thread roles of the profile
+enum Panda4RTRoles {
+  RT_ROLE_SERVO=1,        //!< the servo loop of xmotor, xtask and xrprobot
+  RT_ROLE_CONTROL,        //!< the libfranka control threads of xrprobot
+  RT_ROLE_ETHERCAT,       //!< the load cell acquisition of xrprobot
+  RT_ROLE_GRIPPER,        //!< the gripper threads of xrprobot
+  RT_ROLE_CLI,            //!< the command line threads
+  RT_ROLE_BACKGROUND,     //!< data collection, recording, diagnostics
+
+  N_RT_ROLES
+};
+
+//! maximal number of threads that the report keeps track of
+#define N_RT_THREADS 64
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  // function prototypes
+  int  panda4_initRTProfile(const char *process);
+  int  panda4_rtThread(int role, int cpu);
+  void panda4_rtOtherThreads(int role);
+  void panda4_rtReport(void);
+
+  // external variables
+  extern const char *rt_role_names[];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _panda4_rt_ */
@@ -0,0 +1,63 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_rtcheck.h
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  detector of allocations and blocking system calls in the real-time
+  sections of the Panda servo, built in with -DPANDA4_RTCHECK for debug and
+  CI runs. Without PANDA4_RTCHECK, the section markers compile to nothing.
+
+  ============================================================================*/
+
+#ifndef _panda4_rtcheck_
+#define _panda4_rtcheck_
+
+//! the kinds of violations
+enum RTCheckKinds {
+  RTCHECK_MALLOC=1,       //!< malloc, calloc, realloc, the aligned allocations, new
+  RTCHECK_FREE,           //!< free, delete
+  RTCHECK_LOCK_WAIT,      //!< a contended mutex, i.e., a futex wait
+  RTCHECK_COND_WAIT,      //!< waiting on a condition variable or semaphore
+  RTCHECK_SLEEP,          //!< sleeping
+  RTCHECK_FILE_IO,        //!< file and terminal I/O
+
+  N_RTCHECK_KINDS
+};
+
+//! number of distinct call sites that are kept
+#define N_RTCHECK_SITES  128
+
+//! depth of the backtrace of a call site
+#define N_RTCHECK_FRAMES 16
+
+#ifdef PANDA4_RTCHECK
+#define PANDA4_RT_ENTER() panda4_rtCheckEnter()
+#define PANDA4_RT_LEAVE() panda4_rtCheckLeave()
+#else
+#define PANDA4_RT_ENTER()
+#define PANDA4_RT_LEAVE()
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  // function prototypes
+  void panda4_rtCheckEnter(void);
+  void panda4_rtCheckLeave(void);
+  long panda4_rtCheckViolations(void);
+  void panda4_rtCheckReport(void);
+  void panda4_rtCheckSites(void);
+  void panda4_rtCheckReset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _panda4_rtcheck_ */
@@ -0,0 +1,103 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_shm.h
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  seqlock-protected shared memory between the Panda servo(s) and the motor
+  servo. Every block has exactly one writer, which never blocks, and the
+  readers retry until they obtain a complete sample. The state of each arm
+  is a separate block, such that one servo per arm and one servo for all
+  arms use the same layout.
+
+  ============================================================================*/
+
+#ifndef _panda4_shm_
+#define _panda4_shm_
+
+#include "panda4_clock.h"
+
+//! identifies the layout of the segment, to be incremented with every change
+#define PANDA4_SHM_MAGIC   0x50347368
+#define PANDA4_SHM_VERSION 1
+
+//! number of misc sensors of each arm
+#define N_MISC_PER_ARM (A2_C_FX-A1_C_FX)
+
+//! number of attempts of a reader before it gives up on a torn sample
+#define N_SEQLOCK_RETRIES 100
+
+//! the state of one arm as published by the Panda servo
+typedef struct {
+  unsigned int seq;                          //!< odd while being written
+  double       ts;                           //!< servo time of the sample
+  Panda4ArmStamp stamp;                      //!< when the arm took the sample
+  SL_Jstate    state[N_DOFS_PER_ROBOT+1];    //!< th, thd, thdd, load, uff
+  double       misc[N_MISC_PER_ARM+1];       //!< misc sensors of this arm
+} Panda4ArmState;
+
+//! the command trajectory of one DOF, which the Panda servo interpolates at
+//! the robot rate if the motor servo runs slower. The command u0 answers
+//! the joint state th, thd, and the local PD only corrects the motion since
+//! this state, with t the time since the state: u(t) = u0 + du*t +
+//! gain_th*(th + thd_des*t - th(t)) + gain_thd*(thd - thd(t))
+typedef struct {
+  double       u0;                           //!< command of the motor servo
+  double       du;                           //!< slope of the command without the local PD per s
+  double       th;                           //!< the joint state that u0 answers
+  double       thd;
+  double       thd_des;                      //!< desired velocity of the local PD
+  double       gain_th;                      //!< gains of the local PD, zero for
+  double       gain_thd;                     //!< torque plus slope only
+} Panda4CmdTraj;
+
+//! the commands as published by the motor servo
+typedef struct {
+  unsigned int  seq;                         //!< odd while being written
+  double        ts;                          //!< servo time of the sample
+  double        u[N_DOFS+1];                 //!< total command
+  double        uff[N_DOFS+1];               //!< feedforward command
+  Panda4CmdTraj traj[N_DOFS+1];              //!< command trajectory
+} Panda4Commands;
+
+typedef struct {
+  unsigned int   magic;
+  unsigned int   version;
+  unsigned int   size;                       //!< sizeof(Panda4Shm)
+  Panda4ArmState arm[N_ARMS+1];
+  Panda4Commands commands;
+} Panda4Shm;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  // function prototypes
+  int  panda4_initSharedState(void);
+  int  panda4_stampSegment(unsigned int *magic, unsigned int *version, unsigned int *size,
+			   unsigned int my_magic, unsigned int my_version, unsigned int my_size);
+  void panda4_writeArmState(int arm, double ts, Panda4ArmStamp *stamp,
+			    SL_Jstate *state, double *misc);
+  int  panda4_readArmState(int arm, double *ts, Panda4ArmStamp *stamp,
+			   SL_Jstate *state, double *misc);
+  int  panda4_readArmBlock(int arm, Panda4ArmState *block);
+  void panda4_writeCommands(double ts, SL_Jstate *state, SL_DJstate *des_state,
+			    Panda4CmdTraj *traj);
+  int  panda4_readCommands(int first_arm, int last_arm, double *ts, SL_Jstate *state,
+			   Panda4CmdTraj *traj);
+  void panda4_seqlockBeginWrite(unsigned int *seq);
+  void panda4_seqlockEndWrite(unsigned int *seq);
+
+  // external variables
+  extern Panda4Shm *sm_panda4;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _panda4_shm_ */
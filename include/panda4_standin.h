@@ -0,0 +1,175 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_standin.h
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  A local stand-in for the parts of libfranka that the Panda servo uses,
+  with the same names and signatures. With PANDA4_STANDIN defined, the
+  servo includes this header instead of the libfranka headers and runs
+  without any robot: each franka::Robot drives the control callback from
+  a local 1kHz timer and integrates its arm with the forward dynamics of
+  SL, franka::Model evaluates the SL model of the arm, and franka::Gripper
+  moves with the commanded speed.
+
+  The stand-in robots are addressed as "standin_<arm ID>".
+
+  ============================================================================*/
+
+#ifndef _panda4_standin_
+#define _panda4_standin_
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace franka {
+
+//! time in milliseconds, as in libfranka
+class Duration {
+ public:
+  Duration() noexcept : ms_(0) {}
+  explicit Duration(uint64_t milliseconds) noexcept : ms_(milliseconds) {}
+  double   toSec() const noexcept { return ms_/1000.0; }
+  uint64_t toMSec() const noexcept { return ms_; }
+ private:
+  uint64_t ms_;
+};
+
+enum class RobotMode {
+  kOther,
+  kIdle,
+  kMove,
+  kGuiding,
+  kReflex,
+  kUserStopped,
+  kAutomaticErrorRecovery
+};
+
+//! the subset of the libfranka robot state that the servo uses or records
+struct RobotState {
+  std::array<double, 16> O_T_EE{};
+  std::array<double, 7>  q{};
+  std::array<double, 7>  q_d{};
+  std::array<double, 7>  dq{};
+  std::array<double, 7>  dq_d{};
+  std::array<double, 7>  tau_J{};
+  std::array<double, 7>  dtau_J{};
+  std::array<double, 7>  tau_ext_hat_filtered{};
+  std::array<double, 6>  K_F_ext_hat_K{};
+  double                 control_command_success_rate{};
+  RobotMode              robot_mode{RobotMode::kIdle};
+  Duration               time{};
+};
+
+struct Finishable {
+  bool motion_finished = false;
+};
+
+class Torques : public Finishable {
+ public:
+  Torques(const std::array<double, 7>& torques) noexcept : tau_J(torques) {}
+  Torques(std::initializer_list<double> torques);
+  std::array<double, 7> tau_J{};
+};
+
+template <typename T>
+inline T MotionFinished(T command) noexcept {
+  command.motion_finished = true;
+  return command;
+}
+
+struct Exception : public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+struct CommandException : public Exception {
+  using Exception::Exception;
+};
+struct ControlException : public Exception {
+  using Exception::Exception;
+};
+struct NetworkException : public Exception {
+  using Exception::Exception;
+};
+
+constexpr double kMaxCutoffFrequency     = 1000.0;
+constexpr double kDefaultCutoffFrequency = 100.0;
+
+//! the SL model of one arm
+class Model {
+ public:
+  explicit Model(int arm) : arm_(arm) {}
+  std::array<double, 7>  gravity(const RobotState& state) const;
+  std::array<double, 7>  coriolis(const RobotState& state) const;
+  std::array<double, 49> mass(const RobotState& state) const;
+ private:
+  int arm_;
+};
+
+//! one arm, simulated with the forward dynamics of SL at 1kHz
+class Robot {
+ public:
+  explicit Robot(const std::string& address);
+  void  control(std::function<Torques(const RobotState&, Duration)> control_callback,
+		bool limit_rate = true,
+		double cutoff_frequency = kDefaultCutoffFrequency);
+  Model loadModel() { return Model(arm_); }
+  void  automaticErrorRecovery() {}
+  void  setCollisionBehavior(const std::array<double, 7>&, const std::array<double, 7>&,
+			     const std::array<double, 6>&, const std::array<double, 6>&) {}
+  void  setJointImpedance(const std::array<double, 7>&) {}
+  void  setCartesianImpedance(const std::array<double, 6>&) {}
+  void  setK(const std::array<double, 16>&) {}
+  void  setEE(const std::array<double, 16>&) {}
+ private:
+  int        arm_;
+  RobotState state_;
+};
+
+struct GripperState {
+  double   width{};
+  double   max_width{0.08};
+  bool     is_grasped{};
+  uint16_t temperature{};
+  Duration time{};
+};
+
+//! a gripper that moves linearly with the commanded speed
+class Gripper {
+ public:
+  explicit Gripper(const std::string& address);
+  bool         homing();
+  bool         move(double width, double speed);
+  bool         grasp(double width, double speed, double force,
+		     double epsilon_inner = 0.005, double epsilon_outer = 0.005);
+  bool         stop();
+  GripperState readOnce() const;
+ private:
+  bool   moveTo(double width, double speed);
+  double widthAt(std::chrono::steady_clock::time_point t) const;
+
+  mutable std::mutex                    mutex_;
+  std::condition_variable               cv_;
+  std::chrono::steady_clock::time_point start_;
+  double                                start_width_;
+  double                                target_width_;
+  double                                speed_;
+  bool                                  moving_;
+  bool                                  stopped_;
+  bool                                  grasped_;
+};
+
+}  // namespace franka
+
+#endif  /* _panda4_standin_ */
@@ -0,0 +1,91 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_startup.h
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  the parallel startup of the Panda servos: a startup barrier of all robot
+  servos of the cell, and a shared-memory cache of the parsed configuration
+  files, such that only the first servo parses them
+
+  ============================================================================*/
+
+#ifndef _panda4_startup_
+#define _panda4_startup_
+
+//! maximal number of configuration files whose parse is cached
+#define N_CONFIG_CACHE_FILES 4
+
+//! the states of the configuration cache, in the low bits of config_lock
+enum ConfigCacheStates {
+  CONFIG_EMPTY=0,
+  CONFIG_LOADING,
+  CONFIG_READY
+};
+#define CONFIG_STATE_BITS 2
+#define CONFIG_STATE_MASK ((1UL<<CONFIG_STATE_BITS)-1)
+
+//! number of stamps per configuration file: mtime in s and ns, inode, size
+#define N_CONFIG_STAMPS 4
+
+//! what panda4_lockConfigCache() asks the caller to do
+enum ConfigCacheActions {
+  CONFIG_LOAD=1,          //!< parse the files and fill the cache
+  CONFIG_CACHED           //!< copy from the cache
+};
+
+//! the parsed configuration that is shared by all Panda servos
+typedef struct {
+  double     joint_trans[N_DOFS+1][8];       //!< slope and offset of th, thd, load, u
+  double     misc_trans[N_MISC_SENSORS+1][2];//!< slope and offset of the misc sensors
+  double     joint_lin_rot[N_DOFS+1][6+1];
+  double     pos_polar[N_DOFS+1];
+  double     load_polar[N_DOFS+1];
+  SL_link    links[N_DOFS+1];                //!< the link parameters
+  double     joint_range[N_DOFS+1][3+1];     //!< the sensor offsets, with the two below
+  SL_DJstate joint_default_state[N_DOFS+1];
+  SL_OJstate joint_opt_state[N_DOFS+1];
+} Panda4ConfigCache;
+
+//! a published parse, double buffered by the parity of the generation
+typedef struct {
+  unsigned int      seq;                     //!< seqlock of the slot
+  long              stamp[N_CONFIG_STAMPS*N_CONFIG_CACHE_FILES]; //!< see N_CONFIG_STAMPS
+  Panda4ConfigCache config;
+} Panda4ConfigSlot;
+
+typedef struct {
+  int               n_servos;                //!< robot servos of the launch, 0 without launcher
+  int               n_ready;                 //!< robot servos that are initialized
+  unsigned long     t_launch;                //!< CLOCK_MONOTONIC time of the launch in ns
+  unsigned long     config_lock;             //!< generation of the owner << CONFIG_STATE_BITS | state
+  Panda4ConfigSlot  config_slot[2];          //!< indexed by the generation & 1
+} Panda4Startup;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  // function prototypes
+  int    panda4_initStartup(void);
+  void   panda4_launchServos(int n_servos);
+  void   panda4_servoReady(void);
+  int    panda4_waitForServos(double timeout);
+  double panda4_launchTime(void);
+  int    panda4_lockConfigCache(char files[][100], int n_files, double timeout,
+				Panda4ConfigCache *config);
+  void   panda4_unlockConfigCache(int ok, Panda4ConfigCache *config);
+
+  // external variables
+  extern Panda4Startup *sm_panda4_startup;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _panda4_startup_ */
@@ -0,0 +1,80 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_telemetry.h
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  shared-memory telemetry of the servo processes: every servo publishes its
+  health counters, the durations of its last tick and a histogram of its
+  periods in its own slot, which xtelemetry displays live
+
+  ============================================================================*/
+
+#ifndef _panda4_telemetry_
+#define _panda4_telemetry_
+
+#include "panda4_timing.h"
+
+//! identifies the layout of the segment, to be incremented with every change
+#define PANDA4_TELEMETRY_MAGIC   0x50346d54
+#define PANDA4_TELEMETRY_VERSION 2
+
+//! number of servo processes that can publish
+#define N_TELEMETRY_SLOTS 8
+
+//! maximal length of the name of a servo process
+#define N_TELEMETRY_NAME 32
+
+//! a period above this multiple of the nominal period is an overrun
+#define TELEMETRY_OVERRUN_FACTOR 1.5
+
+//! the slot of one servo process
+typedef struct {
+  unsigned int  seq;                         //!< odd while being written
+  int           pid;                         //!< the publishing process, 0 if free
+  char          name[N_TELEMETRY_NAME];      //!< the name of the servo
+  int           rate;                        //!< nominal servo rate in Hz
+  double        servo_time;                  //!< servo time of the last tick
+  unsigned long t_update;                    //!< CLOCK_MONOTONIC start of the last tick in ns
+  unsigned long ticks;                       //!< number of ticks
+  unsigned long errors;                      //!< the servo errors of the process
+  unsigned long overruns;                    //!< periods above TELEMETRY_OVERRUN_FACTOR
+  unsigned long last_period_ns;              //!< the last period
+  unsigned long max_period_ns;
+  unsigned long last_busy_ns;                //!< computation time of the last tick
+  unsigned long max_busy_ns;
+  unsigned long period_hist[N_TIMING_BUCKETS]; //!< in the buckets of panda4_timingBucket()
+} Panda4TelemetrySlot;
+
+typedef struct {
+  unsigned int        magic;
+  unsigned int        version;
+  unsigned int        size;                  //!< sizeof(Panda4Telemetry)
+  Panda4TelemetrySlot slot[N_TELEMETRY_SLOTS+1];
+} Panda4Telemetry;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  // function prototypes
+  int           panda4_attachTelemetry(void);
+  int           panda4_initTelemetry(const char *name, int rate);
+  void          panda4_telemetryBeginTick(void);
+  void          panda4_telemetryEndTick(double servo_time, long errors);
+  int           panda4_readTelemetry(int slot, Panda4TelemetrySlot *s);
+  unsigned long panda4_telemetryPercentile(Panda4TelemetrySlot *s, double p);
+
+  // external variables
+  extern Panda4Telemetry *sm_panda4_telemetry;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _panda4_telemetry_ */
@@ -0,0 +1,68 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_timing.h
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  per-stage latency histograms of the Panda servo
+
+  ============================================================================*/
+
+#ifndef _panda4_timing_
+#define _panda4_timing_
+
+//! the timed stages of the torque callback and of the servo
+enum TimingStages {
+  TIMING_MODEL=1,     //!< Franka model evaluation in the callback
+  TIMING_STATE,       //!< extraction of the robot state in the callback
+  TIMING_CALLBACK,    //!< entire torque callback
+  TIMING_TRANSLATE,   //!< translation of the raw sensor values
+  TIMING_PUBLISH,     //!< shared memory publish of state and misc sensors
+  TIMING_FLUSH,       //!< semFlush of the motor servo
+  TIMING_RECEIVE,     //!< reading and translating the commands
+  TIMING_MESSAGES,    //!< checkForMessages
+  TIMING_COLLECT,     //!< writeToBuffer of data collection
+  TIMING_SERVO,       //!< entire run_panda_servo
+
+  N_TIMING_STAGES_PLUS_1
+};
+#define N_TIMING_STAGES (N_TIMING_STAGES_PLUS_1-1)
+
+//! histograms have 16 sub-buckets per power of two, i.e., a resolution of
+//! 1/16 of the value, and cover up to 2^(N_TIMING_MAGNITUDES+3) ns, i.e.,
+//! about 2s for the periods of the slowest servo processes
+#define N_TIMING_SUB_BUCKETS 16
+#define N_TIMING_MAGNITUDES  28
+#define N_TIMING_BUCKETS     (N_TIMING_MAGNITUDES*N_TIMING_SUB_BUCKETS)
+
+//! number of recent ticks whose stage durations are kept for fault analysis
+#define N_TIMING_RECENT 64
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  // function prototypes
+  void          panda4_initTiming(void);
+  unsigned long panda4_timeNs(void);
+  int           panda4_timingBucket(unsigned long ns);
+  unsigned long panda4_timingBucketValue(int b);
+  void          panda4_addTiming(int arm, int stage, unsigned long ns);
+  void          panda4_endTimingTick(int arm);
+  void          panda4_printTiming(void);
+  int           panda4_dumpTiming(char *fname);
+  int           panda4_worstTimingStage(int arm, unsigned long *ns);
+
+  // external variables
+  extern char   timing_stage_names[][20];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _panda4_timing_ */
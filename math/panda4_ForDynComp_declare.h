@@ -87,6 +87,10 @@ double  rseff4a2;
 double  rceff4a2;
 double  rseff4a3;
 double  rceff4a3;
+double  effsin[N_ENDEFFS+1][N_CART+1];
+double  effcos[N_ENDEFFS+1][N_CART+1];
+int     effcached;
+extern int getEndeffectorSinCos(SL_endeff *eff, double s[][N_CART+1], double c[][N_CART+1]);
 
 double  S00[3+1][3+1];
 double  S10[3+1][3+1];
@@ -87,6 +87,7 @@ cstate28th=Cos(state[28].th);
 
 
 /* rotation matrix sine and cosine precomputation */
+effcached=getEndeffectorSinCos(eff,effsin,effcos);
 rsA1G=Sin(A1G);
 rcA1G=Cos(A1G);
 
@@ -97,14 +98,14 @@ rcA1G=Cos(A1G);
 
 
 
-rseff1a1=Sin(eff[1].a[1]);
-rceff1a1=Cos(eff[1].a[1]);
+rseff1a1=(effcached ? effsin[1][1] : Sin(eff[1].a[1]));
+rceff1a1=(effcached ? effcos[1][1] : Cos(eff[1].a[1]));
 
-rseff1a2=Sin(eff[1].a[2]);
-rceff1a2=Cos(eff[1].a[2]);
+rseff1a2=(effcached ? effsin[1][2] : Sin(eff[1].a[2]));
+rceff1a2=(effcached ? effcos[1][2] : Cos(eff[1].a[2]));
 
-rseff1a3=Sin(eff[1].a[3]);
-rceff1a3=Cos(eff[1].a[3]);
+rseff1a3=(effcached ? effsin[1][3] : Sin(eff[1].a[3]));
+rceff1a3=(effcached ? effcos[1][3] : Cos(eff[1].a[3]));
 
 
 rsA2G=Sin(A2G);
@@ -117,14 +118,14 @@ rcA2G=Cos(A2G);
 
 
 
-rseff2a1=Sin(eff[2].a[1]);
-rceff2a1=Cos(eff[2].a[1]);
+rseff2a1=(effcached ? effsin[2][1] : Sin(eff[2].a[1]));
+rceff2a1=(effcached ? effcos[2][1] : Cos(eff[2].a[1]));
 
-rseff2a2=Sin(eff[2].a[2]);
-rceff2a2=Cos(eff[2].a[2]);
+rseff2a2=(effcached ? effsin[2][2] : Sin(eff[2].a[2]));
+rceff2a2=(effcached ? effcos[2][2] : Cos(eff[2].a[2]));
 
-rseff2a3=Sin(eff[2].a[3]);
-rceff2a3=Cos(eff[2].a[3]);
+rseff2a3=(effcached ? effsin[2][3] : Sin(eff[2].a[3]));
+rceff2a3=(effcached ? effcos[2][3] : Cos(eff[2].a[3]));
 
 
 rsA3G=Sin(A3G);
@@ -137,14 +138,14 @@ rcA3G=Cos(A3G);
 
 
 
-rseff3a1=Sin(eff[3].a[1]);
-rceff3a1=Cos(eff[3].a[1]);
+rseff3a1=(effcached ? effsin[3][1] : Sin(eff[3].a[1]));
+rceff3a1=(effcached ? effcos[3][1] : Cos(eff[3].a[1]));
 
-rseff3a2=Sin(eff[3].a[2]);
-rceff3a2=Cos(eff[3].a[2]);
+rseff3a2=(effcached ? effsin[3][2] : Sin(eff[3].a[2]));
+rceff3a2=(effcached ? effcos[3][2] : Cos(eff[3].a[2]));
 
-rseff3a3=Sin(eff[3].a[3]);
-rceff3a3=Cos(eff[3].a[3]);
+rseff3a3=(effcached ? effsin[3][3] : Sin(eff[3].a[3]));
+rceff3a3=(effcached ? effcos[3][3] : Cos(eff[3].a[3]));
 
 
 rsA4G=Sin(A4G);
@@ -157,14 +158,14 @@ rcA4G=Cos(A4G);
 
 
 
-rseff4a1=Sin(eff[4].a[1]);
-rceff4a1=Cos(eff[4].a[1]);
+rseff4a1=(effcached ? effsin[4][1] : Sin(eff[4].a[1]));
+rceff4a1=(effcached ? effcos[4][1] : Cos(eff[4].a[1]));
 
-rseff4a2=Sin(eff[4].a[2]);
-rceff4a2=Cos(eff[4].a[2]);
+rseff4a2=(effcached ? effsin[4][2] : Sin(eff[4].a[2]));
+rceff4a2=(effcached ? effcos[4][2] : Cos(eff[4].a[2]));
 
-rseff4a3=Sin(eff[4].a[3]);
-rceff4a3=Cos(eff[4].a[3]);
+rseff4a3=(effcached ? effsin[4][3] : Sin(eff[4].a[3]));
+rceff4a3=(effcached ? effcos[4][3] : Cos(eff[4].a[3]));
 
 
 
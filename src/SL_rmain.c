@@ -12,6 +12,12 @@
   Entry program for SL actual robot controller -- forks off multiple processes 
   or the different servos
 
+  The Panda robots run by default in one servo process with one control
+  thread per arm. With the "-servo_per_arm" option, or panda_servo_per_arm
+  set to 1 in the parameter pool, every robot runs in its own servo process.
+  All robot servos are started at once and bring up their robots in
+  parallel; they meet at a startup barrier before torque control starts.
+
   ============================================================================*/
 
 // SL general includes of system headers
@@ -26,6 +32,8 @@
 #include "SL_unix_common.h"
 #include "SL_shared_memory.h"
 #include "utility.h"
+#include "SL_user.h"
+#include "panda4_startup.h"
 
 // global variables
 int servo_enabled = FALSE;
@@ -53,7 +61,14 @@ main(int argc, char**argv)
 {
   int no_arm_flag = FALSE;
   int no_hand_flag = FALSE;
+  int servo_per_arm_flag = FALSE;
   int robot_id_argv;
+  int arm;
+  int n_servos;
+  int ival;
+  char key[100];
+  pid_t servo_pids[N_ENDEFFS+1];
+  pid_t pid;
 
 #include "SL_user_main_core.h"
 
@@ -74,6 +89,17 @@ main(int argc, char**argv)
     }
   }
 
+  // check whether every robot runs in its own servo process
+  for (i=1; i<argc; ++i) {
+    if (strcmp(argv[i],"-servo_per_arm")==0) {
+      servo_per_arm_flag = TRUE;
+      break;
+    }
+  }
+  if (read_parameter_pool_int(config_files[PARAMETERPOOL],"panda_servo_per_arm",&ival))
+    if (ival)
+      servo_per_arm_flag = TRUE;
+
   for (i=0; i<c; ++i) 
     argv_ptr[i] = argv_array[i];
   argv_ptr[c] = NULL;
@@ -143,66 +169,57 @@ main(int argc, char**argv)
     semTake(sm_init_process_ready_sem,WAIT_FOREVER);
   }
 
-  // the panda robots
-  if (fork() == 0) {
-    sprintf(argv_ptr[geometry_argv],"90x8+%d+30",display_width-delta_width);
-    if (read_parameter_pool_string(config_files[PARAMETERPOOL], 
-				   "panda_4_servo_geometry", string))
-      if (parseWindowSpecs(string, display_width,display_height,xstring, &x, &y, &w, &h))
-	strcpy(argv_ptr[geometry_argv],xstring);
-    sprintf(argv_ptr[background_argv],"LightGray");
-    sprintf(argv_ptr[servo_argv],"xrprobot");
-    sprintf(argv_ptr[nice_argv],"0");
-    sprintf(argv_ptr[robot_id_argv],"4");    
-    execvp("xterm",argv_ptr);
-    exit(-1);
-  }
-  semTake(sm_init_process_ready_sem,WAIT_FOREVER);
+  // the panda robots: all in one servo, or one servo per robot. All
+  // servos are started at once and report to the startup barrier.
+  n_servos = servo_per_arm_flag ? N_ENDEFFS : 1;
+  panda4_launchServos(n_servos);
 
-  if (fork() == 0) {
-    sprintf(argv_ptr[geometry_argv],"90x8+%d+30",display_width-delta_width);
-    if (read_parameter_pool_string(config_files[PARAMETERPOOL], 
-				   "panda_3_servo_geometry", string))
-      if (parseWindowSpecs(string, display_width,display_height,xstring, &x, &y, &w, &h))
-	strcpy(argv_ptr[geometry_argv],xstring);
-    sprintf(argv_ptr[background_argv],"LightGray");
-    sprintf(argv_ptr[servo_argv],"xrprobot");
-    sprintf(argv_ptr[nice_argv],"0");
-    sprintf(argv_ptr[robot_id_argv],"3");    
-    execvp("xterm",argv_ptr);
-    exit(-1);
-  }
-  semTake(sm_init_process_ready_sem,WAIT_FOREVER);
-  
-  if (fork() == 0) {
-    sprintf(argv_ptr[geometry_argv],"90x8+%d+30",display_width-delta_width);
-    if (read_parameter_pool_string(config_files[PARAMETERPOOL], 
-				   "panda_2_servo_geometry", string))
-      if (parseWindowSpecs(string, display_width,display_height,xstring, &x, &y, &w, &h))
-	strcpy(argv_ptr[geometry_argv],xstring);
-    sprintf(argv_ptr[background_argv],"LightGray");
-    sprintf(argv_ptr[servo_argv],"xrprobot");
-    sprintf(argv_ptr[nice_argv],"0");
-    sprintf(argv_ptr[robot_id_argv],"2");        
-    execvp("xterm",argv_ptr);
-    exit(-1);
+  if (!servo_per_arm_flag) {
+    if ((servo_pids[1]=fork()) == 0) {
+      sprintf(argv_ptr[geometry_argv],"90x8+%d+30",display_width-delta_width);
+      if (read_parameter_pool_string(config_files[PARAMETERPOOL], 
+				     "panda_servo_geometry", string))
+	if (parseWindowSpecs(string, display_width,display_height,xstring, &x, &y, &w, &h))
+	  strcpy(argv_ptr[geometry_argv],xstring);
+      sprintf(argv_ptr[background_argv],"LightGray");
+      sprintf(argv_ptr[servo_argv],"xrprobot");
+      sprintf(argv_ptr[nice_argv],"0");
+      sprintf(argv_ptr[robot_id_argv],"0");    
+      execvp("xterm",argv_ptr);
+      exit(-1);
+    }
+  } else {
+    for (arm=N_ENDEFFS; arm>=1; --arm) {
+      if ((servo_pids[arm]=fork()) == 0) {
+	sprintf(argv_ptr[geometry_argv],"90x8+%d+30",display_width-delta_width);
+	sprintf(key,"panda_%d_servo_geometry",arm);
+	if (read_parameter_pool_string(config_files[PARAMETERPOOL],key,string))
+	  if (parseWindowSpecs(string, display_width,display_height,xstring, &x, &y, &w, &h))
+	    strcpy(argv_ptr[geometry_argv],xstring);
+	sprintf(argv_ptr[background_argv],"LightGray");
+	sprintf(argv_ptr[servo_argv],"xrprobot");
+	sprintf(argv_ptr[nice_argv],"0");
+	sprintf(argv_ptr[robot_id_argv],"%d",arm);    
+	execvp("xterm",argv_ptr);
+	exit(-1);
+      }
+    }
   }
-  semTake(sm_init_process_ready_sem,WAIT_FOREVER);  
 
-  if (fork() == 0) {
-    sprintf(argv_ptr[geometry_argv],"90x8+%d+30",display_width-delta_width);
-    if (read_parameter_pool_string(config_files[PARAMETERPOOL], 
-				   "panda_1_servo_geometry", string))
-      if (parseWindowSpecs(string, display_width,display_height,xstring, &x, &y, &w, &h))
-	strcpy(argv_ptr[geometry_argv],xstring);
-    sprintf(argv_ptr[background_argv],"LightGray");
-    sprintf(argv_ptr[servo_argv],"xrprobot");
-    sprintf(argv_ptr[nice_argv],"0");
-    sprintf(argv_ptr[robot_id_argv],"1");            
-    execvp("xterm",argv_ptr);
-    exit(-1);
+  // wait for all robot servos, and take their ready signals. A servo that
+  // dies before it is ready would never arrive.
+  while (!panda4_waitForServos(1.0)) {
+    for (i=1; i<=n_servos; ++i) {
+      pid = waitpid(servo_pids[i],&stat_loc,WNOHANG);
+      if (pid == servo_pids[i] || (pid < 0 && errno != EINTR)) {
+	printf("Panda servo #%d ended before it was ready -- aborting\n",i);
+	return FALSE;
+      }
+    }
   }
-  semTake(sm_init_process_ready_sem,WAIT_FOREVER);
+  for (i=1; i<=n_servos; ++i)
+    semTake(sm_init_process_ready_sem,NO_WAIT);
+  printf("All %d Panda servos ready after %.2f s\n",n_servos,panda4_launchTime());
 
   // monitor dying child process and kill all other if this happens
   waitpid(0,&stat_loc,options);
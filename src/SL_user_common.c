@@ -22,6 +22,7 @@
 #include "SL_user.h"
 #include "SL_common.h"
 #include "SL_dynamics.h"
+#include "panda4_dynamics.h"
 
 // global variables
 char joint_names[][20]= {
@@ -182,6 +183,22 @@ char misc_sensor_names[][20] = {
 // initialization needs to be done for this mapping
 int  link2endeffmap[] = {0,A1_FLANGE,A2_FLANGE,A3_FLANGE,A4_FLANGE};
 
+/* immutable snapshots of the endeffector parameters and the terms derived
+   from them, double buffered with a seqlock each, such that the threads of
+   a process never see a partial update */
+typedef struct EndeffSnapshot {
+  unsigned int seq;                                       // odd while written
+  int          revision;
+  SL_endeff    eff[N_ENDEFFS+1];
+  double       rot[N_ENDEFFS+1][N_CART+1][N_CART+1];      // flange-to-hand rotations
+  double       sin[N_ENDEFFS+1][N_CART+1];                // of the orientation angles
+  double       cos[N_ENDEFFS+1][N_CART+1];
+} EndeffSnapshot;
+
+// local variables
+static EndeffSnapshot endeff_snap[2];
+static int            endeff_snap_current = 0;  // the buffer readers use
+static int            endeff_revision = 0;
 
 /* the following include must be the last line of the variable declaration section */
 #include "SL_user_common.h"   /* do not erase!!! */
@@ -229,6 +246,201 @@ setDefaultEndeffector(void) {
     endeff[i].a[_G_]  = FL_G;
   }
 
+  endeffChanged();
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  endeffChanged
+\date  Oct. 2026
+   
+\remarks 
+
+publishes a new snapshot of the endeffector parameters and of the
+flange-to-hand rotations derived from them. This is called by the handlers
+that change endeff[], and only from one thread of a process at a time: the
+snapshot is built in the buffer that readers do not use, and then made the
+current one.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void 
+endeffChanged(void) {
+
+  int             i,next;
+  double          s[N_CART+1],c[N_CART+1];
+  EndeffSnapshot *snap;
+
+  next = 1 - __atomic_load_n(&endeff_snap_current,__ATOMIC_RELAXED);
+  snap = &endeff_snap[next];
+
+  __atomic_store_n(&snap->seq,snap->seq+1,__ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  snap->revision = ++endeff_revision;
+  for (i=1; i<=N_ENDEFFS; ++i) {
+    snap->eff[i] = endeff[i];
+
+    s[_A_] = sin(endeff[i].a[_A_]); c[_A_] = cos(endeff[i].a[_A_]);
+    s[_B_] = sin(endeff[i].a[_B_]); c[_B_] = cos(endeff[i].a[_B_]);
+    s[_G_] = sin(endeff[i].a[_G_]); c[_G_] = cos(endeff[i].a[_G_]);
+    memcpy(snap->sin[i],s,sizeof(s));
+    memcpy(snap->cos[i],c,sizeof(c));
+
+    // R = Rx(a)*Ry(b)*Rz(g), as in the generated kinematics
+    snap->rot[i][1][1] =  c[_B_]*c[_G_];
+    snap->rot[i][1][2] = -c[_B_]*s[_G_];
+    snap->rot[i][1][3] =  s[_B_];
+
+    snap->rot[i][2][1] =  c[_G_]*s[_A_]*s[_B_] + c[_A_]*s[_G_];
+    snap->rot[i][2][2] =  c[_A_]*c[_G_] - s[_A_]*s[_B_]*s[_G_];
+    snap->rot[i][2][3] = -c[_B_]*s[_A_];
+
+    snap->rot[i][3][1] = -c[_A_]*c[_G_]*s[_B_] + s[_A_]*s[_G_];
+    snap->rot[i][3][2] =  c[_G_]*s[_A_] + c[_A_]*s[_B_]*s[_G_];
+    snap->rot[i][3][3] =  c[_A_]*c[_B_];
+  }
+
+  __atomic_store_n(&snap->seq,snap->seq+1,__ATOMIC_RELEASE);
+  __atomic_store_n(&endeff_snap_current,next,__ATOMIC_RELEASE);
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  getEndeffectorSnapshot
+\date  Oct. 2026
+   
+\remarks 
+
+copies the endeffector parameters of the current snapshot, i.e., a
+consistent set as of the last endeffChanged(). Threads other than the one
+that changes endeff[] use this copy instead of endeff[].
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[out]    eff : the endeffector parameters (N_ENDEFFS+1)
+
+ returns the revision of the snapshot
+
+ ******************************************************************************/
+int 
+getEndeffectorSnapshot(SL_endeff *eff) {
+
+  unsigned int    seq;
+  int             revision;
+  EndeffSnapshot *snap;
+
+  do {
+    snap = &endeff_snap[__atomic_load_n(&endeff_snap_current,__ATOMIC_ACQUIRE)];
+    seq  = __atomic_load_n(&snap->seq,__ATOMIC_ACQUIRE);
+    memcpy(eff,snap->eff,sizeof(snap->eff));
+    revision = snap->revision;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while ((seq & 1) || __atomic_load_n(&snap->seq,__ATOMIC_RELAXED) != seq);
+
+  return revision;
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  getEndeffectorRotation
+\date  Oct. 2026
+   
+\remarks 
+
+returns the flange-to-hand rotation of an endeffector from the current
+snapshot, if the snapshot was computed from the given orientation angles.
+This is the case for endeff[] and its snapshots, unless endeff[] was
+changed without endeffChanged(), e.g., by the SL core in a process without
+a message handler for it. The caller then computes the rotation itself.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     i : the endeffector ID
+ \param[in]     a : the orientation angles of this endeffector
+ \param[out]    R : the rotation matrix
+
+ returns TRUE if R was taken from the snapshot
+
+ ******************************************************************************/
+int 
+getEndeffectorRotation(int i, double *a, double R[][N_CART+1]) {
+
+  unsigned int    seq;
+  int             ok;
+  EndeffSnapshot *snap;
+
+  do {
+    snap = &endeff_snap[__atomic_load_n(&endeff_snap_current,__ATOMIC_ACQUIRE)];
+    seq  = __atomic_load_n(&snap->seq,__ATOMIC_ACQUIRE);
+    ok   = (snap->revision > 0 &&
+	    snap->eff[i].a[_A_] == a[_A_] &&
+	    snap->eff[i].a[_B_] == a[_B_] &&
+	    snap->eff[i].a[_G_] == a[_G_]);
+    if (ok)
+      memcpy(&R[1][0],&snap->rot[i][1][0],N_CART*(N_CART+1)*sizeof(double));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while ((seq & 1) || __atomic_load_n(&snap->seq,__ATOMIC_RELAXED) != seq);
+
+  return ok;
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  getEndeffectorSinCos
+\date  Oct. 2026
+   
+\remarks 
+
+returns the sines and cosines of the orientation angles of all
+endeffectors from the current snapshot, if the given endeffectors have the
+angles of the snapshot. The generated kernels use them instead of
+computing 24 sine and cosine terms per call.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     eff : the endeffector parameters the kernel is called with
+ \param[out]    s   : the sines of the angles
+ \param[out]    c   : the cosines of the angles
+
+ returns TRUE if s and c were taken from the snapshot
+
+ ******************************************************************************/
+int 
+getEndeffectorSinCos(SL_endeff *eff, double s[][N_CART+1], double c[][N_CART+1]) {
+
+  int             i,j;
+  unsigned int    seq;
+  int             ok;
+  EndeffSnapshot *snap;
+
+  do {
+    snap = &endeff_snap[__atomic_load_n(&endeff_snap_current,__ATOMIC_ACQUIRE)];
+    seq  = __atomic_load_n(&snap->seq,__ATOMIC_ACQUIRE);
+    ok   = (snap->revision > 0);
+    for (i=1; i<=N_ENDEFFS && ok; ++i)
+      for (j=_A_; j<=_G_; ++j)
+	ok = ok && snap->eff[i].a[j] == eff[i].a[j];
+    if (ok) {
+      memcpy(s,snap->sin,sizeof(snap->sin));
+      memcpy(c,snap->cos,sizeof(snap->cos));
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while ((seq & 1) || __atomic_load_n(&snap->seq,__ATOMIC_RELAXED) != seq);
+
+  return ok;
+
 }
 
 /*!*****************************************************************************
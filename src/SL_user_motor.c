@@ -18,7 +18,10 @@
 
 /* user specific headers */
 #include "SL.h"
+#include "SL_common.h"
 #include "SL_motor_servo.h"
+#include "SL_man.h"
+#include "panda4_rt.h"
 
 /* global variables */
 
@@ -51,6 +54,15 @@ init_user_motor(void)
   
   int i,j,n;
 
+  // the real-time profile of the motor servo: this thread runs the servo,
+  // and the command line thread of the SL core is moved off its CPU
+  if (real_robot_flag) {
+    panda4_initRTProfile("xmotor");
+    panda4_rtOtherThreads(RT_ROLE_CLI);
+    panda4_rtThread(RT_ROLE_SERVO,-1);
+    panda4_rtReport();
+    addToMan("rtReport","prints the real-time profile of all threads",panda4_rtReport);
+  }
 
   return TRUE;
 }
@@ -27,12 +27,25 @@
 #include "SL_shared_memory.h"
 #include "SL_motor_servo.h"
 #include "SL_dynamics.h"
+#include "SL_man.h"
+#include "SL_collect_data.h"
+#include "panda4_dynamics.h"
+#include "panda4_shm.h"
+#include "panda4_telemetry.h"
 
 #define TIME_OUT_NS  1000000000
 
 // local variables
 static double uff_complete[N_DOFS+1];
 
+// the command trajectories for the interpolation in the Panda servo, if
+// this servo runs slower than the robot
+static Panda4CmdTraj cmd_traj[N_DOFS+1];
+static double        cmd_gain_th[N_DOFS_PER_ROBOT+1]; // gains of the local PD
+static double        cmd_gain_thd[N_DOFS_PER_ROBOT+1];
+static double        last_u_nopd[N_DOFS+1];           // last command without the local PD
+static double        last_cmd_ts = -1;
+
 // external variables
 extern int           motor_servo_errors;
 
@@ -42,6 +55,7 @@ extern int           motor_servo_errors;
 static int receive_sim_state(void);
 static int receive_misc_sensors(void);
 static int send_des_command(void);
+static void compute_command_trajectory(void);
 
 /*!*****************************************************************************
  *******************************************************************************
@@ -63,6 +77,26 @@ init_user_sensor_processing(void)
 {
   int i,j;
 
+  // the real robot exchanges state and commands with the Panda servo(s)
+  // through seqlock-protected shared memory
+  if (real_robot_flag) {
+    if (!panda4_initSharedState())
+      return FALSE;
+    panda4_addClockVarsToCollect();
+    addToMan("armClocks","prints the sample alignment and clock drift of the arms",
+	     panda4_printClockStats);
+    addToMan("resetArmClocks","clears the arm clock statistics",panda4_resetClockStats);
+
+    // the optional local PD of the Panda servo between the ticks of this servo
+    read_parameter_pool_double_array(config_files[PARAMETERPOOL],"panda_cmd_gain_th",
+				     N_DOFS_PER_ROBOT,cmd_gain_th);
+    read_parameter_pool_double_array(config_files[PARAMETERPOOL],"panda_cmd_gain_thd",
+				     N_DOFS_PER_ROBOT,cmd_gain_thd);
+  }
+
+  // the health counters for xtelemetry
+  panda4_initTelemetry("xmotor",servo_base_rate);
+
   return TRUE;
 }
 
@@ -88,6 +122,8 @@ read_user_sensors(SL_Jstate *raw,double *misc_raw)
 {
   int i,j;
 
+  panda4_telemetryBeginTick();
+
   // get simulated sensory data 
   if (!receive_sim_state())
     printf("Time out on receive_sim_state\n");
@@ -153,6 +189,8 @@ send_user_commands(SL_Jstate *command)
   for (i=1; i<=N_DOFS; ++i)
     command[i].u = command[i].uff+command[i].ufb;
 
+  panda4_telemetryEndTick(motor_servo_time,motor_servo_errors);
+
   return TRUE;
 }
 
@@ -163,7 +201,9 @@ send_user_commands(SL_Jstate *command)
    
 \remarks 
 
-        recieves the entire joint_sim_state from shared memory
+        recieves the entire joint_sim_state from shared memory. For the
+        real robot, the latest complete state of every arm is read
+        without locking, which also includes the misc sensors.
 	
 
  *******************************************************************************
@@ -177,6 +217,28 @@ receive_sim_state(void)
 {
   
   int i;
+  double ts;
+
+  if (real_robot_flag) {
+    int            rc = TRUE;
+    int            valid[N_ARMS+1];
+    Panda4ArmStamp stamps[N_ARMS+1];
+
+    for (i=1; i<=N_ARMS; ++i) {
+      valid[i] = panda4_readArmState(i,&ts,&stamps[i],joint_sim_state,misc_sim_sensor);
+      if (!valid[i]) {
+	++motor_servo_errors;
+	rc = FALSE;
+      } else if (i == PANDA4_MASTER_ARM) {
+	motor_servo_time = servo_time = ts;
+      }
+    }
+
+    // how old the sample of every arm is in this tick
+    panda4_alignArms(stamps,valid);
+
+    return rc;
+  }
 
   if (semTake(sm_joint_sim_state_sem,ns2ticks(TIME_OUT_NS)) == ERROR) {
     
@@ -222,6 +284,10 @@ receive_misc_sensors(void)
   if (n_misc_sensors <= 0)
     return TRUE;
 
+  // the real robot misc sensors are read in receive_sim_state()
+  if (real_robot_flag)
+    return TRUE;
+
   if (semTake(sm_misc_sim_sensor_sem,ns2ticks(TIME_OUT_NS)) == ERROR) {
     
     ++motor_servo_errors;
@@ -245,7 +311,7 @@ receive_misc_sensors(void)
 \remarks 
 
         send the commands from the joint_sim_state shared memory
-        structure
+        structure, or the seqlock-protected commands for the real robot
 	
 
  *******************************************************************************
@@ -261,6 +327,18 @@ send_des_command(void)
   int i;
   extern double *upd;
 
+  // the real robot reads the commands lock-free, with command trajectories
+  // if the robot runs faster than this servo
+  if (real_robot_flag) {
+    if (PANDA_ROBOT_RATE > servo_base_rate) {
+      compute_command_trajectory();
+      panda4_writeCommands(motor_servo_time,joint_sim_state,joint_des_state,cmd_traj);
+    } else {
+      panda4_writeCommands(motor_servo_time,joint_sim_state,joint_des_state,NULL);
+    }
+    return TRUE;
+  }
+
   if (semTake(sm_des_commands_sem,ns2ticks(TIME_OUT_NS)) == ERROR) {
     
     ++motor_servo_errors;
@@ -283,6 +361,60 @@ send_des_command(void)
   return TRUE;
 }
 
+/*!*****************************************************************************
+ *******************************************************************************
+\note  compute_command_trajectory
+\date  Oct. 2026
+   
+\remarks 
+
+        the command trajectories that the Panda servo interpolates until
+        the next command of this servo. The trajectory carries the joint
+        state that the command answers, such that the local PD of the
+        Panda servo reproduces the command for this state exactly and only
+        corrects the motion since then at the robot rate. The part of the
+        command that is not produced by the local PD continues with the
+        slope of the last period. Without gains of the local PD, this is
+        torque plus slope.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+ ******************************************************************************/
+static void
+compute_command_trajectory(void)
+{
+  int            i,j;
+  double         u_nopd;
+  double         dt = motor_servo_time - last_cmd_ts;
+  int            slope = last_cmd_ts >= 0 && dt > 0 && dt < 1.5/(double)servo_base_rate;
+  Panda4CmdTraj *c;
+
+  for (i=1; i<=N_DOFS; ++i) {
+    j = (i-1)%N_DOFS_PER_ROBOT+1;
+    c = &cmd_traj[i];
+
+    c->u0       = joint_sim_state[i].u;
+    c->th       = joint_state[i].th;
+    c->thd      = joint_state[i].thd;
+    c->thd_des  = joint_des_state[i].thd;
+    c->gain_th  = cmd_gain_th[j];
+    c->gain_thd = cmd_gain_thd[j];
+
+    // after a missed tick, the slope is unknown
+    u_nopd      = c->u0
+      - c->gain_th*(joint_des_state[i].th - c->th)
+      - c->gain_thd*(c->thd_des - c->thd);
+    c->du       = slope ? (u_nopd - last_u_nopd[i])/dt : 0.0;
+    last_u_nopd[i] = u_nopd;
+  }
+
+  last_cmd_ts = motor_servo_time;
+
+}
+
 /*!*****************************************************************************
  *******************************************************************************
 \note  user_controller
@@ -325,7 +457,7 @@ user_controller(double *u, double *ufb, double *uff)
       js_des_local[i].thdd = 0.0;
     }
     
-    SL_InvDynNE_Gravity(js_local,js_des_local,endeff,&base_state,&base_orient,gravity);
+    panda4_InvDynNE(js_local,js_des_local,endeff,&base_state,&base_orient,gravity);
     
     for (i=1; i<=N_DOFS; ++i) {
       u[i] += js_des_local[i].uff;
@@ -368,4 +500,9 @@ userCheckForMessage(char *name, int k)
 {
   int i,j;
 
+  // the SL core applies the new endeffector parameters, and this publishes
+  // the snapshot of them for the dynamics kernels
+  if (strcmp(name,"changeEndeffector") == 0)
+    endeffChanged();
+
 }
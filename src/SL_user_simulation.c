@@ -29,12 +29,21 @@
 #include "mdefs.h"
 #include "SL_dynamics.h"
 #include "SL_shared_memory.h"
+#include "panda4_messages.h"
+#include "panda4_telemetry.h"
 
 /* global variables */
 
 /* local variables */
+static Panda4MessageTable sim_messages;
+static int gripper_indices[] = {0,A1_G_WIDTH,A2_G_WIDTH,A3_G_WIDTH,A4_G_WIDTH};
   
 /* local functions */
+static void msgGraspGripper(const float *buf, int arm);
+static void msgMoveGripper(const float *buf, int arm);
+static void msgStopGripper(const float *buf, int arg);
+static void msgFTContact(const float *buf, int arg);
+static void msgChangeEndeffector(const float *buf, int arg);
 
 /* external functions */
 
@@ -60,6 +69,7 @@ init_user_simulation(void)
 {
   
   int i,j,n;
+  char string[20];
 
   // initalize objects in the environment
   readObjects(config_files[OBJECTS]);
@@ -76,7 +86,23 @@ init_user_simulation(void)
 
   // zero the state of the robot
   reset();
-  
+
+  // messages of the gripper of each arm, and of all grippers
+  panda4_initMessages(&sim_messages);
+  panda4_addMessage(&sim_messages,"graspGripper",msgGraspGripper,0);
+  panda4_addMessage(&sim_messages,"moveGripper",msgMoveGripper,0);
+  panda4_addMessage(&sim_messages,"stopGripper",msgStopGripper,0);
+  for (i=1; i<=N_ARMS; ++i) {
+    sprintf(string,"graspGripperA%d",i);
+    panda4_addMessage(&sim_messages,string,msgGraspGripper,i);
+    sprintf(string,"moveGripperA%d",i);
+    panda4_addMessage(&sim_messages,string,msgMoveGripper,i);
+  }
+  panda4_addMessage(&sim_messages,"changeEndeffector",msgChangeEndeffector,0);
+  panda4_addMessage(&sim_messages,"ftContact",msgFTContact,0);
+
+  // the health counters for xtelemetry
+  panda4_initTelemetry("xsimulation",servo_base_rate);
 
   return TRUE;
 }
@@ -115,6 +141,8 @@ run_user_simulation(void)
   int           c_m_indices[] = {0,A1_C_MX,A2_C_MX,A3_C_MX,A4_C_MX};
   int           flange_indices[] = {0,A1_FLANGE,A2_FLANGE,A3_FLANGE,A4_FLANGE};
 
+  panda4_telemetryBeginTick();
+
   // loop over all endeffectors
   for (k=1; k<=N_ENDEFFS; ++k) {
   
@@ -171,8 +199,8 @@ run_user_simulation(void)
     }
 
   }
-  
-  
+
+  panda4_telemetryEndTick(servo_time,0);
   
   return TRUE;
 }
@@ -197,117 +225,128 @@ run_user_simulation(void)
 void
 userCheckForMessage(char *name, int k)
 {
-  int i,j;
-  double width,speed,force,eps_in,eps_out; //grasp parameters
 
-  if (strcmp(name,"graspGripperA1") == 0) { // trigger a grasp movement
-    float  buf[5+1];
-    
-    memcpy(&(buf[1]),sm_simulation_message->buf+sm_simulation_message->moff[k],
-	   sizeof(float)*(5));
-      j = 0;
-      width   = buf[++j];
-      speed   = buf[++j];
-      force   = buf[++j];
-      eps_in  = buf[++j];
-      eps_out = buf[++j];
-
-      misc_sim_sensor[A1_G_WIDTH] = width;
-      
-    // -------------------------------------------------------------------------
-    } else if (strcmp(name,"moveGripperA1") == 0) { // trigger a gripper movement
-      float  buf[2+1];
-      
-      memcpy(&(buf[1]),sm_simulation_message->buf+sm_simulation_message->moff[k],
-	     sizeof(float)*(2));
-      j = 0;
-      width   = buf[++j];
-      speed   = buf[++j];
-
-      misc_sim_sensor[A1_G_WIDTH] = width;
-
-    // -------------------------------------------------------------------------      
-    } else if (strcmp(name,"graspGripperA2") == 0) { // trigger a grasp movement
-    float  buf[5+1];
-    
-    memcpy(&(buf[1]),sm_simulation_message->buf+sm_simulation_message->moff[k],
-	   sizeof(float)*(5));
-      j = 0;
-      width   = buf[++j];
-      speed   = buf[++j];
-      force   = buf[++j];
-      eps_in  = buf[++j];
-      eps_out = buf[++j];
-
-      misc_sim_sensor[A2_G_WIDTH] = width;
-      
-    // -------------------------------------------------------------------------
-    } else if (strcmp(name,"moveGripperA2") == 0) { // trigger a gripper movement
-      float  buf[2+1];
-      
-      memcpy(&(buf[1]),sm_simulation_message->buf+sm_simulation_message->moff[k],
-	     sizeof(float)*(2));
-      j = 0;
-      width   = buf[++j];
-      speed   = buf[++j];
-
-      misc_sim_sensor[A2_G_WIDTH] = width;
-
-    // -------------------------------------------------------------------------      
-    } else if (strcmp(name,"graspGripperA3") == 0) { // trigger a grasp movement
-    float  buf[5+1];
-    
-    memcpy(&(buf[1]),sm_simulation_message->buf+sm_simulation_message->moff[k],
-	   sizeof(float)*(5));
-      j = 0;
-      width   = buf[++j];
-      speed   = buf[++j];
-      force   = buf[++j];
-      eps_in  = buf[++j];
-      eps_out = buf[++j];
-
-      misc_sim_sensor[A3_G_WIDTH] = width;
-      
-    // -------------------------------------------------------------------------
-    } else if (strcmp(name,"moveGripperA3") == 0) { // trigger a gripper movement
-      float  buf[2+1];
-      
-      memcpy(&(buf[1]),sm_simulation_message->buf+sm_simulation_message->moff[k],
-	     sizeof(float)*(2));
-      j = 0;
-      width   = buf[++j];
-      speed   = buf[++j];
-
-      misc_sim_sensor[A3_G_WIDTH] = width;
-
-    // -------------------------------------------------------------------------      
-    } else if (strcmp(name,"graspGripperA4") == 0) { // trigger a grasp movement
-    float  buf[5+1];
-    
-    memcpy(&(buf[1]),sm_simulation_message->buf+sm_simulation_message->moff[k],
-	   sizeof(float)*(5));
-      j = 0;
-      width   = buf[++j];
-      speed   = buf[++j];
-      force   = buf[++j];
-      eps_in  = buf[++j];
-      eps_out = buf[++j];
-
-      misc_sim_sensor[A4_G_WIDTH] = width;
-      
-    // -------------------------------------------------------------------------
-    } else if (strcmp(name,"moveGripperA4") == 0) { // trigger a gripper movement
-      float  buf[2+1];
-      
-      memcpy(&(buf[1]),sm_simulation_message->buf+sm_simulation_message->moff[k],
-	     sizeof(float)*(2));
-      j = 0;
-      width   = buf[++j];
-      speed   = buf[++j];
-
-      misc_sim_sensor[A4_G_WIDTH] = width;
+  panda4_dispatchMessage(&sim_messages,name,k);
 
-    }
-    // ---------------------------------------------------------------------------
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  msgGraspGripper
+\date  Oct. 2026
+   
+\remarks 
+
+          a grasp of the simulated gripper reaches the commanded width at once
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     buf : width, speed, force, eps_in, eps_out
+ \param[in]     arm : the arm ID, or 0 for all arms
+
+ ******************************************************************************/
+static void
+msgGraspGripper(const float *buf, int arm)
+{
+  int i;
+
+  for (i=1; i<=N_ARMS; ++i)
+    if (arm == 0 || arm == i)
+      misc_sim_sensor[gripper_indices[i]] = buf[0];
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  msgMoveGripper
+\date  Oct. 2026
+   
+\remarks 
+
+          a move of the simulated gripper reaches the commanded width at once
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     buf : width, speed
+ \param[in]     arm : the arm ID, or 0 for all arms
+
+ ******************************************************************************/
+static void
+msgMoveGripper(const float *buf, int arm)
+{
+  int i;
 
+  for (i=1; i<=N_ARMS; ++i)
+    if (arm == 0 || arm == i)
+      misc_sim_sensor[gripper_indices[i]] = buf[0];
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  msgChangeEndeffector
+\date  Oct. 2026
+   
+\remarks 
+
+          the SL core applies the new endeffector parameters, and this
+          publishes the snapshot of them for the dynamics kernels
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     buf : the message data (not used)
+ \param[in]     arg : not used
+
+ ******************************************************************************/
+static void
+msgChangeEndeffector(const float *buf, int arg)
+{
+  endeffChanged();
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  msgStopGripper
+\date  Oct. 2026
+   
+\remarks 
+
+          the simulated gripper reaches its commanded width at once, such
+          that there is no motion to stop
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     buf : empty
+ \param[in]     arg : not used
+
+ ******************************************************************************/
+static void
+msgStopGripper(const float *buf, int arg)
+{
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  msgFTContact
+\date  Oct. 2026
+   
+\remarks 
+
+          the simulated F/T sensors have no bias, such that there is no bias
+          estimate to suspend during contact
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     buf : the arm ID (0 for all arms), TRUE for contact
+ \param[in]     arg : not used
+
+ ******************************************************************************/
+static void
+msgFTContact(const float *buf, int arg)
+{
 }
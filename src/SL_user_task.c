@@ -24,17 +24,31 @@
 #include "utility.h"
 #include "mdefs.h"
 #include "SL_dynamics.h"
+#include "SL_kinematics.h"
 #include "SL_shared_memory.h"
 #include "SL_man.h"
+#include "SL_collect_data.h"
+#include "panda4_dynamics.h"
+#include "panda4_rt.h"
+#include "panda4_telemetry.h"
 
 // global variables
 
 // local variables
+static double arm_com[N_ARMS+1][N_CART+1];     // COM of each arm
+static double cell_com[N_CART+1];              // COM of all arms
+static double cell_momentum[2*N_CART+1];       // centroidal momentum of all arms
   
 // local functions
 static void grasp(void);
 static void move(void);
+static void stopGripper(void);
 static void printDyn(void);
+static void printKin(void);
+static void benchFK(void);
+
+// external variables
+extern int    task_servo_errors;
 
 // external functions
 
@@ -60,6 +74,43 @@ init_user_task(void)
 {
   
   int i,j;
+  char string[100];
+
+  // the arm and cell COMs and the cell momentum are logged every tick
+  for (i=1; i<=N_ARMS; ++i) {
+    for (j=1; j<=N_CART; ++j) {
+      sprintf(string,"A%d_com_%s",i,cart_names[j]);
+      addVarToCollect((char *)&(arm_com[i][j]),string,"m", DOUBLE,FALSE);
+    }
+  }
+
+  for (j=1; j<=N_CART; ++j) {
+    sprintf(string,"cell_com_%s",cart_names[j]);
+    addVarToCollect((char *)&(cell_com[j]),string,"m", DOUBLE,FALSE);
+    sprintf(string,"cell_k_%s",cart_names[j]);
+    addVarToCollect((char *)&(cell_momentum[j]),string,"Nms", DOUBLE,FALSE);
+    sprintf(string,"cell_l_%s",cart_names[j]);
+    addVarToCollect((char *)&(cell_momentum[N_CART+j]),string,"Ns", DOUBLE,FALSE);
+  }
+
+  // the real-time profile of the task servo, as for the motor servo
+  if (real_robot_flag) {
+    panda4_initRTProfile("xtask");
+    panda4_rtOtherThreads(RT_ROLE_CLI);
+    panda4_rtThread(RT_ROLE_SERVO,-1);
+    panda4_rtReport();
+    addToMan("rtReport","prints the real-time profile of all threads",panda4_rtReport);
+  }
+
+  // the health counters for xtelemetry
+  panda4_initTelemetry("xtask",task_servo_rate);
+
+  addToMan("move","executes a gripper move manually",move);
+  addToMan("grasp","executes a gripper grasp manually",grasp);
+  addToMan("stopGripper","stops a gripper move or grasp",stopGripper);
+  addToMan("printDyn","prints the dynamics parameters",printDyn);
+  addToMan("printKin","prints the endeffector kinematics",printKin);
+  addToMan("benchFK","measures the throughput of the batched kinematics",benchFK);
 
   return TRUE;
 }
@@ -86,9 +137,11 @@ run_user_task(void)
   
   int i,j;
 
-  addToMan("move","executes a gripper move manually",move); 
-  addToMan("grasp","executes a gripper grasp manually",grasp);
-  addToMan("printDyn","prints the dynamics parameters",printDyn);
+  panda4_telemetryBeginTick();
+
+  panda4_Centroidal(joint_state,endeff,NULL,cell_com,cell_momentum,arm_com);
+
+  panda4_telemetryEndTick(task_servo_time,task_servo_errors);
   
   return TRUE;
 }
@@ -163,6 +216,30 @@ sendGripperMoveCommand(double width, double speed)
     
   sendMessageSimulationServo("moveGripper",(void *)cbuf,2*sizeof(float));
 
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  sendGripperStopCommand
+\date  Oct. 2026
+   
+\remarks 
+
+       cancels a move or grasp of the gripper that is in progress
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+  none
+
+ ******************************************************************************/
+void 
+sendGripperStopCommand(void)
+{
+  unsigned char cbuf[sizeof(float)];
+
+  sendMessageSimulationServo("stopGripper",(void *)cbuf,0);
+
 }
 /*!*****************************************************************************
  *******************************************************************************
@@ -190,6 +267,39 @@ sendCalibrateFTCommand(void)
 
 }
 
+/*!*****************************************************************************
+ *******************************************************************************
+\note  sendFTContactCommand
+\date  Oct. 2026
+   
+\remarks 
+
+      tells the robot process whether the task commands contact of an arm,
+      which suspends the estimation of the F/T bias of this arm
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm     : the arm ID, or 0 for all arms
+ \param[in]     contact : TRUE if contact is commanded
+
+ ******************************************************************************/
+void 
+sendFTContactCommand(int arm, int contact)
+{
+  int count = 0;
+  float buf[2+1];
+  unsigned char cbuf[2*sizeof(float)];
+
+  buf[++count] = arm;
+  buf[++count] = contact;
+
+  memcpy(cbuf,(void *)&(buf[1]),(2)*sizeof(float));
+    
+  sendMessageSimulationServo("ftContact",(void *)cbuf,2*sizeof(float));
+
+}
+
 /*!*****************************************************************************
  *******************************************************************************
 \note  grasp
@@ -289,6 +399,29 @@ move(void)
 
 }
 
+/*!*****************************************************************************
+ *******************************************************************************
+\note  stopGripper
+\date  Oct. 2026
+   
+\remarks 
+
+       manually stops a gripper move or grasp
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+  none
+
+ ******************************************************************************/
+static void 
+stopGripper(void)
+{
+
+  sendGripperStopCommand();
+
+}
+
 /*!*****************************************************************************
  *******************************************************************************
 \note  printDyn
@@ -297,7 +430,7 @@ move(void)
 \remarks 
 
  prints the current dynamics parameters, i.e., inertia matrix, coriolis vector,
- gravity vector
+ gravity vector, and the Coriolis matrix of each arm
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
@@ -308,30 +441,39 @@ move(void)
 static void
 printDyn(void)
 {
-  int    i,j;
+  int    i,j,k;
   static int firsttime = TRUE;
   static Matrix rbdM;
   static Vector rbdCG;
+  static Matrix M;
   SL_uext ux[N_DOFS+1];
+  double  C[N_ARMS+1][N_DOFS_PER_ROBOT+1][N_DOFS_PER_ROBOT+1];
+  double  err = 0.0;
 
   if (firsttime) {
     firsttime = FALSE;
     
     rbdM  = my_matrix(1,N_DOFS+2*N_CART,1,N_DOFS+2*N_CART);
     rbdCG = my_vector(1,N_DOFS+2*N_CART);
-    bzero((void *)&ux,sizeof(ux));
+    M     = my_matrix(1,N_DOFS,1,N_DOFS);
 
   }
-  
-  SL_ForDynComp(joint_state,&base_state,&base_orient,ux,endeff,rbdM,rbdCG);
+
+  // no external forces: ux lives on the stack and is read by the fixed-base path
+  bzero((void *)&ux,sizeof(ux));
+  panda4_ForDynComp(joint_state,&base_state,&base_orient,ux,endeff,rbdM,rbdCG);
+  panda4_InertiaMatrix(joint_state,&base_state,&base_orient,endeff,M);
 
   printf("RBD Inertia Matrix:\n");
   for (i=1; i<=N_DOFS; ++i) {
     for (j=1; j<=N_DOFS; ++j) {
-      printf("%7.4f ",rbdM[i][j]);
+      printf("%7.4f ",M[i][j]);
+      if (fabs(M[i][j]-rbdM[i][j]) > err)
+	err = fabs(M[i][j]-rbdM[i][j]);
     }
     printf("\n");
   }
+  printf("max. deviation from the forward dynamics: %g\n",err);
   printf("\n");
 
   printf("RBD Coriolis+Gravity Vector:\n");
@@ -341,4 +483,152 @@ printDyn(void)
   printf("\n");
   printf("\n");
 
+  panda4_CoriolisMatrix(joint_state,endeff,C);
+
+  for (k=1; k<=N_ARMS; ++k) {
+    printf("Coriolis Matrix of Arm %d:\n",k);
+    for (i=1; i<=N_DOFS_PER_ROBOT; ++i) {
+      for (j=1; j<=N_DOFS_PER_ROBOT; ++j) {
+	printf("%7.4f ",C[k][i][j]);
+      }
+      printf("\n");
+    }
+    printf("\n");
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  printKin
+\date  Oct. 2026
+   
+\remarks 
+
+ prints the endeffector position and Jacobian of each arm from the
+ kinematics of panda4_dynamics, and their largest deviation from link_pos
+ and J of the task servo, which the SL core computes with the generated
+ whole-body kernels
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+ ******************************************************************************/
+static void
+printKin(void)
+{
+  int    i,j,k,r;
+  int    row;
+  static int firsttime = TRUE;
+  static Matrix Xmcog, Xaxis, Xorigin, Xlink, Jac;
+  static double ***Ahmat, ***Ahmatdof;
+  double err_x = 0.0;
+  double err_J = 0.0;
+
+  if (firsttime) {
+    firsttime = FALSE;
+
+    Xmcog    = my_matrix(0,N_DOFS,1,N_CART);
+    Xaxis    = my_matrix(0,N_DOFS,1,N_CART);
+    Xorigin  = my_matrix(0,N_DOFS,1,N_CART);
+    Xlink    = my_matrix(0,N_LINKS,1,N_CART);
+    Jac      = my_matrix(1,2*N_CART*N_ENDEFFS,1,N_DOFS);
+    Ahmat    = (double ***) my_calloc(N_LINKS+1,sizeof(Matrix),MY_STOP);
+    Ahmatdof = (double ***) my_calloc(N_DOFS+1,sizeof(Matrix),MY_STOP);
+    for (i=0; i<=N_LINKS; ++i)
+      Ahmat[i] = my_matrix(1,4,1,4);
+    for (i=0; i<=N_DOFS; ++i)
+      Ahmatdof[i] = my_matrix(1,4,1,4);
+
+  }
+
+  panda4_linkInformation(joint_state,&base_state,&base_orient,endeff,
+			 Xmcog,Xaxis,Xorigin,Xlink,Ahmat,Ahmatdof);
+  panda4_Jacobian(joint_state,&base_state,&base_orient,endeff,Jac);
+
+  for (k=1; k<=N_ENDEFFS; ++k) {
+
+    printf("Endeffector %d: x = ",k);
+    for (r=1; r<=N_CART; ++r) {
+      printf("%7.4f ",Xlink[link2endeffmap[k]][r]);
+      if (fabs(Xlink[link2endeffmap[k]][r]-link_pos[link2endeffmap[k]][r]) > err_x)
+	err_x = fabs(Xlink[link2endeffmap[k]][r]-link_pos[link2endeffmap[k]][r]);
+    }
+    printf("\n");
+
+    printf("Jacobian of Arm %d:\n",k);
+    for (i=1; i<=2*N_CART; ++i) {
+      row = (k-1)*2*N_CART+i;
+      for (j=(k-1)*N_DOFS_PER_ROBOT+1; j<=k*N_DOFS_PER_ROBOT; ++j)
+	printf("%7.4f ",Jac[row][j]);
+      printf("\n");
+      for (j=1; j<=N_DOFS; ++j)
+	if (fabs(Jac[row][j]-J[row][j]) > err_J)
+	  err_J = fabs(Jac[row][j]-J[row][j]);
+    }
+    printf("\n");
+
+  }
+
+  printf("max. deviation from the task servo: x %g, J %g\n",err_x,err_J);
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  benchFK
+\date  Oct. 2026
+   
+\remarks 
+
+ measures the throughput of the batched forward kinematics with random
+ configurations within the joint ranges, in million configurations per
+ second for a single arm and for all arms
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+ ******************************************************************************/
+#define N_FK_BATCHES 1000
+#define N_FK_REPS    100
+static void
+benchFK(void)
+{
+  int    i,l,n,r;
+  double t_arm,t_all;
+  struct timeval t0,t1,t2;
+  static double th[N_FK_BATCHES][N_DOFS+1][N_FK_LANES];
+  static double pos[N_ARMS+1][N_FK_FRAMES+1][N_CART+1][N_FK_LANES];
+  static double rot[N_ARMS+1][N_FK_FRAMES+1][N_CART+1][N_CART+1][N_FK_LANES];
+
+  for (n=0; n<N_FK_BATCHES; ++n)
+    for (i=1; i<=N_DOFS; ++i)
+      for (l=0; l<N_FK_LANES; ++l)
+	th[n][i][l] = joint_range[i][MIN_THETA] + ((double)rand()/RAND_MAX)*
+	  (joint_range[i][MAX_THETA]-joint_range[i][MIN_THETA]);
+
+  gettimeofday(&t0,NULL);
+  for (r=0; r<N_FK_REPS; ++r)
+    for (n=0; n<N_FK_BATCHES; ++n)
+      panda4_armFKBatch(1,th[n],endeff,pos[1],rot[1]);
+
+  gettimeofday(&t1,NULL);
+  for (r=0; r<N_FK_REPS; ++r)
+    for (n=0; n<N_FK_BATCHES; ++n)
+      panda4_FKBatch(th[n],endeff,pos,rot);
+  gettimeofday(&t2,NULL);
+
+  t_arm = (t1.tv_sec-t0.tv_sec) + (t1.tv_usec-t0.tv_usec)*1.e-6;
+  t_all = (t2.tv_sec-t1.tv_sec) + (t2.tv_usec-t1.tv_usec)*1.e-6;
+
+  printf("Batched forward kinematics with %d lanes:\n",N_FK_LANES);
+  printf("  single arm : %7.2f M configurations/s\n",
+	 (double)N_FK_REPS*N_FK_BATCHES*N_FK_LANES/t_arm*1.e-6);
+  printf("  all arms   : %7.2f M configurations/s\n",
+	 (double)N_FK_REPS*N_FK_BATCHES*N_FK_LANES/t_all*1.e-6);
+
 }
@@ -0,0 +1,255 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_clock.c
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  Every arm runs on the 1kHz clock of its own Franka controller, and only
+  the master arm triggers the motor servo. Thus, the samples of the arms
+  that the motor servo combines in one tick were taken at different
+  times. The Panda servo stamps every sample with the monotonic time of
+  the arm callback and the libfranka RobotState::time, and this file
+  turns these stamps into a per-tick alignment for the motor servo:
+  the age of the sample of every arm, the spread of the sample times, and
+  the offset of the robot clock of every arm relative to the master arm.
+
+  The statistics accumulate the sample ages, the spreads, and a running
+  least-squares fit of the clock offsets over time, whose slope is the
+  drift of a robot clock relative to the master in ppm.
+
+  ============================================================================*/
+
+// SL general includes of system headers
+#include "SL_system_headers.h"
+
+// private includes
+#include "SL.h"
+#include "SL_user.h"
+#include "SL_common.h"
+#include "SL_collect_data.h"
+#include "utility.h"
+#include "panda4_clock.h"
+#include "panda4_timing.h"
+
+// global variables
+Panda4Alignment panda4_alignment;
+
+// local variables
+typedef struct {
+  long   n;                                 // number of samples
+  long   n_stale;                           // ticks without a new sample
+  double age_sum;
+  double age_max;
+  long   n_fit;                             // number of offsets in the fit
+  double mean_t;                            // running means and co-moments
+  double mean_o;
+  double c_tt;
+  double c_to;
+} ArmClockStats;
+
+static ArmClockStats  clock_stats[N_ARMS+1];
+static long           n_spread = 0;
+static long           n_mixed = 0;          // ticks with a spread above half a period
+static double         spread_sum = 0;
+static double         spread_max = 0;
+static unsigned long  t_mono_first = 0;
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_alignArms
+\date  Oct. 2026
+
+\remarks
+
+ computes the alignment of the samples of all arms for the current tick
+ of the motor servo into panda4_alignment and accumulates the statistics
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     stamps : the stamps of the samples of all arms (1 to N_ARMS)
+ \param[in]     valid  : TRUE for every arm whose sample was read
+
+ ******************************************************************************/
+void
+panda4_alignArms(Panda4ArmStamp *stamps, int *valid)
+{
+  int              arm;
+  unsigned long    t_min = 0, t_max = 0;
+  double           t,d;
+  Panda4Alignment *a = &panda4_alignment;
+  ArmClockStats   *s;
+
+  a->t_mono = panda4_timeNs();
+  a->n_arms = 0;
+
+  for (arm=1; arm<=N_ARMS; ++arm) {
+
+    if (!valid[arm] || stamps[arm].t_mono == 0) {
+      a->valid[arm] = a->fresh[arm] = FALSE;
+      continue;
+    }
+
+    a->fresh[arm]   = !a->valid[arm] || stamps[arm].t_robot != a->t_robot[arm];
+    a->valid[arm]   = TRUE;
+    a->t_robot[arm] = stamps[arm].t_robot;
+    a->age[arm]     = a->t_mono > stamps[arm].t_mono ?
+      (a->t_mono - stamps[arm].t_mono)*1.e-9 : 0.0;
+
+    if (a->n_arms++ == 0 || stamps[arm].t_mono < t_min)
+      t_min = stamps[arm].t_mono;
+    if (stamps[arm].t_mono > t_max)
+      t_max = stamps[arm].t_mono;
+
+    s = &clock_stats[arm];
+    ++s->n;
+    if (!a->fresh[arm])
+      ++s->n_stale;
+    s->age_sum += a->age[arm];
+    if (a->age[arm] > s->age_max)
+      s->age_max = a->age[arm];
+
+  }
+
+  a->spread = a->n_arms > 0 ? (t_max - t_min)*1.e-9 : 0.0;
+  if (a->n_arms > 1) {
+    ++n_spread;
+    spread_sum += a->spread;
+    if (a->spread > spread_max)
+      spread_max = a->spread;
+    if (a->spread > 0.5/(double)PANDA_ROBOT_RATE)
+      ++n_mixed;
+  }
+
+  // the robot clock offsets need the master arm as reference
+  if (!a->valid[PANDA4_MASTER_ARM])
+    return;
+
+  if (t_mono_first == 0)
+    t_mono_first = a->t_mono;
+  t = (a->t_mono - t_mono_first)*1.e-9;
+
+  for (arm=1; arm<=N_ARMS; ++arm) {
+
+    if (!a->valid[arm] || !a->fresh[arm])
+      continue;
+
+    // the monotonic time between the samples minus their robot time difference
+    a->offset[arm] =
+      ((double)stamps[arm].t_mono - (double)stamps[PANDA4_MASTER_ARM].t_mono)*1.e-9 -
+      (a->t_robot[arm] - a->t_robot[PANDA4_MASTER_ARM]);
+
+    // running least-squares fit of offset over time
+    s = &clock_stats[arm];
+    ++s->n_fit;
+    d = t - s->mean_t;
+    s->mean_t += d/(double)s->n_fit;
+    s->mean_o += (a->offset[arm] - s->mean_o)/(double)s->n_fit;
+    s->c_tt   += d*(t - s->mean_t);
+    s->c_to   += d*(a->offset[arm] - s->mean_o);
+
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_addClockVarsToCollect
+\date  Oct. 2026
+
+\remarks
+
+ adds the sample ages, the clock offsets and the spread of the alignment
+ to the data collection
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_addClockVarsToCollect(void)
+{
+  int  arm;
+  char string[100];
+
+  for (arm=1; arm<=N_ARMS; ++arm) {
+    sprintf(string,"A%d_sample_age",arm);
+    addVarToCollect((char *)&(panda4_alignment.age[arm]),string,"s",DOUBLE,FALSE);
+    sprintf(string,"A%d_clock_offset",arm);
+    addVarToCollect((char *)&(panda4_alignment.offset[arm]),string,"s",DOUBLE,FALSE);
+  }
+  addVarToCollect((char *)&(panda4_alignment.spread),"arm_sample_spread","s",DOUBLE,FALSE);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_printClockStats
+\date  Oct. 2026
+
+\remarks
+
+ prints the sample ages, the spread of the samples, and the offset and
+ drift of the robot clocks relative to the master arm
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_printClockStats(void)
+{
+  int            arm;
+  ArmClockStats *s;
+
+  printf("\nArm sample alignment (master arm %d):\n",PANDA4_MASTER_ARM);
+  printf("arm  samples    stale  mean age[ms]  max age[ms]  offset[ms]  drift[ppm]\n");
+  for (arm=1; arm<=N_ARMS; ++arm) {
+    s = &clock_stats[arm];
+    if (s->n == 0)
+      continue;
+    printf("%3d %8ld %8ld %13.3f %12.3f %11.3f %11.2f\n",
+	   arm,s->n,s->n_stale,s->age_sum/(double)s->n*1000.,s->age_max*1000.,
+	   s->n_fit > 0 ? s->mean_o*1000. : 0.0,
+	   s->c_tt > 0 ? s->c_to/s->c_tt*1.e6 : 0.0);
+  }
+
+  if (n_spread > 0)
+    printf("Sample spread: mean = %.3f ms, max = %.3f ms, above half a period in %ld of %ld ticks\n",
+	   spread_sum/(double)n_spread*1000.,spread_max*1000.,n_mixed,n_spread);
+  printf("\n");
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_resetClockStats
+\date  Oct. 2026
+
+\remarks
+
+ clears the statistics of the sample alignment
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_resetClockStats(void)
+{
+  bzero((void *)clock_stats,sizeof(clock_stats));
+  n_spread     = 0;
+  n_mixed      = 0;
+  spread_sum   = 0;
+  spread_max   = 0;
+  t_mono_first = 0;
+}
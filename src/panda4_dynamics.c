@@ -0,0 +1,2191 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_dynamics.c
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  Per-arm kinematics and dynamics kernels for the 4 Panda arms. The generated kernels
+  in the math directory always evaluate the entire 28 DOF robot with a
+  floating base. The kernels in this file exploit that each arm is an
+  independent 7 DOF serial chain mounted on a fixed base, and compute
+  quantities which the generated kernels do not provide.
+
+  All computations are carried out in world coordinates with spatial
+  vectors: motion vectors are ordered as [angular; linear], force vectors
+  as [moment; force], both expressed at the world origin. The link
+  inertias in links[] are given relative to the joint coordinate origin,
+  and the endeffector mass is lumped into the last link of each arm.
+
+  The batched forward kinematics evaluates N_FK_LANES configurations at
+  once, with one configuration per SIMD lane. All batch arrays are in
+  structure-of-arrays layout, i.e., the last index is the lane, such that
+  a row of a batch array loads directly into one SIMD register. The SIMD
+  code uses the GCC/Clang vector extensions, which fall back to narrower
+  registers if the target does not support the full width.
+
+  ============================================================================*/
+
+// SL general includes of system headers
+#include "SL_system_headers.h"
+
+// private includes
+#include "SL.h"
+#include "SL_user.h"
+#include "SL_common.h"
+#include "utility.h"
+#include "SL_dynamics.h"
+#include "SL_kinematics.h"
+#include "panda4_dynamics.h"
+
+#define N_SPATIAL (2*N_CART)
+#define N_LINKS_PER_ARM (N_LINKS/N_ARMS)
+
+// local variables
+
+//! the kinematic and inertial state of one arm in world coordinates
+typedef struct ArmState {
+  double R[N_DOFS_PER_ROBOT+1][N_CART+1][N_CART+1];        //!< orientation of joint frames
+  double p[N_DOFS_PER_ROBOT+1][N_CART+1];                  //!< origin of joint frames
+  double S[N_DOFS_PER_ROBOT+1][N_SPATIAL+1];               //!< spatial joint axes
+  double Sd[N_DOFS_PER_ROBOT+1][N_SPATIAL+1];              //!< time derivative of joint axes
+  double v[N_DOFS_PER_ROBOT+1][N_SPATIAL+1];               //!< spatial link velocities
+  double I[N_DOFS_PER_ROBOT+1][N_SPATIAL+1][N_SPATIAL+1];  //!< spatial link inertias
+} ArmState;
+
+//! one double per configuration of a batch, i.e., one SIMD register
+typedef double    vdouble __attribute__ ((vector_size (N_FK_LANES*sizeof(double))));
+typedef long long vlong   __attribute__ ((vector_size (N_FK_LANES*sizeof(long long))));
+
+#define SIGN_BIT (-0x7fffffffffffffffLL-1)
+
+// mounting of each arm on the table: position and rotation about Z
+static double arm_mount_pos[N_ARMS+1][N_CART+1] = {
+  {0.0, 0.0, 0.0, 0.0},
+  {0.0, A1X, A1Y, DHD1},
+  {0.0, A2X, A2Y, DHD1},
+  {0.0, A3X, A3Y, DHD1},
+  {0.0, A4X, A4Y, DHD1}
+};
+static double arm_mount_rot[N_ARMS+1] = {0.0, A1G, A2G, A3G, A4G};
+
+// fixed rotation about X (cos,sin of +-90deg) and offset of each joint
+// relative to its parent, identical for all arms (see panda4.dyn)
+static double joint_rot_c[N_DOFS_PER_ROBOT+1] = {0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+static double joint_rot_s[N_DOFS_PER_ROBOT+1] = {0.0, 0.0,-1.0, 1.0, 1.0,-1.0, 1.0, 1.0};
+static double joint_offset[N_DOFS_PER_ROBOT+1][N_CART+1] = {
+  {0.0, 0.0,   0.0,  0.0},
+  {0.0, 0.0,   0.0,  0.0},  // the arm mount
+  {0.0, 0.0,   0.0,  0.0},
+  {0.0, 0.0,  -DHD3, 0.0},
+  {0.0, DHA4,  0.0,  0.0},
+  {0.0, DHA5,  DHD5, 0.0},
+  {0.0, 0.0,   0.0,  0.0},
+  {0.0, DHA7,  0.0,  0.0}
+};
+
+// the joint frame of each link of an arm, where N_FK_FRAMES is the
+// endeffector frame (see panda4.dyn)
+static int link_frame[N_LINKS_PER_ARM+1] = {0, 2, 3, 4, 6, 7, N_FK_FRAMES};
+
+// local functions
+static void armKinematics(int arm, SL_Jstate *state, ArmState *a);
+static void armInertias(int arm, SL_endeff *eff, ArmState *a);
+static void endeffRotation(int arm, SL_endeff *eff, double R[][N_CART+1]);
+static void spatialInertia(double m, double *mcm, double I[][N_CART+1],
+			   double R[][N_CART+1], double *p,
+			   double Is[][N_SPATIAL+1]);
+static void skew(double *v, double S[][N_CART+1]);
+static void crossMotion(double *v, double *m, double *c);
+static void coriolisFactor(double *v, double I[][N_SPATIAL+1], double B[][N_SPATIAL+1]);
+static void vsincos(vdouble *x, vdouble *s, vdouble *c);
+static void storeFrame(vdouble R[][N_CART+1], vdouble *p, double pos[][N_FK_LANES],
+		       double rot[][N_CART+1][N_FK_LANES]);
+static void armLinkParameters(int arm, SL_endeff *eff, double *m, double mcm[][N_CART+1],
+			      double I[][N_CART+1][N_CART+1]);
+static void armInvDyn(int arm, double *q, double *qd, double *qdd, double g,
+		      SL_endeff *eff, SL_uext *ux, double *tau);
+static void armInertiaMatrix(int arm, SL_Jstate *state, SL_endeff *eff,
+			     double M[][N_DOFS_PER_ROBOT+1]);
+static void armFrames(int arm, SL_Jstate *state, double R[][N_CART+1][N_CART+1],
+		      double p[][N_CART+1]);
+static void choleskySolve(double M[][N_DOFS_PER_ROBOT+1], double *b);
+static void rotToChild(int i, double ct, double st, double *x, double *y);
+static void rotToParent(int i, double ct, double st, double *x, double *y);
+static void crossProduct(double *a, double *b, double *c);
+static void setHomogeneous(double R[][N_CART+1], double *p, double **A);
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_armCoriolisMatrix
+\date  Oct. 2026
+
+\remarks
+
+ computes the Coriolis matrix C(q,qd) of one arm, such that C*qd are the
+ Coriolis and centripetal torques and Mdot-2C is skew symmetric. The
+ factorization follows the recursive algorithm of Echeandia & Wensing
+ (2021), which reuses the link velocities of the velocity recursion and
+ the composite inertias of the CRBA. As the latter come for free, the
+ arm inertia matrix is returned as well if M is not NULL.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : which arm (1 to N_ARMS)
+ \param[in]     state : the joint state of the entire robot
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[out]    C     : the 7x7 Coriolis matrix of this arm
+ \param[out]    M     : the 7x7 inertia matrix of this arm (or NULL)
+
+ ******************************************************************************/
+void
+panda4_armCoriolisMatrix(int arm, SL_Jstate *state, SL_endeff *eff,
+			 double C[][N_DOFS_PER_ROBOT+1],
+			 double M[][N_DOFS_PER_ROBOT+1])
+{
+  int    i,j,r,c;
+  ArmState a;
+  double B[N_SPATIAL+1][N_SPATIAL+1];
+  double Ic[N_SPATIAL+1][N_SPATIAL+1];
+  double Bc[N_SPATIAL+1][N_SPATIAL+1];
+  double f1[N_SPATIAL+1];
+  double f2[N_SPATIAL+1];
+  double f3[N_SPATIAL+1];
+  double aux1,aux2,aux3;
+
+  armKinematics(arm,state,&a);
+  armInertias(arm,eff,&a);
+
+  // composite inertias and composite Coriolis factors are accumulated
+  // from the hand towards the base
+  for (r=1; r<=N_SPATIAL; ++r)
+    for (c=1; c<=N_SPATIAL; ++c)
+      Ic[r][c] = Bc[r][c] = 0.0;
+
+  for (j=N_DOFS_PER_ROBOT; j>=1; --j) {
+
+    coriolisFactor(a.v[j],a.I[j],B);
+
+    for (r=1; r<=N_SPATIAL; ++r) {
+      for (c=1; c<=N_SPATIAL; ++c) {
+	Ic[r][c] += a.I[j][r][c];
+	Bc[r][c] += B[r][c];
+      }
+    }
+
+    // f1 = Ic*Sd + Bc*S, f2 = Ic*S, f3 = Bc'*S
+    for (r=1; r<=N_SPATIAL; ++r) {
+      aux1 = aux2 = aux3 = 0.0;
+      for (c=1; c<=N_SPATIAL; ++c) {
+	aux1 += Ic[r][c]*a.Sd[j][c] + Bc[r][c]*a.S[j][c];
+	aux2 += Ic[r][c]*a.S[j][c];
+	aux3 += Bc[c][r]*a.S[j][c];
+      }
+      f1[r] = aux1;
+      f2[r] = aux2;
+      f3[r] = aux3;
+    }
+
+    // this column and row of C for all ancestors of joint j
+    for (i=1; i<=j; ++i) {
+      aux1 = aux2 = aux3 = 0.0;
+      for (r=1; r<=N_SPATIAL; ++r) {
+	aux1 += a.S[i][r]*f1[r];
+	aux2 += a.Sd[i][r]*f2[r] + a.S[i][r]*f3[r];
+	aux3 += a.S[i][r]*f2[r];
+      }
+      C[i][j] = aux1;
+      if (i < j)
+	C[j][i] = aux2;
+      if (M != NULL)
+	M[i][j] = M[j][i] = aux3;
+    }
+
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_CoriolisMatrix
+\date  Oct. 2026
+
+\remarks
+
+ computes the Coriolis matrices of all arms. As the arms are dynamically
+ decoupled with a fixed base, the Coriolis matrix of the entire robot is
+ block-diagonal with these four 7x7 blocks.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     state : the joint state of the entire robot
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[out]    C     : C[arm] is the 7x7 Coriolis matrix of this arm
+
+ ******************************************************************************/
+void
+panda4_CoriolisMatrix(SL_Jstate *state, SL_endeff *eff,
+		      double C[][N_DOFS_PER_ROBOT+1][N_DOFS_PER_ROBOT+1])
+{
+  int i;
+
+  for (i=1; i<=N_ARMS; ++i)
+    panda4_armCoriolisMatrix(i,state,eff,C[i],NULL);
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_armFKBatch
+\date  Oct. 2026
+
+\remarks
+
+ forward kinematics of one arm for a batch of N_FK_LANES joint
+ configurations, e.g., for collision checking in sampling-based planners.
+ Only the positions and orientations of the joint frames and the
+ endeffector frame are computed, all in world coordinates.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : which arm (1 to N_ARMS)
+ \param[in]     th    : th[i][l] is joint i (1 to 7) of this arm in lane l
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[out]    pos   : pos[f][r][l] is coordinate r of frame f in lane l
+ \param[out]    rot   : rot[f][r][c][l] is the rotation matrix of frame f
+                        in lane l (or NULL if not needed)
+
+ Frames f are 1 to N_DOFS_PER_ROBOT for the joints and N_FK_FRAMES for the
+ endeffector.
+
+ ******************************************************************************/
+void
+panda4_armFKBatch(int arm, double th[][N_FK_LANES], SL_endeff *eff,
+		  double pos[][N_CART+1][N_FK_LANES],
+		  double rot[][N_CART+1][N_CART+1][N_FK_LANES])
+{
+  int     i,r,c;
+  double  sr;
+  double  Reff[N_CART+1][N_CART+1];
+  vdouble R[N_CART+1][N_CART+1];
+  vdouble B[N_CART+1][N_CART+1];
+  vdouble p[N_CART+1];
+  vdouble q,st,ct;
+  vdouble zero = {0.0};
+
+  // the first joint rotates about the world Z axis, such that the mount
+  // rotation and the joint rotation combine into a single angle
+  memcpy(&q,th[1],sizeof(q));
+  q += arm_mount_rot[arm];
+  vsincos(&q,&st,&ct);
+
+  R[1][1] = ct;   R[1][2] = -st;  R[1][3] = zero;
+  R[2][1] = st;   R[2][2] = ct;   R[2][3] = zero;
+  R[3][1] = zero; R[3][2] = zero; R[3][3] = zero+1.0;
+  for (r=1; r<=N_CART; ++r)
+    p[r] = zero+arm_mount_pos[arm][r];
+
+  storeFrame(R,p,pos[1],rot == NULL ? NULL : rot[1]);
+
+  for (i=2; i<=N_DOFS_PER_ROBOT; ++i) {
+
+    // origin of this joint, offset given in parent coordinates
+    for (c=1; c<=N_CART; ++c)
+      if (joint_offset[i][c] != 0.0)
+	for (r=1; r<=N_CART; ++r)
+	  p[r] += R[r][c]*joint_offset[i][c];
+
+    // fixed rotation about X, which is always +-90deg for the Panda
+    sr = joint_rot_s[i];
+    for (r=1; r<=N_CART; ++r) {
+      B[r][1] =  R[r][1];
+      B[r][2] =  sr*R[r][3];
+      B[r][3] = -sr*R[r][2];
+    }
+
+    // rotation about the joint axis
+    memcpy(&q,th[i],sizeof(q));
+    vsincos(&q,&st,&ct);
+    for (r=1; r<=N_CART; ++r) {
+      R[r][1] = ct*B[r][1] + st*B[r][2];
+      R[r][2] = ct*B[r][2] - st*B[r][1];
+      R[r][3] = B[r][3];
+    }
+
+    storeFrame(R,p,pos[i],rot == NULL ? NULL : rot[i]);
+
+  }
+
+  // the endeffector frame relative to the last joint
+  endeffRotation(arm,&eff[arm],Reff);
+  for (r=1; r<=N_CART; ++r) {
+    p[r] += R[r][1]*eff[arm].x[_X_] + R[r][2]*eff[arm].x[_Y_] + R[r][3]*eff[arm].x[_Z_];
+    for (c=1; c<=N_CART; ++c)
+      B[r][c] = R[r][1]*Reff[1][c] + R[r][2]*Reff[2][c] + R[r][3]*Reff[3][c];
+  }
+
+  storeFrame(B,p,pos[N_FK_FRAMES],rot == NULL ? NULL : rot[N_FK_FRAMES]);
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_FKBatch
+\date  Oct. 2026
+
+\remarks
+
+ batched forward kinematics of all arms, i.e., panda4_armFKBatch() for
+ every arm with the same batch of whole-robot configurations
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     th    : th[dof][l] is joint dof (1 to N_DOFS) in lane l
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[out]    pos   : pos[arm] are the frame positions of this arm
+ \param[out]    rot   : rot[arm] are the frame orientations of this arm
+                        (or NULL if not needed)
+
+ ******************************************************************************/
+void
+panda4_FKBatch(double th[][N_FK_LANES], SL_endeff *eff,
+	       double pos[][N_FK_FRAMES+1][N_CART+1][N_FK_LANES],
+	       double rot[][N_FK_FRAMES+1][N_CART+1][N_CART+1][N_FK_LANES])
+{
+  int i;
+
+  for (i=1; i<=N_ARMS; ++i)
+    panda4_armFKBatch(i,&th[(i-1)*N_DOFS_PER_ROBOT],eff,pos[i],
+		      rot == NULL ? NULL : rot[i]);
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_sinCosBatch
+\date  Oct. 2026
+
+\remarks
+
+ sine and cosine of a batch of N_FK_LANES angles, with the same SIMD code
+ as the batched forward kinematics
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     x   : N_FK_LANES angles
+ \param[out]    s   : their sines
+ \param[out]    c   : their cosines
+
+ ******************************************************************************/
+void
+panda4_sinCosBatch(double *x, double *s, double *c)
+{
+  vdouble vx,vs,vc;
+
+  memcpy(&vx,x,sizeof(vx));
+  vsincos(&vx,&vs,&vc);
+  memcpy(s,&vs,sizeof(vs));
+  memcpy(c,&vc,sizeof(vc));
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_armCentroidal
+\date  Oct. 2026
+
+\remarks
+
+ computes the mass, the center of mass (COM), the COM Jacobian and the
+ centroidal momentum of one arm, including its endeffector. All quantities
+ follow from the composite inertias Ic_j of the subtrees of the arm: the
+ columns Ic_j*S_j are the momenta of the subtrees for a unit velocity of
+ joint j, i.e., the columns of the centroidal momentum matrix at the world
+ origin.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : which arm (1 to N_ARMS)
+ \param[in]     state : the joint state of the entire robot
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[out]    mass  : the total mass of the arm (or NULL)
+ \param[out]    com   : the COM of the arm in world coordinates
+ \param[out]    Jcom  : the 3x7 COM Jacobian of the arm (or NULL)
+ \param[out]    hG    : the centroidal momentum as [angular about the COM;
+                        linear] (or NULL)
+
+ ******************************************************************************/
+void
+panda4_armCentroidal(int arm, SL_Jstate *state, SL_endeff *eff, double *mass,
+		     double *com, double Jcom[][N_DOFS_PER_ROBOT+1], double *hG)
+{
+  int    j,r,c;
+  int    dof;
+  ArmState a;
+  double Ic[N_SPATIAL+1][N_SPATIAL+1];
+  double F[N_SPATIAL+1][N_DOFS_PER_ROBOT+1];
+  double hO[N_SPATIAL+1];
+  double m;
+
+  armKinematics(arm,state,&a);
+  armInertias(arm,eff,&a);
+
+  for (r=1; r<=N_SPATIAL; ++r) {
+    hO[r] = 0.0;
+    for (c=1; c<=N_SPATIAL; ++c)
+      Ic[r][c] = 0.0;
+  }
+
+  // momentum columns of all subtrees, accumulated from the hand to the base
+  for (j=N_DOFS_PER_ROBOT; j>=1; --j) {
+
+    dof = (arm-1)*N_DOFS_PER_ROBOT+j;
+
+    for (r=1; r<=N_SPATIAL; ++r)
+      for (c=1; c<=N_SPATIAL; ++c)
+	Ic[r][c] += a.I[j][r][c];
+
+    for (r=1; r<=N_SPATIAL; ++r) {
+      F[r][j] = 0.0;
+      for (c=1; c<=N_SPATIAL; ++c)
+	F[r][j] += Ic[r][c]*a.S[j][c];
+      hO[r] += F[r][j]*state[dof].thd;
+    }
+
+  }
+
+  // Ic now is the inertia of the entire arm: the mass and the first
+  // moment m*com = (Ic[3][5],Ic[1][6],Ic[2][4]) follow from its structure
+  m = Ic[N_CART+1][N_CART+1];
+  com[_X_] = Ic[3][5]/m;
+  com[_Y_] = Ic[1][6]/m;
+  com[_Z_] = Ic[2][4]/m;
+
+  if (mass != NULL)
+    *mass = m;
+
+  // the linear momentum of a subtree is m*d(com)/dt
+  if (Jcom != NULL)
+    for (r=1; r<=N_CART; ++r)
+      for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+	Jcom[r][j] = F[N_CART+r][j]/m;
+
+  // shift the angular momentum from the world origin to the COM
+  if (hG != NULL) {
+    hG[1] = hO[1] - (com[_Y_]*hO[6] - com[_Z_]*hO[5]);
+    hG[2] = hO[2] - (com[_Z_]*hO[4] - com[_X_]*hO[6]);
+    hG[3] = hO[3] - (com[_X_]*hO[5] - com[_Y_]*hO[4]);
+    for (r=1; r<=N_CART; ++r)
+      hG[N_CART+r] = hO[N_CART+r];
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_Centroidal
+\date  Oct. 2026
+
+\remarks
+
+ computes the mass, the COM and the centroidal momentum of the entire
+ cell from the quantities of the individual arms
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     state : the joint state of the entire robot
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[out]    mass  : the total mass of all arms (or NULL)
+ \param[out]    com   : the COM of all arms in world coordinates
+ \param[out]    hG    : the centroidal momentum of all arms as [angular
+                        about the COM; linear] (or NULL)
+ \param[out]    acom  : acom[arm] is the COM of this arm (or NULL)
+
+ ******************************************************************************/
+void
+panda4_Centroidal(SL_Jstate *state, SL_endeff *eff, double *mass,
+		  double *com, double *hG, double acom[][N_CART+1])
+{
+  int    i,r;
+  double m[N_ARMS+1];
+  double c[N_ARMS+1][N_CART+1];
+  double h[N_ARMS+1][N_SPATIAL+1];
+  double mtot = 0.0;
+  double d[N_CART+1];
+
+  for (r=1; r<=N_CART; ++r)
+    com[r] = 0.0;
+
+  for (i=1; i<=N_ARMS; ++i) {
+    panda4_armCentroidal(i,state,eff,&m[i],c[i],NULL,h[i]);
+    mtot += m[i];
+    for (r=1; r<=N_CART; ++r)
+      com[r] += m[i]*c[i][r];
+  }
+
+  for (r=1; r<=N_CART; ++r)
+    com[r] /= mtot;
+
+  if (mass != NULL)
+    *mass = mtot;
+
+  if (acom != NULL)
+    for (i=1; i<=N_ARMS; ++i)
+      for (r=1; r<=N_CART; ++r)
+	acom[i][r] = c[i][r];
+
+  // the angular momentum of each arm about the cell COM adds the moment
+  // of its linear momentum
+  if (hG != NULL) {
+    for (r=1; r<=N_SPATIAL; ++r)
+      hG[r] = 0.0;
+    for (i=1; i<=N_ARMS; ++i) {
+      for (r=1; r<=N_CART; ++r)
+	d[r] = c[i][r] - com[r];
+      hG[1] += h[i][1] + d[_Y_]*h[i][6] - d[_Z_]*h[i][5];
+      hG[2] += h[i][2] + d[_Z_]*h[i][4] - d[_X_]*h[i][6];
+      hG[3] += h[i][3] + d[_X_]*h[i][5] - d[_Y_]*h[i][4];
+      for (r=1; r<=N_CART; ++r)
+	hG[N_CART+r] += h[i][N_CART+r];
+    }
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_fixedBase
+\date  Oct. 2026
+
+\remarks
+
+ checks whether the base is frozen, i.e., whether the simulation or the
+ robot holds it with freeze_base, and whether it is frozen without any
+ rotation or motion. Only then the fixed-base kernels below are valid,
+ which have the base orientation built in as a compile-time constant. The
+ base position can be anywhere, e.g., at freeze_base_pos: the dynamics
+ do not depend on it, and the kinematics add it to all positions.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     cbase : the base position
+ \param[in]     obase : the base orientation
+
+ returns TRUE if the fixed-base kernels can be used
+
+ ******************************************************************************/
+int
+panda4_fixedBase(SL_Cstate *cbase, SL_quat *obase)
+{
+  int i;
+
+  if (!freeze_base)
+    return FALSE;
+
+  if (obase->q[_Q0_] != 1.0 || obase->q[_Q1_] != 0.0 ||
+      obase->q[_Q2_] != 0.0 || obase->q[_Q3_] != 0.0)
+    return FALSE;
+
+  for (i=1; i<=N_CART; ++i)
+    if (cbase->xd[i] != 0.0 || cbase->xdd[i] != 0.0 ||
+	obase->ad[i] != 0.0 || obase->add[i] != 0.0)
+      return FALSE;
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_InvDynNE
+\date  Oct. 2026
+
+\remarks
+
+ Newton-Euler inverse dynamics with the same interface as
+ SL_InvDynNE_Gravity(). If the base is frozen, a recursion per arm in local
+ link coordinates is used, which has no base velocity or acceleration
+ propagation. As in the generated kernel, the external joint torques
+ lstate[i].uex are subtracted from the result. Otherwise, the generated
+ whole-body kernel is called.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     cstate: the current state (NULL to use lstate for th and thd)
+ \param[in,out] lstate: the desired state, lstate[i].uff is the result
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[in]     cbase : the base position
+ \param[in]     obase : the base orientation
+ \param[in]     g     : gravity constant
+
+ ******************************************************************************/
+void
+panda4_InvDynNE(SL_Jstate *cstate, SL_DJstate *lstate, SL_endeff *eff,
+		SL_Cstate *cbase, SL_quat *obase, double g)
+{
+  int    i,j;
+  int    dof;
+  double q[N_DOFS_PER_ROBOT+1];
+  double qd[N_DOFS_PER_ROBOT+1];
+  double qdd[N_DOFS_PER_ROBOT+1];
+  double tau[N_DOFS_PER_ROBOT+1];
+
+  if (!panda4_fixedBase(cbase,obase)) {
+    SL_InvDynNE_Gravity(cstate,lstate,eff,cbase,obase,g);
+    return;
+  }
+
+  for (i=1; i<=N_ARMS; ++i) {
+
+    for (j=1; j<=N_DOFS_PER_ROBOT; ++j) {
+      dof = (i-1)*N_DOFS_PER_ROBOT+j;
+      if (cstate != NULL) {
+	q[j]  = cstate[dof].th;
+	qd[j] = cstate[dof].thd;
+      } else {
+	q[j]  = lstate[dof].th;
+	qd[j] = lstate[dof].thd;
+      }
+      qdd[j] = lstate[dof].thdd;
+    }
+
+    armInvDyn(i,q,qd,qdd,g,eff,NULL,tau);
+
+    for (j=1; j<=N_DOFS_PER_ROBOT; ++j) {
+      dof = (i-1)*N_DOFS_PER_ROBOT+j;
+      lstate[dof].uff = tau[j] - lstate[dof].uex;
+    }
+
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_ForDynComp
+\date  Oct. 2026
+
+\remarks
+
+ forward dynamics with the same interface as SL_ForDynComp(). If the base
+ is frozen, the inertia matrix is block-diagonal with one 7x7 block per
+ arm, and each arm is solved separately: M*thdd = u - CG with a Cholesky
+ decomposition of its block. The rows and columns of the base in rbdM and
+ rbdCG are zero in this case. Otherwise, the generated whole-body kernel
+ is called.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in,out] state : the joint state, state[i].thdd is the result
+ \param[in]     cbase : the base position
+ \param[in]     obase : the base orientation
+ \param[in]     ux    : external forces on each link
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[out]    rbdM  : the inertia matrix (N_DOFS+2*N_CART square)
+ \param[out]    rbdCG : the Coriolis, centripetal and gravity forces
+
+ ******************************************************************************/
+void
+panda4_ForDynComp(SL_Jstate *state, SL_Cstate *cbase, SL_quat *obase,
+		  SL_uext *ux, SL_endeff *eff, Matrix rbdM, Vector rbdCG)
+{
+  int    i,j,k;
+  int    dof;
+  double q[N_DOFS_PER_ROBOT+1];
+  double qd[N_DOFS_PER_ROBOT+1];
+  double qdd[N_DOFS_PER_ROBOT+1];
+  double cg[N_DOFS_PER_ROBOT+1];
+  double b[N_DOFS_PER_ROBOT+1];
+  double M[N_DOFS_PER_ROBOT+1][N_DOFS_PER_ROBOT+1];
+
+  if (!panda4_fixedBase(cbase,obase)) {
+    SL_ForDynComp(state,cbase,obase,ux,eff,rbdM,rbdCG);
+    return;
+  }
+
+  for (i=1; i<=N_DOFS+2*N_CART; ++i) {
+    rbdCG[i] = 0.0;
+    for (j=1; j<=N_DOFS+2*N_CART; ++j)
+      rbdM[i][j] = 0.0;
+  }
+
+  for (i=1; i<=N_ARMS; ++i) {
+
+    dof = (i-1)*N_DOFS_PER_ROBOT;
+
+    for (j=1; j<=N_DOFS_PER_ROBOT; ++j) {
+      q[j]   = state[dof+j].th;
+      qd[j]  = state[dof+j].thd;
+      qdd[j] = 0.0;
+    }
+
+    armInvDyn(i,q,qd,qdd,gravity,eff,&ux[dof],cg);
+    armInertiaMatrix(i,state,eff,M);
+
+    for (j=1; j<=N_DOFS_PER_ROBOT; ++j) {
+      rbdCG[dof+j] = cg[j];
+      b[j] = state[dof+j].u - cg[j];
+      for (k=1; k<=N_DOFS_PER_ROBOT; ++k)
+	rbdM[dof+j][dof+k] = M[j][k];
+    }
+
+    choleskySolve(M,b);
+
+    for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+      state[dof+j].thdd = b[j];
+
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_armInvDyn
+\date  Oct. 2026
+
+\remarks
+
+ fixed-base inverse dynamics of one arm, with the base frozen at the cell
+ origin. Only local variables are used, such that several threads can
+ compute the dynamics of different arms at the same time.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : which arm (1 to N_ARMS)
+ \param[in]     state : the joint state of the entire robot (th and thd)
+ \param[in]     qdd   : the joint accelerations of this arm (1 to N_DOFS_PER_ROBOT)
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[out]    tau   : the joint torques of this arm (1 to N_DOFS_PER_ROBOT)
+
+ ******************************************************************************/
+void
+panda4_armInvDyn(int arm, SL_Jstate *state, double *qdd, SL_endeff *eff, double *tau)
+{
+  int    j;
+  int    dof = (arm-1)*N_DOFS_PER_ROBOT;
+  double q[N_DOFS_PER_ROBOT+1];
+  double qd[N_DOFS_PER_ROBOT+1];
+
+  for (j=1; j<=N_DOFS_PER_ROBOT; ++j) {
+    q[j]  = state[dof+j].th;
+    qd[j] = state[dof+j].thd;
+  }
+
+  armInvDyn(arm,q,qd,qdd,gravity,eff,NULL,tau);
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_armGravity
+\date  Oct. 2026
+
+\remarks
+
+ gravity torques of one arm on the fixed base, i.e., panda4_armInvDyn()
+ at rest, specialized for the 7 DOF chain. Without motion, the link forces
+ are only the weights, and the moment about each joint is the first mass
+ moment of the subtree of the joint crossed with the gravity acceleration.
+ The forward recursion thus only rotates the gravity vector into each link,
+ and the backward recursion accumulates mass and first mass moment of the
+ subtrees. Like panda4_armInvDyn(), this is safe to call from several
+ threads, and it is cheap enough for the servo loop.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : which arm (1 to N_ARMS)
+ \param[in]     q     : joint angles of this arm (1 to N_DOFS_PER_ROBOT)
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[in]     g     : gravity constant
+ \param[out]    tau   : gravity torques of this arm (1 to N_DOFS_PER_ROBOT)
+
+ ******************************************************************************/
+void
+panda4_armGravity(int arm, double *q, SL_endeff *eff, double g, double *tau)
+{
+  int    i,r;
+  double m[N_DOFS_PER_ROBOT+1];
+  double mcm[N_DOFS_PER_ROBOT+1][N_CART+1];
+  double ct[N_DOFS_PER_ROBOT+1];
+  double st[N_DOFS_PER_ROBOT+1];
+  double a[N_DOFS_PER_ROBOT+1][N_CART+1];
+  double h[N_CART+1];
+  double hp[N_CART+1];
+  double ms;
+
+  armLinkParameters(arm,eff,m,mcm,NULL);
+
+  for (i=1; i<=N_DOFS_PER_ROBOT; ++i) {
+    ct[i] = cos(q[i] + ((i == 1) ? arm_mount_rot[arm] : 0.0));
+    st[i] = sin(q[i] + ((i == 1) ? arm_mount_rot[arm] : 0.0));
+  }
+
+  // forward recursion: gravity in link coordinates, where the rotation
+  // about Z of the first joint leaves it unchanged
+  a[1][1] = a[1][2] = 0.0;
+  a[1][_Z_] = g;
+  for (i=2; i<=N_DOFS_PER_ROBOT; ++i)
+    rotToChild(i,ct[i],st[i],a[i-1],a[i]);
+
+  // backward recursion: the torque is the Z component of h x a
+  ms = 0.0;
+  for (r=1; r<=N_CART; ++r)
+    h[r] = 0.0;
+
+  for (i=N_DOFS_PER_ROBOT; i>=1; --i) {
+
+    ms += m[i];
+    for (r=1; r<=N_CART; ++r)
+      h[r] += mcm[i][r];
+
+    tau[i] = h[1]*a[i][2] - h[2]*a[i][1];
+
+    if (i > 1) {
+      rotToParent(i,ct[i],st[i],h,hp);
+      for (r=1; r<=N_CART; ++r)
+	h[r] = hp[r] + ms*joint_offset[i][r];
+    }
+
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_armForDyn
+\date  Oct. 2026
+
+\remarks
+
+ fixed-base forward dynamics of one arm, i.e., the arm block of
+ panda4_ForDynComp() without any work for the other arms. Like
+ panda4_armInvDyn(), this is safe to call from several threads.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : which arm (1 to N_ARMS)
+ \param[in,out] state : the joint state of the entire robot: th, thd and u
+                        of this arm are used, and thdd of this arm is the result
+ \param[in]     eff   : the endeffector parameters of the entire robot
+
+ ******************************************************************************/
+void
+panda4_armForDyn(int arm, SL_Jstate *state, SL_endeff *eff)
+{
+  int    j;
+  int    dof = (arm-1)*N_DOFS_PER_ROBOT;
+  double qdd[N_DOFS_PER_ROBOT+1];
+  double b[N_DOFS_PER_ROBOT+1];
+  double M[N_DOFS_PER_ROBOT+1][N_DOFS_PER_ROBOT+1];
+
+  for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+    qdd[j] = 0.0;
+
+  panda4_armInvDyn(arm,state,qdd,eff,b);
+  armInertiaMatrix(arm,state,eff,M);
+
+  for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+    b[j] = state[dof+j].u - b[j];
+
+  choleskySolve(M,b);
+
+  for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+    state[dof+j].thdd = b[j];
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_InertiaMatrix
+\date  Oct. 2026
+
+\remarks
+
+ computes the N_DOFS x N_DOFS inertia matrix of the robot. If the base is
+ frozen, only the 7x7 diagonal blocks of the arms are computed with the
+ composite rigid body algorithm, and all coupling blocks are zero.
+ Otherwise, the inertia matrix is taken from the generated whole-body
+ kernel.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     state : the joint state of the entire robot
+ \param[in]     cbase : the base position
+ \param[in]     obase : the base orientation
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[out]    M     : the inertia matrix
+
+ ******************************************************************************/
+void
+panda4_InertiaMatrix(SL_Jstate *state, SL_Cstate *cbase, SL_quat *obase,
+		     SL_endeff *eff, Matrix M)
+{
+  int    i,j,k;
+  int    dof;
+  double Marm[N_DOFS_PER_ROBOT+1][N_DOFS_PER_ROBOT+1];
+  static int firsttime = TRUE;
+  static Matrix rbdM;
+  static Vector rbdCG;
+  static SL_uext ux[N_DOFS+1];
+  SL_Jstate s[N_DOFS+1];
+
+  if (!panda4_fixedBase(cbase,obase)) {
+
+    if (firsttime) {
+      firsttime = FALSE;
+      rbdM  = my_matrix(1,N_DOFS+2*N_CART,1,N_DOFS+2*N_CART);
+      rbdCG = my_vector(1,N_DOFS+2*N_CART);
+      bzero((void *)ux,sizeof(ux));
+    }
+
+    // the forward dynamics overwrites the accelerations
+    memcpy((void *)s,(void *)state,sizeof(s));
+    SL_ForDynComp(s,cbase,obase,ux,eff,rbdM,rbdCG);
+    for (i=1; i<=N_DOFS; ++i)
+      for (j=1; j<=N_DOFS; ++j)
+	M[i][j] = rbdM[i][j];
+
+    return;
+  }
+
+  for (i=1; i<=N_DOFS; ++i)
+    for (j=1; j<=N_DOFS; ++j)
+      M[i][j] = 0.0;
+
+  for (i=1; i<=N_ARMS; ++i) {
+    dof = (i-1)*N_DOFS_PER_ROBOT;
+    armInertiaMatrix(i,state,eff,Marm);
+    for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+      for (k=1; k<=N_DOFS_PER_ROBOT; ++k)
+	M[dof+j][dof+k] = Marm[j][k];
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_linkInformation
+\date  Oct. 2026
+
+\remarks
+
+ link information with the same interface as linkInformation(). If the
+ base is frozen, the forward kinematics of each arm starts directly at its
+ mount on the table, shifted by the base position. Otherwise, the
+ generated whole-body kernel is called.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     state   : the joint state of the entire robot
+ \param[in]     basec   : the base position
+ \param[in]     baseo   : the base orientation
+ \param[in]     eff     : the endeffector parameters of the entire robot
+ \param[out]    Xmcog   : mass times center of gravity of each link
+ \param[out]    Xaxis   : joint axis of each DOF
+ \param[out]    Xorigin : joint origin of each DOF
+ \param[out]    Xlink   : position of each link
+ \param[out]    Ahmat   : homogeneous transformation of each link
+ \param[out]    Ahmatdof: homogeneous transformation of each DOF
+
+ ******************************************************************************/
+void
+panda4_linkInformation(SL_Jstate *state, SL_Cstate *basec, SL_quat *baseo,
+		       SL_endeff *eff, double **Xmcog, double **Xaxis,
+		       double **Xorigin, double **Xlink, double ***Ahmat,
+		       double ***Ahmatdof)
+{
+  int    i,j,r,c;
+  int    dof,link;
+  double Ra[N_DOFS_PER_ROBOT+1][N_CART+1][N_CART+1];
+  double pa[N_DOFS_PER_ROBOT+1][N_CART+1];
+  double Reff[N_CART+1][N_CART+1];
+  double R[N_CART+1][N_CART+1];
+  double p[N_CART+1];
+
+  if (!panda4_fixedBase(basec,baseo)) {
+    linkInformation(state,basec,baseo,eff,Xmcog,Xaxis,Xorigin,Xlink,Ahmat,Ahmatdof);
+    return;
+  }
+
+  // the base frame is the world frame, shifted by the base position
+  for (r=1; r<=N_CART; ++r) {
+    Xorigin[0][r] = basec->x[r];
+    Xaxis[0][r]   = 0.0;
+    Xlink[0][r]   = basec->x[r];
+    Xmcog[0][r]   = links[0].mcm[r] + links[0].m*basec->x[r];
+    p[r] = basec->x[r];
+    for (c=1; c<=N_CART; ++c)
+      R[r][c] = (r == c) ? 1.0 : 0.0;
+  }
+  setHomogeneous(R,p,Ahmatdof[0]);
+  setHomogeneous(R,p,Ahmat[0]);
+
+  for (i=1; i<=N_ARMS; ++i) {
+
+    armFrames(i,state,Ra,pa);
+    for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+      for (r=1; r<=N_CART; ++r)
+	pa[j][r] += basec->x[r];
+
+    for (j=1; j<=N_DOFS_PER_ROBOT; ++j) {
+      dof = (i-1)*N_DOFS_PER_ROBOT+j;
+      for (r=1; r<=N_CART; ++r) {
+	Xorigin[dof][r] = pa[j][r];
+	Xaxis[dof][r]   = Ra[j][r][3];
+	Xmcog[dof][r]   = links[dof].m*pa[j][r];
+	for (c=1; c<=N_CART; ++c)
+	  Xmcog[dof][r] += Ra[j][r][c]*links[dof].mcm[c];
+      }
+      setHomogeneous(Ra[j],pa[j],Ahmatdof[dof]);
+    }
+
+    // the endeffector frame
+    endeffRotation(i,&eff[i],Reff);
+    for (r=1; r<=N_CART; ++r) {
+      p[r] = pa[N_DOFS_PER_ROBOT][r];
+      for (c=1; c<=N_CART; ++c) {
+	p[r] += Ra[N_DOFS_PER_ROBOT][r][c]*eff[i].x[c];
+	R[r][c] = 0.0;
+	for (j=1; j<=N_CART; ++j)
+	  R[r][c] += Ra[N_DOFS_PER_ROBOT][r][j]*Reff[j][c];
+      }
+    }
+
+    // the links of each arm, see panda4.dyn
+    for (j=1; j<=N_LINKS_PER_ARM; ++j) {
+      link = (i-1)*N_LINKS_PER_ARM+j;
+      if (link_frame[j] > N_DOFS_PER_ROBOT) {
+	setHomogeneous(R,p,Ahmat[link]);
+	for (r=1; r<=N_CART; ++r)
+	  Xlink[link][r] = p[r];
+      } else {
+	setHomogeneous(Ra[link_frame[j]],pa[link_frame[j]],Ahmat[link]);
+	for (r=1; r<=N_CART; ++r)
+	  Xlink[link][r] = pa[link_frame[j]][r];
+      }
+    }
+
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_Jacobian
+\date  Oct. 2026
+
+\remarks
+
+ computes the geometric Jacobian of all endeffectors, with the same layout
+ as jacobian(): rows (i-1)*6+1 to (i-1)*6+6 are the position and
+ orientation rows of endeffector i. If the base is frozen, each arm's
+ Jacobian is computed directly from its forward kinematics, which does not
+ depend on the base position. Otherwise,
+ the generated link information and Jacobian kernels are called.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     state : the joint state of the entire robot
+ \param[in]     basec : the base position
+ \param[in]     baseo : the base orientation
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[out]    Jac   : the 6*N_ENDEFFS x N_DOFS Jacobian
+
+ ******************************************************************************/
+void
+panda4_Jacobian(SL_Jstate *state, SL_Cstate *basec, SL_quat *baseo,
+		SL_endeff *eff, Matrix Jac)
+{
+  int    i,j,r,c;
+  int    dof,row;
+  double Ra[N_DOFS_PER_ROBOT+1][N_CART+1][N_CART+1];
+  double pa[N_DOFS_PER_ROBOT+1][N_CART+1];
+  double p[N_CART+1];
+  double z[N_CART+1];
+  static int firsttime = TRUE;
+  static Matrix Xmcog, Xaxis, Xorigin, Xlink;
+  static double ***Ahmat, ***Ahmatdof;
+
+  if (!panda4_fixedBase(basec,baseo)) {
+
+    if (firsttime) {
+      firsttime = FALSE;
+      Xmcog    = my_matrix(0,N_DOFS,1,N_CART);
+      Xaxis    = my_matrix(0,N_DOFS,1,N_CART);
+      Xorigin  = my_matrix(0,N_DOFS,1,N_CART);
+      Xlink    = my_matrix(0,N_LINKS,1,N_CART);
+      Ahmat    = (double ***) my_calloc(N_LINKS+1,sizeof(Matrix),MY_STOP);
+      Ahmatdof = (double ***) my_calloc(N_DOFS+1,sizeof(Matrix),MY_STOP);
+      for (i=0; i<=N_LINKS; ++i)
+	Ahmat[i] = my_matrix(1,4,1,4);
+      for (i=0; i<=N_DOFS; ++i)
+	Ahmatdof[i] = my_matrix(1,4,1,4);
+    }
+
+    linkInformation(state,basec,baseo,eff,Xmcog,Xaxis,Xorigin,Xlink,Ahmat,Ahmatdof);
+    jacobian(Xlink,Xorigin,Xaxis,Jac);
+
+    return;
+  }
+
+  for (i=1; i<=2*N_CART*N_ENDEFFS; ++i)
+    for (j=1; j<=N_DOFS; ++j)
+      Jac[i][j] = 0.0;
+
+  for (i=1; i<=N_ARMS; ++i) {
+
+    armFrames(i,state,Ra,pa);
+
+    // endeffector position
+    for (r=1; r<=N_CART; ++r) {
+      p[r] = pa[N_DOFS_PER_ROBOT][r];
+      for (c=1; c<=N_CART; ++c)
+	p[r] += Ra[N_DOFS_PER_ROBOT][r][c]*eff[i].x[c];
+    }
+
+    row = (i-1)*2*N_CART;
+    for (j=1; j<=N_DOFS_PER_ROBOT; ++j) {
+      dof = (i-1)*N_DOFS_PER_ROBOT+j;
+      for (r=1; r<=N_CART; ++r)
+	z[r] = Ra[j][r][3];
+      Jac[row+_X_][dof] = z[2]*(p[3]-pa[j][3]) - z[3]*(p[2]-pa[j][2]);
+      Jac[row+_Y_][dof] = z[3]*(p[1]-pa[j][1]) - z[1]*(p[3]-pa[j][3]);
+      Jac[row+_Z_][dof] = z[1]*(p[2]-pa[j][2]) - z[2]*(p[1]-pa[j][1]);
+      for (r=1; r<=N_CART; ++r)
+	Jac[row+N_CART+r][dof] = z[r];
+    }
+
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  armKinematics
+\date  Oct. 2026
+
+\remarks
+
+ forward kinematics and velocity recursion of one arm: computes the world
+ frame of every joint, the spatial joint axes and their time derivatives,
+ and the spatial link velocities
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : which arm (1 to N_ARMS)
+ \param[in]     state : the joint state of the entire robot
+ \param[out]    a     : the kinematic state of this arm
+
+ ******************************************************************************/
+static void
+armKinematics(int arm, SL_Jstate *state, ArmState *a)
+{
+  int    i,j,r;
+  int    dof;
+  double cr,sr,ct,st;
+  double B[N_CART+1][N_CART+1];
+  double *z;
+
+  // the world frame is the parent of the arm mount
+  for (r=1; r<=N_CART; ++r) {
+    a->p[0][r] = 0.0;
+    for (j=1; j<=N_CART; ++j)
+      a->R[0][r][j] = (r == j) ? 1.0 : 0.0;
+  }
+  for (r=1; r<=N_SPATIAL; ++r)
+    a->v[0][r] = 0.0;
+
+  for (i=1; i<=N_DOFS_PER_ROBOT; ++i) {
+
+    dof = (arm-1)*N_DOFS_PER_ROBOT+i;
+
+    // origin of this joint, offset given in parent coordinates
+    for (r=1; r<=N_CART; ++r) {
+      if (i == 1) {
+	a->p[i][r] = arm_mount_pos[arm][r];
+      } else {
+	a->p[i][r] = a->p[i-1][r];
+	for (j=1; j<=N_CART; ++j)
+	  a->p[i][r] += a->R[i-1][r][j]*joint_offset[i][j];
+      }
+    }
+
+    // fixed rotation of this joint: about Z for the mount, about X otherwise
+    if (i == 1) {
+      cr = cos(arm_mount_rot[arm]);
+      sr = sin(arm_mount_rot[arm]);
+      for (r=1; r<=N_CART; ++r) {
+	B[r][1] =  cr*a->R[i-1][r][1] + sr*a->R[i-1][r][2];
+	B[r][2] = -sr*a->R[i-1][r][1] + cr*a->R[i-1][r][2];
+	B[r][3] =  a->R[i-1][r][3];
+      }
+    } else {
+      cr = joint_rot_c[i];
+      sr = joint_rot_s[i];
+      for (r=1; r<=N_CART; ++r) {
+	B[r][1] =  a->R[i-1][r][1];
+	B[r][2] =  cr*a->R[i-1][r][2] + sr*a->R[i-1][r][3];
+	B[r][3] = -sr*a->R[i-1][r][2] + cr*a->R[i-1][r][3];
+      }
+    }
+
+    // rotation about the joint axis
+    ct = cos(state[dof].th);
+    st = sin(state[dof].th);
+    for (r=1; r<=N_CART; ++r) {
+      a->R[i][r][1] =  ct*B[r][1] + st*B[r][2];
+      a->R[i][r][2] = -st*B[r][1] + ct*B[r][2];
+      a->R[i][r][3] =  B[r][3];
+    }
+
+    // spatial joint axis at the world origin: [z; p x z]
+    z = a->S[i];
+    for (r=1; r<=N_CART; ++r)
+      z[r] = a->R[i][r][3];
+    z[4] = a->p[i][2]*z[3] - a->p[i][3]*z[2];
+    z[5] = a->p[i][3]*z[1] - a->p[i][1]*z[3];
+    z[6] = a->p[i][1]*z[2] - a->p[i][2]*z[1];
+
+    // velocity recursion, and Sd = v x S
+    for (r=1; r<=N_SPATIAL; ++r)
+      a->v[i][r] = a->v[i-1][r] + a->S[i][r]*state[dof].thd;
+    crossMotion(a->v[i],a->S[i],a->Sd[i]);
+
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  armInertias
+\date  Oct. 2026
+
+\remarks
+
+ computes the spatial inertias of all links of an arm in world coordinates.
+ The endeffector is treated as a point mass distribution attached to the
+ last link, as in the generated kernels. Requires armKinematics() first.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : which arm (1 to N_ARMS)
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[in,out] a     : the kinematic state of this arm
+
+ ******************************************************************************/
+static void
+armInertias(int arm, SL_endeff *eff, ArmState *a)
+{
+  int    i,j,r,c;
+  int    dof;
+  double Reff[N_CART+1][N_CART+1];
+  double Rhand[N_CART+1][N_CART+1];
+  double phand[N_CART+1];
+  double zero[N_CART+1][N_CART+1];
+  double Is[N_SPATIAL+1][N_SPATIAL+1];
+
+  for (i=1; i<=N_DOFS_PER_ROBOT; ++i) {
+    dof = (arm-1)*N_DOFS_PER_ROBOT+i;
+    spatialInertia(links[dof].m,links[dof].mcm,links[dof].inertia,
+		   a->R[i],a->p[i],a->I[i]);
+  }
+
+  // the endeffector frame relative to the last joint
+  endeffRotation(arm,&eff[arm],Reff);
+  for (r=1; r<=N_CART; ++r) {
+    phand[r] = a->p[N_DOFS_PER_ROBOT][r];
+    for (c=1; c<=N_CART; ++c) {
+      phand[r] += a->R[N_DOFS_PER_ROBOT][r][c]*eff[arm].x[c];
+      Rhand[r][c] = 0.0;
+      zero[r][c] = 0.0;
+      for (j=1; j<=N_CART; ++j)
+	Rhand[r][c] += a->R[N_DOFS_PER_ROBOT][r][j]*Reff[j][c];
+    }
+  }
+
+  spatialInertia(eff[arm].m,eff[arm].mcm,zero,Rhand,phand,Is);
+
+  for (r=1; r<=N_SPATIAL; ++r)
+    for (c=1; c<=N_SPATIAL; ++c)
+      a->I[N_DOFS_PER_ROBOT][r][c] += Is[r][c];
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  endeffRotation
+\date  Oct. 2026
+
+\remarks
+
+ rotation matrix of the endeffector frame relative to the last joint
+ frame, using the same x-y-z Euler convention as the generated kernels.
+ The rotation is taken from the endeffector snapshot if it has the same
+ angles, which saves the sine and cosine terms.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : the arm ID (1 to N_ARMS)
+ \param[in]     eff   : the endeffector parameters of this arm
+ \param[out]    R     : rotation matrix
+
+ ******************************************************************************/
+static void
+endeffRotation(int arm, SL_endeff *eff, double R[][N_CART+1])
+{
+  if (getEndeffectorRotation(arm,eff->a,R))
+    return;
+
+  double sa = sin(eff->a[_A_]);
+  double ca = cos(eff->a[_A_]);
+  double sb = sin(eff->a[_B_]);
+  double cb = cos(eff->a[_B_]);
+  double sg = sin(eff->a[_G_]);
+  double cg = cos(eff->a[_G_]);
+
+  R[1][1] =  cb*cg;
+  R[1][2] = -cb*sg;
+  R[1][3] =  sb;
+
+  R[2][1] =  cg*sa*sb + ca*sg;
+  R[2][2] =  ca*cg - sa*sb*sg;
+  R[2][3] = -cb*sa;
+
+  R[3][1] = -ca*cg*sb + sa*sg;
+  R[3][2] =  cg*sa + ca*sb*sg;
+  R[3][3] =  ca*cb;
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  spatialInertia
+\date  Oct. 2026
+
+\remarks
+
+ converts the inertial parameters of a body, given relative to a local
+ frame (R,p), into a spatial inertia at the world origin
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     m   : mass
+ \param[in]     mcm : mass times center of mass in local coordinates
+ \param[in]     I   : inertia tensor about the local origin
+ \param[in]     R   : orientation of the local frame
+ \param[in]     p   : origin of the local frame
+ \param[out]    Is  : spatial inertia
+
+ ******************************************************************************/
+static void
+spatialInertia(double m, double *mcm, double I[][N_CART+1],
+	       double R[][N_CART+1], double *p,
+	       double Is[][N_SPATIAL+1])
+{
+  int    i,j,k;
+  double c[N_CART+1];
+  double h[N_CART+1];
+  double RI[N_CART+1][N_CART+1];
+  double P[N_CART+1][N_CART+1];
+  double Cx[N_CART+1][N_CART+1];
+  double H[N_CART+1][N_CART+1];
+  double aux;
+
+  // first moment in world orientation about the local and the world origin
+  for (i=1; i<=N_CART; ++i) {
+    c[i] = 0.0;
+    for (j=1; j<=N_CART; ++j)
+      c[i] += R[i][j]*mcm[j];
+    h[i] = c[i] + m*p[i];
+  }
+
+  // R*I (the generated kernels only fill the upper triangle of I)
+  for (i=1; i<=N_CART; ++i) {
+    for (j=1; j<=N_CART; ++j) {
+      RI[i][j] = 0.0;
+      for (k=1; k<=N_CART; ++k)
+	RI[i][j] += R[i][k] * ((k <= j) ? I[k][j] : I[j][k]);
+    }
+  }
+
+  skew(p,P);
+  skew(c,Cx);
+  skew(h,H);
+
+  // rotational inertia about the world origin: R*I*R' - P*C - C*P - m*P*P
+  for (i=1; i<=N_CART; ++i) {
+    for (j=1; j<=N_CART; ++j) {
+      aux = 0.0;
+      for (k=1; k<=N_CART; ++k)
+	aux += RI[i][k]*R[j][k] - P[i][k]*Cx[k][j] - Cx[i][k]*P[k][j] - m*P[i][k]*P[k][j];
+      Is[i][j] = aux;
+      Is[i][j+N_CART] = H[i][j];
+      Is[i+N_CART][j] = H[j][i];
+      Is[i+N_CART][j+N_CART] = (i == j) ? m : 0.0;
+    }
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  coriolisFactor
+\date  Oct. 2026
+
+\remarks
+
+ computes B = 1/2 ( vx* I + (I v)xbar* - I vx ) of one body, which
+ fulfills B*v = vx* I v and B + B' = dI/dt, the two properties needed for
+ the skew symmetry of Mdot-2C. vx and vx* are the spatial cross product
+ operators for motion and force vectors, and (f)xbar* v = vx* f.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     v   : spatial velocity of the body
+ \param[in]     I   : spatial inertia of the body
+ \param[out]    B   : Coriolis factor of the body
+
+ ******************************************************************************/
+static void
+coriolisFactor(double *v, double I[][N_SPATIAL+1], double B[][N_SPATIAL+1])
+{
+  int    i,j,k;
+  double W[N_CART+1][N_CART+1];
+  double U[N_CART+1][N_CART+1];
+  double Vm[N_SPATIAL+1][N_SPATIAL+1];
+  double Vf[N_SPATIAL+1][N_SPATIAL+1];
+  double F[N_SPATIAL+1][N_SPATIAL+1];
+  double f[N_SPATIAL+1];
+  double aux;
+
+  skew(&v[0],W);
+  skew(&v[N_CART],U);
+
+  // motion cross product matrix [W 0; U W], force cross product matrix [W U; 0 W]
+  for (i=1; i<=N_CART; ++i) {
+    for (j=1; j<=N_CART; ++j) {
+      Vm[i][j] = Vm[i+N_CART][j+N_CART] = W[i][j];
+      Vm[i][j+N_CART] = 0.0;
+      Vm[i+N_CART][j] = U[i][j];
+
+      Vf[i][j] = Vf[i+N_CART][j+N_CART] = W[i][j];
+      Vf[i][j+N_CART] = U[i][j];
+      Vf[i+N_CART][j] = 0.0;
+    }
+  }
+
+  // momentum f = I*v and its xbar* operator [-n~ -f~; -f~ 0]
+  for (i=1; i<=N_SPATIAL; ++i) {
+    f[i] = 0.0;
+    for (j=1; j<=N_SPATIAL; ++j)
+      f[i] += I[i][j]*v[j];
+  }
+  skew(&f[0],W);
+  skew(&f[N_CART],U);
+  for (i=1; i<=N_CART; ++i) {
+    for (j=1; j<=N_CART; ++j) {
+      F[i][j] = -W[i][j];
+      F[i][j+N_CART] = F[i+N_CART][j] = -U[i][j];
+      F[i+N_CART][j+N_CART] = 0.0;
+    }
+  }
+
+  for (i=1; i<=N_SPATIAL; ++i) {
+    for (j=1; j<=N_SPATIAL; ++j) {
+      aux = F[i][j];
+      for (k=1; k<=N_SPATIAL; ++k)
+	aux += Vf[i][k]*I[k][j] - I[i][k]*Vm[k][j];
+      B[i][j] = 0.5*aux;
+    }
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  crossMotion
+\date  Oct. 2026
+
+\remarks
+
+ spatial cross product of two motion vectors c = v x m
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     v   : spatial motion vector
+ \param[in]     m   : spatial motion vector
+ \param[out]    c   : the cross product
+
+ ******************************************************************************/
+static void
+crossMotion(double *v, double *m, double *c)
+{
+  c[1] = v[2]*m[3] - v[3]*m[2];
+  c[2] = v[3]*m[1] - v[1]*m[3];
+  c[3] = v[1]*m[2] - v[2]*m[1];
+
+  c[4] = v[2]*m[6] - v[3]*m[5] + v[5]*m[3] - v[6]*m[2];
+  c[5] = v[3]*m[4] - v[1]*m[6] + v[6]*m[1] - v[4]*m[3];
+  c[6] = v[1]*m[5] - v[2]*m[4] + v[4]*m[2] - v[5]*m[1];
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  skew
+\date  Oct. 2026
+
+\remarks
+
+ the skew symmetric cross product matrix of a 3D vector
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     v   : 3D vector
+ \param[out]    S   : cross product matrix, i.e., S*x = v x x
+
+ ******************************************************************************/
+static void
+skew(double *v, double S[][N_CART+1])
+{
+  S[1][1] =  0.0;  S[1][2] = -v[3]; S[1][3] =  v[2];
+  S[2][1] =  v[3]; S[2][2] =  0.0;  S[2][3] = -v[1];
+  S[3][1] = -v[2]; S[3][2] =  v[1]; S[3][3] =  0.0;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  vsincos
+\date  Oct. 2026
+
+\remarks
+
+ sine and cosine of all lanes of a SIMD register at once, as libm has no
+ vectorized sincos. Follows the Cephes algorithm: reduction to an octant
+ with a 3-term Cody-Waite split of pi/4 and minimax polynomials, which is
+ accurate to about 1e-16 for the joint ranges of the Panda.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     x   : angles
+ \param[out]    s   : sin(x)
+ \param[out]    c   : cos(x)
+
+ ******************************************************************************/
+static void
+vsincos(vdouble *x, vdouble *s, vdouble *c)
+{
+  vdouble ax,y,z,zz,ps,pc;
+  vlong   j,sx,swap;
+
+  // work with |x| and flip the sign of the sine at the end
+  sx = (vlong)(*x) & SIGN_BIT;
+  ax = (vdouble)((vlong)(*x) & ~SIGN_BIT);
+
+  // octant of |x|, rounded to an even octant, and the remainder in [-pi/4,pi/4]
+  j  = __builtin_convertvector(ax*1.27323954473516268615,vlong);
+  j  = (j+1) & ~1LL;
+  y  = __builtin_convertvector(j,vdouble);
+  z  = ((ax - y*7.85398125648498535156E-1) - y*3.77489470793079817668E-8)
+    - y*2.69515142907905952645E-15;
+  zz = z*z;
+
+  ps = z + z*zz*(((((1.58962301576546568060E-10*zz - 2.50507477628578072866E-8)*zz
+		    + 2.75573136213857245213E-6)*zz - 1.98412698295895385996E-4)*zz
+		  + 8.33333333332211858878E-3)*zz - 1.66666666666666307295E-1);
+  pc = 1.0 - 0.5*zz + zz*zz*(((((-1.13585365213876817300E-11*zz + 2.08757008419747316778E-9)*zz
+				- 2.75573141792967388112E-7)*zz + 2.48015872888517045348E-5)*zz
+			      - 1.38888888888730564116E-3)*zz + 4.16666666666665929218E-2);
+
+  // quadrants 1 and 3 swap sine and cosine, and the signs follow the quadrant
+  swap = (vlong)((j & 2) != 0);
+  *s = (vdouble)((((vlong)ps & ~swap) | ((vlong)pc & swap)) ^ ((j & 4) << 61) ^ sx);
+  *c = (vdouble)((((vlong)pc & ~swap) | ((vlong)ps & swap)) ^ (((j+2) & 4) << 61));
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  storeFrame
+\date  Oct. 2026
+
+\remarks
+
+ stores a batch of frames from SIMD registers into the output arrays
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     R   : orientation of the frame
+ \param[in]     p   : origin of the frame
+ \param[out]    pos : the batch of frame origins
+ \param[out]    rot : the batch of frame orientations (or NULL)
+
+ ******************************************************************************/
+static void
+storeFrame(vdouble R[][N_CART+1], vdouble *p, double pos[][N_FK_LANES],
+	   double rot[][N_CART+1][N_FK_LANES])
+{
+  int r,c;
+
+  for (r=1; r<=N_CART; ++r) {
+    memcpy(pos[r],&p[r],sizeof(vdouble));
+    if (rot != NULL)
+      for (c=1; c<=N_CART; ++c)
+	memcpy(rot[r][c],&R[r][c],sizeof(vdouble));
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  armFrames
+\date  Oct. 2026
+
+\remarks
+
+ forward kinematics of one arm on the fixed base, which only computes the
+ orientations and origins of the joint frames in world coordinates
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : which arm (1 to N_ARMS)
+ \param[in]     state : the joint state of the entire robot
+ \param[out]    R     : orientation of the joint frames
+ \param[out]    p     : origin of the joint frames
+
+ ******************************************************************************/
+static void
+armFrames(int arm, SL_Jstate *state, double R[][N_CART+1][N_CART+1],
+	  double p[][N_CART+1])
+{
+  int    i,r,c;
+  double th,ct,st;
+
+  for (i=1; i<=N_DOFS_PER_ROBOT; ++i) {
+
+    th = state[(arm-1)*N_DOFS_PER_ROBOT+i].th;
+
+    // the rows of R[i] are the rows of R[i-1] rotated into link i
+    if (i == 1) {
+      th += arm_mount_rot[arm];
+      for (r=1; r<=N_CART; ++r) {
+	p[i][r] = arm_mount_pos[arm][r];
+	for (c=1; c<=N_CART; ++c)
+	  R[i-1][r][c] = (r == c) ? 1.0 : 0.0;
+      }
+    } else {
+      for (r=1; r<=N_CART; ++r) {
+	p[i][r] = p[i-1][r];
+	for (c=1; c<=N_CART; ++c)
+	  p[i][r] += R[i-1][r][c]*joint_offset[i][c];
+      }
+    }
+
+    ct = cos(th);
+    st = sin(th);
+    for (r=1; r<=N_CART; ++r)
+      rotToChild(i,ct,st,R[i-1][r],R[i][r]);
+
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  armLinkParameters
+\date  Oct. 2026
+
+\remarks
+
+ collects the inertial parameters of all links of an arm in local link
+ coordinates, with full symmetric inertia tensors about the joint origin.
+ The endeffector is lumped into the last link, as in armInertias().
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : which arm (1 to N_ARMS)
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[out]    m     : mass of each link
+ \param[out]    mcm   : mass times center of mass of each link
+ \param[out]    I     : inertia tensor of each link (or NULL)
+
+ ******************************************************************************/
+static void
+armLinkParameters(int arm, SL_endeff *eff, double *m, double mcm[][N_CART+1],
+		  double I[][N_CART+1][N_CART+1])
+{
+  int    i,r,c,k;
+  int    dof;
+  double Reff[N_CART+1][N_CART+1];
+  double h[N_CART+1];
+  double P[N_CART+1][N_CART+1];
+  double H[N_CART+1][N_CART+1];
+  double me;
+
+  for (i=1; i<=N_DOFS_PER_ROBOT; ++i) {
+    dof = (arm-1)*N_DOFS_PER_ROBOT+i;
+    m[i] = links[dof].m;
+    for (r=1; r<=N_CART; ++r) {
+      mcm[i][r] = links[dof].mcm[r];
+      if (I != NULL)
+	for (c=1; c<=N_CART; ++c)
+	  I[i][r][c] = (r <= c) ? links[dof].inertia[r][c] : links[dof].inertia[c][r];
+    }
+  }
+
+  // the endeffector is a mass distribution without rotational inertia about
+  // its own origin, shifted to the origin of the last joint
+  me = eff[arm].m;
+  endeffRotation(arm,&eff[arm],Reff);
+  for (r=1; r<=N_CART; ++r) {
+    h[r] = 0.0;
+    for (c=1; c<=N_CART; ++c)
+      h[r] += Reff[r][c]*eff[arm].mcm[c];
+  }
+  skew(eff[arm].x,P);
+  skew(h,H);
+
+  i = N_DOFS_PER_ROBOT;
+  m[i] += me;
+  for (r=1; r<=N_CART; ++r) {
+    mcm[i][r] += me*eff[arm].x[r] + h[r];
+    if (I != NULL)
+      for (c=1; c<=N_CART; ++c)
+	for (k=1; k<=N_CART; ++k)
+	  I[i][r][c] -= P[r][k]*H[k][c] + H[r][k]*P[k][c] + me*P[r][k]*P[k][c];
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  armInvDyn
+\date  Oct. 2026
+
+\remarks
+
+ Newton-Euler inverse dynamics of one arm on the fixed base. The recursion
+ runs in local link coordinates, where the joint transforms of the Panda
+ are sparse: a rotation about Z by the joint angle, preceded by a fixed
+ rotation of +-90deg about X (or the mount rotation about Z for the first
+ joint). The base does not move, such that the recursion starts with the
+ gravity acceleration only.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : which arm (1 to N_ARMS)
+ \param[in]     q     : joint angles of this arm
+ \param[in]     qd    : joint velocities of this arm
+ \param[in]     qdd   : joint accelerations of this arm
+ \param[in]     g     : gravity constant
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[in]     ux    : external forces on the links of this arm, in world
+                        coordinates at the joint origins (or NULL)
+ \param[out]    tau   : joint torques
+
+ ******************************************************************************/
+static void
+armInvDyn(int arm, double *q, double *qd, double *qdd, double g,
+	  SL_endeff *eff, SL_uext *ux, double *tau)
+{
+  int    i,r,c;
+  double m[N_DOFS_PER_ROBOT+1];
+  double mcm[N_DOFS_PER_ROBOT+1][N_CART+1];
+  double I[N_DOFS_PER_ROBOT+1][N_CART+1][N_CART+1];
+  double ct[N_DOFS_PER_ROBOT+1];
+  double st[N_DOFS_PER_ROBOT+1];
+  double w[N_DOFS_PER_ROBOT+1][N_CART+1];
+  double v[N_DOFS_PER_ROBOT+1][N_CART+1];
+  double dw[N_DOFS_PER_ROBOT+1][N_CART+1];
+  double a[N_DOFS_PER_ROBOT+1][N_CART+1];
+  double n[N_DOFS_PER_ROBOT+1][N_CART+1];
+  double f[N_DOFS_PER_ROBOT+1][N_CART+1];
+  double R[N_CART+1][N_CART+1];
+  double Rp[N_CART+1][N_CART+1];
+  double u[N_CART+1];
+  double ua[N_CART+1];
+  double hl[N_CART+1];
+  double ha[N_CART+1];
+  double t1[N_CART+1];
+  double t2[N_CART+1];
+  double *r0;
+
+  armLinkParameters(arm,eff,m,mcm,I);
+
+  // the first joint combines the mount rotation and the joint rotation
+  for (i=1; i<=N_DOFS_PER_ROBOT; ++i) {
+    ct[i] = cos(q[i] + ((i == 1) ? arm_mount_rot[arm] : 0.0));
+    st[i] = sin(q[i] + ((i == 1) ? arm_mount_rot[arm] : 0.0));
+  }
+
+  // forward recursion: the fixed base only contributes gravity, which is
+  // invariant to the rotation about Z of the first joint
+  for (i=1; i<=N_DOFS_PER_ROBOT; ++i) {
+
+    if (i == 1) {
+      for (r=1; r<=N_CART; ++r)
+	w[i][r] = v[i][r] = dw[i][r] = a[i][r] = 0.0;
+      a[i][_Z_] = g;
+    } else {
+      r0 = joint_offset[i];
+      crossProduct(w[i-1],r0,u);
+      crossProduct(dw[i-1],r0,ua);
+      for (r=1; r<=N_CART; ++r) {
+	u[r]  += v[i-1][r];
+	ua[r] += a[i-1][r];
+      }
+      rotToChild(i,ct[i],st[i],w[i-1],w[i]);
+      rotToChild(i,ct[i],st[i],u,v[i]);
+      rotToChild(i,ct[i],st[i],dw[i-1],dw[i]);
+      rotToChild(i,ct[i],st[i],ua,a[i]);
+    }
+
+    // joint motion about the local Z axis, and its velocity product terms
+    dw[i][1] += w[i][2]*qd[i];
+    dw[i][2] -= w[i][1]*qd[i];
+    dw[i][3] += qdd[i];
+    a[i][1]  += v[i][2]*qd[i];
+    a[i][2]  -= v[i][1]*qd[i];
+    w[i][3]  += qd[i];
+
+  }
+
+  // net forces of each link: f = I*a + v x* I*v in spatial notation
+  for (i=1; i<=N_DOFS_PER_ROBOT; ++i) {
+
+    crossProduct(w[i],mcm[i],hl);
+    crossProduct(mcm[i],v[i],ha);
+    for (r=1; r<=N_CART; ++r) {
+      hl[r] += m[i]*v[i][r];
+      for (c=1; c<=N_CART; ++c)
+	ha[r] += I[i][r][c]*w[i][c];
+    }
+
+    crossProduct(dw[i],mcm[i],f[i]);
+    crossProduct(w[i],hl,t1);
+    for (r=1; r<=N_CART; ++r)
+      f[i][r] += m[i]*a[i][r] + t1[r];
+
+    crossProduct(mcm[i],a[i],n[i]);
+    crossProduct(w[i],ha,t1);
+    crossProduct(v[i],hl,t2);
+    for (r=1; r<=N_CART; ++r) {
+      n[i][r] += t1[r] + t2[r];
+      for (c=1; c<=N_CART; ++c)
+	n[i][r] += I[i][r][c]*dw[i][c];
+    }
+
+  }
+
+  // external forces need the orientation of each link in world coordinates
+  if (ux != NULL) {
+    for (r=1; r<=N_CART; ++r)
+      for (c=1; c<=N_CART; ++c)
+	R[r][c] = (r == c) ? 1.0 : 0.0;
+    for (i=1; i<=N_DOFS_PER_ROBOT; ++i) {
+      for (r=1; r<=N_CART; ++r)
+	rotToChild(i,ct[i],st[i],R[r],Rp[r]);
+      for (r=1; r<=N_CART; ++r) {
+	for (c=1; c<=N_CART; ++c) {
+	  R[r][c] = Rp[r][c];
+	  f[i][c] -= R[r][c]*ux[i].f[r];
+	  n[i][c] -= R[r][c]*ux[i].t[r];
+	}
+      }
+    }
+  }
+
+  // backward recursion
+  for (i=N_DOFS_PER_ROBOT; i>=1; --i) {
+
+    tau[i] = n[i][_Z_];
+
+    if (i > 1) {
+      rotToParent(i,ct[i],st[i],f[i],t1);
+      rotToParent(i,ct[i],st[i],n[i],t2);
+      crossProduct(joint_offset[i],t1,u);
+      for (r=1; r<=N_CART; ++r) {
+	f[i-1][r] += t1[r];
+	n[i-1][r] += t2[r] + u[r];
+      }
+    }
+
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  armInertiaMatrix
+\date  Oct. 2026
+
+\remarks
+
+ composite rigid body algorithm for the 7x7 inertia matrix of one arm on
+ the fixed base
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : which arm (1 to N_ARMS)
+ \param[in]     state : the joint state of the entire robot
+ \param[in]     eff   : the endeffector parameters of the entire robot
+ \param[out]    M     : the inertia matrix of this arm
+
+ ******************************************************************************/
+static void
+armInertiaMatrix(int arm, SL_Jstate *state, SL_endeff *eff,
+		 double M[][N_DOFS_PER_ROBOT+1])
+{
+  int    i,j,r,c;
+  ArmState a;
+  double Ic[N_SPATIAL+1][N_SPATIAL+1];
+  double F[N_SPATIAL+1];
+  double aux;
+
+  armKinematics(arm,state,&a);
+  armInertias(arm,eff,&a);
+
+  for (r=1; r<=N_SPATIAL; ++r)
+    for (c=1; c<=N_SPATIAL; ++c)
+      Ic[r][c] = 0.0;
+
+  for (j=N_DOFS_PER_ROBOT; j>=1; --j) {
+
+    for (r=1; r<=N_SPATIAL; ++r)
+      for (c=1; c<=N_SPATIAL; ++c)
+	Ic[r][c] += a.I[j][r][c];
+
+    for (r=1; r<=N_SPATIAL; ++r) {
+      F[r] = 0.0;
+      for (c=1; c<=N_SPATIAL; ++c)
+	F[r] += Ic[r][c]*a.S[j][c];
+    }
+
+    for (i=1; i<=j; ++i) {
+      aux = 0.0;
+      for (r=1; r<=N_SPATIAL; ++r)
+	aux += a.S[i][r]*F[r];
+      M[i][j] = M[j][i] = aux;
+    }
+
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  choleskySolve
+\date  Oct. 2026
+
+\remarks
+
+ solves M*x = b for the symmetric positive definite 7x7 inertia matrix of
+ an arm with a Cholesky decomposition. M is overwritten by its Cholesky
+ factor, and b by the solution.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in,out] M   : the inertia matrix of an arm
+ \param[in,out] b   : right hand side, and the solution on return
+
+ ******************************************************************************/
+static void
+choleskySolve(double M[][N_DOFS_PER_ROBOT+1], double *b)
+{
+  int    i,j,k;
+  double aux;
+
+  // M = L*L', with L in the lower triangle of M
+  for (j=1; j<=N_DOFS_PER_ROBOT; ++j) {
+    aux = M[j][j];
+    for (k=1; k<j; ++k)
+      aux -= M[j][k]*M[j][k];
+    M[j][j] = sqrt(aux);
+    for (i=j+1; i<=N_DOFS_PER_ROBOT; ++i) {
+      aux = M[i][j];
+      for (k=1; k<j; ++k)
+	aux -= M[i][k]*M[j][k];
+      M[i][j] = aux/M[j][j];
+    }
+  }
+
+  // forward and backward substitution
+  for (i=1; i<=N_DOFS_PER_ROBOT; ++i) {
+    for (k=1; k<i; ++k)
+      b[i] -= M[i][k]*b[k];
+    b[i] /= M[i][i];
+  }
+  for (i=N_DOFS_PER_ROBOT; i>=1; --i) {
+    for (k=i+1; k<=N_DOFS_PER_ROBOT; ++k)
+      b[i] -= M[k][i]*b[k];
+    b[i] /= M[i][i];
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  rotToChild
+\date  Oct. 2026
+
+\remarks
+
+ rotates a vector from the coordinates of the parent link into the
+ coordinates of link i, i.e., y = Rz(th)' * Rfix' * x. For the first
+ joint, the mount rotation is already contained in the joint angle.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     i   : joint number within the arm
+ \param[in]     ct  : cosine of the joint angle
+ \param[in]     st  : sine of the joint angle
+ \param[in]     x   : vector in parent coordinates
+ \param[out]    y   : vector in link coordinates
+
+ ******************************************************************************/
+static void
+rotToChild(int i, double ct, double st, double *x, double *y)
+{
+  double x2,x3;
+
+  if (i == 1) {
+    x2 = x[2];
+    x3 = x[3];
+  } else {
+    x2 =  joint_rot_s[i]*x[3];
+    x3 = -joint_rot_s[i]*x[2];
+  }
+
+  y[1] =  ct*x[1] + st*x2;
+  y[2] = -st*x[1] + ct*x2;
+  y[3] =  x3;
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  rotToParent
+\date  Oct. 2026
+
+\remarks
+
+ rotates a vector from the coordinates of link i into the coordinates of
+ the parent link, i.e., the inverse of rotToChild()
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     i   : joint number within the arm
+ \param[in]     ct  : cosine of the joint angle
+ \param[in]     st  : sine of the joint angle
+ \param[in]     x   : vector in link coordinates
+ \param[out]    y   : vector in parent coordinates
+
+ ******************************************************************************/
+static void
+rotToParent(int i, double ct, double st, double *x, double *y)
+{
+  double y2;
+
+  y[1] = ct*x[1] - st*x[2];
+  y2   = st*x[1] + ct*x[2];
+
+  if (i == 1) {
+    y[2] = y2;
+    y[3] = x[3];
+  } else {
+    y[2] = -joint_rot_s[i]*x[3];
+    y[3] =  joint_rot_s[i]*y2;
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  crossProduct
+\date  Oct. 2026
+
+\remarks
+
+ c = a x b for 3D vectors
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     a   : first vector
+ \param[in]     b   : second vector
+ \param[out]    c   : cross product
+
+ ******************************************************************************/
+static void
+crossProduct(double *a, double *b, double *c)
+{
+  c[1] = a[2]*b[3] - a[3]*b[2];
+  c[2] = a[3]*b[1] - a[1]*b[3];
+  c[3] = a[1]*b[2] - a[2]*b[1];
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  setHomogeneous
+\date  Oct. 2026
+
+\remarks
+
+ assembles a 4x4 homogeneous transformation from a rotation and a position
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     R   : rotation matrix
+ \param[in]     p   : position
+ \param[out]    A   : homogeneous transformation
+
+ ******************************************************************************/
+static void
+setHomogeneous(double R[][N_CART+1], double *p, double **A)
+{
+  int r,c;
+
+  for (r=1; r<=N_CART; ++r) {
+    for (c=1; c<=N_CART; ++c)
+      A[r][c] = R[r][c];
+    A[r][N_CART+1] = p[r];
+    A[N_CART+1][r] = 0.0;
+  }
+  A[N_CART+1][N_CART+1] = 1.0;
+
+}
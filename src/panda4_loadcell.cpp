@@ -0,0 +1,469 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_loadcell.cpp
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  The Axia80 load cell streams at 3.9kHz over EtherCAT. Instead of
+  running the EtherCAT cycle in the torque callback, where any hiccup of
+  the bus delays the torque reply to the Franka controller, a real-time
+  thread of its own runs the EtherCAT cycle at the sensor rate, averages
+  the last n readings (boxcar oversampling), and publishes the result with
+  a time stamp in a triple buffer. The callback only picks up the latest
+  sample, which never blocks and never waits for the bus.
+
+  Without EtherCAT hardware, a loopback source takes the place of the load
+  cell: it produces the wrench set with panda4_setLoopbackWrench at the
+  sensor rate, such that the acquisition can be tested on any machine.
+
+  ============================================================================*/
+
+// system includes
+#include <atomic>
+#include <mutex>
+#include <pthread.h>
+#include <time.h>
+
+#include "SL_system_headers.h"
+
+// private includes
+#include "utility.h"
+#include "SL.h"
+#include "SL_user.h"
+#include "panda4_timing.h"
+#include "panda4_loadcell.h"
+#include "panda4_rt.h"
+
+#ifdef AXIA80
+#include "ethercat_communication.h"
+#include "axia80_ethercat.h"
+using ethercat_communication::EthercatCommunication;
+using axia80_ethercat::Axia80Ethercat;
+#endif
+
+// local variables
+#define SLOT_NEW 4
+
+typedef struct LoadCellSlot {
+  Panda4LoadCellSample sample[3];
+  std::atomic<int>     middle;   // index of the exchange copy, plus SLOT_NEW
+  int                  back;     // index of the copy owned by the writer
+  int                  front;    // index of the copy owned by the reader
+} LoadCellSlot;
+
+static LoadCellSlot       loadcell_slot;
+static std::atomic<int>   run_loadcell_flag(FALSE);
+static std::atomic<int>   tare_request(FALSE);
+static pthread_t          lthread;              // thread for the load cell acquisition
+static int                loadcell_loopback = FALSE;
+static int                loadcell_n_avg = 1;
+static int                loadcell_cpu = -1;
+
+// statistics, written by the acquisition thread only
+static std::atomic<long>  loadcell_readings(0);
+static std::atomic<long>  loadcell_overruns(0); // readings missed by a late cycle
+static unsigned long      loadcell_io_max = 0;  // longest EtherCAT cycle in ns
+static double             loadcell_io_sum = 0;
+
+// the loopback source
+static std::mutex         loopback_mutex;
+static double             loopback_ft[2*N_CART];
+static double             loopback_offset[2*N_CART];
+
+#ifdef AXIA80
+static EthercatCommunication *ethercat_ptr = NULL;
+static Axia80Ethercat        *axia80_ptr = NULL;
+#endif
+
+// local functions
+static void *loadCellThread(void *);
+static void  readLoadCellOnce(double *ft);
+static void  tareLoadCellOnce(void);
+static void  writeLoadCellSlot(const Panda4LoadCellSample &sample);
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_startLoadCell
+\date  Oct. 2026
+
+\remarks
+
+ initializes the load cell, or the loopback source, and starts the
+ acquisition thread
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     loopback : TRUE for the loopback source instead of EtherCAT
+ \param[in]     n_avg    : number of readings to average (1 to N_LOADCELL_AVG)
+ \param[in]     cpu      : the CPU of the acquisition thread, or -1 for any
+
+ returns TRUE on success
+
+ ******************************************************************************/
+int
+panda4_startLoadCell(int loopback, int n_avg, int cpu)
+{
+  int                 rc;
+
+  if (run_loadcell_flag) {
+    printf("Load cell acquisition is already running\n");
+    return FALSE;
+  }
+
+  loadcell_loopback = loopback;
+  loadcell_n_avg    = n_avg < 1 ? 1 : (n_avg > N_LOADCELL_AVG ? N_LOADCELL_AVG : n_avg);
+  loadcell_cpu      = cpu;
+
+  if (!loadcell_loopback) {
+#ifdef AXIA80
+    ethercat_ptr = new EthercatCommunication();
+    ethercat_ptr->InitEthercat("enp2s0");
+    if (!ethercat_ptr->active_) {
+      printf("No active ethercat master running\n");
+      return FALSE;
+    }
+    axia80_ptr = new Axia80Ethercat();
+    axia80_ptr->InitAxia80( ethercat_ptr,
+			    1,
+			    axia80_ethercat::kSlot1,
+			    axia80_ethercat::k3900Hz,
+			    axia80_ethercat::kFilter4);
+#else
+    printf("This servo was built without the Axia80 load cell -- use the loopback\n");
+    return FALSE;
+#endif
+  }
+
+  // the slot starts empty: seq == 0
+  bzero((void *)loadcell_slot.sample,sizeof(loadcell_slot.sample));
+  loadcell_slot.back   = 0;
+  loadcell_slot.middle = 1;
+  loadcell_slot.front  = 2;
+
+  loadcell_readings = 0;
+  loadcell_overruns = 0;
+  loadcell_io_max   = 0;
+  loadcell_io_sum   = 0;
+  tare_request      = FALSE;
+  run_loadcell_flag = TRUE;
+
+  // the thread takes the real-time profile of its role when it starts
+  if ((rc=pthread_create( &lthread, NULL, loadCellThread, NULL))) {
+    printf("pthread_create returned with %d\n",rc);
+    run_loadcell_flag = FALSE;
+    return FALSE;
+  }
+
+  printf("Load cell acquisition at %d Hz with %d-fold averaging%s\n",
+	 PANDA4_LOADCELL_RATE,loadcell_n_avg,loadcell_loopback ? " (loopback)" : "");
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_stopLoadCell
+\date  Oct. 2026
+
+\remarks
+
+ stops the acquisition thread
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_stopLoadCell(void)
+{
+  if (!run_loadcell_flag)
+    return;
+
+  run_loadcell_flag = FALSE;
+  pthread_join(lthread,NULL);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_readLoadCell
+\date  Oct. 2026
+
+\remarks
+
+ returns the latest load cell sample. This is wait-free and thus safe to
+ call from the torque callback, but only one thread may read.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[out]    sample : the latest sample
+
+ returns TRUE if there is a sample at all
+
+ ******************************************************************************/
+int
+panda4_readLoadCell(Panda4LoadCellSample *sample)
+{
+  if (loadcell_slot.middle.load() & SLOT_NEW)
+    loadcell_slot.front = loadcell_slot.middle.exchange(loadcell_slot.front) & ~SLOT_NEW;
+
+  *sample = loadcell_slot.sample[loadcell_slot.front];
+
+  return sample->seq > 0;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  writeLoadCellSlot
+\date  Oct. 2026
+
+\remarks
+
+ publishes a sample, replacing the previous one if the reader has not
+ picked it up yet
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     sample : the sample
+
+ ******************************************************************************/
+static void
+writeLoadCellSlot(const Panda4LoadCellSample &sample)
+{
+  loadcell_slot.sample[loadcell_slot.back] = sample;
+  loadcell_slot.back = loadcell_slot.middle.exchange(loadcell_slot.back | SLOT_NEW) & ~SLOT_NEW;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_tareLoadCell
+\date  Oct. 2026
+
+\remarks
+
+ asks the acquisition thread to zero the load cell, as the EtherCAT
+ master must only be used by this thread
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_tareLoadCell(void)
+{
+  tare_request = TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_setLoopbackWrench
+\date  Oct. 2026
+
+\remarks
+
+ sets the wrench that the loopback source reports
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     ft : force and torque (0 to 2*N_CART-1)
+
+ ******************************************************************************/
+void
+panda4_setLoopbackWrench(double *ft)
+{
+  std::lock_guard<std::mutex> lock(loopback_mutex);
+
+  memcpy(loopback_ft,ft,sizeof(loopback_ft));
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  readLoadCellOnce
+\date  Oct. 2026
+
+\remarks
+
+ runs one EtherCAT cycle and reads the load cell, or reads the loopback
+ source
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[out]    ft : force and torque (0 to 2*N_CART-1)
+
+ ******************************************************************************/
+static void
+readLoadCellOnce(double *ft)
+{
+  int i;
+
+  if (loadcell_loopback) {
+    std::lock_guard<std::mutex> lock(loopback_mutex);
+    for (i=0; i<2*N_CART; ++i)
+      ft[i] = loopback_ft[i] - loopback_offset[i];
+    return;
+  }
+
+#ifdef AXIA80
+  axia80_ethercat::Axia80Data data;
+
+  ethercat_ptr->RunEthercat();
+  axia80_ptr->ReadAxia80Data(&data,ft);
+#endif
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  tareLoadCellOnce
+\date  Oct. 2026
+
+\remarks
+
+ zeros the load cell, or the loopback source
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+static void
+tareLoadCellOnce(void)
+{
+  if (loadcell_loopback) {
+    std::lock_guard<std::mutex> lock(loopback_mutex);
+    memcpy(loopback_offset,loopback_ft,sizeof(loopback_offset));
+    return;
+  }
+
+#ifdef AXIA80
+  axia80_ptr->TareAxia80();
+#endif
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  loadCellThread
+\date  Oct. 2026
+
+\remarks
+
+ reads the load cell at its sample rate from the monotonic clock and
+ publishes the average of the last n_avg readings after every reading.
+ A cycle that is later than a full period skips the missed readings
+ instead of catching up with a burst.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+static void *
+loadCellThread(void *arg)
+{
+  int                  i,k,n = 0;
+  const long           period = 1000000000L/PANDA4_LOADCELL_RATE;
+  unsigned long        seq = 0, t0, t1, t_next;
+  double               ring[N_LOADCELL_AVG][2*N_CART];
+  Panda4LoadCellSample sample;
+  struct timespec      next;
+
+  // real-time priority just below the control threads of libfranka
+  panda4_rtThread(RT_ROLE_ETHERCAT,loadcell_cpu);
+
+  clock_gettime(CLOCK_MONOTONIC,&next);
+
+  while (run_loadcell_flag) {
+
+    next.tv_nsec += period;
+    if (next.tv_nsec >= 1000000000L) {
+      next.tv_nsec -= 1000000000L;
+      ++next.tv_sec;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&next,NULL);
+
+    t0 = panda4_timeNs();
+
+    if (tare_request.exchange(FALSE)) {
+      tareLoadCellOnce();
+      n = 0;  // readings before the tare must not be averaged in
+    }
+
+    k = (int)(seq % loadcell_n_avg);
+    readLoadCellOnce(ring[k]);
+
+    t1 = panda4_timeNs();
+    if (t1-t0 > loadcell_io_max)
+      loadcell_io_max = t1-t0;
+    loadcell_io_sum += t1-t0;
+
+    // boxcar average of the last n_avg readings
+    if (n < loadcell_n_avg)
+      ++n;
+    for (i=0; i<2*N_CART; ++i) {
+      sample.ft[i] = 0;
+      for (k=0; k<n; ++k)
+	sample.ft[i] += ring[(seq+loadcell_n_avg-k)%loadcell_n_avg][i];
+      sample.ft[i] /= (double)n;
+    }
+    sample.t_mono = t1;
+    sample.seq    = ++seq;
+    sample.n_avg  = n;
+    writeLoadCellSlot(sample);
+    loadcell_readings = seq;
+
+    // skip the readings that a late cycle missed
+    t_next = (unsigned long)next.tv_sec*1000000000UL + (unsigned long)next.tv_nsec;
+    if (t1 > t_next + period) {
+      loadcell_overruns += (t1 - t_next)/period;
+      next.tv_sec  = t1/1000000000UL;
+      next.tv_nsec = t1%1000000000UL;
+    }
+
+  }
+
+  return NULL;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_printLoadCellStats
+\date  Oct. 2026
+
+\remarks
+
+ prints the statistics of the load cell acquisition
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_printLoadCellStats(void)
+{
+  long n = loadcell_readings;
+
+  if (!run_loadcell_flag)
+    return;
+
+  printf("Load cell readings             = %ld%s\n",n,loadcell_loopback ? " (loopback)" : "");
+  printf("Load cell missed readings      = %ld\n",loadcell_overruns.load());
+  printf("Load cell cycle mean/max       = %.1f/%.1f us\n",
+	 n > 0 ? loadcell_io_sum/(double)n/1000. : 0.0,loadcell_io_max/1000.);
+  printf("Load cell averaging            = %d\n",loadcell_n_avg);
+}
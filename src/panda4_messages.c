@@ -0,0 +1,204 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_messages.c
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  Hashed dispatch of the messages in sm_simulation_message. Every process
+  registers its message names with a handler once at startup in an open
+  addressing hash table, where the slot of a message is its integer ID. A
+  received message costs one hash over its name, which has at most 20
+  characters, and usually a single string compare, independent of the
+  number of registered messages. The handlers read the payload in place
+  from the shared memory buffer, which is float aligned since all messages
+  of this package consist of floats.
+
+  ============================================================================*/
+
+// SL general includes of system headers
+#include "SL_system_headers.h"
+
+// private includes
+#include "SL.h"
+#include "SL_user.h"
+#include "SL_shared_memory.h"
+#include "utility.h"
+#include "panda4_messages.h"
+
+// local functions
+static unsigned int messageHash(const char *name);
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  messageHash
+\date  Oct. 2026
+
+\remarks
+
+ FNV-1a hash of a message name. The hash is never 0, which marks an empty
+ slot.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     name : the message name
+
+ ******************************************************************************/
+static unsigned int
+messageHash(const char *name)
+{
+  int          i;
+  unsigned int h = 2166136261u;
+
+  for (i=0; i<20 && name[i] != '\0'; ++i) {
+    h ^= (unsigned char) name[i];
+    h *= 16777619u;
+  }
+
+  return h != 0 ? h : 1;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_initMessages
+\date  Oct. 2026
+
+\remarks
+
+ clears a message table
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[out]    t : the message table
+
+ ******************************************************************************/
+void
+panda4_initMessages(Panda4MessageTable *t)
+{
+  bzero((void *)t,sizeof(Panda4MessageTable));
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_addMessage
+\date  Oct. 2026
+
+\remarks
+
+ registers a message name with its handler
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in,out] t       : the message table
+ \param[in]     name    : the message name
+ \param[in]     handler : the function that handles this message
+ \param[in]     arg     : the argument that is handed to the handler
+
+ returns the ID of the message, or 0 if the name is already registered or
+ the table is full
+
+ ******************************************************************************/
+int
+panda4_addMessage(Panda4MessageTable *t, const char *name,
+		  Panda4MessageHandler handler, int arg)
+{
+  int          i;
+  unsigned int h = messageHash(name);
+
+  if (panda4_findMessage(t,name) != 0) {
+    printf("Message >%s< is already registered\n",name);
+    return 0;
+  }
+
+  if (2*(t->n_messages+1) > N_MESSAGE_SLOTS) {
+    printf("Message table is full -- increase N_MESSAGE_SLOTS\n");
+    return 0;
+  }
+
+  // slot 0 is not used, such that all IDs are positive
+  i = h & (N_MESSAGE_SLOTS-1);
+  while (i == 0 || t->hash[i] != 0)
+    i = (i+1) & (N_MESSAGE_SLOTS-1);
+
+  strncpy(t->name[i],name,sizeof(t->name[i])-1);
+  t->hash[i]    = h;
+  t->handler[i] = handler;
+  t->arg[i]     = arg;
+  ++t->n_messages;
+
+  return i;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_findMessage
+\date  Oct. 2026
+
+\remarks
+
+ resolves a message name to its ID
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     t    : the message table
+ \param[in]     name : the message name
+
+ returns the ID of the message, or 0 if the name is not registered
+
+ ******************************************************************************/
+int
+panda4_findMessage(Panda4MessageTable *t, const char *name)
+{
+  int          i;
+  unsigned int h = messageHash(name);
+
+  i = h & (N_MESSAGE_SLOTS-1);
+  while (i == 0 || t->hash[i] != 0) {
+    if (t->hash[i] == h && strncmp(t->name[i],name,sizeof(t->name[i])) == 0)
+      return i;
+    i = (i+1) & (N_MESSAGE_SLOTS-1);
+  }
+
+  return 0;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_dispatchMessage
+\date  Oct. 2026
+
+\remarks
+
+ calls the handler of a message in sm_simulation_message with its payload
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     t    : the message table
+ \param[in]     name : the message name
+ \param[in]     k    : index of message in shared memory
+
+ returns TRUE if the message was handled, FALSE if it is not registered
+
+ ******************************************************************************/
+int
+panda4_dispatchMessage(Panda4MessageTable *t, const char *name, int k)
+{
+  int id = panda4_findMessage(t,name);
+
+  if (id == 0)
+    return FALSE;
+
+  (*t->handler[id])((const float *)(sm_simulation_message->buf+sm_simulation_message->moff[k]),
+		    t->arg[id]);
+
+  return TRUE;
+}
@@ -0,0 +1,414 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_record.c
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  Recording of the robot state stream of the Panda servo into a binary
+  file, and reading of such recordings for the replay of the servo.
+
+  Every arm has its own lock-free single-producer ring, such that the
+  torque callback of an arm only copies one record and never blocks, and
+  the servo thread has ring 0 for the command records. A background
+  thread merges the rings by the stamps of the records and writes them to
+  the file, such that the file is in the order in which the ticks
+  happened. If a ring is full, the record is dropped and counted.
+
+  ============================================================================*/
+
+// SL general includes of system headers
+#include "SL_system_headers.h"
+#include <pthread.h>
+
+// private includes
+#include "SL.h"
+#include "SL_user.h"
+#include "SL_unix_common.h"
+#include "utility.h"
+#include "panda4_record.h"
+#include "panda4_rt.h"
+#include "panda4_timing.h"
+
+// local variables
+typedef struct {
+  Panda4Record  r[N_RECORD_RING];
+  unsigned long head;                       // next record to write to file
+  unsigned long tail;                       // next free slot
+} RecordRing;
+
+/* a record is pushed to its ring within a tick of its stamp, such that
+   records older than this are complete in all rings and can be merged */
+#define RECORD_MERGE_DELAY_NS 10000000UL
+
+static RecordRing    record_ring[N_ARMS+1];   // 0 is the servo thread
+static FILE         *record_fp = NULL;
+static int           record_flag = FALSE;
+static long          record_overflows = 0;
+static pthread_t     rthread;               // thread for writing the records
+static FILE         *replay_fp = NULL;
+
+// local functions
+static void *recordThread(void *);
+static int   drainRecordRings(unsigned long t_limit);
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_startRecording
+\date  Oct. 2026
+
+\remarks
+
+ opens a recording file and starts the thread that writes the records
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     fname      : the file name
+ \param[in]     first_arm  : the first arm of the servo
+ \param[in]     last_arm   : the last arm of the servo
+ \param[in]     servo_rate : the rate of the servo
+
+ returns TRUE on success
+
+ ******************************************************************************/
+int
+panda4_startRecording(char *fname, int first_arm, int last_arm, int servo_rate)
+{
+  int                 rc;
+  Panda4RecordHeader  h;
+
+  if (panda4_isRecording()) {
+    printf("Recording is already running\n");
+    return FALSE;
+  }
+
+  record_fp = fopen(fname,"w");
+  if (record_fp == NULL) {
+    printf("Couldn't open file >%s< for writing\n",fname);
+    return FALSE;
+  }
+
+  bzero((void *)&h,sizeof(h));
+  strcpy(h.magic,PANDA4_RECORD_MAGIC);
+  h.version     = PANDA4_RECORD_VERSION;
+  h.record_size = sizeof(Panda4Record);
+  h.first_arm   = first_arm;
+  h.last_arm    = last_arm;
+  h.servo_rate  = servo_rate;
+  fwrite(&h,sizeof(h),1,record_fp);
+
+  bzero((void *)record_ring,sizeof(record_ring));
+  record_overflows = 0;
+  __atomic_store_n(&record_flag,TRUE,__ATOMIC_RELEASE);
+
+  // the thread demotes itself to the background role of panda4_rt
+  if ((rc=pthread_create( &rthread, NULL, recordThread, NULL))) {
+    printf("pthread_create returned with %d\n",rc);
+    record_flag = FALSE;
+    fclose(record_fp);
+    record_fp = NULL;
+    return FALSE;
+  }
+
+  printf("Recording to >%s<\n",fname);
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_stopRecording
+\date  Oct. 2026
+
+\remarks
+
+ stops the recording, writes all remaining records and closes the file
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_stopRecording(void)
+{
+  if (!panda4_isRecording())
+    return;
+
+  __atomic_store_n(&record_flag,FALSE,__ATOMIC_RELEASE);
+  pthread_join(rthread,NULL);
+
+  fclose(record_fp);
+  record_fp = NULL;
+
+  if (record_overflows > 0)
+    printf("Recording dropped %ld records\n",record_overflows);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_isRecording
+\date  Oct. 2026
+
+\remarks
+
+ returns TRUE while a recording is running
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+int
+panda4_isRecording(void)
+{
+  return __atomic_load_n(&record_flag,__ATOMIC_ACQUIRE);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_record
+\date  Oct. 2026
+
+\remarks
+
+ copies a record into the ring of its arm, or into ring 0 for a command
+ record. Only the control thread of this arm may call this function for
+ a state record, and only the servo thread for a command record.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     r : the record
+
+ ******************************************************************************/
+void
+panda4_record(Panda4Record *r)
+{
+  RecordRing    *q;
+  unsigned long  tail;
+
+  if (!panda4_isRecording())
+    return;
+
+  q = &record_ring[r->type == PANDA4_RECORD_COMMAND ? 0 : r->arm];
+
+  tail = __atomic_load_n(&q->tail,__ATOMIC_RELAXED);
+  if (tail - __atomic_load_n(&q->head,__ATOMIC_ACQUIRE) >= N_RECORD_RING) {
+    __atomic_fetch_add(&record_overflows,1,__ATOMIC_RELAXED);
+    return;
+  }
+
+  memcpy(&q->r[tail%N_RECORD_RING],r,sizeof(Panda4Record));
+  __atomic_store_n(&q->tail,tail+1,__ATOMIC_RELEASE);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_recordOverflows
+\date  Oct. 2026
+
+\remarks
+
+ returns the number of records that were dropped since the recording started
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+long
+panda4_recordOverflows(void)
+{
+  return __atomic_load_n(&record_overflows,__ATOMIC_RELAXED);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  drainRecordRings
+\date  Oct. 2026
+
+\remarks
+
+ writes the records in the rings to file in the order of their stamps, up
+ to a stamp limit. At equal stamps, the command records of ring 0 come
+ first, such that a replay has the commands of a servo tick before the
+ tick that triggers it.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     t_limit : records with a later stamp stay in the rings
+
+ returns the number of records written
+
+ ******************************************************************************/
+static int
+drainRecordRings(unsigned long t_limit)
+{
+  int            i,n = 0;
+  unsigned long  head,head_min = 0;
+  RecordRing    *q,*q_min;
+  Panda4Record  *r,*r_min;
+
+  for (;;) {
+
+    // the ring with the oldest record
+    q_min = NULL;
+    r_min = NULL;
+    for (i=0; i<=N_ARMS; ++i) {
+      q    = &record_ring[i];
+      head = __atomic_load_n(&q->head,__ATOMIC_RELAXED);
+      if (head == __atomic_load_n(&q->tail,__ATOMIC_ACQUIRE))
+	continue;
+      r = &q->r[head%N_RECORD_RING];
+      if (r_min == NULL || r->t_mono < r_min->t_mono) {
+	q_min    = q;
+	r_min    = r;
+	head_min = head;
+      }
+    }
+
+    if (r_min == NULL || r_min->t_mono > t_limit)
+      break;
+
+    fwrite(r_min,sizeof(Panda4Record),1,record_fp);
+    __atomic_store_n(&q_min->head,head_min+1,__ATOMIC_RELEASE);
+    ++n;
+  }
+
+  return n;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  recordThread
+\date  Oct. 2026
+
+\remarks
+
+ non-realtime thread that writes the records to file every 10ms
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arg : not used
+
+ ******************************************************************************/
+static void *
+recordThread(void *arg)
+{
+  (void) arg;
+
+  panda4_rtThread(RT_ROLE_BACKGROUND,-1);
+
+  while (panda4_isRecording()) {
+    taskDelay(ns2ticks(10000000)); // wait 10ms
+    drainRecordRings(panda4_timeNs() - RECORD_MERGE_DELAY_NS);
+  }
+
+  // the records of the last ticks
+  drainRecordRings(~0UL);
+  fflush(record_fp);
+
+  return NULL;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_openReplay
+\date  Oct. 2026
+
+\remarks
+
+ opens a recording for reading
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     fname : the file name
+ \param[out]    h     : the header of the recording
+
+ returns TRUE on success
+
+ ******************************************************************************/
+int
+panda4_openReplay(char *fname, Panda4RecordHeader *h)
+{
+
+  replay_fp = fopen(fname,"r");
+  if (replay_fp == NULL) {
+    printf("Couldn't open file >%s< for reading\n",fname);
+    return FALSE;
+  }
+
+  if (fread(h,sizeof(Panda4RecordHeader),1,replay_fp) != 1 ||
+      strcmp(h->magic,PANDA4_RECORD_MAGIC) != 0) {
+    printf("File >%s< is not a Panda recording\n",fname);
+    panda4_closeReplay();
+    return FALSE;
+  }
+
+  if (h->version != PANDA4_RECORD_VERSION || h->record_size != sizeof(Panda4Record)) {
+    printf("Recording >%s< has version %d with %d bytes per record, expected %d and %d\n",
+	   fname,h->version,h->record_size,PANDA4_RECORD_VERSION,(int)sizeof(Panda4Record));
+    panda4_closeReplay();
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_readRecord
+\date  Oct. 2026
+
+\remarks
+
+ reads the next record of the replay
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[out]    r : the record
+
+ returns FALSE at the end of the recording
+
+ ******************************************************************************/
+int
+panda4_readRecord(Panda4Record *r)
+{
+  return fread(r,sizeof(Panda4Record),1,replay_fp) == 1;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_closeReplay
+\date  Oct. 2026
+
+\remarks
+
+ closes the replay file
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_closeReplay(void)
+{
+  if (replay_fp != NULL)
+    fclose(replay_fp);
+  replay_fp = NULL;
+}
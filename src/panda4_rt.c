@@ -0,0 +1,564 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_rt.c
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  The real-time profile of the servo processes. Page faults and CPU
+  migrations are the main source of missed 1kHz deadlines, so every
+  process that runs a servo locks its memory, keeps malloc from returning
+  memory to the system, and prefaults its stack, and every thread sets
+  the scheduling class, priority and CPU of its role.
+
+  The profile is read from the parameter pool:
+
+    rt_profile               0 disables the profile (default 1)
+    rt_stack_prefault_kb     stack to prefault per thread (default 512)
+    <process>_<role>_prio    SCHED_FIFO priority, 0 for SCHED_OTHER
+    <process>_<role>_cpu     CPU of the thread, -1 for any
+
+  e.g., xrprobot_gripper_cpu or xmotor_servo_prio. Threads that are
+  created by the SL core, like the command line thread, are configured
+  from outside with panda4_rtOtherThreads. panda4_rtReport prints what
+  the kernel actually applied to every thread of the process, such that
+  a missing permission or a thread on the wrong CPU shows at startup.
+
+  ============================================================================*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+// SL general includes of system headers
+#include "SL_system_headers.h"
+#include <dirent.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+// private includes
+#include "SL.h"
+#include "SL_user.h"
+#include "SL_common.h"
+#include "utility.h"
+#include "panda4_rt.h"
+
+// global variables
+const char *rt_role_names[] = {"","servo","control","ethercat","gripper","cli","background"};
+
+// local variables
+typedef struct {
+  int prio;                                 // SCHED_FIFO priority, 0 for SCHED_OTHER
+  int cpu;                                  // -1 for any CPU
+} RTSetting;
+
+typedef struct {
+  int tid;
+  int role;
+  int prio;
+  int cpu;
+} RTThread;
+
+static char       rt_process[100] = "";
+static int        rt_enabled = FALSE;
+static int        rt_stack_prefault_kb = 512;
+static int        rt_mlock_errno = -1;      // -1: not tried
+static RTSetting  rt_settings[N_RT_ROLES];
+static RTThread   rt_threads[N_RT_THREADS];
+static int        n_rt_threads = 0;
+
+// the defaults: the control threads at the priority that libfranka uses,
+// the load cell just below, and everything else off the real-time CPUs
+static const RTSetting rt_defaults[N_RT_ROLES] = {
+  {0,-1},
+  {90,-1},                                  // servo
+  {99,-1},                                  // control
+  {98,-1},                                  // ethercat
+  {0,0},                                    // gripper
+  {0,0},                                    // cli
+  {0,0}                                     // background
+};
+
+// local functions
+static int  getTid(void);
+static void prefaultStack(int kb);
+static int  applyToThread(int tid, int role, int prio, int cpu);
+static void registerThread(int tid, int role, int prio, int cpu);
+static int  findThread(int tid);
+static long readProcValue(const char *fname, const char *key);
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_initRTProfile
+\date  Oct. 2026
+
+\remarks
+
+ reads the real-time profile of a process from the parameter pool, locks
+ all current and future memory, and prefaults the stack of the calling
+ thread
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     process : the name of the process, e.g., "xrprobot"
+
+ returns TRUE if the profile is disabled or memory could be locked
+
+ ******************************************************************************/
+int
+panda4_initRTProfile(const char *process)
+{
+  int  role,ival;
+  char string[100];
+
+  strcpy(rt_process,process);
+
+  rt_enabled = TRUE;
+  if (read_parameter_pool_int(config_files[PARAMETERPOOL],"rt_profile",&ival))
+    rt_enabled = ival;
+  if (read_parameter_pool_int(config_files[PARAMETERPOOL],"rt_stack_prefault_kb",&ival))
+    rt_stack_prefault_kb = ival;
+
+  for (role=1; role<N_RT_ROLES; ++role) {
+    rt_settings[role] = rt_defaults[role];
+    if (role == RT_ROLE_SERVO && strcmp(process,"xtask") == 0)
+      rt_settings[role].prio = 80;          // the task servo yields to the motor servo
+    sprintf(string,"%s_%s_prio",process,rt_role_names[role]);
+    if (read_parameter_pool_int(config_files[PARAMETERPOOL],string,&ival))
+      rt_settings[role].prio = ival;
+    sprintf(string,"%s_%s_cpu",process,rt_role_names[role]);
+    if (read_parameter_pool_int(config_files[PARAMETERPOOL],string,&ival))
+      rt_settings[role].cpu = ival;
+  }
+
+  if (!rt_enabled) {
+    printf("Real-time profile of %s is disabled\n",process);
+    return TRUE;
+  }
+
+  // memory that was once allocated is never given back, such that later
+  // allocations do not fault in new pages
+  mallopt(M_TRIM_THRESHOLD,-1);
+  mallopt(M_MMAP_MAX,0);
+
+  rt_mlock_errno = mlockall(MCL_CURRENT|MCL_FUTURE) == 0 ? 0 : errno;
+  if (rt_mlock_errno != 0)
+    printf("mlockall failed for %s: %s\n",process,strerror(rt_mlock_errno));
+
+  prefaultStack(rt_stack_prefault_kb);
+
+  return rt_mlock_errno == 0;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_rtThread
+\date  Oct. 2026
+
+\remarks
+
+ applies the profile of a role to the calling thread and prefaults its
+ stack. Without a profile, only an explicit CPU is applied.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     role : the role of the thread (RT_ROLE_*)
+ \param[in]     cpu  : the CPU of the thread, or -1 for the CPU of the role
+
+ returns TRUE if everything was applied
+
+ ******************************************************************************/
+int
+panda4_rtThread(int role, int cpu)
+{
+  int            rc;
+  size_t         stack_size = 0;
+  pthread_attr_t attr;
+
+  if (!rt_enabled) {
+    if (cpu < 0)
+      return TRUE;
+    return applyToThread(getTid(),role,-1,cpu);
+  }
+
+  if (cpu < 0)
+    cpu = rt_settings[role].cpu;
+
+  rc = applyToThread(getTid(),role,rt_settings[role].prio,cpu);
+
+  // the main thread stack grows on demand, and a small thread stack must
+  // not be overrun by the prefault
+  if (pthread_getattr_np(pthread_self(),&attr) == 0) {
+    pthread_attr_getstacksize(&attr,&stack_size);
+    pthread_attr_destroy(&attr);
+  }
+  if (stack_size > 0 && (size_t)rt_stack_prefault_kb*1024 > stack_size/2)
+    prefaultStack(stack_size/2/1024);
+  else
+    prefaultStack(rt_stack_prefault_kb);
+
+  return rc;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_rtOtherThreads
+\date  Oct. 2026
+
+\remarks
+
+ applies the profile of a role to all threads of this process that have
+ not been configured yet, other than the calling thread. This is meant
+ for threads that the SL core creates, like the command line thread.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     role : the role of the threads (RT_ROLE_*)
+
+ ******************************************************************************/
+void
+panda4_rtOtherThreads(int role)
+{
+  int            tid,self = getTid();
+  DIR           *dir;
+  struct dirent *d;
+
+  if (!rt_enabled)
+    return;
+
+  if ((dir = opendir("/proc/self/task")) == NULL)
+    return;
+
+  while ((d = readdir(dir)) != NULL) {
+    tid = atoi(d->d_name);
+    if (tid <= 0 || tid == self || findThread(tid) >= 0)
+      continue;
+    applyToThread(tid,role,rt_settings[role].prio,rt_settings[role].cpu);
+  }
+
+  closedir(dir);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  applyToThread
+\date  Oct. 2026
+
+\remarks
+
+ sets the scheduling class, priority and CPU of a thread of this process
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     tid  : the kernel thread ID
+ \param[in]     role : the role of the thread
+ \param[in]     prio : SCHED_FIFO priority, 0 for SCHED_OTHER, -1 to keep
+ \param[in]     cpu  : the CPU, or -1 for any
+
+ returns TRUE on success
+
+ ******************************************************************************/
+static int
+applyToThread(int tid, int role, int prio, int cpu)
+{
+  int                rc = TRUE;
+  cpu_set_t          cpus;
+  struct sched_param sched;
+
+  if (prio >= 0) {
+    if (prio > sched_get_priority_max(SCHED_FIFO))
+      prio = sched_get_priority_max(SCHED_FIFO);
+    sched.sched_priority = prio;
+    if (sched_setscheduler(tid,prio > 0 ? SCHED_FIFO : SCHED_OTHER,&sched) != 0) {
+      printf("%s: cannot set priority %d of the %s thread %d: %s\n",
+	     rt_process,prio,rt_role_names[role],tid,strerror(errno));
+      rc = FALSE;
+    }
+  }
+
+  if (cpu >= 0) {
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu,&cpus);
+    if (sched_setaffinity(tid,sizeof(cpu_set_t),&cpus) != 0) {
+      printf("%s: cannot pin the %s thread %d to CPU %d: %s\n",
+	     rt_process,rt_role_names[role],tid,cpu,strerror(errno));
+      rc = FALSE;
+    }
+  }
+
+  registerThread(tid,role,prio,cpu);
+
+  return rc;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  prefaultStack
+\date  Oct. 2026
+
+\remarks
+
+ touches the given amount of stack below the current frame, such that the
+ pages exist before the real-time loop runs
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     kb : the stack size to prefault in kB
+
+ ******************************************************************************/
+static void
+prefaultStack(int kb)
+{
+  size_t         i,n = (size_t)kb*1024;
+  volatile char *buf;
+
+  if (n == 0)
+    return;
+
+  buf = (volatile char *) alloca(n);
+  for (i=0; i<n; i+=sysconf(_SC_PAGESIZE))
+    buf[i] = 0;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  registerThread
+\date  Oct. 2026
+
+\remarks
+
+ remembers the role and the requested settings of a thread for the report
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     tid  : the kernel thread ID
+ \param[in]     role : the role of the thread
+ \param[in]     prio : the requested priority, -1 if not set
+ \param[in]     cpu  : the requested CPU, -1 if not set
+
+ ******************************************************************************/
+static void
+registerThread(int tid, int role, int prio, int cpu)
+{
+  int i = findThread(tid);
+
+  if (i < 0) {
+    i = __atomic_fetch_add(&n_rt_threads,1,__ATOMIC_RELAXED);
+    if (i >= N_RT_THREADS) {
+      __atomic_fetch_sub(&n_rt_threads,1,__ATOMIC_RELAXED);
+      return;
+    }
+  }
+
+  rt_threads[i].role = role;
+  rt_threads[i].prio = prio;
+  rt_threads[i].cpu  = cpu;
+  __atomic_store_n(&rt_threads[i].tid,tid,__ATOMIC_RELEASE);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  findThread
+\date  Oct. 2026
+
+\remarks
+
+ returns the index of a thread in the thread table, or -1
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     tid  : the kernel thread ID
+
+ ******************************************************************************/
+static int
+findThread(int tid)
+{
+  int i,n = __atomic_load_n(&n_rt_threads,__ATOMIC_ACQUIRE);
+
+  for (i=0; i<n && i<N_RT_THREADS; ++i)
+    if (__atomic_load_n(&rt_threads[i].tid,__ATOMIC_ACQUIRE) == tid)
+      return i;
+
+  return -1;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  getTid
+\date  Oct. 2026
+
+\remarks
+
+ returns the kernel thread ID of the calling thread
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+static int
+getTid(void)
+{
+  return (int) syscall(SYS_gettid);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  readProcValue
+\date  Oct. 2026
+
+\remarks
+
+ reads a numeric value from a "key: value" file in /proc
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     fname : the file
+ \param[in]     key   : the key, including the colon
+
+ returns the value, or -1 if it was not found
+
+ ******************************************************************************/
+static long
+readProcValue(const char *fname, const char *key)
+{
+  FILE *fp;
+  char  line[200];
+  long  value = -1;
+  int   n = strlen(key);
+
+  if ((fp = fopen(fname,"r")) == NULL)
+    return -1;
+
+  while (fgets(line,sizeof(line),fp) != NULL) {
+    if (strncmp(line,key,n) == 0) {
+      // the sched file pads the key with blanks before the colon
+      char *c = strchr(line+n,':');
+      value = atol(c != NULL ? c+1 : line+n);
+      break;
+    }
+  }
+
+  fclose(fp);
+
+  return value;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_rtReport
+\date  Oct. 2026
+
+\remarks
+
+ prints the memory locking and page faults of this process, and for every
+ thread the scheduling class, priority and CPUs that the kernel reports,
+ the CPU migrations if the kernel counts them, and whether this matches
+ the profile of its role
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_rtReport(void)
+{
+  int                i,j,tid,policy,ok;
+  long               migrations;
+  char               fname[100],name[32],cpus_string[100];
+  FILE              *fp;
+  DIR               *dir;
+  struct dirent     *d;
+  struct rusage      usage;
+  struct sched_param sched;
+  cpu_set_t          cpus;
+
+  printf("\nReal-time profile of %s: %s\n",rt_process,rt_enabled ? "enabled" : "disabled");
+  if (rt_enabled)
+    printf("  memory locked     = %s (VmLck %ld kB)\n",
+	   rt_mlock_errno == 0 ? "yes" : strerror(rt_mlock_errno),
+	   readProcValue("/proc/self/status","VmLck:"));
+  getrusage(RUSAGE_SELF,&usage);
+  printf("  page faults       = %ld minor, %ld major\n",usage.ru_minflt,usage.ru_majflt);
+
+  if ((dir = opendir("/proc/self/task")) == NULL)
+    return;
+
+  printf("  %7s %-16s %-10s %-6s %4s %-12s %10s\n",
+	 "tid","name","role","policy","prio","cpus","migrations");
+
+  while ((d = readdir(dir)) != NULL) {
+
+    tid = atoi(d->d_name);
+    if (tid <= 0)
+      continue;
+
+    sprintf(fname,"/proc/self/task/%d/comm",tid);
+    strcpy(name,"?");
+    if ((fp = fopen(fname,"r")) != NULL) {
+      if (fgets(name,sizeof(name),fp) != NULL)
+	name[strcspn(name,"\n")] = '\0';
+      fclose(fp);
+    }
+
+    policy = sched_getscheduler(tid);
+    sched.sched_priority = 0;
+    sched_getparam(tid,&sched);
+
+    cpus_string[0] = '\0';
+    CPU_ZERO(&cpus);
+    sched_getaffinity(tid,sizeof(cpu_set_t),&cpus);
+    if (CPU_COUNT(&cpus) == sysconf(_SC_NPROCESSORS_ONLN)) {
+      strcpy(cpus_string,"all");
+    } else {
+      for (j=0; j<CPU_SETSIZE && strlen(cpus_string) < sizeof(cpus_string)-8; ++j)
+	if (CPU_ISSET(j,&cpus))
+	  sprintf(cpus_string+strlen(cpus_string),"%s%d",strlen(cpus_string) ? "," : "",j);
+    }
+
+    sprintf(fname,"/proc/self/task/%d/sched",tid);
+    migrations = readProcValue(fname,"se.nr_migrations");
+
+    i  = findThread(tid);
+    ok = TRUE;
+    if (i >= 0) {
+      if (rt_threads[i].prio > 0 &&
+	  (policy != SCHED_FIFO || sched.sched_priority != rt_threads[i].prio))
+	ok = FALSE;
+      if (rt_threads[i].prio == 0 && policy == SCHED_FIFO)
+	ok = FALSE;
+      if (rt_threads[i].cpu >= 0 &&
+	  (CPU_COUNT(&cpus) != 1 || !CPU_ISSET(rt_threads[i].cpu,&cpus)))
+	ok = FALSE;
+    }
+
+    printf("  %7d %-16s %-10s %-6s %4d %-12s %10s%s\n",
+	   tid,name,i >= 0 ? rt_role_names[rt_threads[i].role] : "-",
+	   policy == SCHED_FIFO ? "FIFO" : (policy == SCHED_RR ? "RR" : "OTHER"),
+	   sched.sched_priority,cpus_string,
+	   migrations >= 0 ? (sprintf(fname,"%ld",migrations),fname) : "-",
+	   ok ? "" : "  <-- differs from profile");
+  }
+
+  closedir(dir);
+  printf("\n");
+}
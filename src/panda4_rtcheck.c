@@ -0,0 +1,603 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_rtcheck.c
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  Detector of allocations and blocking system calls in the real-time
+  sections of the Panda servo. Code between panda4_rtCheckEnter and
+  panda4_rtCheckLeave, i.e., the torque callback with everything it calls,
+  must never allocate, free, wait for a lock, sleep, or do file I/O.
+
+  With PANDA4_RTCHECK, this file interposes malloc, calloc, realloc,
+  free, posix_memalign, aligned_alloc, memalign, valloc, pvalloc, the
+  contended path of pthread_mutex_lock, the
+  condition variable and semaphore waits, the sleeps, and the common file
+  and terminal I/O calls. The executable defines these symbols, so they
+  also catch the calls from libstdc++ and the SL libraries. Outside of a
+  real-time section the wrappers only forward to libc. Inside one, they
+  take a backtrace and count the violation per call site, where a call
+  site is the backtrace above the wrapper. The first backtrace of every
+  site is kept for panda4_rtCheckReport, and panda4_rtCheckSites lists the
+  sites in one line each.
+
+  Without PANDA4_RTCHECK, only the report functions exist, and the
+  section markers in panda4_rtcheck.h compile to nothing.
+
+  ============================================================================*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+// SL general includes of system headers
+#include "SL_system_headers.h"
+
+#ifdef PANDA4_RTCHECK
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#endif
+
+// private includes
+#include "SL.h"
+#include "SL_user.h"
+#include "utility.h"
+#include "panda4_rtcheck.h"
+
+#ifdef PANDA4_RTCHECK
+
+// local variables
+static const char *rtcheck_kind_names[] =
+  {"","allocation","free","lock wait","condition wait","sleep","file I/O"};
+
+typedef struct {
+  unsigned long key;                        // hash of kind and backtrace, 0 if unused
+  int           ready;                      // the backtrace is complete
+  int           kind;
+  long          count;
+  int           n_frames;
+  void         *frames[N_RTCHECK_FRAMES];
+} RTCheckSite;
+
+static RTCheckSite     rtcheck_sites[N_RTCHECK_SITES];
+static long            rtcheck_counts[N_RTCHECK_KINDS];
+static long            rtcheck_lost = 0;    // violations at sites beyond the table
+static __thread int    rt_depth = 0;        // > 0 inside a real-time section
+static __thread int    in_check = FALSE;    // no recursion from the backtrace
+
+// the libc functions behind the wrappers
+extern void *__libc_malloc(size_t n);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t n);
+extern void  __libc_free(void *p);
+extern void *__libc_memalign(size_t align, size_t n);
+
+// the functions behind the wrappers that are not exported as __libc_*,
+// resolved on first use, as other constructors may run before this file's
+#define RESOLVE(f) if (real_##f == NULL) real_##f = (__typeof__(f) *) dlsym(RTLD_NEXT,#f)
+
+static __typeof__(pthread_mutex_lock)     *real_pthread_mutex_lock = NULL;
+static __typeof__(pthread_cond_wait)      *real_pthread_cond_wait = NULL;
+static __typeof__(pthread_cond_timedwait) *real_pthread_cond_timedwait = NULL;
+static __typeof__(sem_wait)               *real_sem_wait = NULL;
+static __typeof__(sem_timedwait)          *real_sem_timedwait = NULL;
+static __typeof__(nanosleep)              *real_nanosleep = NULL;
+static __typeof__(usleep)                 *real_usleep = NULL;
+static __typeof__(read)                   *real_read = NULL;
+static __typeof__(write)                  *real_write = NULL;
+static __typeof__(fopen)                  *real_fopen = NULL;
+static __typeof__(fwrite)                 *real_fwrite = NULL;
+static __typeof__(fread)                  *real_fread = NULL;
+static __typeof__(fflush)                 *real_fflush = NULL;
+static __typeof__(puts)                   *real_puts = NULL;
+
+// local functions
+static void rtCheckInit(void) __attribute__((constructor));
+static void violation(int kind);
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  rtCheckInit
+\date  Oct. 2026
+
+\remarks
+
+ takes one backtrace before main, which loads the unwinder such that
+ later backtraces do not allocate
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+static void
+rtCheckInit(void)
+{
+  void *frames[2];
+
+  in_check = TRUE;
+  backtrace(frames,2);
+  in_check = FALSE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  violation
+\date  Oct. 2026
+
+\remarks
+
+ counts a violation at the current call site if the calling thread is in
+ a real-time section. The sites are a lock-free open-addressing table.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     kind : the kind of the violation (RTCHECK_*)
+
+ ******************************************************************************/
+static void
+violation(int kind)
+{
+  int           i,j,n;
+  unsigned long key,expected;
+  void         *frames[N_RTCHECK_FRAMES+2];
+  RTCheckSite  *s;
+
+  if (rt_depth == 0 || in_check)
+    return;
+  in_check = TRUE;
+
+  __atomic_fetch_add(&rtcheck_counts[kind],1,__ATOMIC_RELAXED);
+
+  // frame 0 is this function and frame 1 the wrapper
+  n = backtrace(frames,N_RTCHECK_FRAMES+2) - 2;
+  if (n < 0)
+    n = 0;
+
+  key = 1469598103934665603UL ^ (unsigned long)kind;
+  for (j=0; j<n && j<4; ++j)
+    key = (key ^ (unsigned long)frames[j+2]) * 1099511628211UL;
+  if (key == 0)
+    key = 1;
+
+  for (i=0; i<N_RTCHECK_SITES; ++i) {
+    s = &rtcheck_sites[(key+i)%N_RTCHECK_SITES];
+    expected = __atomic_load_n(&s->key,__ATOMIC_ACQUIRE);
+    if (expected == key) {
+      __atomic_fetch_add(&s->count,1,__ATOMIC_RELAXED);
+      break;
+    }
+    if (expected == 0 &&
+	__atomic_compare_exchange_n(&s->key,&expected,key,FALSE,
+				    __ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE)) {
+      s->kind     = kind;
+      s->n_frames = n;
+      memcpy(s->frames,frames+2,sizeof(void *)*n);
+      __atomic_store_n(&s->ready,TRUE,__ATOMIC_RELEASE);
+      __atomic_fetch_add(&s->count,1,__ATOMIC_RELAXED);
+      break;
+    }
+    if (expected == key) {
+      __atomic_fetch_add(&s->count,1,__ATOMIC_RELAXED);
+      break;
+    }
+  }
+  if (i == N_RTCHECK_SITES)
+    __atomic_fetch_add(&rtcheck_lost,1,__ATOMIC_RELAXED);
+
+  in_check = FALSE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_rtCheckEnter
+\date  Oct. 2026
+
+\remarks
+
+ marks the start of a real-time section of the calling thread. Sections
+ may nest.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_rtCheckEnter(void)
+{
+  ++rt_depth;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_rtCheckLeave
+\date  Oct. 2026
+
+\remarks
+
+ marks the end of a real-time section of the calling thread
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_rtCheckLeave(void)
+{
+  if (rt_depth > 0)
+    --rt_depth;
+}
+
+// the wrappers: allocation
+void *
+malloc(size_t n)
+{
+  violation(RTCHECK_MALLOC);
+  return __libc_malloc(n);
+}
+
+void *
+calloc(size_t n, size_t size)
+{
+  violation(RTCHECK_MALLOC);
+  return __libc_calloc(n,size);
+}
+
+void *
+realloc(void *p, size_t n)
+{
+  violation(RTCHECK_MALLOC);
+  return __libc_realloc(p,n);
+}
+
+int
+posix_memalign(void **p, size_t align, size_t n)
+{
+  violation(RTCHECK_MALLOC);
+  *p = __libc_memalign(align,n);
+  return *p == NULL ? ENOMEM : 0;
+}
+
+void *
+aligned_alloc(size_t align, size_t n)
+{
+  violation(RTCHECK_MALLOC);
+  return __libc_memalign(align,n);
+}
+
+void *
+memalign(size_t align, size_t n)
+{
+  violation(RTCHECK_MALLOC);
+  return __libc_memalign(align,n);
+}
+
+void *
+valloc(size_t n)
+{
+  violation(RTCHECK_MALLOC);
+  return __libc_memalign((size_t) sysconf(_SC_PAGESIZE),n);
+}
+
+void *
+pvalloc(size_t n)
+{
+  size_t page = (size_t) sysconf(_SC_PAGESIZE);
+
+  // whole pages, and at least one
+  violation(RTCHECK_MALLOC);
+  return __libc_memalign(page,n == 0 ? page : (n+page-1) & ~(page-1));
+}
+
+void
+free(void *p)
+{
+  if (p != NULL)
+    violation(RTCHECK_FREE);
+  __libc_free(p);
+}
+
+// the wrappers: waiting
+int
+pthread_mutex_lock(pthread_mutex_t *m)
+{
+  // only a contended lock waits in the kernel
+  if (rt_depth > 0 && pthread_mutex_trylock(m) == 0)
+    return 0;
+  violation(RTCHECK_LOCK_WAIT);
+  RESOLVE(pthread_mutex_lock);
+  return real_pthread_mutex_lock(m);
+}
+
+int
+pthread_cond_wait(pthread_cond_t *c, pthread_mutex_t *m)
+{
+  violation(RTCHECK_COND_WAIT);
+  RESOLVE(pthread_cond_wait);
+  return real_pthread_cond_wait(c,m);
+}
+
+int
+pthread_cond_timedwait(pthread_cond_t *c, pthread_mutex_t *m, const struct timespec *t)
+{
+  violation(RTCHECK_COND_WAIT);
+  RESOLVE(pthread_cond_timedwait);
+  return real_pthread_cond_timedwait(c,m,t);
+}
+
+int
+sem_wait(sem_t *s)
+{
+  violation(RTCHECK_COND_WAIT);
+  RESOLVE(sem_wait);
+  return real_sem_wait(s);
+}
+
+int
+sem_timedwait(sem_t *s, const struct timespec *t)
+{
+  violation(RTCHECK_COND_WAIT);
+  RESOLVE(sem_timedwait);
+  return real_sem_timedwait(s,t);
+}
+
+int
+nanosleep(const struct timespec *t, struct timespec *rem)
+{
+  violation(RTCHECK_SLEEP);
+  RESOLVE(nanosleep);
+  return real_nanosleep(t,rem);
+}
+
+int
+usleep(useconds_t us)
+{
+  violation(RTCHECK_SLEEP);
+  RESOLVE(usleep);
+  return real_usleep(us);
+}
+
+// the wrappers: I/O
+ssize_t
+read(int fd, void *buf, size_t n)
+{
+  violation(RTCHECK_FILE_IO);
+  RESOLVE(read);
+  return real_read(fd,buf,n);
+}
+
+ssize_t
+write(int fd, const void *buf, size_t n)
+{
+  violation(RTCHECK_FILE_IO);
+  RESOLVE(write);
+  return real_write(fd,buf,n);
+}
+
+FILE *
+fopen(const char *fname, const char *mode)
+{
+  violation(RTCHECK_FILE_IO);
+  RESOLVE(fopen);
+  return real_fopen(fname,mode);
+}
+
+size_t
+fwrite(const void *p, size_t size, size_t n, FILE *fp)
+{
+  violation(RTCHECK_FILE_IO);
+  RESOLVE(fwrite);
+  return real_fwrite(p,size,n,fp);
+}
+
+size_t
+fread(void *p, size_t size, size_t n, FILE *fp)
+{
+  violation(RTCHECK_FILE_IO);
+  RESOLVE(fread);
+  return real_fread(p,size,n,fp);
+}
+
+int
+fflush(FILE *fp)
+{
+  violation(RTCHECK_FILE_IO);
+  RESOLVE(fflush);
+  return real_fflush(fp);
+}
+
+int
+puts(const char *s)
+{
+  violation(RTCHECK_FILE_IO);
+  RESOLVE(puts);
+  return real_puts(s);
+}
+
+int
+printf(const char *fmt, ...)
+{
+  int     rc;
+  va_list ap;
+
+  violation(RTCHECK_FILE_IO);
+  va_start(ap,fmt);
+  rc = vprintf(fmt,ap);
+  va_end(ap);
+
+  return rc;
+}
+
+int
+fprintf(FILE *fp, const char *fmt, ...)
+{
+  int     rc;
+  va_list ap;
+
+  violation(RTCHECK_FILE_IO);
+  va_start(ap,fmt);
+  rc = vfprintf(fp,fmt,ap);
+  va_end(ap);
+
+  return rc;
+}
+
+#endif  /* PANDA4_RTCHECK */
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_rtCheckViolations
+\date  Oct. 2026
+
+\remarks
+
+ returns the number of violations in real-time sections so far
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+long
+panda4_rtCheckViolations(void)
+{
+  long n = 0;
+#ifdef PANDA4_RTCHECK
+  int  i;
+
+  for (i=1; i<N_RTCHECK_KINDS; ++i)
+    n += __atomic_load_n(&rtcheck_counts[i],__ATOMIC_RELAXED);
+#endif
+
+  return n;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_rtCheckReport
+\date  Oct. 2026
+
+\remarks
+
+ prints the violations per kind, and every call site with its count and
+ the backtrace of its first violation
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_rtCheckReport(void)
+{
+#ifdef PANDA4_RTCHECK
+  int          i,j;
+  char       **symbols;
+  RTCheckSite *s;
+
+  printf("            RT Violations          =");
+  for (i=1; i<N_RTCHECK_KINDS; ++i)
+    printf(" %ld %s%s",rtcheck_counts[i],rtcheck_kind_names[i],
+	   i < N_RTCHECK_KINDS-1 ? "," : "\n");
+  if (rtcheck_lost > 0)
+    printf("            RT Violations Untracked = %ld\n",rtcheck_lost);
+
+  for (i=0; i<N_RTCHECK_SITES; ++i) {
+    s = &rtcheck_sites[i];
+    if (!__atomic_load_n(&s->ready,__ATOMIC_ACQUIRE))
+      continue;
+    printf("\n            %ld x %s at:\n",s->count,rtcheck_kind_names[s->kind]);
+    symbols = backtrace_symbols(s->frames,s->n_frames);
+    for (j=0; j<s->n_frames; ++j)
+      printf("              %s\n",symbols != NULL ? symbols[j] : "?");
+    free(symbols);
+  }
+#else
+  printf("            RT Violations          = not checked, build with -DPANDA4_RTCHECK\n");
+#endif
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_rtCheckSites
+\date  Oct. 2026
+
+\remarks
+
+ lists every call site with its count, its kind, and the innermost
+ functions of its backtrace, one line per site
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_rtCheckSites(void)
+{
+#ifdef PANDA4_RTCHECK
+  int          i,j,n;
+  char       **symbols;
+  RTCheckSite *s;
+
+  for (i=0; i<N_RTCHECK_SITES; ++i) {
+    s = &rtcheck_sites[i];
+    if (!__atomic_load_n(&s->ready,__ATOMIC_ACQUIRE))
+      continue;
+    n = s->n_frames < 3 ? s->n_frames : 3;
+    symbols = backtrace_symbols(s->frames,n);
+    printf("            %8ld x %-14s",s->count,rtcheck_kind_names[s->kind]);
+    for (j=0; j<n; ++j)
+      printf("%s%s",j > 0 ? " < " : " ",symbols != NULL ? symbols[j] : "?");
+    printf("\n");
+    free(symbols);
+  }
+  if (rtcheck_lost > 0)
+    printf("            %8ld x at untracked sites\n",rtcheck_lost);
+#endif
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_rtCheckReset
+\date  Oct. 2026
+
+\remarks
+
+ clears the violations and call sites. Must not run concurrently with a
+ real-time section that violates.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_rtCheckReset(void)
+{
+#ifdef PANDA4_RTCHECK
+  bzero((void *)rtcheck_sites,sizeof(rtcheck_sites));
+  bzero((void *)rtcheck_counts,sizeof(rtcheck_counts));
+  rtcheck_lost = 0;
+#endif
+}
@@ -11,19 +11,31 @@
 
   Runs a servo loop for input/output with the actual panda robot
   by using the libfranka APIs. The panda4_servo can receive calling
-  arguments to run multiple robots at the same time.
+  arguments to run multiple robots at the same time: "-id n" runs
+  Panda n in this process, and "-id 0" runs all Pandas of the cell in
+  this process, with one control thread per arm that is pinned to its
+  own CPU. The callbacks of the arms exchange their samples and commands
+  with a servo thread through lock-free slots, and the arm whose tick
+  completes the set of all arms triggers the servo thread, which publishes
+  the combined state of the cell to shared memory, such that there is one
+  publish per tick and one clock for all arms.
 
   ============================================================================*/
 
 // system includes
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <cmath>
 #include <functional>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <mutex>
 #include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
 
 #include "SL_system_headers.h"
 
@@ -41,27 +53,43 @@
 #include "SL_collect_data.h"
 #include "SL_shared_memory.h"
 #include "SL_dynamics.h"
-
-// panda includes
+#include "panda4_shm.h"
+#include "panda4_timing.h"
+#include "panda4_messages.h"
+#include "panda4_record.h"
+#include "panda4_loadcell.h"
+#include "panda4_rt.h"
+#include "panda4_rtcheck.h"
+#include "panda4_telemetry.h"
+#include "panda4_startup.h"
+#include "panda4_dynamics.h"
+
+// panda includes, or the local stand-in for runs without robots
+#ifdef PANDA4_STANDIN
+#include "panda4_standin.h"
+#else
 #include <franka/duration.h>
 #include <franka/exception.h>
 #include <franka/model.h>
 #include <franka/rate_limiting.h>
 #include <franka/robot.h>
 #include <franka/gripper.h>
+#endif
 
-// axia f/t sensor includes
-#ifdef AXIA80
-#include "ethercat_communication.h"
-#include "axia80_ethercat.h"
-using ethercat_communication::EthercatCommunication;
-using axia80_ethercat::Axia80Ethercat;
+// gripper includes
+#ifdef ROBOTIQ2F
+#define  ROBOTIQ_TIMEOUT 5.0  // in seconds
+#include "robotiq_2f_gripper.h"
+#include "robotiq_2f_gripper_serial.h"
+using robotiq_2f_gripper::Robotiq2fGripperSerial;
+typedef Robotiq2fGripperSerial PandaGripper;
+#else
+typedef franka::Gripper        PandaGripper;
 #endif
 
 #define TRANSLATION_FILE "Translation.cf"
 #define TIME_OUT_NS  NO_WAIT
 
-#define N_DOFS_PER_ROBOT 7
 #define N_MISC_PER_ROBOT (A2_C_FX-A1_C_FX)
 #define ROBOT_MASTER_CLOCK 1
 
@@ -73,10 +101,6 @@ double        **joint_lin_rot;
 double         *pos_polar;
 double         *load_polar;
 
-#ifdef AXIA80
-Axia80Ethercat *axia80_ptr;
-#endif
-
 //! local variables
 typedef struct Translation {
   double slope;
@@ -88,6 +112,27 @@ static Translation     joint_trans_velocities[N_DOFS+1];
 static Translation     joint_trans_torques[N_DOFS+1];
 static Translation     joint_trans_desired_torques[N_DOFS+1];
 static Translation     misc_trans_sensors[N_MISC_SENSORS+1];
+
+//! the calibration of the servo loop: the translations above, the polarities
+//! and the position offsets folded into one gain and bias per channel, such
+//! that a range of arms is translated with one multiply-add per channel
+typedef struct Calibration {
+  double pos_gain[N_DOFS+1];
+  double pos_bias[N_DOFS+1];
+  double vel_gain[N_DOFS+1];
+  double vel_bias[N_DOFS+1];
+  double load_gain[N_DOFS+1];
+  double load_bias[N_DOFS+1];
+  double cmd_gain[N_DOFS+1];      //!< includes the reciprocal of the slope
+  double cmd_bias[N_DOFS+1];
+  double misc_gain[N_MISC_SENSORS+1];
+  double misc_bias[N_MISC_SENSORS+1];
+} Calibration;
+
+static Calibration     calib;
+static unsigned int    calib_seq = 0;   // seqlock of calib for the threads besides the servo
+static Calibration     arm_calib[N_ARMS+1];      // copies of the control callbacks
+static unsigned int    arm_calib_seq[N_ARMS+1];
 static double          raw_positions[N_DOFS+1];
 static double          raw_velocities[N_DOFS+1];
 static double          raw_torques[N_DOFS+1];
@@ -104,29 +149,138 @@ static int             panda_servo_rate;
 static double          panda_time_overrun = 0;
 
 static double          real_time_dt = 0;
+static double          arm_dt[N_ARMS+1];  // last period of each arm in ms
+static Panda4ArmStamp  arm_stamp[N_ARMS+1]; // when each arm took its last sample
 
-static pthread_t       cthread;   // thread for gripper read state
-static pthread_t       ethread;   // thread for gripper execute
-
-static char            ip_string[20]; // ip of franka robot
+static char            ip_string[N_ARMS+1][20]; // ip of franka robots
 
 static int             change_endeff_flag = FALSE;
 
-static int             robot_id=1;
+static int             robot_id=1;        // 0 means all arms in this process
+static int             first_arm=1;       // the arms served by this process
+static int             last_arm=1;
+static int             arm_cpu[N_ARMS+1]; // CPU of the control thread of each arm
 static int             use_gripper = FALSE;
+#ifdef PANDA4_STANDIN
+static int             loadcell_loopback = TRUE;  // no EtherCAT without robots
+#else
+static int             loadcell_loopback = FALSE; // loopback instead of the Axia80
+#endif
+#ifdef AXIA80
+static int             use_loadcell = TRUE;       // the Axia80, or its loopback
+#else
+static int             use_loadcell = FALSE;      // only with the loopback
+#endif
+static long            loadcell_stale = 0;        // ticks without a new load cell sample
+
+// synchronization of the control threads of the arms with the servo thread
+static pthread_mutex_t   calib_mutex;         // guards the calibration against the command line
+static sem_t             servo_sem;           // triggers the servo thread
+static pthread_t         servo_thread;
+static int               servo_thread_running = FALSE;
+static std::atomic<int>  arrived_arms(0);     // bit mask of arms that ticked
+static std::atomic<int>  run_arms_flag(TRUE);
+static std::atomic<int>  arm_errors(0);
+static int               all_arms_mask = 0;
+static long              cmd_wait_ns = 300000; // wait of an arm for the servo thread
+static long              stale_servo_cmds[N_ARMS+1]; // ticks that kept the last command
+
+// the policy for commands of the motor servo that are missing or late
+enum LateCommandPolicies {
+  LATE_CMD_HOLD=1,        // repeat the last command
+  LATE_CMD_EXTRAPOLATE,   // extrapolate the last two commands linearly, then hold
+  LATE_CMD_GRAVITY,       // zero torque, i.e., only the gravity compensation of the robot
+};
+
+static char late_cmd_policy_names[][20]= {
+  {"dummy"},
+  {"hold"},
+  {"extrapolate"},
+  {"gravity"}
+};
+
+typedef struct LateCommand {
+  double        servo_time;   // servo time of the tick
+  unsigned long t_mono;       // CLOCK_MONOTONIC time of the tick in ns
+  double        age;          // age of the command in s, or -1 if none could be read
+  int           n_in_row;     // consecutive late commands including this one
+} LateCommand;
+
+#define N_LATE_CMD_LOG 32
+#define LATE_CMD_MAX_EXTRAPOLATION 2.0  // command periods beyond the last command
+static int             late_cmd_policy = LATE_CMD_HOLD;
+static int             late_cmd_max_age = 1;      // motor servo ticks a command may lag behind the state
+static int             late_cmd_stop = 20;        // late commands in a row for a safe stop, 0 for never
+static long            late_cmds = 0;
+static int             late_cmds_in_row = 0;
+static int             late_cmds_max_in_row = 0;
+static int             late_cmd_tripped = FALSE;
+static LateCommand     late_cmd_log[N_LATE_CMD_LOG];
+static double          good_u[2][N_DOFS+1];      // the last two commands in time
+static double          good_ts[2] = {-1,-1};     // and their servo times
+static double          good_uff[N_DOFS+1];       // uff of the last command that was read
+
+/* the motor servo can run at an integer divisor of the robot rate, and its
+   commands are then interpolated along their command trajectories */
+static int             cmd_ratio = 1;             // robot ticks per motor servo tick
+static Panda4CmdTraj   cmd_traj[N_DOFS+1];
+
+// the startup: the arms of this servo are brought up in parallel, and all
+// robot servos of the cell meet at a barrier before torque control starts
+typedef struct ArmStartup {
+  int    ok;
+  double connect;         // connecting to the robot in s
+  double model;           // loading the Franka model in s
+  double init;            // collision behavior, impedances and frames in s
+} ArmStartup;
+
+typedef struct StartupPhase {
+  char   name[40];
+  double duration;        // in s
+} StartupPhase;
+
+#define N_STARTUP_PHASES 32
+static ArmStartup      arm_startup[N_ARMS+1];
+static StartupPhase    startup_phases[N_STARTUP_PHASES];
+static int             n_startup_phases = 0;
+static double          startup_timeout = 60.0;   // wait for the other servos in s
 
 
 
 enum GripperTasks {
-  MOVE,
+  MOVE=1,
   GRASP,
-  READ_STATE,
+  STOP,
 };
 
-static int             run_gripper_thread_flag = FALSE;
-static int             gripper_task=READ_STATE;
-
-static double          width,speed,force,eps_in,eps_out; //grasp parameters
+typedef struct GripperCommand {
+  int    task;
+  double width,speed,force,eps_in,eps_out;
+} GripperCommand;
+
+/*! a lock-free single-producer single-consumer queue of gripper commands:
+    the servo pushes and the command thread of the gripper pops */
+#define N_GRIPPER_QUEUE 8
+typedef struct GripperQueue {
+  GripperCommand              cmd[N_GRIPPER_QUEUE];
+  std::atomic<unsigned long>  head;   // next command to pop
+  std::atomic<unsigned long>  tail;   // next free slot
+} GripperQueue;
+
+static GripperQueue            gripper_queue[N_ARMS+1];
+static sem_t                   gripper_cmd_sem[N_ARMS+1];   // posted for every queued command
+static sem_t                   gripper_state_sem[N_ARMS+1]; // ditto, wakes the state thread
+static std::atomic<int>        gripper_busy[N_ARMS+1];      // a move or grasp is executing
+static std::atomic<int>        gripper_preempted[N_ARMS+1]; // stop was sent for the current motion
+static std::atomic<long>       gripper_drops[N_ARMS+1];     // commands dropped on a full queue
+static PandaGripper           *gripper_ptr[N_ARMS+1];
+#ifdef ROBOTIQ2F
+static std::mutex              gripper_io_mutex[N_ARMS+1];  // the serial line is not shared
+#endif
+static pthread_t               gripper_cmd_thread[N_ARMS+1];
+static pthread_t               gripper_state_thread[N_ARMS+1];
+static double                  gripper_rate = 20.0;         // rate of the gripper state in Hz
+static std::atomic<int>        run_gripper_thread_flag(FALSE);
 
 enum CollectData {
   COLLECT_NONE=0,
@@ -134,39 +288,197 @@ enum CollectData {
   COLLECT_SYSTEMATIC,
 };
 
-// model parameters from Franka model library
-static  std::array<double, N_DOFS_PER_ROBOT> coriolis;
-static  std::array<double, N_DOFS_PER_ROBOT> u_gravity;
-static  std::array<double, 49> mass;
+/* the gravity torques of the servo loop can come from the SL model instead
+   of the Franka model, which the diagnostics thread then cross-checks */
+static int     sl_gravity = FALSE;
+
+/*! the results of the diagnostics thread for one arm: model parameters from
+    the Franka model library, and the cross-check of the gravity models. They
+    are published under a seqlock for the data collection and status(). */
+typedef struct DiagResult {
+  std::array<double, N_DOFS_PER_ROBOT> coriolis;
+  std::array<double, 49>               mass;
+  std::array<double, N_DOFS_PER_ROBOT> gravity_err;   // SL minus Franka
+  double                               gravity_err_max; // largest discrepancy of any joint
+} DiagResult;
+
+static DiagResult      diag_result[N_ARMS+1];
+static unsigned int    diag_seq[N_ARMS+1];
+static std::atomic<int> gravity_err_reset[N_ARMS+1];  // status() printed the maximum
+
+/*! a lock-free single-slot buffer that always hands the reader the most recent
+    item: a triple buffer, where the writer and the reader each own one
+    copy and exchange it atomically with the third one */
+#define SLOT_NEW 4
+template <typename T> struct LatestSlot {
+  T                  item[3];
+  std::atomic<int>   middle;   // index of the exchange copy, plus SLOT_NEW
+  int                back;     // index of the copy owned by the writer
+  int                front;    // index of the copy owned by the reader
+};
+typedef LatestSlot<franka::RobotState> StateSlot;
+
+static StateSlot       diag_slot[N_ARMS+1];
+static franka::Model  *diag_model[N_ARMS+1];
+static double          diag_rate = 10.0;   // rate of the diagnostics thread in Hz
+static long            diag_updates = 0;
+static pthread_t       dthread;   // thread for model diagnostics
+static pthread_t       pthread_sl;      // thread that publishes the SL shared memory
+static long            publish_errors = 0;  // time-outs of the SL semaphores
+
+// continuous estimation of the bias of the f/t channels of each arm
+#define N_FT_CHANNELS (4*N_CART)  // computed and sensed forces and moments
+static double          ft_bias[N_MISC_SENSORS+1];  // EWMA of the raw f/t channels at rest
+static long            ft_bias_samples[N_ARMS+1];  // number of samples in the EWMA
+static int             ft_contact[N_ARMS+1];       // the task commands contact
+static double          ft_bias_tau     = 1.0;      // time constant of the EWMA in s
+static double          ft_bias_max_vel = 0.05;     // joint velocity gate in rad/s
+
+/*! the sample that the control callback of an arm hands to the servo thread,
+    and the torque command that the servo thread hands back, both in the raw
+    units of the robot */
+typedef struct ArmSample {
+  double         q[N_DOFS_PER_ROBOT];
+  double         dq[N_DOFS_PER_ROBOT];
+  double         tau_J[N_DOFS_PER_ROBOT];
+  double         u_grav[N_DOFS_PER_ROBOT];  // Franka gravity, unless sl_gravity
+  double         ft[N_FT_CHANNELS];         // computed and sensed f/t channels
+  double         dt;                        // period in ms
+  Panda4ArmStamp stamp;
+} ArmSample;
+
+typedef struct ArmCommand {
+  double         tau_d[N_DOFS_PER_ROBOT];   // includes the torque offset
+  unsigned long  t_sample;                  // t_mono of the sample it answers
+} ArmCommand;
+
+static LatestSlot<ArmSample>  arm_sample_slot[N_ARMS+1];
+static LatestSlot<ArmCommand> arm_command_slot[N_ARMS+1];
+
+static Panda4MessageTable servo_messages;
+
+// recording and replay of the robot state stream
+static char            record_file[100] = "";
+static char            replay_file[100] = "";
+static int             replay_fast = FALSE;  // replay as fast as possible instead of 1x
+static Panda4Record   *replay_record[N_ARMS+1]; // the record that replaces the robot
+static int             replaying = FALSE;    // the servo runs from a recording
+static Panda4Record    replay_cmd[N_ARMS+1]; // the commands that replace the motor servo
+static int             replay_cmd_fresh[N_ARMS+1];
+static long            replay_cmd_misses = 0;
 
 static int collect_data = COLLECT_NONE;
 
+/*! the packed sample of all collected variables: the data collection of SL
+    reads from collect_sample, which the servo fills with a few memcpys, either
+    directly or through a lock-free ring that a background thread drains */
+typedef struct CollectSample {
+  double    real_time_dt;
+  double    late_cmds;
+  SL_Jstate joint[N_DOFS+1];
+  double    ucor[N_DOFS+1];
+  double    ugerr[N_DOFS+1];
+  double    misc[N_MISC_SENSORS+1];
+} CollectSample;
+
+#define N_COLLECT_RING 1024
+static CollectSample              collect_sample;
+static CollectSample              collect_ring[N_COLLECT_RING];
+static std::atomic<unsigned long> collect_head(0);   // next sample to write to file
+static std::atomic<unsigned long> collect_tail(0);   // next free slot
+static long                       collect_overflows = 0;
+static unsigned long              collect_max_fill  = 0;
+static int                        async_collect     = TRUE;
+static pthread_t                  wthread;           // thread for data collection
+
 // global functions
 
 
 // local functions
 static int  receive_des_commands(void);
-static int  send_sim_state(void);
-static int  send_misc_sensors(void);
+static void interpolate_commands(double t);
+static int  send_sim_state(SL_Jstate *state, double ts);
+static int  send_misc_sensors(double *misc, double ts);
 
 static int  init_translation(void);
-static void translate_sensor_readings(SL_Jstate *joint_raw_state);
-static void translate_misc_sensor_readings(double *misc_raw_sensors);
-static void translate_commands(SL_Jstate *commands);
+static int  load_cached_config(void);
+static int  update_calibration(void);
+static void translate_sensor_readings(int from_arm, int to_arm, SL_Jstate *joint_raw_state,
+				      double *misc_raw_sensors);
+static void translate_commands(int from_arm, int to_arm, SL_Jstate *commands);
+static void sl_arm_gravity(int arm, const Calibration *c, const double *q_raw,
+			   double *u_gravity);
+static int  readCalibration(Calibration *c, unsigned int *seq);
+static int  readDiagResult(int arm, DiagResult *d);
 
 static void addVarsToDataCollection(void);
+static void packCollectSample(CollectSample *sample);
+static void collectSample(void);
+static void spawnCollectThread(void);
+static void *collectThread(void *);
 
-static int  init_panda_servo(franka::Robot &robot);
+static int  init_panda_servo(void);
+static int  init_panda_robot(franka::Robot &robot);
 static int  run_panda_servo(void);
+static franka::Torques panda_callback(int arm, franka::Model *model,
+				      const franka::RobotState &state,
+				      franka::Duration period);
+static void recordTick(int arm, unsigned long t_mono,
+		       const franka::RobotState &state, franka::Duration period,
+		       const std::array<double, N_DOFS_PER_ROBOT> &u_gravity,
+		       const double *ft, const std::array<double, N_DOFS_PER_ROBOT> &tau_d);
+static int  replayServo(char *fname);
+static int  replayCommands(double *ts);
+static void recordCommands(int ok, double ts);
+static void runArmControl(int arm, franka::Robot *robot, franka::Model *model);
+static void connectArm(int arm, std::unique_ptr<franka::Robot> *robot,
+		       std::unique_ptr<franka::Model> *model);
+static void initArm(int arm, franka::Robot *robot);
+static void addStartupPhase(const char *name, unsigned long t0);
+static void printStartup(void);
+static void lockCalibration(void);
+static void unlockCalibration(void);
+static int  serveArms(void);
+static void waitForCommand(int arm, unsigned long t_sample, ArmCommand **command);
+static void spawnServoThread(void);
+static void stopServoThread(void);
+static void *servoThread(void *);
 
 static void read_sensor_offs(void);
+static void dump_timing(void);
+static void reset_timing(void);
+static void start_recording(void);
+static void stop_recording(void);
+static void loopback_wrench(void);
+static void print_late_commands(void);
 
 static void compute_ft_offsets(void);
+static void update_ft_bias(void);
 
-static void spawnGripperThread(void);
+static void spawnGripperThread(int arm);
 static void *gripperThread(void *);
+static void *gripperStateThread(void *);
+static int  pushGripperCommand(int arm, GripperCommand *cmd);
+static int  popGripperCommand(int arm, GripperCommand *cmd);
+static void addToTimespec(struct timespec *t, long ns);
+
+template <typename T> static void initSlot(LatestSlot<T> *slot);
+template <typename T> static void writeSlot(LatestSlot<T> *slot, const T &item);
+template <typename T> static int  readSlot(LatestSlot<T> *slot, T **item);
+static void spawnDiagnosticsThread(void);
+static void *diagnosticsThread(void *);
+static void spawnPublishThread(void);
+static void *publishThread(void *);
 
 static int  checkForMessages(void);
+static void initMessages(void);
+static void msgGraspGripper(const float *buf, int arg);
+static void msgMoveGripper(const float *buf, int arg);
+static void msgStopGripper(const float *buf, int arg);
+static void msgChangeEndeffector(const float *buf, int arg);
+static void msgCalibrateFT(const float *buf, int arg);
+static void msgFTContact(const float *buf, int arg);
+static void msgStatus(const float *buf, int arg);
 
 static int  set_stiffness_frame(franka::Robot &robot);
 static int  set_endeffector_frame(franka::Robot &robot);
@@ -195,9 +507,11 @@ initializes everything and starts the servo loop
 int 
 main(int argc, char**argv)
 {
-  int  i,j;
+  int  i,j,arm;
+  int  n_cpus;
   char string[100];
   double aux;
+  unsigned long t0 = panda4_timeNs(),t1;
 
   // parse command line options
   parseOptions(argc, argv);
@@ -207,41 +521,88 @@ main(int argc, char**argv)
     if (strcmp(argv[i],"-id")==0) {
       if (i+1 < argc) {
 	sscanf(argv[i+1],"%d",&robot_id);
-	printf("Create servo for Panda %d ...\n",robot_id);
 	break;
       }
     }
   }
-  sprintf(servo_name,"panda_%d",robot_id);
 
-  // check for Panda IP address
+  if (robot_id == 0) {
+    first_arm = 1;
+    last_arm  = N_ARMS;
+    sprintf(servo_name,"panda");
+    printf("Create servo for all %d Pandas ...\n",N_ARMS);
+  } else {
+    first_arm = last_arm = robot_id;
+    sprintf(servo_name,"panda_%d",robot_id);
+    printf("Create servo for Panda %d ...\n",robot_id);
+  }
+
+  for (arm=first_arm; arm<=last_arm; ++arm)
+    all_arms_mask |= 1<<arm;
+
+  // recording of the robot state stream, or replay of such a recording
+  // instead of the robots
   for (i=1; i<argc; ++i) {
-    if (strcmp(argv[i],"-ip")==0) {
+    if (strcmp(argv[i],"-record")==0 && i+1 < argc)
+      strcpy(record_file,argv[i+1]);
+    else if (strcmp(argv[i],"-replay")==0 && i+1 < argc)
+      strcpy(replay_file,argv[i+1]);
+    else if (strcmp(argv[i],"-fast")==0)
+      replay_fast = TRUE;
+    else if (strcmp(argv[i],"-loadcell_loopback")==0)
+      loadcell_loopback = TRUE;
+  }
+  if (loadcell_loopback)
+    use_loadcell = TRUE;
+
+#ifdef PANDA4_STANDIN
+  // the stand-in robots need no IP address
+  for (arm=first_arm; arm<=last_arm; ++arm)
+    sprintf(ip_string[arm],"standin_%d",arm);
+  printf("Running the Panda stand-in instead of the robots\n");
+#else
+  // check for Panda IP address, which is only meaningful for a single arm
+  for (i=1; i<argc; ++i) {
+    if (strcmp(argv[i],"-ip")==0 && first_arm == last_arm) {
       if (i+1 < argc) {
-	strcpy(ip_string,argv[i+1]);
-	printf("Connecting to Panda at %s ...\n",ip_string);
+	strcpy(ip_string[first_arm],argv[i+1]);
+	printf("Connecting to Panda at %s ...\n",ip_string[first_arm]);
 	break;
       }
     }
   }
-  if (i>= argc) {
+  if (i>= argc && strlen(replay_file) == 0) {
     // no IP found
     // try to find it in the parameter pool
-    sprintf(string,"panda_ip_%d",robot_id);
-    if (read_parameter_pool_string(config_files[PARAMETERPOOL],string,ip_string)) {
-      ;  // ip string found
-    } else {
-      // abort
-      printf("No IP address for Panda_%d\n",robot_id);
-      std::cout << "Press Enter to continue..." << std::endl;
-      std::cin.ignore();
-      return FALSE;
+    for (arm=first_arm; arm<=last_arm; ++arm) {
+      sprintf(string,"panda_ip_%d",arm);
+      if (read_parameter_pool_string(config_files[PARAMETERPOOL],string,ip_string[arm])) {
+	;  // ip string found
+      } else {
+	// abort
+	printf("No IP address for Panda_%d\n",arm);
+	std::cout << "Press Enter to continue..." << std::endl;
+	std::cin.ignore();
+	return FALSE;
+      }
     }
   }
+#endif
+
+  // the CPU for the control thread of each arm: CPU 0 is left to the
+  // non-real-time threads by default
+  n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  for (arm=first_arm; arm<=last_arm; ++arm) {
+    sprintf(string,"panda_%d_servo_cpu",arm);
+    if (read_parameter_pool_int(config_files[PARAMETERPOOL],string,&j))
+      arm_cpu[arm] = j;
+    else
+      arm_cpu[arm] = n_cpus > 1 ? 1 + (arm-1)%(n_cpus-1) : 0;
+  }
 
   // a bit of a hack: allow offset commands for all joints in case of a
   // a load cell bias
-  for (i=(robot_id-1)*N_DOFS_PER_ROBOT+1; i<=robot_id*N_DOFS_PER_ROBOT; ++i) {
+  for (i=(first_arm-1)*N_DOFS_PER_ROBOT+1; i<=last_arm*N_DOFS_PER_ROBOT; ++i) {
     sprintf(string,"%s_load_offset",joint_names[i]);
     if (read_parameter_pool_double(config_files[PARAMETERPOOL],string,&aux)) {
       torque_offset[i] = aux;
@@ -253,154 +614,151 @@ main(int argc, char**argv)
   // adjust settings if SL runs for a real robot
   setRealRobotOptions();
 
+  // the startup barrier and configuration cache of all robot servos
+  panda4_initStartup();
+  if (read_parameter_pool_double(config_files[PARAMETERPOOL],"panda_startup_timeout",&aux) && aux > 0)
+    startup_timeout = aux;
+
   // signal handlers
   installSignalHandlers();
 
-  // spawn command line interface thread
-  spawnCommandLineThread(NULL);
+  // lock memory and prefault the stack before anything real-time starts
+  panda4_initRTProfile("xrprobot");
 
-  // spawn gripper thread
-  if (use_gripper)
-    spawnGripperThread();
+  // spawn command line interface thread, which is kept off the control CPUs
+  spawnCommandLineThread(NULL);
+  panda4_rtOtherThreads(RT_ROLE_CLI);
 
-  // initialize Panda robot
-  try {
-    franka::Robot   robot(ip_string);
+  addStartupPhase("options and RT profile",t0);
 
-    // Load the kinematics and dynamics model and keep it accessible in the scope of this file
-    franka::Model model = robot.loadModel();
+  // a replay runs the servo without any hardware
+  if (strlen(replay_file) > 0)
+    return replayServo(replay_file);
 
-    // turn on auto recovery
-    robot.automaticErrorRecovery();
+  // spawn gripper threads
+  if (read_parameter_pool_double(config_files[PARAMETERPOOL],"panda_gripper_rate",&aux) && aux > 0)
+    gripper_rate = aux;
+  if (use_gripper)
+    for (arm=first_arm; arm<=last_arm; ++arm)
+      spawnGripperThread(arm);
 
-#ifdef AXIA80
-    // the axia load cell
-    EthercatCommunication ethercat_mod;
-    Axia80Ethercat        axia80;
-    double                ft_in_units[6];
-
-    ethercat_mod.InitEthercat("enp2s0");
-    if (ethercat_mod.active_) {
-      axia80.InitAxia80( &ethercat_mod,
-			 1,
-			 axia80_ethercat::kSlot1,
-			 axia80_ethercat::k3900Hz,
-			 axia80_ethercat::kFilter4);
-      axia80_ptr = &axia80;
-    } else {
-      printf("No active ethercat master running\n");
-      return false;
+  // initialize Panda robots
+  try {
+    std::unique_ptr<franka::Robot> robots[N_ARMS+1];
+    std::unique_ptr<franka::Model> models[N_ARMS+1];
+    std::thread                    arm_threads[N_ARMS+1];
+    int                            ok;
+
+    // connect to all robots and load their models in parallel, while this
+    // thread initializes the servo
+    t1 = panda4_timeNs();
+    for (arm=first_arm; arm<=last_arm; ++arm)
+      arm_threads[arm] = std::thread(connectArm,arm,&robots[arm],&models[arm]);
+
+    // the axia load cell of the first arm, or its loopback, which is read
+    // in its own thread
+    ok = TRUE;
+    if (use_loadcell) {
+      int n_avg = 1, cpu = -1;
+
+      read_parameter_pool_int(config_files[PARAMETERPOOL],"panda_loadcell_n_avg",&n_avg);
+      read_parameter_pool_int(config_files[PARAMETERPOOL],"panda_loadcell_cpu",&cpu);
+      ok = panda4_startLoadCell(loadcell_loopback,n_avg,cpu);
+      addStartupPhase("load cell",t1);
     }
-#endif
-
-
-    // Define callback for the joint torque control loop.
-#ifdef AXIA80    
-    std::function<franka::Torques(const franka::RobotState&, franka::Duration)> panda_callback = 
-      [&model,&robot,&axia80,&ethercat_mod](const franka::RobotState& state, franka::Duration period) -> franka::Torques {
-#else
-    std::function<franka::Torques(const franka::RobotState&, franka::Duration)> panda_callback = 
-      [&model,&robot](const franka::RobotState& state, franka::Duration period) -> franka::Torques {
-#endif
 
-      static int n_calls = 0;
-      double ft_in_units[6];
-#ifdef AXIA80          
-      axia80_ethercat::Axia80Data data;
-#endif
+    // initalize the servo
+    t0 = panda4_timeNs();
+    if (ok)
+      ok = init_panda_servo();
+    addStartupPhase("servo and configuration",t0);
+
+    for (arm=first_arm; arm<=last_arm; ++arm) {
+      arm_threads[arm].join();
+      ok = ok && arm_startup[arm].ok;
+    }
+    addStartupPhase("bring-up of all arms",t1);
+    if (!ok) {
+      panda4_stopLoadCell();
+      return FALSE;
+    }
 
-      ++n_calls;
+    for (arm=first_arm; arm<=last_arm; ++arm) {
+      // the diagnostics thread shares the model, which only evaluates functions
+      diag_model[arm] = models[arm].get();
+      initSlot(&diag_slot[arm]);
+    }
 
-      // extract all relevant info from the robot state variable
-      for (size_t i = 0; i < N_DOFS_PER_ROBOT; i++) {
-	raw_positions[(robot_id-1)*N_DOFS_PER_ROBOT+i+1]  = state.q[i];
-	raw_velocities[(robot_id-1)*N_DOFS_PER_ROBOT+i+1] = state.dq[i];
-	raw_torques[(robot_id-1)*N_DOFS_PER_ROBOT+i+1]    = state.tau_J[i] - torque_offset[(robot_id-1)*N_DOFS_PER_ROBOT+i+1];
-      }
+    // the robot parameters, again in parallel
+    t0 = panda4_timeNs();
+    for (arm=first_arm; arm<=last_arm; ++arm)
+      arm_threads[arm] = std::thread(initArm,arm,robots[arm].get());
+    for (arm=first_arm; arm<=last_arm; ++arm) {
+      arm_threads[arm].join();
+      ok = ok && arm_startup[arm].ok;
+    }
+    addStartupPhase("robot parameters",t0);
+    if (!ok) {
+      panda4_stopLoadCell();
+      return FALSE;
+    }
 
-      // change sign of the readings as we seemingly get the force/torque the robot applies
-      raw_misc_sensors[c_f_indices[robot_id]+0] = -state.K_F_ext_hat_K[0];
-      raw_misc_sensors[c_f_indices[robot_id]+1] = -state.K_F_ext_hat_K[1];
-      raw_misc_sensors[c_f_indices[robot_id]+2] = -state.K_F_ext_hat_K[2];
-      raw_misc_sensors[c_m_indices[robot_id]+0] = -state.K_F_ext_hat_K[3];
-      raw_misc_sensors[c_m_indices[robot_id]+1] = -state.K_F_ext_hat_K[4];
-      raw_misc_sensors[c_m_indices[robot_id]+2] = -state.K_F_ext_hat_K[5];
+    printf("\nPanda initialized\n");
+    printStartup();
+    panda4_rtReport();
 
-#ifdef AXIA80
-      // read the axia load cell and fix orientation offset of load cell relative to gripper coordinates
-      ethercat_mod.RunEthercat();
-      axia80.ReadAxia80Data(&data,ft_in_units);
-      raw_misc_sensors[s_f_indices[robot_id]+0] =  ft_in_units[1] * cos(PI/12.) - ft_in_units[0] * sin(PI/12.);
-      raw_misc_sensors[s_f_indices[robot_id]+1] = -ft_in_units[0] * cos(PI/12.) - ft_in_units[1] * sin(PI/12.);
-      raw_misc_sensors[s_f_indices[robot_id]+2] =  ft_in_units[2];
-      raw_misc_sensors[s_m_indices[robot_id]+0] =  ft_in_units[4] * cos(PI/12.) - ft_in_units[3] * sin(PI/12.);
-      raw_misc_sensors[s_m_indices[robot_id]+1] = -ft_in_units[3] * cos(PI/12.) - ft_in_units[4] * sin(PI/12.);
-      raw_misc_sensors[s_m_indices[robot_id]+2] =  ft_in_units[5];
-#else
-      // just pretend the sensed load cell is identical to the computed one
-      raw_misc_sensors[s_f_indices[robot_id]+0] =  raw_misc_sensors[c_f_indices[robot_id]+0];
-      raw_misc_sensors[s_f_indices[robot_id]+1] =  raw_misc_sensors[c_f_indices[robot_id]+1];
-      raw_misc_sensors[s_f_indices[robot_id]+2] =  raw_misc_sensors[c_f_indices[robot_id]+2];
-      raw_misc_sensors[s_m_indices[robot_id]+0] =  raw_misc_sensors[c_m_indices[robot_id]+0];
-      raw_misc_sensors[s_m_indices[robot_id]+1] =  raw_misc_sensors[c_m_indices[robot_id]+1];
-      raw_misc_sensors[s_m_indices[robot_id]+2] =  raw_misc_sensors[c_m_indices[robot_id]+2];
-#endif
-      // check the timing: number of milliseconds the servo loop ran: should be 1 for perfect behavior
-      real_time_dt = period.toMSec();
+    // signal that this process is initialized
+    semGive(sm_init_process_ready_sem);
+    panda4_servoReady();
 
-      // all processing is done in a separate function
-      std::array<double, N_DOFS_PER_ROBOT> tau_d;
+    // the model diagnostics run at low priority outside of the control loops
+    if (read_parameter_pool_double(config_files[PARAMETERPOOL],"panda_diagnostics_rate",&aux))
+      diag_rate = aux;
+    if (diag_rate > 0)
+      spawnDiagnosticsThread();
 
-      // compute gravity torques to inform the motor servo about the total command
-      // and compute other dyn parameters for print out. Only gravity is really needed
-      // while coriolis and mass matrix are just for debugging
-      
-      u_gravity = model.gravity(state); // default gravity is -9.81 in Z
-      coriolis = model.coriolis(state);
-      mass = model.mass(state);
+    // all arms of the cell go into torque control together
+    t0 = panda4_timeNs();
+    if (!panda4_waitForServos(startup_timeout))
+      printf("Not all Panda servos are ready after %.0f s -- starting anyway\n",startup_timeout);
+    else if (panda4_launchTime() > 0)
+      printf("All Panda servos ready after %.2f s (waited %.2f s)\n",
+	     panda4_launchTime(),(panda4_timeNs()-t0)*1.e-9);
 
-      for (size_t i = 0; i < N_DOFS_PER_ROBOT; ++i)
-	u_grav[(robot_id-1)*N_DOFS_PER_ROBOT+i+1] = u_gravity[i];
+    // Start real-time control with the callback without rate limitter and no cutoff
+    servo_enabled = TRUE;
+    // default first data collection
+    scd();
 
+    if (strlen(record_file) > 0)
+      panda4_startRecording(record_file,first_arm,last_arm,panda_servo_rate);
 
-      if (! run_panda_servo() ) {
+    // with several arms, the servo runs in its own thread, off the control
+    // threads of the arms; a single arm runs it in its callback
+    if (first_arm != last_arm)
+      spawnServoThread();
 
-	robot.stop();
+    if (first_arm == last_arm) {
 
-      } else {
+      // a single arm runs its control loop in the main thread
+      runArmControl(first_arm,robots[first_arm].get(),models[first_arm].get());
 
-	// copy the control commands back into franka::Torques
-	if (n_calls <= 10) {  // these are a few start-up ticks to assure the task servo has the robot state
-	  for (size_t i = 0; i < N_DOFS_PER_ROBOT; i++) 
-	    tau_d[i] = 0.0;
-	} else {
-	  for (size_t i = 0; i < N_DOFS_PER_ROBOT; i++) {
-	    tau_d[i] = raw_desired_torques[(robot_id-1)*N_DOFS_PER_ROBOT+i+1] + torque_offset[(robot_id-1)*N_DOFS_PER_ROBOT+i+1]; 
-	  }
-	}
-      }
-      
-      // Send torque command.
-      return tau_d;
-    };
+    } else {
 
-    // initalize the servo
-    if (!init_panda_servo(robot))
-      return FALSE;
+      // one pinned control thread per arm
+      for (arm=first_arm; arm<=last_arm; ++arm)
+	arm_threads[arm] = std::thread(runArmControl,arm,robots[arm].get(),models[arm].get());
 
-    // Start real-time control with the callback without rate limitter and no cutoff
-    servo_enabled = TRUE;
-    // default first data collection
-    scd();
+      for (arm=first_arm; arm<=last_arm; ++arm)
+	arm_threads[arm].join();
 
-    // note that the rate limitter is enabled, such that the robot does not shut down
-    // e.g., when executing freeze. Normally, if smooth motion is generated, we should
-    // not get weird dynamics from this
-    robot.control(panda_callback,true,franka::kMaxCutoffFrequency);
-    //robot.control(panda_callback,true,franka::kDefaultCutoffFrequency);    
+    }
 
   } catch (const franka::Exception& ex) {
     std::cerr << ex.what() << std::endl;
+    stopServoThread();
+    panda4_stopRecording();
+    panda4_stopLoadCell();
     // need to kills process immediate to kill all other robots
     // std::cout << "Press Enter to continue..." << std::endl;
     // std::cin.ignore();
@@ -408,483 +766,544 @@ main(int argc, char**argv)
     return FALSE;
   } 
 
+  stopServoThread();
+  panda4_stopRecording();
+  panda4_stopLoadCell();
+
+  if (arm_errors > 0)
+    return FALSE;
+
+  if (late_cmd_tripped) {
+    printf("Safe stop after %d late commands of the motor servo in a row\n",late_cmd_stop);
+    print_late_commands();
+    return FALSE;
+  }
+
+#ifdef PANDA4_RTCHECK
+  // a checked run fails if the callback ever allocated or blocked
+  if (panda4_rtCheckViolations() > 0) {
+    panda4_rtCheckReport();
+    return FALSE;
+  }
+#endif
 
   return TRUE;
 }
  
 /*!*****************************************************************************
  *******************************************************************************
-\note  init_panda_servo
-\date  Dec. 2018
+\note  runArmControl
+\date  Oct. 2026
    
 \remarks 
 
-          Initializes all user specific sensory processing
+ runs the libfranka control loop of one arm until it terminates. The
+ calling thread first takes the real-time profile of a control thread on
+ the CPU of this arm. An exception in one arm ends the control loops of all
+ arms, as the cell cannot continue with a missing arm.
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
 
-     \param[in,out]     robot  : robot object of Panda
+ \param[in]     arm   : the arm ID (1 to N_ARMS)
+ \param[in]     robot : robot object of this arm
+ \param[in]     model : model object of this arm
 
  ******************************************************************************/
-static int
-init_panda_servo(franka::Robot &robot)
+static void
+runArmControl(int arm, franka::Robot *robot, franka::Model *model)
 {
-  int i,j, count;
-  double quat[N_QUAT+1];
-  double pos[N_CART+1];
-  double euler[N_CART+1];
-  double aux;
-  MY_MATRIX(R,1,N_CART,1,N_CART);
-  MY_VECTOR(v,1,N_CART);
-
 
-  // get shared memory
-  if (!init_shared_memory())
-    return FALSE;
+  panda4_rtThread(RT_ROLE_CONTROL,arm_cpu[arm]);
 
-  // memory
-  joint_lin_rot     = my_matrix(1,n_dofs,1,6);
-  pos_polar         = my_vector(1,n_dofs);
-  load_polar        = my_vector(1,n_dofs);
-  
+  try {
 
-  // initalizes translation to and from units
-  if (!init_translation())
-    return FALSE;
+    // note that the rate limitter is enabled, such that the robot does not shut down
+    // e.g., when executing freeze. Normally, if smooth motion is generated, we should
+    // not get weird dynamics from this
+    robot->control([arm,model](const franka::RobotState& state,
+			       franka::Duration period) -> franka::Torques {
+		     return panda_callback(arm,model,state,period);
+		   },true,franka::kMaxCutoffFrequency);
+    //robot->control(...,true,franka::kDefaultCutoffFrequency);    
 
-  // read link parameters
-  if (!read_link_parameters(config_files[LINKPARAMETERS]))
-    return FALSE;
+  } catch (const franka::Exception& ex) {
+    char          fname[100];
+    int           stage;
+    unsigned long ns;
+
+    std::cerr << "Panda " << arm << ": " << ex.what() << std::endl;
+    ++arm_errors;
+    run_arms_flag = FALSE;
+
+    // report which stage took the longest in the last ticks before the fault
+    stage = panda4_worstTimingStage(arm,&ns);
+    if (stage > 0)
+      printf("Panda %d: slowest callback stage before the fault: %s (%.1f us)\n",
+	     arm,timing_stage_names[stage],ns/1000.);
+    stage = panda4_worstTimingStage(0,&ns);
+    if (stage > 0)
+      printf("Panda %d: slowest servo stage before the fault: %s (%.1f us)\n",
+	     arm,timing_stage_names[stage],ns/1000.);
+    sprintf(fname,"%s_fault_timing.txt",servo_name);
+    panda4_dumpTiming(fname);
+  }
 
-  // the the default endeffector parameters
-  setDefaultEndeffector();
+}
 
-  // initialize the base variables
-  bzero((void *)&base_state,sizeof(base_state));
-  bzero((void *)&base_orient,sizeof(base_orient));
-  base_orient.q[_Q0_] = 1.0;
+/*!*****************************************************************************
+ *******************************************************************************
+\note  connectArm
+\date  Oct. 2026
+   
+\remarks 
 
-  if (read_parameter_pool_double_array(config_files[PARAMETERPOOL],"init_base_pos",N_CART,pos)) {
-    for (i=1; i<=N_CART; ++i)
-      base_state.x[i] = pos[i];
-  }
-  
-  if (read_parameter_pool_double_array(config_files[PARAMETERPOOL],"init_base_quat",N_QUAT,quat)) {
-    aux = 0.0;
-    for (i=1; i<=N_QUAT; ++i)
-      aux += sqr(quat[i]);
-    aux = sqrt(aux);
+ connects to the robot of one arm and loads its model, which runs in a
+ thread per arm at startup
 
-    for (i=1; i<=N_QUAT; ++i) 
-      base_orient.q[i] = quat[i]/(aux + 1.e-10);
-  } else if (read_parameter_pool_double_array(config_files[PARAMETERPOOL],"init_base_euler",N_CART,euler)) {
-    SL_quat qtmp;
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
 
-    bzero((void *)&qtmp,sizeof(qtmp));
-    eulerToQuat(euler, &qtmp);
-    for (i=1; i<=N_QUAT; ++i) 
-      base_orient.q[i] = qtmp.q[i];
-  }
+ \param[in]     arm   : the arm ID (1 to N_ARMS)
+ \param[out]    robot : the robot object of this arm
+ \param[out]    model : the model object of this arm
 
-  // initialize servo variables
-  servo_time         = 0;
-  panda_servo_errors = 0;
-  panda_servo_time   = 0;
-  panda_servo_calls  = 0;
-  panda_servo_rate   = servo_base_rate;
-  
-  // man pages
-  addToMan("status","displays status information about servo",status);
-  addToMan("readSensorOffsets","re-reads the sensor-offsets file",read_sensor_offs);
-  addToMan("calibrate_cFT","calibrates the computed FT offsets",compute_ft_offsets);
-  
-  // data collection
-  initCollectData(servo_base_rate);
-  addVarsToDataCollection();
+ ******************************************************************************/
+static void
+connectArm(int arm, std::unique_ptr<franka::Robot> *robot,
+	   std::unique_ptr<franka::Model> *model)
+{
+  unsigned long t0,t1;
 
-  // the sensor calibration
-  if (!read_sensor_calibration(config_files[SENSORCALIBRATION],joint_lin_rot,
-      pos_polar,load_polar))
-    return FALSE;
+  arm_startup[arm].ok = FALSE;
 
-  if (!read_sensor_offsets(config_files[SENSOROFFSETS]))
-    return FALSE;
+  try {
 
-  // set Panda parameters
+    t0 = panda4_timeNs();
+    robot->reset(new franka::Robot(ip_string[arm]));
+    t1 = panda4_timeNs();
+    arm_startup[arm].connect = (t1-t0)*1.e-9;
 
-  // Set collision behavior: needs to be outside of real-time loop
-  robot.setCollisionBehavior({{100.0, 100.0, 100.0, 100.0, 100.0, 100.0, 100.0}},
-			     {{100.0, 100.0, 100.0, 100.0, 100.0, 100.0, 100.0}},
-			     {{100.0, 100.0, 100.0, 100.0, 100.0, 100.0}},
-			     {{100.0, 100.0, 100.0, 100.0, 100.0, 100.0}});
-  
-  robot.setJointImpedance({{3000, 3000, 3000, 2500, 2500, 2000, 2000}});
-  robot.setCartesianImpedance({{3000, 3000, 3000, 300, 300, 300}});
+    // Load the kinematics and dynamics model and keep it accessible in the scope of this file
+    model->reset(new franka::Model((*robot)->loadModel()));
+    arm_startup[arm].model = (panda4_timeNs()-t1)*1.e-9;
 
-  // set the stiffness frame of the robot to the endeffector frame
-  set_endeffector_frame(robot);
-  set_stiffness_frame(robot);  
+    // turn on auto recovery
+    (*robot)->automaticErrorRecovery();
 
-  printf("\nPanda initialized\n");
+    arm_startup[arm].ok = TRUE;
 
-  // signal that this process is initialized
-  semGive(sm_init_process_ready_sem);
+  } catch (const franka::Exception& ex) {
+    std::cerr << "Panda " << arm << ": " << ex.what() << std::endl;
+  }
 
-  return TRUE;
 }
 
 /*!*****************************************************************************
  *******************************************************************************
-\note  set_stiffness_frame
-\date  May 2019
+\note  initArm
+\date  Oct. 2026
    
 \remarks 
 
- Sets the stiffness coordinate for the simulated F/T sensor. This is relative
- to the EE (endeffector) frame, which was set in another function
+ sets the parameters of the robot of one arm, which runs in a thread per
+ arm at startup
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
 
- \param[in]     robot  : robot object of Panda
+ \param[in]     arm   : the arm ID (1 to N_ARMS)
+ \param[in]     robot : the robot object of this arm
 
  ******************************************************************************/
-static int
-set_stiffness_frame(franka::Robot &robot)
+static void
+initArm(int arm, franka::Robot *robot)
 {
-  int i,j, count;
-  MY_MATRIX(R,1,N_CART,1,N_CART);
-  MY_VECTOR(v,1,N_CART);
-
-  // set the stiffness frame of the robot to the endeffector frame
-  std::array<double, 16> offset_homogeneous_matrix;
-  offset_homogeneous_matrix.fill(0.0);
-
-  // compute the rotation matrix of endeffector
-  vec_zero(v);
-  v[_Z_] = FT_OFF_G;
-
-  eulerToRotMat(v,R);
+  unsigned long t0 = panda4_timeNs();
 
-  // sort all into a homogenous transformation matrix in column-major format (Franka!)
-  count = 0;
-  for (i=1; i<=N_CART; ++i) {
-    for (j=1; j<=N_CART; ++j) {
-      offset_homogeneous_matrix[count++] = R[j][i];
-    }
-    offset_homogeneous_matrix[count++] = 0.0;
-  }
+  arm_startup[arm].ok = FALSE;
 
-  for (i=1; i<=N_CART; ++i) {
-    if ( i == _Z_ ) {
-      offset_homogeneous_matrix[count++] = FT_OFF_Z;
-    } else {
-      offset_homogeneous_matrix[count++] = 0.0;
-    }
+  try {
+    arm_startup[arm].ok = init_panda_robot(*robot);
+  } catch (const franka::Exception& ex) {
+    std::cerr << "Panda " << arm << ": " << ex.what() << std::endl;
   }
 
-  offset_homogeneous_matrix[count++] = 1.0;
-
-  robot.setK(offset_homogeneous_matrix);
-
-  return TRUE;
+  arm_startup[arm].init = (panda4_timeNs()-t0)*1.e-9;
 
 }
+
 /*!*****************************************************************************
  *******************************************************************************
-\note  set_endeffector_frame
-\date  May 2019
+\note  addStartupPhase
+\date  Oct. 2026
    
 \remarks 
 
- Sets the endeffector coordinate frame. This overwrite any config from the 
- Web interface, such that the EE is consistently at the flange. This is 
- important to set the stiffness frame afterwards, which mimics the location
- of an actual load cell (such that an actualy load cell can be mounted 
- trivially with no code change, just offset parameters in SL_user.h
-
- Caveat: the libfranka will report endeffector info in this EE frame, which is
- not the actual endeffector. But SL does not use this info as it relies on its
- own kinematics computations.
+ adds the duration of a phase of the startup
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
 
- \param[in]     robot  : robot object of Panda
+ \param[in]     name : the name of the phase
+ \param[in]     t0   : the start of the phase from panda4_timeNs()
 
  ******************************************************************************/
-static int
-set_endeffector_frame(franka::Robot &robot)
+static void
+addStartupPhase(const char *name, unsigned long t0)
 {
-  int i,j, count;
-  MY_MATRIX(R,1,N_CART,1,N_CART);
-  MY_VECTOR(v,1,N_CART);
-
-  // set the stiffness frame of the robot to the endeffector frame
-  std::array<double, 16> offset_homogeneous_matrix;
-  offset_homogeneous_matrix.fill(0.0);
+  StartupPhase *p;
 
-  // compute the rotation matrix of endeffector
-  vec_zero(v);
-  v[_G_] = -FL_G;
-
-  eulerToRotMat(v,R);
+  if (n_startup_phases >= N_STARTUP_PHASES)
+    return;
 
-  // sort all into a homogenous transformation matrix in column-major format (Franka!)
-  count = 0;
-  for (i=1; i<=N_CART; ++i) {
-    for (j=1; j<=N_CART; ++j) {
-      offset_homogeneous_matrix[count++] = R[j][i];
-    }
-    offset_homogeneous_matrix[count++] = 0.0;
-  }
+  p = &startup_phases[n_startup_phases++];
+  strncpy(p->name,name,sizeof(p->name)-1);
+  p->name[sizeof(p->name)-1] = '\0';
+  p->duration = (panda4_timeNs()-t0)*1.e-9;
+}
 
-  for (i=1; i<=N_CART; ++i) {
-    if ( i == _Z_ ) {
-      offset_homogeneous_matrix[count++] = 0.0; // this means at the FLANGE
-    } else {
-      offset_homogeneous_matrix[count++] = 0.0;
-    }
-  }
+/*!*****************************************************************************
+ *******************************************************************************
+\note  printStartup
+\date  Oct. 2026
+   
+\remarks 
 
-  offset_homogeneous_matrix[count++] = 1.0;
+ prints the durations of the startup phases, and of each arm
 
-  robot.setEE(offset_homogeneous_matrix);
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
 
-  return TRUE;
+     none
 
+ ******************************************************************************/
+static void
+printStartup(void)
+{
+  int i,arm;
+
+  printf("Startup of %s [s]:\n",servo_name);
+  for (i=0; i<n_startup_phases; ++i)
+    printf("  %-28s %7.3f\n",startup_phases[i].name,startup_phases[i].duration);
+  for (arm=first_arm; arm<=last_arm; ++arm)
+    printf("  Panda %d: connect %7.3f  model %7.3f  parameters %7.3f\n",
+	   arm,arm_startup[arm].connect,arm_startup[arm].model,arm_startup[arm].init);
 }
 
 /*!*****************************************************************************
-*******************************************************************************
-\note  run_panda_servo
-\date  Dec 2018
+ *******************************************************************************
+\note  panda_callback
+\date  Oct. 2026
    
 \remarks 
 
-    this function is clocked by the panda callback at the moto_servo_rate
+ the 1kHz torque control callback of one arm. It hands the sample of this
+ arm to the servo thread through a lock-free slot, and the arm whose tick
+ completes the set of all arms of this process triggers the servo thread,
+ which publishes the combined state and reads the new commands. The
+ torques are the most recent ones that the servo thread handed back, i.e.,
+ commands lag the state by one tick. In a replay, the servo runs in the
+ calling thread instead, such that the replay is deterministic. An arm that
+ ticks twice before the set is complete just refreshes its sample.
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
 
-         none
-     
-         returns sucess or failure
+ \param[in]     arm    : the arm ID (1 to N_ARMS)
+ \param[in]     model  : model object of this arm, or NULL in a replay
+ \param[in]     state  : the current robot state
+ \param[in]     period : time since the last call
+
+ returns the torque command of this arm
 
  ******************************************************************************/
-int
-run_panda_servo(void) 
+static franka::Torques
+panda_callback(int arm, franka::Model *model,
+	       const franka::RobotState& state, franka::Duration period)
 {
-  int      i,j;
-  double   aux;
+  static int        n_calls[N_ARMS+1];
+  static ArmCommand *command[N_ARMS+1];  // the last command of the servo thread
+  int        mask;
+  double     ft_in_units[6] = {0.0,0.0,0.0,0.0,0.0,0.0};
+  double    *ft;
+  ArmSample  sample;
+  unsigned long t0,t1,t2;
+  Panda4LoadCellSample loadcell;
+
+  // all processing is done in a separate function
+  std::array<double, N_DOFS_PER_ROBOT> tau_d;
+
+  // no allocations or blocking calls from here on
+  PANDA4_RT_ENTER();
+
+  ++n_calls[arm];
+
+  t0 = panda4_timeNs();
+
+  // compute gravity torques to inform the motor servo about the total command.
+  // The SL gravity model uses a copy of the calibration, which is refreshed
+  // without a lock whenever the calibration changed. Coriolis and mass matrix
+  // are only for print out and logging, and they are computed by the
+  // diagnostics thread from a snapshot of the state
+      
+  std::array<double, N_DOFS_PER_ROBOT> u_gravity;
+  if (replay_record[arm] != NULL) {
+    std::copy(replay_record[arm]->gravity,replay_record[arm]->gravity+N_DOFS_PER_ROBOT,
+	      u_gravity.begin());
+  } else if (sl_gravity) {
+    if (__atomic_load_n(&calib_seq,__ATOMIC_ACQUIRE) != arm_calib_seq[arm])
+      readCalibration(&arm_calib[arm],&arm_calib_seq[arm]);
+    sl_arm_gravity(arm,&arm_calib[arm],state.q.data(),u_gravity.data());
+  } else {
+    u_gravity = model->gravity(state); // default gravity is -9.81 in Z
+  }
+  if (diag_rate > 0)
+    writeSlot(&diag_slot[arm],state);
+
+  t1 = panda4_timeNs();
+  panda4_addTiming(arm,TIMING_MODEL,t1-t0);
+
+  // read the axia load cell and fix orientation offset of load cell relative to gripper coordinates
+  if (use_loadcell && arm == first_arm) {
+    if (replay_record[arm] != NULL) {
+      memcpy(ft_in_units,replay_record[arm]->ft,sizeof(ft_in_units));
+    } else if (panda4_readLoadCell(&loadcell)) {
+      // the latest sample of the acquisition thread, which is never waited for
+      memcpy(ft_in_units,loadcell.ft,sizeof(ft_in_units));
+      if (t0 > loadcell.t_mono + 2000000000UL/PANDA4_LOADCELL_RATE)
+	++loadcell_stale;
+    } else {
+      ++loadcell_stale;
+    }
+  }
 
-  // increment time
-  servo_time += 1./(double)panda_servo_rate;
-  panda_servo_time = servo_time;
-  ++panda_servo_calls;
+  // extract all relevant info from the robot state variable
+  for (size_t i = 0; i < N_DOFS_PER_ROBOT; i++) {
+    sample.q[i]      = state.q[i];
+    sample.dq[i]     = state.dq[i];
+    sample.tau_J[i]  = state.tau_J[i];
+    sample.u_grav[i] = u_gravity[i];
+  }
 
-  // translate the raw values to units
-  for (i=(robot_id-1)*N_DOFS_PER_ROBOT+1; i<=robot_id*N_DOFS_PER_ROBOT; ++i)
-    last_joint_sim_state[i] = joint_sim_state[i];
+  // change sign of the readings as we seemingly get the force/torque the robot
+  // applies; the channels are ordered as c_f, c_m, s_f, s_m
+  ft = sample.ft;
+  ft[0] = -state.K_F_ext_hat_K[0];
+  ft[1] = -state.K_F_ext_hat_K[1];
+  ft[2] = -state.K_F_ext_hat_K[2];
+  ft[3] = -state.K_F_ext_hat_K[3];
+  ft[4] = -state.K_F_ext_hat_K[4];
+  ft[5] = -state.K_F_ext_hat_K[5];
+
+  if (use_loadcell && arm == first_arm) {
+    ft[6]  =  ft_in_units[1] * cos(PI/12.) - ft_in_units[0] * sin(PI/12.);
+    ft[7]  = -ft_in_units[0] * cos(PI/12.) - ft_in_units[1] * sin(PI/12.);
+    ft[8]  =  ft_in_units[2];
+    ft[9]  =  ft_in_units[4] * cos(PI/12.) - ft_in_units[3] * sin(PI/12.);
+    ft[10] = -ft_in_units[3] * cos(PI/12.) - ft_in_units[4] * sin(PI/12.);
+    ft[11] =  ft_in_units[5];
+  } else {
+    // just pretend the sensed load cell is identical to the computed one
+    for (size_t i = 0; i < 2*N_CART; i++)
+      ft[2*N_CART+i] = ft[i];
+  }
 
-  translate_sensor_readings(joint_sim_state);
+  // check the timing: number of milliseconds the servo loop ran: should be 1 for perfect behavior
+  sample.dt = period.toMSec();
 
-  // u_grav was computed from the Fanka model as gravity component, and
-  // this gravity component needs to be added to uff that was provided by
-  // the motor servo, which intentially excludes gravity in uff.
-  // this uff part of joint_sim_state is communicated back to the motor servo
-  for (i=(robot_id-1)*N_DOFS_PER_ROBOT+1; i<=robot_id*N_DOFS_PER_ROBOT; ++i)
-    joint_sim_state[i].uff  += u_grav[i];
+  // stamp the sample with the common monotonic clock and the robot clock
+  sample.stamp.t_mono  = t0;
+  sample.stamp.t_robot = state.time.toSec();
 
-  if (real_time_dt > 0) {
-    for (i=(robot_id-1)*N_DOFS_PER_ROBOT+1; i<=robot_id*N_DOFS_PER_ROBOT; ++i)
-      joint_sim_state[i].thdd = (joint_sim_state[i].thd - last_joint_sim_state[i].thd)/
-	((double)real_time_dt/1000.0); // real_time_dt is in milliseconds
-  }
-  translate_misc_sensor_readings(misc_sim_sensor);
+  writeSlot(&arm_sample_slot[arm],sample);
 
-  // send to shared memory
-  send_sim_state();
-  send_misc_sensors();
+  t2 = panda4_timeNs();
+  panda4_addTiming(arm,TIMING_STATE,t2-t1);
 
-  // trigger the motor servo with semFlush for nicer synchronization, but only for
-  // robot #1, the master clock robot
-  if (robot_id == ROBOT_MASTER_CLOCK) {
-    if (semFlush(sm_motor_servo_sem) == ERROR) {
-      return FALSE;
+  // the arm that completes the set of arms runs the servo for all of them,
+  // inline for a single arm or in a replay, and in the servo thread
+  // otherwise; clearing the set atomically lets only one arm claim it
+  mask = arrived_arms.fetch_or(1<<arm) | (1<<arm);
+  if (mask == all_arms_mask &&
+      (arrived_arms.fetch_and(~all_arms_mask) & all_arms_mask) == all_arms_mask) {
+    if (!servo_thread_running) {
+      if (!serveArms())
+	run_arms_flag = FALSE;
+    } else {
+      sem_post(&servo_sem);
     }
   }
 
-  // read the commands
-  receive_des_commands();
+  // the command that answers this sample, or the last one
+  waitForCommand(arm,sample.stamp.t_mono,&command[arm]);
 
-  // translate commands to raw
-  translate_commands(joint_sim_state);
+  // copy the control commands back into franka::Torques
+  if (n_calls[arm] <= 10 || !run_arms_flag || command[arm] == NULL) {  // these are a few start-up ticks to assure the task servo has the robot state
+    for (size_t i = 0; i < N_DOFS_PER_ROBOT; i++) 
+      tau_d[i] = 0.0;
+  } else {
+    for (size_t i = 0; i < N_DOFS_PER_ROBOT; i++)
+      tau_d[i] = command[arm]->tau_d[i];
+  }
 
-  // check for messages
-  checkForMessages();
+  if (panda4_isRecording())
+    recordTick(arm,t0,state,period,u_gravity,ft_in_units,tau_d);
 
-  // data collection
-  writeToBuffer();
+  panda4_addTiming(arm,TIMING_CALLBACK,panda4_timeNs()-t0);
+  panda4_endTimingTick(arm);
 
-  // check for servo overuns
-  panda_servo_errors += real_time_dt - 1;
+  PANDA4_RT_LEAVE();
 
-  return TRUE;
+  // end the control loop of all arms if the servo failed in any of them
+  if (!run_arms_flag)
+    return franka::MotionFinished(franka::Torques(tau_d));
+
+  // Send torque command.
+  return tau_d;
 }
 
 /*!*****************************************************************************
  *******************************************************************************
-\note  init_translation
-\date  Dec 1997
+\note  lockCalibration
+\date  Oct. 2026
    
 \remarks 
 
-          the translation of raw numbers to and from units
+ locks the calibration of the servo against changes from the command
+ line. The lock inherits the priority of the servo thread when it waits.
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
 
-     none
+ none
 
  ******************************************************************************/
-static int
-init_translation(void)
-
+static void
+lockCalibration(void)
 {
-  
-  int       i,j;
-  FILE      *in;
-  int       error_flag = FALSE;
-  char      string[100];
-  int       rc;
-
-
-  /* Get the translation info for each joint: we just parse those
-     values from the file config/Translation.cf */
-
-  sprintf(string,"%s%s",CONFIG,TRANSLATION_FILE);
-  in = fopen(string,"r");
-  if (in == NULL) {
-    printf("ERROR: Cannot open file >%s<!\n",string);
-    return FALSE;
-  }
-
-  /* parse all translation variables according to the joint variables */
-  for (i=1; i<=N_DOFS; ++i) {
-    if (!find_keyword(in, &(joint_names[i][0]))) {
-      printf("ERROR: Cannot find offset for >%s<!\n",joint_names[i]);
-      fclose(in);
-      return FALSE;
-    }
-    rc = fscanf(in,"%lf %lf %lf %lf %lf %lf %lf %lf",
-	   &joint_trans_positions[i].slope,
-	   &joint_trans_positions[i].offset,
-	   &joint_trans_velocities[i].slope,
-	   &joint_trans_velocities[i].offset,
-	   &joint_trans_torques[i].slope,
-	   &joint_trans_torques[i].offset,
-	   &joint_trans_desired_torques[i].slope,
-	   &joint_trans_desired_torques[i].offset);
-  }
-
-  for (i=1; i<= n_misc_sensors; ++i) {
-    if (!find_keyword(in, &(misc_sensor_names[i][0]))) {
-      printf("ERROR: Cannot find offset for >%s<!\n",misc_sensor_names[i]);
-      fclose(in);
-      return FALSE;
-    }
-    rc =fscanf(in,"%lf %lf",
-	   &misc_trans_sensors[i].slope,
-	   &misc_trans_sensors[i].offset);
-  }
-
-  fclose(in);
-
-  return TRUE;
-
+  pthread_mutex_lock(&calib_mutex);
 }
 
 /*!*****************************************************************************
  *******************************************************************************
-\note  translate_sensor_readings
-\date  Dec 1997
+\note  unlockCalibration
+\date  Oct. 2026
    
 \remarks 
 
-          translate sensors to unit values
+ unlocks the calibration of the servo
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
 
- \param[out]    raw : the raw state
+ none
 
  ******************************************************************************/
 static void
-translate_sensor_readings(SL_Jstate *joint_raw_state)
-
+unlockCalibration(void)
 {
+  pthread_mutex_unlock(&calib_mutex);
+}
 
-  int i,j;
-  double temp=0;
-
-  for (i=(robot_id-1)*N_DOFS_PER_ROBOT+1; i<=robot_id*N_DOFS_PER_ROBOT; ++i) {
-
-    // translate the position sensors
-    joint_raw_state[i].th = (joint_trans_positions[i].offset + 
-			     raw_positions[i]) * joint_trans_positions[i].slope;
+/*!*****************************************************************************
+ *******************************************************************************
+\note  serveArms
+\date  Oct. 2026
+   
+\remarks 
 
-    // translate the velocity sensors
+ one tick of the servo for all arms of this process: picks up the latest
+ sample of each arm, runs the servo, and hands the new torque commands
+ back to the control callbacks. Called by the servo thread, or by the
+ callback itself for a single arm and in a replay.
 
-    joint_raw_state[i].thd = (joint_trans_velocities[i].offset + 
-			      raw_velocities[i]) * joint_trans_velocities[i].slope;
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
 
-    // translate the force sensors
-    joint_raw_state[i].load = (joint_trans_torques[i].offset + 
-			       raw_torques[i]) * joint_trans_torques[i].slope;
+ returns the result of run_panda_servo()
 
-    joint_raw_state[i].th   *= pos_polar[i];
-    joint_raw_state[i].thd  *= pos_polar[i];
-    joint_raw_state[i].load *= load_polar[i];
+ ******************************************************************************/
+static int
+serveArms(void)
+{
+  int        i,arm,off,rc;
+  ArmSample *sample;
+  ArmCommand command;
+
+  for (arm=first_arm; arm<=last_arm; ++arm) {
+    if (!readSlot(&arm_sample_slot[arm],&sample))
+      continue;   // an arm that ticked twice in a set has refreshed its sample
+
+    off = (arm-1)*N_DOFS_PER_ROBOT;
+    for (i=0; i<N_DOFS_PER_ROBOT; ++i) {
+      raw_positions[off+i+1]  = sample->q[i];
+      raw_velocities[off+i+1] = sample->dq[i];
+      raw_torques[off+i+1]    = sample->tau_J[i] - torque_offset[off+i+1];
+      u_grav[off+i+1]         = sample->u_grav[i];
+    }
+    for (i=0; i<N_FT_CHANNELS; ++i)
+      raw_misc_sensors[c_f_indices[arm]+i] = sample->ft[i];
+    arm_dt[arm]    = sample->dt;
+    arm_stamp[arm] = sample->stamp;
+  }
 
-    // take out the user offset from the position
-    joint_raw_state[i].th -= joint_range[i][THETA_OFFSET];
+  rc = run_panda_servo();
 
+  for (arm=first_arm; arm<=last_arm; ++arm) {
+    off = (arm-1)*N_DOFS_PER_ROBOT;
+    for (i=0; i<N_DOFS_PER_ROBOT; ++i)
+      command.tau_d[i] = raw_desired_torques[off+i+1] + torque_offset[off+i+1];
+    command.t_sample = arm_stamp[arm].t_mono;
+    writeSlot(&arm_command_slot[arm],command);
   }
 
+  return rc;
 }
 
 /*!*****************************************************************************
  *******************************************************************************
-\note  translate_misc_sensor_readings
-\date  Dec 1997
+\note  waitForCommand
+\date  Oct. 2026
    
 \remarks 
 
-          translate miscellaneous sensors to unit values
+ picks up the command that the servo computed from the current sample of
+ an arm. With the servo thread, the arm waits for it for at most
+ cmd_wait_ns, since the servo only runs when the last arm of the set has
+ ticked, and keeps the last command otherwise. Without the servo thread,
+ the command is already there, or, in a replay of several arms, comes
+ with the next set.
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
 
- \param[out]    raw : the raw state
+ \param[in]     arm      : the arm ID (1 to N_ARMS)
+ \param[in]     t_sample : t_mono of the current sample of the arm
+ \param[in,out] command  : the last command, replaced by newer ones
 
  ******************************************************************************/
 static void
-translate_misc_sensor_readings(double *misc_raw_sensor)
-
+waitForCommand(int arm, unsigned long t_sample, ArmCommand **command)
 {
+  unsigned long t0 = 0;
+  unsigned long t;
 
-  int i,j;
-  double temp=0;
+  while (TRUE) {
 
-  for (i=c_f_indices[robot_id]; i<=c_f_indices[robot_id]+N_MISC_PER_ROBOT-1; ++i) {
+    if (readSlot(&arm_command_slot[arm],command) && (*command)->t_sample >= t_sample)
+      return;
 
-    /* translate the position sensors */
+    if (!servo_thread_running || !run_arms_flag)
+      return;
 
-    misc_raw_sensor[i] = (misc_trans_sensors[i].offset + 
-			     raw_misc_sensors[i]) * 
-      misc_trans_sensors[i].slope;
+    t = panda4_timeNs();
+    if (t0 == 0) {
+      t0 = t;
+    } else if ((long)(t-t0) > cmd_wait_ns) {
+      ++stale_servo_cmds[arm];
+      return;
+    }
 
   }
 
@@ -892,140 +1311,106 @@ translate_misc_sensor_readings(double *misc_raw_sensor)
 
 /*!*****************************************************************************
  *******************************************************************************
-\note  translate_commands
-\date  Dec 1997
+\note  spawnServoThread
+\date  Oct. 2026
    
 \remarks 
 
-          translate unit commands into raw values
+ spawns the servo thread, which runs the servo of all arms whenever the
+ control callbacks complete a set of arms
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
 
- \param[in]     commands : the structure containing the commands
+ none
 
  ******************************************************************************/
 static void
-translate_commands(SL_Jstate *command)
+spawnServoThread(void)
 {
+  int rc;
 
-  int i,j;
-  double temp=0;
-  double raw;
-
-  for (i=(robot_id-1)*N_DOFS_PER_ROBOT+1; i<=robot_id*N_DOFS_PER_ROBOT; ++i) {
-
-    temp = command[i].u * load_polar[i];
-
-    raw = temp/joint_trans_desired_torques[i].slope -
-      joint_trans_desired_torques[i].offset; 
-
-    raw_desired_torques[i] = raw;
-
+  if ((rc=pthread_create(&servo_thread,NULL,servoThread,NULL))) {
+    printf("pthread_create returned with %d\n",rc);
+    return;
   }
-
+  servo_thread_running = TRUE;
 }
 
-
 /*!*****************************************************************************
  *******************************************************************************
-\note  addVarsToDataCollection
-\date  Nov 2007
+\note  stopServoThread
+\date  Oct. 2026
    
 \remarks 
 
-        adds important variables to data collection
+ ends the control loops of all arms and joins the servo thread
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
 
-     none
+ none
 
  ******************************************************************************/
 static void
-addVarsToDataCollection(void)
-
+stopServoThread(void)
 {
-  int i;
-  
-  addVarToCollect((char *)&(real_time_dt),"real_time_dt","s", DOUBLE,FALSE);
-
-  for (i=1; i<=N_DOFS; ++i) {
-    char string[100];
-
-    sprintf(string,"%s_th",joint_names[i]);
-    addVarToCollect((char *)&(joint_sim_state[i].th),string,"rad", DOUBLE,FALSE);
-    sprintf(string,"%s_thd",joint_names[i]);
-    addVarToCollect((char *)&(joint_sim_state[i].thd),string,"rad/s", DOUBLE,FALSE);
-    sprintf(string,"%s_thdd",joint_names[i]);
-    addVarToCollect((char *)&(joint_sim_state[i].thdd),string,"rad/s^2", DOUBLE,FALSE);
-    sprintf(string,"%s_u",joint_names[i]);
-    addVarToCollect((char *)&(joint_sim_state[i].u),string,"Nm", DOUBLE,FALSE);
-    sprintf(string,"%s_load",joint_names[i]);
-    addVarToCollect((char *)&(joint_sim_state[i].load),string,"Nm", DOUBLE,FALSE);
-  }
-
-
-  for (i=1; i<=N_MISC_SENSORS; ++i) {
-    char string[100];
+  run_arms_flag = FALSE;
 
-    sprintf(string,"%s",misc_sensor_names[i]);
-    addVarToCollect((char *)&(misc_sim_sensor[i]),string,"-",DOUBLE,FALSE);
-  }
-
-  updateDataCollectScript();
+  if (!servo_thread_running)
+    return;
 
+  sem_post(&servo_sem);
+  pthread_join(servo_thread,NULL);
+  servo_thread_running = FALSE;
 }
 
 /*!*****************************************************************************
  *******************************************************************************
-\note  receive_des_commands
-\date  Nov. 2007
+\note  servoThread
+\date  Oct. 2026
    
 \remarks 
 
-        reads the commands from the joint_sim_state shared memory
-        structure
-	
+ the servo thread, with the real-time profile of a servo loop. It waits
+ for the trigger of the control callbacks, and a failing servo ends the
+ control loops of all arms.
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
 
-     none
+ none
 
  ******************************************************************************/
-static int 
-receive_des_commands(void)
+static void *
+servoThread(void *)
 {
-  
-  int i;
+  panda4_rtThread(RT_ROLE_SERVO,-1);
 
-  if (semTake(sm_des_commands_sem,ns2ticks(TIME_OUT_NS)) == ERROR) {
-    
-    ++panda_servo_errors;
-    return FALSE;
+  while (TRUE) {
 
-  } 
+    if (sem_wait(&servo_sem) != 0)
+      continue;   // interrupted by a signal
+
+    if (!run_arms_flag)
+      break;
+
+    if (!serveArms())
+      run_arms_flag = FALSE;
 
-  for (i=(robot_id-1)*N_DOFS_PER_ROBOT+1; i<=robot_id*N_DOFS_PER_ROBOT; ++i) {
-    joint_sim_state[i].u  = (double) sm_des_commands->des_command[i].u;
-    joint_sim_state[i].uff = (double) sm_des_commands->des_command[i].uff;
   }
-  
-  semGive(sm_des_commands_sem);
 
-  return TRUE;
+  return NULL;
 }
 
 /*!*****************************************************************************
  *******************************************************************************
-\note  send_sim_state
-\date  Nov. 2007
+\note  init_panda_servo
+\date  Dec. 2018
    
 \remarks 
 
-        sends the entire joint_sim_state to shared memory
-	
+          Initializes all user specific sensory processing
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
@@ -1033,225 +1418,2728 @@ receive_des_commands(void)
      none
 
  ******************************************************************************/
-static int 
-send_sim_state(void)
+static int
+init_panda_servo(void)
 {
-  
-  int i;
+  int i,j, count;
+  double quat[N_QUAT+1];
+  double pos[N_CART+1];
+  double euler[N_CART+1];
+  double aux;
+  char   string[100];
+  pthread_mutexattr_t mattr;
+  MY_MATRIX(R,1,N_CART,1,N_CART);
+  MY_VECTOR(v,1,N_CART);
 
-  // joint state
-  if (semTake(sm_joint_sim_state_sem,ns2ticks(TIME_OUT_NS)) == ERROR) {
-    
-    ++panda_servo_errors;
+
+  // get shared memory
+  if (!init_shared_memory())
     return FALSE;
 
-  } 
+  // the exchange between the control callbacks and the servo thread; a
+  // command line thread that holds the calibration lock inherits the
+  // priority of the servo thread waiting for it
+  pthread_mutexattr_init(&mattr);
+  pthread_mutexattr_setprotocol(&mattr,PTHREAD_PRIO_INHERIT);
+  pthread_mutex_init(&calib_mutex,&mattr);
+  pthread_mutexattr_destroy(&mattr);
+  sem_init(&servo_sem,0,0);
+  for (i=1; i<=N_ARMS; ++i) {
+    initSlot(&arm_sample_slot[i]);
+    initSlot(&arm_command_slot[i]);
+  }
 
-  cSL_Jstate(joint_sim_state,sm_joint_sim_state_data,n_dofs,DOUBLE2FLOAT);
-    
-  for (i=(robot_id-1)*N_DOFS_PER_ROBOT+1; i<=robot_id*N_DOFS_PER_ROBOT; ++i)
-      sm_joint_sim_state->joint_sim_state[i] = sm_joint_sim_state_data[i];
+  // the lock-free state and command exchange with the motor servo
+  if (!panda4_initSharedState())
+    return FALSE;
 
-  if (robot_id == ROBOT_MASTER_CLOCK)
-    sm_joint_sim_state->ts = servo_time;
-  else
-    // keep the clock synrnized against master
-    servo_time = sm_joint_sim_state->ts;
+  // memory
+  joint_lin_rot     = my_matrix(1,n_dofs,1,6);
+  pos_polar         = my_vector(1,n_dofs);
+  load_polar        = my_vector(1,n_dofs);
   
-  semGive(sm_joint_sim_state_sem);
 
+  // initalizes translation to and from units, the sensor calibration, the
+  // link parameters and the sensor offsets, which only the first servo of
+  // the cell parses
+  if (!load_cached_config())
+    return FALSE;
+
+  // the the default endeffector parameters
+  setDefaultEndeffector();
+
+  // initialize the base variables
+  bzero((void *)&base_state,sizeof(base_state));
+  bzero((void *)&base_orient,sizeof(base_orient));
+  base_orient.q[_Q0_] = 1.0;
+
+  if (read_parameter_pool_double_array(config_files[PARAMETERPOOL],"init_base_pos",N_CART,pos)) {
+    for (i=1; i<=N_CART; ++i)
+      base_state.x[i] = pos[i];
+  }
+  
+  if (read_parameter_pool_double_array(config_files[PARAMETERPOOL],"init_base_quat",N_QUAT,quat)) {
+    aux = 0.0;
+    for (i=1; i<=N_QUAT; ++i)
+      aux += sqr(quat[i]);
+    aux = sqrt(aux);
+
+    for (i=1; i<=N_QUAT; ++i) 
+      base_orient.q[i] = quat[i]/(aux + 1.e-10);
+  } else if (read_parameter_pool_double_array(config_files[PARAMETERPOOL],"init_base_euler",N_CART,euler)) {
+    SL_quat qtmp;
+
+    bzero((void *)&qtmp,sizeof(qtmp));
+    eulerToQuat(euler, &qtmp);
+    for (i=1; i<=N_QUAT; ++i) 
+      base_orient.q[i] = qtmp.q[i];
+  }
+
+  // initialize servo variables
+  servo_time         = 0;
+  panda_servo_errors = 0;
+  panda_servo_time   = 0;
+  panda_servo_calls  = 0;
+  panda_servo_rate   = PANDA_ROBOT_RATE;
+
+  // the motor servo runs at servo_base_rate
+  if (servo_base_rate <= 0 || panda_servo_rate % servo_base_rate != 0) {
+    printf("The servo base rate %d is not an integer divisor of the robot rate %d\n",
+	   servo_base_rate,panda_servo_rate);
+    return FALSE;
+  }
+  cmd_ratio = panda_servo_rate/servo_base_rate;
+
+  // the health counters for xtelemetry, which are not essential for the servo
+  panda4_initTelemetry(servo_name,panda_servo_rate);
+
+  // f/t bias estimation
+  if (read_parameter_pool_double(config_files[PARAMETERPOOL],"panda_ft_bias_tau",&aux) && aux > 0)
+    ft_bias_tau = aux;
+  if (read_parameter_pool_double(config_files[PARAMETERPOOL],"panda_ft_bias_max_vel",&aux))
+    ft_bias_max_vel = aux;
+  bzero((void *)ft_bias,sizeof(ft_bias));
+  bzero((void *)ft_bias_samples,sizeof(ft_bias_samples));
+  bzero((void *)ft_contact,sizeof(ft_contact));
+
+  // the policy for late commands of the motor servo
+  if (read_parameter_pool_string(config_files[PARAMETERPOOL],"panda_late_cmd_policy",string)) {
+    for (i=LATE_CMD_HOLD; i<=LATE_CMD_GRAVITY; ++i)
+      if (strcmp(string,late_cmd_policy_names[i])==0)
+	break;
+    if (i > LATE_CMD_GRAVITY) {
+      printf("Unknown late command policy >%s< -- using %s\n",
+	     string,late_cmd_policy_names[LATE_CMD_HOLD]);
+      i = LATE_CMD_HOLD;
+    }
+    late_cmd_policy = i;
+  }
+  if (read_parameter_pool_int(config_files[PARAMETERPOOL],"panda_late_cmd_max_age",&i) && i >= 1)
+    late_cmd_max_age = i;
+  if (read_parameter_pool_int(config_files[PARAMETERPOOL],"panda_late_cmd_stop",&i) && i >= 0)
+    late_cmd_stop = i;
+
+  // the wait of the arms for the servo thread in us
+  if (read_parameter_pool_double(config_files[PARAMETERPOOL],"panda_cmd_wait",&aux) && aux >= 0)
+    cmd_wait_ns = (long)(aux*1000.);
+
+  // the gravity torques from the SL model instead of the Franka model
+  if (read_parameter_pool_int(config_files[PARAMETERPOOL],"panda_sl_gravity",&i))
+    sl_gravity = i;
+  
+  // man pages
+  addToMan("status","displays status information about servo",status);
+  addToMan("readSensorOffsets","re-reads the sensor-offsets file",read_sensor_offs);
+  addToMan("calibrate_cFT","latches the F/T bias estimate into the FT offsets",compute_ft_offsets);
+  addToMan("dumpTiming","writes the latency histograms of the servo to file",dump_timing);
+  addToMan("resetTiming","clears the latency histograms of the servo",reset_timing);
+  addToMan("startRecording","records the robot states and torques to file",start_recording);
+  addToMan("stopRecording","stops the recording of the robot states",stop_recording);
+  addToMan("rtReport","prints the real-time profile of all threads",panda4_rtReport);
+  addToMan("lateCommands","prints the last late commands of the motor servo",print_late_commands);
+#ifdef PANDA4_RTCHECK
+  addToMan("rtCheckReport","prints the allocations and blocking calls of the callback with backtraces",
+	   panda4_rtCheckReport);
+  addToMan("rtCheckReset","clears the allocations and blocking calls of the callback",
+	   panda4_rtCheckReset);
+#endif
+  if (loadcell_loopback)
+    addToMan("loopbackWrench","sets the wrench of the load cell loopback",loopback_wrench);
+
+  // messages from the task
+  initMessages();
+
+  // latency histograms
+  panda4_initTiming();
+  
+  // data collection
+  initCollectData(panda_servo_rate);
+  addVarsToDataCollection();
+  if (read_parameter_pool_int(config_files[PARAMETERPOOL],"panda_async_collect",&i))
+    async_collect = i;
+  if (async_collect)
+    spawnCollectThread();
+
+  // the SL shared memory of the joint states is published off the servo
+  spawnPublishThread();
+
+  if (!update_calibration())
+    return FALSE;
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  init_panda_robot
+\date  Oct. 2026
+   
+\remarks 
+
+          sets the parameters of one Panda robot
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     \param[in,out]     robot  : robot object of Panda
+
+ ******************************************************************************/
+static int
+init_panda_robot(franka::Robot &robot)
+{
+
+  // set Panda parameters
+
+  // Set collision behavior: needs to be outside of real-time loop
+  robot.setCollisionBehavior({{100.0, 100.0, 100.0, 100.0, 100.0, 100.0, 100.0}},
+			     {{100.0, 100.0, 100.0, 100.0, 100.0, 100.0, 100.0}},
+			     {{100.0, 100.0, 100.0, 100.0, 100.0, 100.0}},
+			     {{100.0, 100.0, 100.0, 100.0, 100.0, 100.0}});
+  
+  robot.setJointImpedance({{3000, 3000, 3000, 2500, 2500, 2000, 2000}});
+  robot.setCartesianImpedance({{3000, 3000, 3000, 300, 300, 300}});
+
+  // set the stiffness frame of the robot to the endeffector frame
+  set_endeffector_frame(robot);
+  set_stiffness_frame(robot);  
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  set_stiffness_frame
+\date  May 2019
+   
+\remarks 
+
+ Sets the stiffness coordinate for the simulated F/T sensor. This is relative
+ to the EE (endeffector) frame, which was set in another function
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     robot  : robot object of Panda
+
+ ******************************************************************************/
+static int
+set_stiffness_frame(franka::Robot &robot)
+{
+  int i,j, count;
+  MY_MATRIX(R,1,N_CART,1,N_CART);
+  MY_VECTOR(v,1,N_CART);
+
+  // set the stiffness frame of the robot to the endeffector frame
+  std::array<double, 16> offset_homogeneous_matrix;
+  offset_homogeneous_matrix.fill(0.0);
+
+  // compute the rotation matrix of endeffector
+  vec_zero(v);
+  v[_Z_] = FT_OFF_G;
+
+  eulerToRotMat(v,R);
+
+  // sort all into a homogenous transformation matrix in column-major format (Franka!)
+  count = 0;
+  for (i=1; i<=N_CART; ++i) {
+    for (j=1; j<=N_CART; ++j) {
+      offset_homogeneous_matrix[count++] = R[j][i];
+    }
+    offset_homogeneous_matrix[count++] = 0.0;
+  }
+
+  for (i=1; i<=N_CART; ++i) {
+    if ( i == _Z_ ) {
+      offset_homogeneous_matrix[count++] = FT_OFF_Z;
+    } else {
+      offset_homogeneous_matrix[count++] = 0.0;
+    }
+  }
+
+  offset_homogeneous_matrix[count++] = 1.0;
+
+  robot.setK(offset_homogeneous_matrix);
+
+  return TRUE;
+
+}
+/*!*****************************************************************************
+ *******************************************************************************
+\note  set_endeffector_frame
+\date  May 2019
+   
+\remarks 
+
+ Sets the endeffector coordinate frame. This overwrite any config from the 
+ Web interface, such that the EE is consistently at the flange. This is 
+ important to set the stiffness frame afterwards, which mimics the location
+ of an actual load cell (such that an actualy load cell can be mounted 
+ trivially with no code change, just offset parameters in SL_user.h
+
+ Caveat: the libfranka will report endeffector info in this EE frame, which is
+ not the actual endeffector. But SL does not use this info as it relies on its
+ own kinematics computations.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     robot  : robot object of Panda
+
+ ******************************************************************************/
+static int
+set_endeffector_frame(franka::Robot &robot)
+{
+  int i,j, count;
+  MY_MATRIX(R,1,N_CART,1,N_CART);
+  MY_VECTOR(v,1,N_CART);
+
+  // set the stiffness frame of the robot to the endeffector frame
+  std::array<double, 16> offset_homogeneous_matrix;
+  offset_homogeneous_matrix.fill(0.0);
+
+  // compute the rotation matrix of endeffector
+  vec_zero(v);
+  v[_G_] = -FL_G;
+
+  eulerToRotMat(v,R);
+
+  // sort all into a homogenous transformation matrix in column-major format (Franka!)
+  count = 0;
+  for (i=1; i<=N_CART; ++i) {
+    for (j=1; j<=N_CART; ++j) {
+      offset_homogeneous_matrix[count++] = R[j][i];
+    }
+    offset_homogeneous_matrix[count++] = 0.0;
+  }
+
+  for (i=1; i<=N_CART; ++i) {
+    if ( i == _Z_ ) {
+      offset_homogeneous_matrix[count++] = 0.0; // this means at the FLANGE
+    } else {
+      offset_homogeneous_matrix[count++] = 0.0;
+    }
+  }
+
+  offset_homogeneous_matrix[count++] = 1.0;
+
+  robot.setEE(offset_homogeneous_matrix);
+
+  return TRUE;
+
+}
+
+/*!*****************************************************************************
+*******************************************************************************
+\note  run_panda_servo
+\date  Dec 2018
+   
+\remarks 
+
+    this function is clocked by the panda callbacks at the robot rate, and
+    runs in the servo thread (or in the callback in a replay). The motor servo is triggered every cmd_ratio ticks, and its commands are
+    interpolated in between.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+         none
+     
+         returns sucess or failure
+
+ ******************************************************************************/
+int
+run_panda_servo(void) 
+{
+  int      i,j,arm;
+  double   aux;
+  int      cmd_ok;
+  unsigned long t0,t1,t2;
+  Panda4ArmStamp stamps[N_ARMS+1];
+  Panda4ArmState master;
+
+  t0 = t1 = panda4_timeNs();
+  panda4_telemetryBeginTick();
+
+  // increment time; a servo without the master clock robot keeps its
+  // clock synchronized with the time that the master published last
+  if (first_arm != ROBOT_MASTER_CLOCK && panda4_readArmBlock(ROBOT_MASTER_CLOCK,&master))
+    servo_time = master.ts;
+  else
+    servo_time += 1./(double)panda_servo_rate;
+  panda_servo_time = servo_time;
+  ++panda_servo_calls;
+
+  // translate the raw values to units
+  for (i=(first_arm-1)*N_DOFS_PER_ROBOT+1; i<=last_arm*N_DOFS_PER_ROBOT; ++i)
+    last_joint_sim_state[i] = joint_sim_state[i];
+
+  // the slowest arm determines the period of this tick
+  real_time_dt = 0;
+  for (arm=first_arm; arm<=last_arm; ++arm) {
+    if (arm_dt[arm] > real_time_dt)
+      real_time_dt = arm_dt[arm];
+    stamps[arm] = arm_stamp[arm];
+  }
+
+  lockCalibration();
+
+  // translate the raw values to units, which also adds the Franka gravity
+  // to uff for the motor servo
+  translate_sensor_readings(first_arm,last_arm,joint_sim_state,misc_sim_sensor);
+
+  update_ft_bias();
+
+  unlockCalibration();
+
+  if (real_time_dt > 0) {
+    for (i=(first_arm-1)*N_DOFS_PER_ROBOT+1; i<=last_arm*N_DOFS_PER_ROBOT; ++i)
+      joint_sim_state[i].thdd = (joint_sim_state[i].thd - last_joint_sim_state[i].thd)/
+	((double)real_time_dt/1000.0); // real_time_dt is in milliseconds
+  }
+
+  t2 = panda4_timeNs();
+  panda4_addTiming(0,TIMING_TRANSLATE,t2-t1);
+  t1 = t2;
+
+  // send to shared memory: the motor servo reads the seqlock blocks, which
+  // never block or drop a sample. The semaphore-protected SL structures for
+  // all other processes are filled from these blocks by the publish thread.
+  for (arm=first_arm; arm<=last_arm; ++arm)
+    panda4_writeArmState(arm,servo_time,&stamps[arm],joint_sim_state,misc_sim_sensor);
+
+  t2 = panda4_timeNs();
+  panda4_addTiming(0,TIMING_PUBLISH,t2-t1);
+  t1 = t2;
+
+  // trigger the motor servo with semFlush for nicer synchronization, but only for
+  // robot #1, the master clock robot, and only every cmd_ratio ticks. A replay
+  // takes the recorded commands instead.
+  if (!replaying && first_arm == ROBOT_MASTER_CLOCK && (panda_servo_calls-1) % cmd_ratio == 0) {
+    if (semFlush(sm_motor_servo_sem) == ERROR) {
+      return FALSE;
+    }
+  }
+
+  t2 = panda4_timeNs();
+  panda4_addTiming(0,TIMING_FLUSH,t2-t1);
+  t1 = t2;
+
+  // read the commands, with the late command policy; false trips a safe stop
+  cmd_ok = receive_des_commands();
+
+  // translate commands to raw
+  lockCalibration();
+  translate_commands(first_arm,last_arm,joint_sim_state);
+  unlockCalibration();
+
+  t2 = panda4_timeNs();
+  panda4_addTiming(0,TIMING_RECEIVE,t2-t1);
+  t1 = t2;
+
+  // check for messages
+  checkForMessages();
+
+  t2 = panda4_timeNs();
+  panda4_addTiming(0,TIMING_MESSAGES,t2-t1);
+  t1 = t2;
+
+  // data collection
+  collectSample();
+
+  t2 = panda4_timeNs();
+  panda4_addTiming(0,TIMING_COLLECT,t2-t1);
+  panda4_addTiming(0,TIMING_SERVO,t2-t0);
+  panda4_endTimingTick(0);
+
+  // check for servo overuns
+  panda_servo_errors += real_time_dt - 1;
+
+  panda4_telemetryEndTick(servo_time,panda_servo_errors);
+
+  return cmd_ok;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  init_translation
+\date  Dec 1997
+   
+\remarks 
+
+          the translation of raw numbers to and from units
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+ ******************************************************************************/
+static int
+init_translation(void)
+
+{
+  
+  int       i,j;
+  FILE      *in;
+  int       error_flag = FALSE;
+  char      string[100];
+  int       rc;
+
+
+  /* Get the translation info for each joint: we just parse those
+     values from the file config/Translation.cf */
+
+  sprintf(string,"%s%s",CONFIG,TRANSLATION_FILE);
+  in = fopen(string,"r");
+  if (in == NULL) {
+    printf("ERROR: Cannot open file >%s<!\n",string);
+    return FALSE;
+  }
+
+  /* parse all translation variables according to the joint variables */
+  for (i=1; i<=N_DOFS; ++i) {
+    if (!find_keyword(in, &(joint_names[i][0]))) {
+      printf("ERROR: Cannot find offset for >%s<!\n",joint_names[i]);
+      fclose(in);
+      return FALSE;
+    }
+    rc = fscanf(in,"%lf %lf %lf %lf %lf %lf %lf %lf",
+	   &joint_trans_positions[i].slope,
+	   &joint_trans_positions[i].offset,
+	   &joint_trans_velocities[i].slope,
+	   &joint_trans_velocities[i].offset,
+	   &joint_trans_torques[i].slope,
+	   &joint_trans_torques[i].offset,
+	   &joint_trans_desired_torques[i].slope,
+	   &joint_trans_desired_torques[i].offset);
+  }
+
+  for (i=1; i<= n_misc_sensors; ++i) {
+    if (!find_keyword(in, &(misc_sensor_names[i][0]))) {
+      printf("ERROR: Cannot find offset for >%s<!\n",misc_sensor_names[i]);
+      fclose(in);
+      return FALSE;
+    }
+    rc =fscanf(in,"%lf %lf",
+	   &misc_trans_sensors[i].slope,
+	   &misc_trans_sensors[i].offset);
+  }
+
+  fclose(in);
+
+  return TRUE;
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  load_cached_config
+\date  Oct. 2026
+   
+\remarks 
+
+          the translation, the sensor calibration, the link parameters and
+          the sensor offsets, which are identical for all Panda servos:
+          the first servo parses the files and fills the configuration
+          cache in shared memory, and all others copy from the cache
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+     returns TRUE on success
+
+ ******************************************************************************/
+static int
+load_cached_config(void)
+{
+  int                      i,j;
+  int                      ok;
+  char                     files[4][100];
+  static Panda4ConfigCache c;   // private: published only by the unlock
+
+  sprintf(files[0],"%s%s",CONFIG,TRANSLATION_FILE);
+  sprintf(files[1],"%s%s",CONFIG,config_files[SENSORCALIBRATION]);
+  sprintf(files[2],"%s%s",CONFIG,config_files[LINKPARAMETERS]);
+  sprintf(files[3],"%s%s",CONFIG,config_files[SENSOROFFSETS]);
+
+  if (panda4_lockConfigCache(files,4,startup_timeout,&c) == CONFIG_CACHED) {
+    for (i=1; i<=N_DOFS; ++i) {
+      joint_trans_positions[i].slope        = c.joint_trans[i][0];
+      joint_trans_positions[i].offset       = c.joint_trans[i][1];
+      joint_trans_velocities[i].slope       = c.joint_trans[i][2];
+      joint_trans_velocities[i].offset      = c.joint_trans[i][3];
+      joint_trans_torques[i].slope          = c.joint_trans[i][4];
+      joint_trans_torques[i].offset         = c.joint_trans[i][5];
+      joint_trans_desired_torques[i].slope  = c.joint_trans[i][6];
+      joint_trans_desired_torques[i].offset = c.joint_trans[i][7];
+      for (j=1; j<=6; ++j)
+	joint_lin_rot[i][j] = c.joint_lin_rot[i][j];
+      pos_polar[i]  = c.pos_polar[i];
+      load_polar[i] = c.load_polar[i];
+    }
+    for (i=1; i<=N_MISC_SENSORS; ++i) {
+      misc_trans_sensors[i].slope  = c.misc_trans[i][0];
+      misc_trans_sensors[i].offset = c.misc_trans[i][1];
+    }
+    // the SL globals that read_link_parameters() and read_sensor_offsets() fill
+    for (i=0; i<=N_DOFS; ++i)
+      links[i] = c.links[i];
+    for (i=1; i<=N_DOFS; ++i) {
+      for (j=MIN_THETA; j<=THETA_OFFSET; ++j)
+	joint_range[i][j] = c.joint_range[i][j];
+      joint_default_state[i] = c.joint_default_state[i];
+      joint_opt_state[i]     = c.joint_opt_state[i];
+    }
+    return TRUE;
+  }
+
+  ok = init_translation() &&
+    read_sensor_calibration(config_files[SENSORCALIBRATION],joint_lin_rot,pos_polar,load_polar) &&
+    read_link_parameters(config_files[LINKPARAMETERS]) &&
+    read_sensor_offsets(config_files[SENSOROFFSETS]);
+
+  if (ok) {
+    for (i=1; i<=N_DOFS; ++i) {
+      c.joint_trans[i][0] = joint_trans_positions[i].slope;
+      c.joint_trans[i][1] = joint_trans_positions[i].offset;
+      c.joint_trans[i][2] = joint_trans_velocities[i].slope;
+      c.joint_trans[i][3] = joint_trans_velocities[i].offset;
+      c.joint_trans[i][4] = joint_trans_torques[i].slope;
+      c.joint_trans[i][5] = joint_trans_torques[i].offset;
+      c.joint_trans[i][6] = joint_trans_desired_torques[i].slope;
+      c.joint_trans[i][7] = joint_trans_desired_torques[i].offset;
+      for (j=1; j<=6; ++j)
+	c.joint_lin_rot[i][j] = joint_lin_rot[i][j];
+      c.pos_polar[i]  = pos_polar[i];
+      c.load_polar[i] = load_polar[i];
+    }
+    for (i=1; i<=N_MISC_SENSORS; ++i) {
+      c.misc_trans[i][0] = misc_trans_sensors[i].slope;
+      c.misc_trans[i][1] = misc_trans_sensors[i].offset;
+    }
+    for (i=0; i<=N_DOFS; ++i)
+      c.links[i] = links[i];
+    for (i=1; i<=N_DOFS; ++i) {
+      for (j=MIN_THETA; j<=THETA_OFFSET; ++j)
+	c.joint_range[i][j] = joint_range[i][j];
+      c.joint_default_state[i] = joint_default_state[i];
+      c.joint_opt_state[i]     = joint_opt_state[i];
+    }
+  }
+
+  panda4_unlockConfigCache(ok,&c);
+
+  return ok;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  update_calibration
+\date  Oct. 2026
+   
+\remarks 
+
+          folds the translations, the polarities and the position offsets
+          into the gains and biases of the servo loop. Needs to be called
+          whenever one of them changes, with the arms locked if the servo
+          runs. A zero slope of the desired torques cannot be inverted: the
+          command gain of such a joint keeps its previous value, which is
+          zero before the first successful calibration. The new calibration
+          is computed aside and published with one copy under calib_seq,
+          such that readCalibration() is rarely sent into a retry.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+     returns FALSE if a slope of the desired torques is zero
+
+ ******************************************************************************/
+static int
+update_calibration(void)
+{
+  int                i;
+  int                ok = TRUE;
+  static Calibration next;
+
+  next = calib;
+
+  for (i=1; i<=N_DOFS; ++i) {
+
+    // th = (offset + raw) * slope * polar - theta_offset
+    next.pos_gain[i]  = joint_trans_positions[i].slope * pos_polar[i];
+    next.pos_bias[i]  = joint_trans_positions[i].offset * next.pos_gain[i] -
+      joint_range[i][THETA_OFFSET];
+
+    next.vel_gain[i]  = joint_trans_velocities[i].slope * pos_polar[i];
+    next.vel_bias[i]  = joint_trans_velocities[i].offset * next.vel_gain[i];
+
+    next.load_gain[i] = joint_trans_torques[i].slope * load_polar[i];
+    next.load_bias[i] = joint_trans_torques[i].offset * next.load_gain[i];
+
+    // raw = u * polar / slope - offset
+    if (joint_trans_desired_torques[i].slope != 0.0) {
+      next.cmd_gain[i] = load_polar[i] / joint_trans_desired_torques[i].slope;
+    } else {
+      printf("ERROR: Zero desired torque slope for >%s< -- keeping previous command gain %f\n",
+	     joint_names[i],next.cmd_gain[i]);
+      ok = FALSE;
+    }
+    next.cmd_bias[i]  = -joint_trans_desired_torques[i].offset;
+
+  }
+
+  for (i=1; i<=N_MISC_SENSORS; ++i) {
+    next.misc_gain[i] = misc_trans_sensors[i].slope;
+    next.misc_bias[i] = misc_trans_sensors[i].offset * misc_trans_sensors[i].slope;
+  }
+
+  panda4_seqlockBeginWrite(&calib_seq);
+  calib = next;
+  panda4_seqlockEndWrite(&calib_seq);
+
+  return ok;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  translate_sensor_readings
+\date  Dec 1997
+   
+\remarks 
+
+          translate the joint and miscellaneous sensors of a range of arms
+          to unit values in one pass, and add the gravity torques of the
+          Franka model to uff
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     from_arm : the first arm to translate
+ \param[in]     to_arm   : the last arm to translate
+ \param[out]    raw      : the joint state
+ \param[out]    misc_raw : the misc sensors
+
+ ******************************************************************************/
+static void
+translate_sensor_readings(int from_arm, int to_arm, SL_Jstate *joint_raw_state,
+			  double *misc_raw_sensor)
+
+{
+  int i;
+  int i0 = (from_arm-1)*N_DOFS_PER_ROBOT+1;
+  int i1 = to_arm*N_DOFS_PER_ROBOT;
+  int m0 = c_f_indices[from_arm];
+  int m1 = c_f_indices[to_arm]+N_MISC_PER_ROBOT-1;
+
+  // the joints: u_grav was computed from the Franka model as gravity
+  // component, and it needs to be added to uff that was provided by the
+  // motor servo, which intentionally excludes gravity in uff. This uff part
+  // of joint_sim_state is communicated back to the motor servo.
+  for (i=i0; i<=i1; ++i) {
+    joint_raw_state[i].th    = raw_positions[i]  * calib.pos_gain[i]  + calib.pos_bias[i];
+    joint_raw_state[i].thd   = raw_velocities[i] * calib.vel_gain[i]  + calib.vel_bias[i];
+    joint_raw_state[i].load  = raw_torques[i]    * calib.load_gain[i] + calib.load_bias[i];
+    joint_raw_state[i].uff  += u_grav[i];
+  }
+
+  // the misc sensors
+#pragma GCC ivdep
+  for (i=m0; i<=m1; ++i)
+    misc_raw_sensor[i] = raw_misc_sensors[i] * calib.misc_gain[i] + calib.misc_bias[i];
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  translate_commands
+\date  Dec 1997
+   
+\remarks 
+
+          translate unit commands of a range of arms into raw values
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     from_arm : the first arm to translate
+ \param[in]     to_arm   : the last arm to translate
+ \param[in]     commands : the structure containing the commands
+
+ ******************************************************************************/
+static void
+translate_commands(int from_arm, int to_arm, SL_Jstate *command)
+{
+  int i;
+  int i0 = (from_arm-1)*N_DOFS_PER_ROBOT+1;
+  int i1 = to_arm*N_DOFS_PER_ROBOT;
+
+  for (i=i0; i<=i1; ++i)
+    raw_desired_torques[i] = command[i].u * calib.cmd_gain[i] + calib.cmd_bias[i];
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  sl_arm_gravity
+\date  Oct. 2026
+   
+\remarks 
+
+          the gravity torques of one arm from the identified link parameters
+          of the SL model, in the raw units of the Franka model. The joint
+          angles and torques are mapped with the calibration, such that the
+          result can take the place of model->gravity(). The calibration
+          must not change during the call, i.e., it is a copy from
+          readCalibration().
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm       : which arm
+ \param[in]     c         : the calibration
+ \param[in]     q_raw     : the raw joint angles of this arm (0-based)
+ \param[out]    u_gravity : the gravity torques (0-based)
+
+ ******************************************************************************/
+static void
+sl_arm_gravity(int arm, const Calibration *c, const double *q_raw, double *u_gravity)
+{
+  int    i;
+  int    off = (arm-1)*N_DOFS_PER_ROBOT;
+  double q[N_DOFS_PER_ROBOT+1];
+  double tau[N_DOFS_PER_ROBOT+1];
+  SL_endeff eff[N_ENDEFFS+1];
+
+  for (i=1; i<=N_DOFS_PER_ROBOT; ++i)
+    q[i] = q_raw[i-1] * c->pos_gain[off+i] + c->pos_bias[off+i];
+
+  // the diagnostics thread must not see a partial endeffector change
+  getEndeffectorSnapshot(eff);
+  panda4_armGravity(arm,q,eff,gravity,tau);
+
+  for (i=1; i<=N_DOFS_PER_ROBOT; ++i)
+    u_gravity[i-1] = tau[i] * c->cmd_gain[off+i];
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  readCalibration
+\date  Oct. 2026
+   
+\remarks 
+
+          copies the calibration without the calibration lock, for the
+          threads that must not wait for the command line
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[out]    c   : the calibration
+ \param[out]    seq : the sequence number of the copy, or NULL
+
+ returns TRUE if a complete copy was read, FALSE if all attempts were torn,
+ in which case c is unchanged
+
+ ******************************************************************************/
+static int
+readCalibration(Calibration *c, unsigned int *seq)
+{
+  int          n;
+  unsigned int s1,s2;
+  Calibration  tmp;
+
+  for (n=1; n<=N_SEQLOCK_RETRIES; ++n) {
+
+    s1 = __atomic_load_n(&calib_seq,__ATOMIC_ACQUIRE);
+    if (s1 & 1)
+      continue;
+
+    memcpy(&tmp,&calib,sizeof(tmp));
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    s2 = __atomic_load_n(&calib_seq,__ATOMIC_RELAXED);
+    if (s1 != s2)
+      continue;
+
+    *c = tmp;
+    if (seq != NULL)
+      *seq = s1;
+
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  addVarsToDataCollection
+\date  Nov 2007
+   
+\remarks 
+
+        adds important variables to data collection
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+ ******************************************************************************/
+static void
+addVarsToDataCollection(void)
+
+{
+  int i;
+  
+  addVarToCollect((char *)&(collect_sample.real_time_dt),"real_time_dt","s", DOUBLE,FALSE);
+  addVarToCollect((char *)&(collect_sample.late_cmds),"late_cmds","-", DOUBLE,FALSE);
+
+  for (i=1; i<=N_DOFS; ++i) {
+    char string[100];
+
+    sprintf(string,"%s_th",joint_names[i]);
+    addVarToCollect((char *)&(collect_sample.joint[i].th),string,"rad", DOUBLE,FALSE);
+    sprintf(string,"%s_thd",joint_names[i]);
+    addVarToCollect((char *)&(collect_sample.joint[i].thd),string,"rad/s", DOUBLE,FALSE);
+    sprintf(string,"%s_thdd",joint_names[i]);
+    addVarToCollect((char *)&(collect_sample.joint[i].thdd),string,"rad/s^2", DOUBLE,FALSE);
+    sprintf(string,"%s_u",joint_names[i]);
+    addVarToCollect((char *)&(collect_sample.joint[i].u),string,"Nm", DOUBLE,FALSE);
+    sprintf(string,"%s_load",joint_names[i]);
+    addVarToCollect((char *)&(collect_sample.joint[i].load),string,"Nm", DOUBLE,FALSE);
+    sprintf(string,"%s_ucor",joint_names[i]);
+    addVarToCollect((char *)&(collect_sample.ucor[i]),string,"Nm", DOUBLE,FALSE);
+    sprintf(string,"%s_ugerr",joint_names[i]);
+    addVarToCollect((char *)&(collect_sample.ugerr[i]),string,"Nm", DOUBLE,FALSE);
+  }
+
+
+  for (i=1; i<=N_MISC_SENSORS; ++i) {
+    char string[100];
+
+    sprintf(string,"%s",misc_sensor_names[i]);
+    addVarToCollect((char *)&(collect_sample.misc[i]),string,"-",DOUBLE,FALSE);
+  }
+
+  updateDataCollectScript();
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  packCollectSample
+\date  Oct. 2026
+
+\remarks
+
+        copies all collected variables into a packed sample
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[out]    sample : the packed sample
+
+ ******************************************************************************/
+static void
+packCollectSample(CollectSample *sample)
+{
+  int               arm;
+  static DiagResult d[N_ARMS+1];   // the last complete results
+
+  sample->real_time_dt = real_time_dt;
+  sample->late_cmds    = late_cmds_in_row;
+  memcpy(sample->joint,joint_sim_state,sizeof(sample->joint));
+  for (arm=1; arm<=N_ARMS; ++arm) {
+    readDiagResult(arm,&d[arm]);
+    memcpy(&(sample->ucor[(arm-1)*N_DOFS_PER_ROBOT+1]),d[arm].coriolis.data(),
+	   sizeof(double)*N_DOFS_PER_ROBOT);
+    memcpy(&(sample->ugerr[(arm-1)*N_DOFS_PER_ROBOT+1]),d[arm].gravity_err.data(),
+	   sizeof(double)*N_DOFS_PER_ROBOT);
+  }
+  memcpy(sample->misc,misc_sim_sensor,sizeof(sample->misc));
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  collectSample
+\date  Oct. 2026
+
+\remarks
+
+        hands the variables of this tick to the data collection. With
+        async_collect, the sample is only copied into the ring and the
+        collect thread writes it to the buffer of the data collection. If
+        the ring is full, the sample is dropped and counted as overflow.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+ ******************************************************************************/
+static void
+collectSample(void)
+{
+  unsigned long tail,fill;
+
+  if (!async_collect) {
+    packCollectSample(&collect_sample);
+    writeToBuffer();
+    return;
+  }
+
+  tail = collect_tail.load(std::memory_order_relaxed);
+  fill = tail - collect_head.load(std::memory_order_acquire);
+  if (fill >= N_COLLECT_RING) {
+    ++collect_overflows;
+    return;
+  }
+  if (fill+1 > collect_max_fill)
+    collect_max_fill = fill+1;
+
+  packCollectSample(&collect_ring[tail%N_COLLECT_RING]);
+  collect_tail.store(tail+1,std::memory_order_release);
+}
+
+/*!*****************************************************************************
+*******************************************************************************
+\note  spawnCollectThread
+\date  Oct. 2026
+
+\remarks
+
+spawns off the non-real-time thread that writes the collected samples
+
+*******************************************************************************
+Function Parameters: [in]=input,[out]=output
+
+none
+
+******************************************************************************/
+static void
+spawnCollectThread(void)
+{
+  int rc;
+
+  // the thread demotes itself to the background role of panda4_rt
+  if ((rc=pthread_create( &wthread, NULL, collectThread, NULL)))
+      printf("pthread_create returned with %d\n",rc);
+
+}
+
+/*!*****************************************************************************
+*******************************************************************************
+\note  collectThread
+\date  Oct. 2026
+
+\remarks
+
+non-realtime thread that drains the collect ring every millisecond into
+the data collection of SL, which does the variable lookup, the buffering
+and the file writing
+
+*******************************************************************************
+Function Parameters: [in]=input,[out]=output
+
+none
+
+******************************************************************************/
+static void *
+collectThread(void *)
+{
+  unsigned long head;
+
+  panda4_rtThread(RT_ROLE_BACKGROUND,-1);
+
+  while (run_arms_flag) {
+
+    taskDelay(ns2ticks(1000000));
+
+    head = collect_head.load(std::memory_order_relaxed);
+    while (head != collect_tail.load(std::memory_order_acquire)) {
+      memcpy(&collect_sample,&collect_ring[head%N_COLLECT_RING],sizeof(CollectSample));
+      collect_head.store(++head,std::memory_order_release);
+      writeToBuffer();
+    }
+
+  }
+
+  return NULL;
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  receive_des_commands
+\date  Nov. 2007
+   
+\remarks 
+
+        reads the latest complete commands of the motor servo from the
+        seqlock-protected shared memory. The motor servo answers the
+        state of the previous tick, and a command that lags more than
+        late_cmd_max_age motor servo ticks behind, or that cannot be read,
+        is late: it is replaced according to late_cmd_policy, and logged.
+        Too many late commands in a row trip a safe stop. If the motor
+        servo runs slower than the robot, a command in time is
+        interpolated along its command trajectory.
+	
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+     returns FALSE for a safe stop
+
+ ******************************************************************************/
+static int 
+receive_des_commands(void)
+{
+  
+  int          i,rc;
+  int          i0 = (first_arm-1)*N_DOFS_PER_ROBOT+1;
+  int          i1 = last_arm*N_DOFS_PER_ROBOT;
+  double       ts = -1;
+  double       dt = 1./(double)panda_servo_rate;
+  double       age,s;
+  LateCommand *l;
+
+  if (replaying)
+    rc = replayCommands(&ts);
+  else
+    rc = panda4_readCommands(first_arm,last_arm,&ts,joint_sim_state,
+			     cmd_ratio > 1 ? cmd_traj : NULL);
+  if (panda4_isRecording())
+    recordCommands(rc,ts);
+  if (rc) {
+    for (i=i0; i<=i1; ++i)
+      good_uff[i] = joint_sim_state[i].uff;
+  } else {
+    // nothing was read, and uff still includes the gravity of this tick,
+    // which would be added again in the next tick
+    for (i=i0; i<=i1; ++i)
+      joint_sim_state[i].uff = good_uff[i];
+    // before the first command of the motor servo, there is nothing to read
+    if (good_ts[1] >= 0)
+      ++panda_servo_errors;
+  }
+
+  age = servo_time - ts;
+  if (rc && age <= ((double)(cmd_ratio*late_cmd_max_age)+0.5)*dt) {
+    // keep the last two commands for the policy
+    if (ts != good_ts[1]) {
+      good_ts[0] = good_ts[1];
+      good_ts[1] = ts;
+      for (i=i0; i<=i1; ++i) {
+	good_u[0][i] = good_u[1][i];
+	good_u[1][i] = joint_sim_state[i].u;
+      }
+    }
+    // the trajectory runs from the state that the command answers
+    if (cmd_ratio > 1)
+      interpolate_commands(age);
+    late_cmds_in_row = 0;
+    return TRUE;
+  }
+
+  // the motor servo has not started yet
+  if (good_ts[1] < 0)
+    return TRUE;
+
+  ++late_cmds;
+  if (++late_cmds_in_row > late_cmds_max_in_row)
+    late_cmds_max_in_row = late_cmds_in_row;
+
+  l = &late_cmd_log[(late_cmds-1)%N_LATE_CMD_LOG];
+  l->servo_time = servo_time;
+  l->t_mono     = panda4_timeNs();
+  l->age        = rc ? age : -1;
+  l->n_in_row   = late_cmds_in_row;
+
+  // extrapolate to the command that would have arrived in this tick, but
+  // only for a few command periods, after which the extrapolation would
+  // run away and the last command is held instead
+  s = 0;
+  if (good_ts[1] > good_ts[0] && good_ts[0] >= 0)
+    s = (servo_time - dt - good_ts[1])/(good_ts[1] - good_ts[0]);
+
+  if (late_cmd_policy == LATE_CMD_EXTRAPOLATE && s > 0 && s <= LATE_CMD_MAX_EXTRAPOLATION) {
+    for (i=i0; i<=i1; ++i)
+      joint_sim_state[i].u = good_u[1][i] + s*(good_u[1][i] - good_u[0][i]);
+  } else if (late_cmd_policy == LATE_CMD_GRAVITY) {
+    for (i=i0; i<=i1; ++i)
+      joint_sim_state[i].u = 0.0;
+  } else {
+    for (i=i0; i<=i1; ++i)
+      joint_sim_state[i].u = good_u[1][i];
+  }
+
+  if (late_cmd_stop > 0 && late_cmds_in_row >= late_cmd_stop) {
+    late_cmd_tripped = TRUE;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  interpolate_commands
+\date  Oct. 2026
+   
+\remarks 
+
+        evaluates the command trajectories of the motor servo at time t
+        after the state that they answer: the torque follows its slope,
+        and the local PD corrects the motion of the latest joint state of
+        this tick since the answered state, relative to the desired
+        velocity. At the answered state, this is the command of the motor
+        servo.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     t : time since the state that the commands answer in s
+
+ ******************************************************************************/
+static void
+interpolate_commands(double t)
+{
+  int            i;
+  int            i0 = (first_arm-1)*N_DOFS_PER_ROBOT+1;
+  int            i1 = last_arm*N_DOFS_PER_ROBOT;
+  Panda4CmdTraj *c;
+
+  for (i=i0; i<=i1; ++i) {
+    c = &cmd_traj[i];
+    joint_sim_state[i].u = c->u0 + c->du*t
+      + c->gain_th*(c->th + c->thd_des*t - joint_sim_state[i].th)
+      + c->gain_thd*(c->thd - joint_sim_state[i].thd);
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  send_sim_state
+\date  Nov. 2007
+   
+\remarks 
+
+        sends the joint states of the arms of this servo to shared memory
+	
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     state : joint states of the entire robot (1 to N_DOFS)
+ \param[in]     ts    : the servo time of the states
+
+ ******************************************************************************/
+static int 
+send_sim_state(SL_Jstate *state, double ts)
+{
+  
+  int i;
+
+  // joint state
+  if (semTake(sm_joint_sim_state_sem,ns2ticks(TIME_OUT_NS)) == ERROR) {
+    
+    ++publish_errors;
+    return FALSE;
+
+  } 
+
+  cSL_Jstate(state,sm_joint_sim_state_data,n_dofs,DOUBLE2FLOAT);
+    
+  for (i=(first_arm-1)*N_DOFS_PER_ROBOT+1; i<=last_arm*N_DOFS_PER_ROBOT; ++i)
+      sm_joint_sim_state->joint_sim_state[i] = sm_joint_sim_state_data[i];
+
+  if (first_arm == ROBOT_MASTER_CLOCK)
+    sm_joint_sim_state->ts = ts;
+  
+  semGive(sm_joint_sim_state_sem);
+
+
+  // base state
+  if (semTake(sm_base_state_sem,ns2ticks(TIME_OUT_NS)) == ERROR) {
+    
+    ++publish_errors;
+    return FALSE;
+
+  } 
+
+  cSL_Cstate(&base_state-1, sm_base_state_data, 1, DOUBLE2FLOAT);
+
+  sm_base_state->state[1] = sm_base_state_data[1];
+
+  if (first_arm == ROBOT_MASTER_CLOCK)
+    sm_base_state->ts = ts;
+  
+  semGive(sm_base_state_sem);
+
+
+  // base orient
+  if (semTake(sm_base_orient_sem,ns2ticks(TIME_OUT_NS)) == ERROR) {
+    
+    ++publish_errors;
+    return FALSE;
+
+  } 
+
+  cSL_quat(&base_orient-1, sm_base_orient_data, 1, DOUBLE2FLOAT);
+
+  sm_base_orient->orient[1] = sm_base_orient_data[1];
+
+  if (first_arm == ROBOT_MASTER_CLOCK)
+    sm_base_orient->ts = ts;
+  
+  semGive(sm_base_orient_sem);
+
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  send_misc_sensors
+\date  Nov. 2007
+   
+\remarks 
+
+        sends the misc sensors of the arms of this servo to shared memory
+	
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     misc : misc sensors of the entire robot (1 to N_MISC_SENSORS)
+ \param[in]     ts   : the servo time of the sensors
+
+ ******************************************************************************/
+static int 
+send_misc_sensors(double *misc, double ts)
+{
+  
+  int i;
+
+  if (n_misc_sensors <= 0)
+    return TRUE;
+
+  if (semTake(sm_misc_sim_sensor_sem,ns2ticks(TIME_OUT_NS)) == ERROR) {
+    
+    ++publish_errors;
+    return FALSE;
+
+  } 
+
+  for (i=c_f_indices[first_arm]; i<=c_f_indices[last_arm]+N_MISC_PER_ROBOT-1; ++i)
+      sm_misc_sim_sensor->value[i] = misc[i];
+
+  if (first_arm == ROBOT_MASTER_CLOCK)
+    sm_misc_sim_sensor->ts = ts;
+  
+  semGive(sm_misc_sim_sensor_sem);
+
+  return TRUE;
+}
+
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  status
+\date  Nov 2007
+   
+\remarks 
+
+        prints out all important variables
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+ ******************************************************************************/
+void
+status(void)
+{
+
+  printf("\n");
+  printf("            Time                   = %f\n",panda_servo_time);
+  printf("            Servo Calls            = %ld\n",panda_servo_calls);
+  printf("            Servo Rate             = %d\n",panda_servo_rate);
+  if (cmd_ratio > 1)
+    printf("            Motor Servo Rate       = %d (commands interpolated over %d ticks)\n",
+	   servo_base_rate,cmd_ratio);
+  printf("            Servo Errors           = %d (%6.2f%%)\n",panda_servo_errors,
+	 (double)panda_servo_errors/(double)panda_servo_calls*100);
+  if (first_arm != last_arm) {
+    int arm;
+    for (arm=first_arm; arm<=last_arm; ++arm)
+      printf("            Panda %d CPU            = %d (%ld stale commands)\n",
+	     arm,arm_cpu[arm],stale_servo_cmds[arm]);
+  }
+  printf("            Diagnostics Rate       = %.1f Hz (%ld updates)\n",diag_rate,diag_updates);
+  printf("            Gravity Model          = %s\n",sl_gravity ? "SL" : "Franka");
+  printf("            Late Commands          = %ld (max. %d in a row, policy %s)\n",
+	 late_cmds,late_cmds_max_in_row,late_cmd_policy_names[late_cmd_policy]);
+  printf("            SL Publish Time-Outs   = %ld\n",publish_errors);
+  if (async_collect)
+    printf("            Collect Ring           = %ld overflows, max. fill %ld of %d\n",
+	   collect_overflows,collect_max_fill,N_COLLECT_RING);
+  if (use_loadcell) {
+    printf("            Load Cell Stale Ticks  = %ld\n",loadcell_stale);
+    panda4_printLoadCellStats();
+  }
+#ifdef PANDA4_RTCHECK
+  printf("            RT Violations          = %ld\n",panda4_rtCheckViolations());
+  panda4_rtCheckSites();
+#endif
+  printf("\n            Latencies [us]:\n");
+  panda4_printTiming();
+  if (use_gripper) {
+    int arm;
+    for (arm=first_arm; arm<=last_arm; ++arm)
+      printf("            Panda %d Gripper Drops  = %ld\n",arm,gripper_drops[arm].load());
+  }
+  {
+    int arm;
+    for (arm=first_arm; arm<=last_arm; ++arm)
+      printf("            Panda %d F/T Bias       = %ld samples (%.2f s)%s\n",arm,
+	     ft_bias_samples[arm],ft_bias_samples[arm]/(double)panda_servo_rate,
+	     ft_contact[arm] ? ", contact" : "");
+  }
+  if (diag_updates > 0) {
+    int        arm,i;
+    DiagResult d;
+    for (arm=first_arm; arm<=last_arm; ++arm) {
+      if (!readDiagResult(arm,&d))
+	continue;
+      printf("            Panda %d Coriolis       =",arm);
+      for (i=0; i<N_DOFS_PER_ROBOT; ++i)
+	printf(" % 7.3f",d.coriolis[i]);
+      printf("\n            Panda %d Mass Diagonal  =",arm);
+      for (i=0; i<N_DOFS_PER_ROBOT; ++i)
+	printf(" % 7.3f",d.mass[i*N_DOFS_PER_ROBOT+i]);
+      printf("\n            Panda %d Gravity SL-Fr. =",arm);
+      for (i=0; i<N_DOFS_PER_ROBOT; ++i)
+	printf(" % 7.3f",d.gravity_err[i]);
+      printf(" (max. %.3f since last status)\n",d.gravity_err_max);
+      gravity_err_reset[arm] = TRUE;
+    }
+  }
+  printf("\n");
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  read_sensor_offs
+\date  Oct 2011
+   
+\remarks 
+
+interface to read sensor offsets configuration file
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+static void
+read_sensor_offs(void)
+{
+  // the file is parsed outside of the lock, as the servo only uses calib
+  read_sensor_offsets(config_files[SENSOROFFSETS]);
+  lockCalibration();
+  update_calibration();
+  unlockCalibration();
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  dump_timing
+\date  Oct. 2026
+   
+\remarks 
+
+writes the latency histograms to <servo_name>_timing.txt
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+static void
+dump_timing(void)
+{
+  char fname[100];
+
+  sprintf(fname,"%s_timing.txt",servo_name);
+  if (panda4_dumpTiming(fname))
+    printf("Latency histograms written to %s\n",fname);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  reset_timing
+\date  Oct. 2026
+   
+\remarks 
+
+clears the latency histograms
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+static void
+reset_timing(void)
+{
+  panda4_initTiming();
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  start_recording
+\date  Oct. 2026
+
+\remarks
+
+ asks for a file name and starts recording the robot state stream
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+ ******************************************************************************/
+static void
+start_recording(void)
+{
+  char fname[100];
+
+  if (strlen(record_file) == 0)
+    sprintf(record_file,"%s_record.bin",servo_name);
+
+  if (!get_string((char *)"Recording file",record_file,fname))
+    return;
+  strcpy(record_file,fname);
+
+  panda4_startRecording(record_file,first_arm,last_arm,panda_servo_rate);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  stop_recording
+\date  Oct. 2026
+
+\remarks
+
+ stops recording the robot state stream
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+ ******************************************************************************/
+static void
+stop_recording(void)
+{
+  panda4_stopRecording();
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  loopback_wrench
+\date  Oct. 2026
+
+\remarks
+
+ asks for the wrench that the load cell loopback reports, in the sensor
+ frame of the Axia80
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+ ******************************************************************************/
+static void
+loopback_wrench(void)
+{
+  int           i;
+  char          string[100];
+  const char   *names[] = {"Fx","Fy","Fz","Mx","My","Mz"};
+  static double ft[2*N_CART];
+
+  for (i=0; i<2*N_CART; ++i) {
+    sprintf(string,"Loopback %s",names[i]);
+    if (!get_double(string,ft[i],&ft[i]))
+      return;
+  }
+
+  panda4_setLoopbackWrench(ft);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  print_late_commands
+\date  Oct. 2026
+
+\remarks
+
+ prints the last N_LATE_CMD_LOG late commands of the motor servo
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+ ******************************************************************************/
+static void
+print_late_commands(void)
+{
+  long         i,n;
+  LateCommand *l;
+
+  printf("%ld late commands, max. %d in a row, policy %s, safe stop after %d in a row\n",
+	 late_cmds,late_cmds_max_in_row,late_cmd_policy_names[late_cmd_policy],late_cmd_stop);
+
+  n = late_cmds < N_LATE_CMD_LOG ? late_cmds : N_LATE_CMD_LOG;
+  for (i=late_cmds-n; i<late_cmds; ++i) {
+    l = &late_cmd_log[i%N_LATE_CMD_LOG];
+    if (l->age < 0)
+      printf("  t=%10.3f s  mono=%14.6f s  unreadable      #%d in a row\n",
+	     l->servo_time,l->t_mono*1.e-9,l->n_in_row);
+    else
+      printf("  t=%10.3f s  mono=%14.6f s  age=%7.2f ms  #%d in a row\n",
+	     l->servo_time,l->t_mono*1.e-9,l->age*1.e3,l->n_in_row);
+  }
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  recordTick
+\date  Oct. 2026
+
+\remarks
+
+ packs the robot state and the torque command of one tick of an arm into
+ a record and hands it to the recording ring
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm       : the arm ID (1 to N_ARMS)
+ \param[in]     t_mono    : CLOCK_MONOTONIC stamp of this tick in ns
+ \param[in]     state     : the robot state of this tick
+ \param[in]     period    : time since the last tick
+ \param[in]     u_gravity : the gravity torques of the Franka model
+ \param[in]     ft        : the sensed F/T values
+ \param[in]     tau_d     : the torque command of this tick
+
+ ******************************************************************************/
+static void
+recordTick(int arm, unsigned long t_mono,
+	   const franka::RobotState &state, franka::Duration period,
+	   const std::array<double, N_DOFS_PER_ROBOT> &u_gravity,
+	   const double *ft, const std::array<double, N_DOFS_PER_ROBOT> &tau_d)
+{
+  Panda4Record r;
+
+  bzero((void *)&r,sizeof(r));
+  r.type       = PANDA4_RECORD_STATE;
+  r.arm        = arm;
+  r.t_mono     = t_mono;
+  r.robot_mode = (int) state.robot_mode;
+  r.time       = state.time.toSec();
+  r.period     = period.toSec();
+  std::copy(state.q.begin(),state.q.end(),r.q);
+  std::copy(state.dq.begin(),state.dq.end(),r.dq);
+  std::copy(state.tau_J.begin(),state.tau_J.end(),r.tau_J);
+  std::copy(state.dtau_J.begin(),state.dtau_J.end(),r.dtau_J);
+  std::copy(state.q_d.begin(),state.q_d.end(),r.q_d);
+  std::copy(state.dq_d.begin(),state.dq_d.end(),r.dq_d);
+  std::copy(state.tau_ext_hat_filtered.begin(),state.tau_ext_hat_filtered.end(),
+	    r.tau_ext_hat_filtered);
+  std::copy(state.K_F_ext_hat_K.begin(),state.K_F_ext_hat_K.end(),r.K_F_ext_hat_K);
+  std::copy(state.O_T_EE.begin(),state.O_T_EE.end(),r.O_T_EE);
+  r.control_command_success_rate = state.control_command_success_rate;
+  std::copy(u_gravity.begin(),u_gravity.end(),r.gravity);
+  memcpy(r.ft,ft,sizeof(r.ft));
+  std::copy(tau_d.begin(),tau_d.end(),r.tau_d);
+  r.motion_finished = !run_arms_flag;
+
+  panda4_record(&r);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  recordCommands
+\date  Oct. 2026
+
+\remarks
+
+ records the commands that the servo read from the motor servo in this
+ tick, one record per arm. The records are stamped with the latest sample
+ of the tick, such that they precede the tick of the arm that triggered
+ the servo in the recording.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     ok : complete commands could be read
+ \param[in]     ts : the servo time of the commands
+
+ ******************************************************************************/
+static void
+recordCommands(int ok, double ts)
+{
+  int           i,j,arm;
+  unsigned long t_mono = 0;
+  Panda4Record  r;
+
+  for (arm=first_arm; arm<=last_arm; ++arm)
+    if (arm_stamp[arm].t_mono > t_mono)
+      t_mono = arm_stamp[arm].t_mono;
+
+  for (arm=first_arm; arm<=last_arm; ++arm) {
+    bzero((void *)&r,sizeof(r));
+    r.type    = PANDA4_RECORD_COMMAND;
+    r.arm     = arm;
+    r.t_mono  = t_mono;
+    r.cmd_ok  = ok;
+    r.cmd_age = ok ? servo_time - ts : 0.0;
+    for (j=0; j<N_DOFS_PER_ROBOT; ++j) {
+      i = (arm-1)*N_DOFS_PER_ROBOT+j+1;
+      r.u[j]    = joint_sim_state[i].u;
+      r.uff[j]  = joint_sim_state[i].uff;
+      r.traj[j] = cmd_traj[i];
+    }
+    panda4_record(&r);
+  }
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  replayCommands
+\date  Oct. 2026
+
+\remarks
+
+ the replacement of panda4_readCommands in a replay: hands out the
+ recorded commands of all arms of this tick, which replayServo read from
+ the recording before the tick that triggered the servo. The recorded
+ commands are used once; without them, nothing is read, as if the motor
+ servo had not answered.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[out]    ts : the servo time of the commands
+
+ returns TRUE if complete commands were recorded
+
+ ******************************************************************************/
+static int
+replayCommands(double *ts)
+{
+  int           i,j,arm,ok = TRUE;
+  Panda4Record *r;
+
+  for (arm=first_arm; arm<=last_arm; ++arm) {
+    if (!replay_cmd_fresh[arm]) {
+      ++replay_cmd_misses;
+      return FALSE;
+    }
+  }
+
+  for (arm=first_arm; arm<=last_arm; ++arm) {
+    r = &replay_cmd[arm];
+    replay_cmd_fresh[arm] = FALSE;
+    if (!r->cmd_ok) {
+      ok = FALSE;
+      continue;
+    }
+    *ts = servo_time - r->cmd_age;
+    for (j=0; j<N_DOFS_PER_ROBOT; ++j) {
+      i = (arm-1)*N_DOFS_PER_ROBOT+j+1;
+      joint_sim_state[i].u   = r->u[j];
+      joint_sim_state[i].uff = r->uff[j];
+      cmd_traj[i]            = r->traj[j];
+    }
+  }
+
+  return ok;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  replayServo
+\date  Oct. 2026
+
+\remarks
+
+ runs the servo from a recording instead of the robots: every state
+ record is turned back into a robot state and fed through panda_callback,
+ with the recorded model gravity and F/T values in place of the Franka
+ model and the load cell. The recorded commands of the motor servo take
+ the place of the motor servo, which is not triggered, such that the
+ replay is deterministic. The replay runs at the recorded pace, or as
+ fast as possible with -fast, and reports the throughput and the largest
+ difference between the replayed and the recorded torque commands.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     fname : the recording
+
+ returns TRUE on success
+
+ ******************************************************************************/
+static int
+replayServo(char *fname)
+{
+  int                 i;
+  long                n = 0;
+  double              t_first = -1, t_last = 0;
+  double              max_dev = 0, wall;
+  unsigned long       t_start,t_due,t_now;
+  Panda4RecordHeader  h;
+  Panda4Record        r;
+  franka::RobotState  state;
+
+  if (!panda4_openReplay(fname,&h))
+    return FALSE;
+
+  if (h.first_arm != first_arm || h.last_arm != last_arm) {
+    printf("Recording >%s< is of arms %d to %d, but this servo runs arms %d to %d\n",
+	   fname,h.first_arm,h.last_arm,first_arm,last_arm);
+    panda4_closeReplay();
+    return FALSE;
+  }
+
+  // there is no Franka model library without the robots
+  diag_rate = 0;
+  replaying = TRUE;
+
+  if (!init_panda_servo())
+    return FALSE;
+
+  printf("\nPanda replay of >%s< initialized\n",fname);
+
+  // signal that this process is initialized
+  semGive(sm_init_process_ready_sem);
+
+  servo_enabled = TRUE;
+  scd();
+
+  t_start = panda4_timeNs();
+
+  while (run_arms_flag && panda4_readRecord(&r)) {
+
+    if (r.arm < first_arm || r.arm > last_arm)
+      continue;
+
+    // the commands of the next servo tick
+    if (r.type == PANDA4_RECORD_COMMAND) {
+      replay_cmd[r.arm] = r;
+      replay_cmd_fresh[r.arm] = TRUE;
+      continue;
+    }
+
+    if (t_first < 0)
+      t_first = r.time;
+    t_last = r.time;
+
+    // the recorded pace
+    if (!replay_fast) {
+      t_due = t_start + (unsigned long)((r.time - t_first)*1.e9);
+      t_now = panda4_timeNs();
+      if (t_due > t_now)
+	std::this_thread::sleep_for(std::chrono::nanoseconds(t_due-t_now));
+    }
+
+    state.robot_mode = static_cast<franka::RobotMode>(r.robot_mode);
+    state.time       = franka::Duration((uint64_t) llround(r.time*1000.));
+    std::copy(r.q,r.q+N_DOFS_PER_ROBOT,state.q.begin());
+    std::copy(r.dq,r.dq+N_DOFS_PER_ROBOT,state.dq.begin());
+    std::copy(r.tau_J,r.tau_J+N_DOFS_PER_ROBOT,state.tau_J.begin());
+    std::copy(r.dtau_J,r.dtau_J+N_DOFS_PER_ROBOT,state.dtau_J.begin());
+    std::copy(r.q_d,r.q_d+N_DOFS_PER_ROBOT,state.q_d.begin());
+    std::copy(r.dq_d,r.dq_d+N_DOFS_PER_ROBOT,state.dq_d.begin());
+    std::copy(r.tau_ext_hat_filtered,r.tau_ext_hat_filtered+N_DOFS_PER_ROBOT,
+	      state.tau_ext_hat_filtered.begin());
+    std::copy(r.K_F_ext_hat_K,r.K_F_ext_hat_K+2*N_CART,state.K_F_ext_hat_K.begin());
+    std::copy(r.O_T_EE,r.O_T_EE+16,state.O_T_EE.begin());
+    state.control_command_success_rate = r.control_command_success_rate;
+
+    replay_record[r.arm] = &r;
+    franka::Torques tau = panda_callback(r.arm,NULL,state,
+					 franka::Duration((uint64_t) llround(r.period*1000.)));
+    replay_record[r.arm] = NULL;
+
+    for (i=0; i<N_DOFS_PER_ROBOT; ++i)
+      if (fabs(tau.tau_J[i]-r.tau_d[i]) > max_dev)
+	max_dev = fabs(tau.tau_J[i]-r.tau_d[i]);
+    ++n;
+
+  }
+
+  panda4_closeReplay();
+
+  wall = (panda4_timeNs()-t_start)/1.e9;
+  printf("Replayed %ld ticks of %.3f s in %.3f s (%.1f x real time)\n",
+	 n,t_last-t_first,wall,wall > 0 ? (t_last-t_first)/wall : 0.0);
+  printf("Max. difference to the recorded torque commands = %f Nm\n",max_dev);
+  if (replay_cmd_misses > 0)
+    printf("%ld servo ticks had no recorded commands\n",replay_cmd_misses);
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  update_ft_bias
+\date  Oct. 2026
+   
+\remarks 
+
+ updates the bias estimate of the computed and sensed F/T channels of all
+ arms with an exponentially weighted moving average of the raw values. An
+ arm only contributes while all its joints are slower than ft_bias_max_vel,
+ its gripper does not move, and the task does not command contact. The
+ channels of each arm are contiguous, such that the update of an arm is a
+ single loop without branches.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+ ******************************************************************************/
+static void
+update_ft_bias(void)
+{
+  int    i,j,arm,gate;
+  double w;
+
+  for (arm=first_arm; arm<=last_arm; ++arm) {
+
+    gate = !ft_contact[arm] && !raw_misc_sensors[gripper_indices[arm]+1]; //G_MOTION
+    for (j=(arm-1)*N_DOFS_PER_ROBOT+1; j<=arm*N_DOFS_PER_ROBOT; ++j)
+      gate = gate && fabs(joint_sim_state[j].thd) < ft_bias_max_vel;
+
+    if (!gate)
+      continue;
+
+    // the first sample initializes the average
+    if (ft_bias_samples[arm]++ == 0)
+      w = 1.0;
+    else
+      w = 1.0/(ft_bias_tau*(double)panda_servo_rate);
+
+    i = c_f_indices[arm];
+    for (j=0; j<N_FT_CHANNELS; ++j)
+      ft_bias[i+j] += w*(raw_misc_sensors[i+j] - ft_bias[i+j]);
+
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  compute_ft_offsets
+\date  Jan 2019
+   
+\remarks 
+
+ latches the current bias estimate of the F/T channels of Panda into the
+ offsets of these channels
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+     none
+
+ ******************************************************************************/
+static void
+compute_ft_offsets(void)
+{
+  int    j,arm;
+  int    n = N_FT_CHANNELS;
+
+  // zero the axia80, which removes the bias of the sensed channels in the sensor;
+  // the acquisition thread does this at its next reading
+  if (use_loadcell) {
+    panda4_tareLoadCell();
+    n = 2*N_CART;
+  }
+
+  lockCalibration();
+
+  for (arm=first_arm; arm<=last_arm; ++arm) {
+
+    if (ft_bias_samples[arm] == 0) {
+      printf("No F/T bias estimate for Panda %d yet -- robot was never at rest\n",arm);
+      continue;
+    }
+
+    if (ft_bias_samples[arm] < ft_bias_tau*panda_servo_rate)
+      printf("Warning: F/T bias of Panda %d is based on %ld samples only\n",
+	     arm,ft_bias_samples[arm]);
+
+    for (j=0; j<n; ++j)
+      misc_trans_sensors[c_f_indices[arm]+j].offset = -ft_bias[c_f_indices[arm]+j];
+
+  }
+
+  update_calibration();
+
+  unlockCalibration();
+
+}
+
+/*!*****************************************************************************
+*******************************************************************************
+\note  spawnGripperThread
+\date  Feb 2019
+
+\remarks
+
+connects to the gripper of an arm and spawns off two non-real-time threads
+for it: the command thread executes the queued gripper commands, and the
+state thread samples the gripper width at gripper_rate and preempts a
+motion in progress when a new command arrives
+
+*******************************************************************************
+Function Parameters: [in]=input,[out]=output
+
+\param[in]     arm : the arm ID whose gripper is served by these threads
+
+******************************************************************************/
+static void
+spawnGripperThread(int arm)
+{
+  int err = 0;
+  int rc;
+  pthread_attr_t pth_attr;
+  size_t stack_size = 0;
+
+  try {
+#ifdef ROBOTIQ2F
+    char port_name[] = "/dev/ttyUSB1";
+    gripper_ptr[arm] = new Robotiq2fGripperSerial(0.085, 0., 0.15, 220.,port_name);
+    gripper_ptr[arm]->GripperInitialization();
+#else
+    gripper_ptr[arm] = new franka::Gripper(ip_string[arm]);
+#endif
+  } catch (const franka::Exception& ex) {
+    std::cerr << "spawnGripperThread:" << std::endl;
+    std::cerr << ex.what() << std::endl;
+    gripper_ptr[arm] = NULL;
+    return;
+  }
 
-  // base state
-  if (semTake(sm_base_state_sem,ns2ticks(TIME_OUT_NS)) == ERROR) {
-    
-    ++panda_servo_errors;
+  err = pthread_attr_init(&pth_attr);
+  pthread_attr_getstacksize(&pth_attr, &stack_size);
+  double reqd = 1024*1024*8;
+  if (stack_size < reqd)
+    pthread_attr_setstacksize(&pth_attr, reqd);
+
+  // initialize the threads for the gripper commands and the gripper state
+  run_gripper_thread_flag = TRUE;
+  gripper_queue[arm].head = 0;
+  gripper_queue[arm].tail = 0;
+  gripper_busy[arm] = FALSE;
+  gripper_preempted[arm] = FALSE;
+  gripper_drops[arm] = 0;
+  sem_init(&gripper_cmd_sem[arm],0,0);
+  sem_init(&gripper_state_sem[arm],0,0);
+  if ((rc=pthread_create( &gripper_cmd_thread[arm], &pth_attr, gripperThread, (void *)(long)arm)))
+      printf("pthread_create returned with %d\n",rc);
+  if ((rc=pthread_create( &gripper_state_thread[arm], &pth_attr, gripperStateThread,
+			  (void *)(long)arm)))
+      printf("pthread_create returned with %d\n",rc);
+
+}
+
+/*!*****************************************************************************
+*******************************************************************************
+\note  pushGripperCommand
+\date  Oct. 2026
+
+\remarks
+
+queues a gripper command and wakes up the gripper threads. This is called
+from the servo and neither blocks nor allocates: the wakeup is a sem_post
+after the command is published, which a gripper thread cannot miss, as
+the post is counted even if the thread is not waiting yet.
+
+*******************************************************************************
+Function Parameters: [in]=input,[out]=output
+
+\param[in]     arm : the arm ID
+\param[in]     cmd : the gripper command
+
+returns FALSE if the queue is full, in which case the command is dropped
+and counted in gripper_drops
+
+******************************************************************************/
+static int
+pushGripperCommand(int arm, GripperCommand *cmd)
+{
+  GripperQueue  *q = &gripper_queue[arm];
+  unsigned long  tail = q->tail.load(std::memory_order_relaxed);
+
+  if (tail - q->head.load(std::memory_order_acquire) >= N_GRIPPER_QUEUE) {
+    gripper_drops[arm].fetch_add(1,std::memory_order_relaxed);
     return FALSE;
+  }
 
-  } 
+  q->cmd[tail%N_GRIPPER_QUEUE] = *cmd;
+  q->tail.store(tail+1,std::memory_order_release);
+
+  sem_post(&gripper_cmd_sem[arm]);
+  sem_post(&gripper_state_sem[arm]);
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+*******************************************************************************
+\note  popGripperCommand
+\date  Oct. 2026
+
+\remarks
+
+removes all queued gripper commands and returns the most recent one, as a
+new command preempts all earlier ones
+
+*******************************************************************************
+Function Parameters: [in]=input,[out]=output
+
+\param[in]     arm : the arm ID
+\param[out]    cmd : the most recent gripper command
+
+returns FALSE if the queue was empty
+
+******************************************************************************/
+static int
+popGripperCommand(int arm, GripperCommand *cmd)
+{
+  GripperQueue  *q = &gripper_queue[arm];
+  unsigned long  head = q->head.load(std::memory_order_relaxed);
+  unsigned long  tail = q->tail.load(std::memory_order_acquire);
+
+  if (head == tail)
+    return FALSE;
+
+  *cmd = q->cmd[(tail-1)%N_GRIPPER_QUEUE];
+  q->head.store(tail,std::memory_order_release);
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+*******************************************************************************
+\note  addToTimespec
+\date  Oct. 2026
+
+\remarks
+
+adds a duration to an absolute time for the timed waits of the gripper
+threads
+
+*******************************************************************************
+Function Parameters: [in]=input,[out]=output
+
+\param[in,out] t  : the time
+\param[in]     ns : the duration in ns
+
+******************************************************************************/
+static void
+addToTimespec(struct timespec *t, long ns)
+{
+  t->tv_sec  += ns/1000000000L;
+  t->tv_nsec += ns%1000000000L;
+  if (t->tv_nsec >= 1000000000L) {
+    t->tv_nsec -= 1000000000L;
+    ++t->tv_sec;
+  }
+}
+
+/*!*****************************************************************************
+*******************************************************************************
+\note  gripperThread
+\date  Feb 2019
+
+\remarks
+
+non-realtime thread that executes the gripper commands of an arm. It sleeps
+on a semaphore until a command is queued. The wait times out after one
+gripper sampling period such that a shutdown is noticed.
+
+*******************************************************************************
+Function Parameters: [in]=input,[out]=output
+
+\param[in]     arg : the arm ID whose gripper is served by this thread
+
+******************************************************************************/
+static void *
+gripperThread(void *arg)
+{
+  int            arm = (int)(long)arg;
+  PandaGripper  &gripper = *gripper_ptr[arm];
+  GripperCommand cmd;
+  const long     period = (long)(1.e9/gripper_rate);
+  struct timespec deadline;
+
+  panda4_rtThread(RT_ROLE_GRIPPER,-1);
+
+  while (run_gripper_thread_flag) {
+
+    // several commands may have been posted, but only the last one is run
+    clock_gettime(CLOCK_REALTIME,&deadline);
+    addToTimespec(&deadline,period);
+    sem_timedwait(&gripper_cmd_sem[arm],&deadline);
+
+    if (!popGripperCommand(arm,&cmd))
+      continue;
+
+    // a stop has already been sent by the state thread if a motion was preempted
+    gripper_preempted[arm] = FALSE;
+    if (cmd.task == STOP)
+      continue;
+
+    gripper_busy[arm] = TRUE;
+    raw_misc_sensors[gripper_indices[arm]+1] = TRUE; //G_MOTION
+
+    try {
+
+      switch (cmd.task) {
+
+      case MOVE:
+#ifdef ROBOTIQ2F
+	{
+	  std::lock_guard<std::mutex> io(gripper_io_mutex[arm]);
+	  gripper.GripperControlCommandBlocking(cmd.width, cmd.speed, 10, ROBOTIQ_TIMEOUT);
+	}
+#else
+	gripper.move(cmd.width,cmd.speed);
+#endif
+	break;
+
+      case GRASP:
+#ifdef ROBOTIQ2F
+	{
+	  std::lock_guard<std::mutex> io(gripper_io_mutex[arm]);
+	  gripper.GripperControlCommandBlocking(cmd.width, cmd.speed, cmd.force, ROBOTIQ_TIMEOUT);
+	}
+#else
+	gripper.grasp(cmd.width,cmd.speed,cmd.force,cmd.eps_in,cmd.eps_out);
+#endif
+	break;
+
+      }
+
+    } catch (const franka::Exception& ex) {
+
+      // a preempted motion ends with an exception, which is expected
+      if (!gripper_preempted[arm])
+	std::cerr << "gripperThread: " << ex.what() << std::endl;
+
+    }
+
+    gripper_busy[arm] = FALSE;
+    raw_misc_sensors[gripper_indices[arm]+1] = FALSE; //G_MOTION
+
+  }
+
+  return NULL;
+
+}
+
+/*!*****************************************************************************
+*******************************************************************************
+\note  gripperStateThread
+\date  Oct. 2026
+
+\remarks
+
+non-realtime thread that samples the width and motion state of the gripper
+of an arm at gripper_rate, also while a motion is executing. A new command
+that arrives during a motion wakes this thread up, which stops the motion
+such that the command thread can start the new command. The Robotiq
+gripper can neither be read nor stopped during a blocking command on its
+serial line, such that its width is only updated between commands.
+
+*******************************************************************************
+Function Parameters: [in]=input,[out]=output
+
+\param[in]     arg : the arm ID whose gripper is served by this thread
+
+******************************************************************************/
+static void *
+gripperStateThread(void *arg)
+{
+  int            arm = (int)(long)arg;
+  PandaGripper  &gripper = *gripper_ptr[arm];
+  double         gripper_position=0.0,gripper_force=0.0;
+  const long     period = (long)(1.e9/gripper_rate);
+  struct timespec next,now;
+  auto           preempt = [arm]{
+    return gripper_busy[arm] && !gripper_preempted[arm] &&
+      gripper_queue[arm].head.load() != gripper_queue[arm].tail.load();};
+
+  panda4_rtThread(RT_ROLE_GRIPPER,-1);
+
+  clock_gettime(CLOCK_REALTIME,&next);
+
+  while (run_gripper_thread_flag) {
+
+    // sleep until the next sample, unless a new command preempts a motion;
+    // posts that do not preempt anything are consumed here
+    addToTimespec(&next,period);
+    while (run_gripper_thread_flag && !preempt() &&
+	   sem_timedwait(&gripper_state_sem[arm],&next) == 0)
+      ;
+    clock_gettime(CLOCK_REALTIME,&now);
+    if ((now.tv_sec-next.tv_sec)*1000000000L + (now.tv_nsec-next.tv_nsec) > period)
+      next = now;
+
+    try {
+
+      // preempt the current motion in favor of a new command
+      if (preempt()) {
+	gripper_preempted[arm] = TRUE;
+#ifndef ROBOTIQ2F
+	gripper.stop();
+#endif
+      }
+
+#ifdef ROBOTIQ2F
+      std::unique_lock<std::mutex> io(gripper_io_mutex[arm],std::try_to_lock);
+      if (io.owns_lock()) {
+	gripper.GetGripperStatus(&gripper_position, &gripper_force, ROBOTIQ_TIMEOUT);
+	raw_misc_sensors[gripper_indices[arm]] = gripper_position;	//G_WIDTH
+      }
+#else
+      franka::GripperState gripper_state = gripper.readOnce();
+      raw_misc_sensors[gripper_indices[arm]] = gripper_state.width; //G_WIDTH
+#endif
+      raw_misc_sensors[gripper_indices[arm]+1] = gripper_busy[arm]; //G_MOTION
+
+    } catch (const franka::Exception& ex) {
+
+      std::cerr << "gripperStateThread: " << ex.what() << std::endl;
+
+    }
+
+  }
+
+  return NULL;
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  checkForMessages
+\date  Feb 2019
+   
+\remarks 
+
+      Messages can be given to the servo for hard-coded tasks.This allows
+      some information passing between the different processes on variables
+      of common interest, e.g., the endeffector specs, object information,
+      etc.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+   none
+
+ ******************************************************************************/
+static int
+checkForMessages(void)
+{
+  int k;
+
+  // check whether a message is available
+  if (semTake(sm_simulation_message_ready_sem,NO_WAIT) == ERROR) {
+    return FALSE;
+  }
+
+  // receive the message
+  if (semTake(sm_simulation_message_sem,ns2ticks(TIME_OUT_NS)) == ERROR) {
+    printf("Couldn't take simulation message semaphore\n");
+    return FALSE;
+  }
+
+
+  for (k=1; k<=sm_simulation_message->n_msgs; ++k)
+    panda4_dispatchMessage(&servo_messages,sm_simulation_message->name[k],k);
+
+  // give back semaphore
+  sm_simulation_message->n_msgs = 0;
+  sm_simulation_message->n_bytes_used = 0;
+  semGive(sm_simulation_message_sem);
+
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  initMessages
+\date  Oct. 2026
+   
+\remarks 
+
+ registers the messages that this servo handles
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+   none
+
+ ******************************************************************************/
+static void
+initMessages(void)
+{
+  panda4_initMessages(&servo_messages);
+
+  panda4_addMessage(&servo_messages,"graspGripper",msgGraspGripper,0);
+  panda4_addMessage(&servo_messages,"moveGripper",msgMoveGripper,0);
+  panda4_addMessage(&servo_messages,"stopGripper",msgStopGripper,0);
+  panda4_addMessage(&servo_messages,"changeEndeffector",msgChangeEndeffector,0);
+  panda4_addMessage(&servo_messages,"calibrateFT",msgCalibrateFT,0);
+  panda4_addMessage(&servo_messages,"ftContact",msgFTContact,0);
+  panda4_addMessage(&servo_messages,"status",msgStatus,0);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  msgGraspGripper
+\date  Oct. 2026
+   
+\remarks 
+
+ triggers a grasp movement of all grippers of this servo
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     buf : width, speed, force, eps_in, eps_out
+ \param[in]     arg : not used
+
+ ******************************************************************************/
+static void
+msgGraspGripper(const float *buf, int arg)
+{
+  int            i,j = 0;
+  GripperCommand cmd;
+
+  cmd.task    = GRASP;
+  cmd.width   = buf[j++];
+  cmd.speed   = buf[j++];
+  cmd.force   = buf[j++];
+  cmd.eps_in  = buf[j++];
+  cmd.eps_out = buf[j++];
+
+  if (use_gripper)
+    for (i=first_arm; i<=last_arm; ++i)
+      pushGripperCommand(i,&cmd);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  msgMoveGripper
+\date  Oct. 2026
+   
+\remarks 
+
+ triggers a movement of all grippers of this servo
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     buf : width, speed
+ \param[in]     arg : not used
+
+ ******************************************************************************/
+static void
+msgMoveGripper(const float *buf, int arg)
+{
+  int            i,j = 0;
+  GripperCommand cmd;
+
+  cmd.task    = MOVE;
+  cmd.width   = buf[j++];
+  cmd.speed   = buf[j++];
+
+  if (use_gripper)
+    for (i=first_arm; i<=last_arm; ++i)
+      pushGripperCommand(i,&cmd);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  msgStopGripper
+\date  Oct. 2026
+   
+\remarks 
 
-  cSL_Cstate(&base_state-1, sm_base_state_data, 1, DOUBLE2FLOAT);
+ cancels the movements of all grippers of this servo
 
-  sm_base_state->state[1] = sm_base_state_data[1];
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
 
-  if (robot_id == ROBOT_MASTER_CLOCK)
-    sm_base_state->ts = servo_time;
-  
-  semGive(sm_base_state_sem);
+ \param[in]     buf : empty
+ \param[in]     arg : not used
 
+ ******************************************************************************/
+static void
+msgStopGripper(const float *buf, int arg)
+{
+  int            i;
+  GripperCommand cmd;
 
-  // base orient
-  if (semTake(sm_base_orient_sem,ns2ticks(TIME_OUT_NS)) == ERROR) {
-    
-    ++panda_servo_errors;
-    return FALSE;
+  cmd.task = STOP;
 
-  } 
+  if (use_gripper)
+    for (i=first_arm; i<=last_arm; ++i)
+      pushGripperCommand(i,&cmd);
+}
 
-  cSL_quat(&base_orient-1, sm_base_orient_data, 1, DOUBLE2FLOAT);
+/*!*****************************************************************************
+ *******************************************************************************
+\note  msgChangeEndeffector
+\date  Oct. 2026
+   
+\remarks 
 
-  sm_base_orient->orient[1] = sm_base_orient_data[1];
+ updates the parameters of all endeffectors
 
-  if (robot_id == ROBOT_MASTER_CLOCK)
-    sm_base_orient->ts = servo_time;
-  
-  semGive(sm_base_orient_sem);
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
 
+ \param[in]     buf : m, mcm, x, a of all endeffectors
+ \param[in]     arg : not used
 
-  return TRUE;
+ ******************************************************************************/
+static void
+msgChangeEndeffector(const float *buf, int arg)
+{
+  int i,j;
+  int count = 0;
+
+  for (i=1; i<=n_endeffs; ++i) {
+    endeff[i].m = buf[count++];
+    for (j=1; j<=N_CART; ++j)
+      endeff[i].mcm[j] = buf[count++];
+    for (j=1; j<=N_CART; ++j)
+      endeff[i].x[j] = buf[count++];
+    for (j=1; j<=N_CART; ++j)
+      endeff[i].a[j] = buf[count++];
+  }
+  endeffChanged();
 }
 
 /*!*****************************************************************************
  *******************************************************************************
-\note  send_misc_sensors
-\date  Nov. 2007
+\note  msgCalibrateFT
+\date  Oct. 2026
    
 \remarks 
 
-        sends the entire misc_sim_sensor to shared memory
-	
+ latches the F/T bias from the command line thread, as the Axia tare
+ blocks
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
 
-     none
+ \param[in]     buf : empty
+ \param[in]     arg : not used
 
  ******************************************************************************/
-static int 
-send_misc_sensors(void)
+static void
+msgCalibrateFT(const float *buf, int arg)
 {
-  
-  int i;
+  sendCommandLineCmd((char *)"calibrate_cFT");
+}
 
-  if (n_misc_sensors <= 0)
-    return TRUE;
+/*!*****************************************************************************
+ *******************************************************************************
+\note  msgFTContact
+\date  Oct. 2026
+   
+\remarks 
 
-  if (semTake(sm_misc_sim_sensor_sem,ns2ticks(TIME_OUT_NS)) == ERROR) {
-    
-    ++panda_servo_errors;
-    return FALSE;
+ contact of an arm suspends the estimation of its F/T bias
 
-  } 
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
 
-  for (i=c_f_indices[robot_id]; i<=N_MISC_PER_ROBOT; ++i)
-      sm_misc_sim_sensor->value[i] = misc_sim_sensor[i];
+ \param[in]     buf : the arm ID (0 for all arms), TRUE for contact
+ \param[in]     arg : not used
 
-  if (robot_id == ROBOT_MASTER_CLOCK)
-    sm_misc_sim_sensor->ts = servo_time;
-  
-  semGive(sm_misc_sim_sensor_sem);
+ ******************************************************************************/
+static void
+msgFTContact(const float *buf, int arg)
+{
+  int i;
+  int arm = (int) buf[0];
 
-  return TRUE;
+  for (i=first_arm; i<=last_arm; ++i)
+    if (arm == 0 || arm == i)
+      ft_contact[i] = (buf[1] != 0);
 }
 
-
 /*!*****************************************************************************
  *******************************************************************************
-\note  status
-\date  Nov 2007
+\note  msgStatus
+\date  Oct. 2026
    
 \remarks 
 
-        prints out all important variables
+ prints the status of the servo
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
 
-     none
+ \param[in]     buf : empty
+ \param[in]     arg : not used
 
  ******************************************************************************/
-void
-status(void)
+static void
+msgStatus(const float *buf, int arg)
 {
-
-  printf("\n");
-  printf("            Time                   = %f\n",panda_servo_time);
-  printf("            Servo Calls            = %ld\n",panda_servo_calls);
-  printf("            Servo Rate             = %d\n",servo_base_rate);
-  printf("            Servo Errors           = %d (%6.2f%%)\n",panda_servo_errors,
-	 (double)panda_servo_errors/(double)panda_servo_calls*100);
-  printf("\n");
-
+  status();
 }
 
 /*!*****************************************************************************
  *******************************************************************************
-\note  read_sensor_offs
-\date  Oct 2011
+\note  initSlot
+\date  Oct. 2026
    
 \remarks 
 
-interface to read sensor offsets configuration file
+ initializes a single-slot buffer as empty
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
 
- none
+ \param[out]    slot : the slot
 
  ******************************************************************************/
-static void
-read_sensor_offs(void)
+template <typename T> static void
+initSlot(LatestSlot<T> *slot)
 {
-  read_sensor_offsets(config_files[SENSOROFFSETS]);
+  slot->back   = 0;
+  slot->middle = 1;
+  slot->front  = 2;
 }
 
 /*!*****************************************************************************
  *******************************************************************************
-\note  compute_ft_offsets
-\date  Jan 2019
+\note  writeSlot
+\date  Oct. 2026
    
 \remarks 
 
- computes an average offset of the computer F/T sensor of Panda
+ stores an item in a single-slot buffer, replacing the previous one if
+ the reader has not picked it up yet. This never blocks and is thus safe to
+ call from the real-time callback.
 
  *******************************************************************************
  Function Parameters: [in]=input,[out]=output
 
-     none
+ \param[in,out] slot : the slot
+ \param[in]     item : the item to store
 
  ******************************************************************************/
-static void
-compute_ft_offsets(void)
+template <typename T> static void
+writeSlot(LatestSlot<T> *slot, const T &item)
 {
+  slot->item[slot->back] = item;
+  slot->back = slot->middle.exchange(slot->back | SLOT_NEW) & ~SLOT_NEW;
+}
 
-  double data[2*N_CART+1]={0,0,0,0,0,0,0};
-  int    count=100;
-  int    i,j;
-  long   last_panda_servo_calls = panda_servo_calls;
+/*!*****************************************************************************
+ *******************************************************************************
+\note  readSlot
+\date  Oct. 2026
+   
+\remarks 
 
+ returns the most recent item of a single-slot buffer, if a new one
+ was written since the last call
 
-#ifdef AXIA80      
-  // zero the axia80
-  axia80_ptr->TareAxia80();
-#endif
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
 
-  // zero computed f/t
-  for (i=1; i<= count; ++i) {
-    
-    while (last_panda_servo_calls == panda_servo_calls) {
-      taskDelay(ns2ticks(1000000)); // wait 10ms
-    }
-    last_panda_servo_calls = panda_servo_calls;
+ \param[in,out] slot : the slot
+ \param[out]    item : pointer to the item, valid until the next call
 
-    for (j=1; j<=2*N_CART; ++j)
-      data[j] += raw_misc_sensors[c_f_indices[robot_id]-1+j];
-    
-  }
+ returns TRUE if a new item is available
 
-  for (j=1; j<=2*N_CART; ++j)
-    misc_trans_sensors[c_f_indices[robot_id]-1+j].offset = -data[j]/(double)count;
+ ******************************************************************************/
+template <typename T> static int
+readSlot(LatestSlot<T> *slot, T **item)
+{
+  if (!(slot->middle.load() & SLOT_NEW))
+    return FALSE;
 
+  slot->front = slot->middle.exchange(slot->front) & ~SLOT_NEW;
+  *item = &(slot->item[slot->front]);
 
-  
+  return TRUE;
 }
 
 /*!*****************************************************************************
 *******************************************************************************
-\note  spawnGripperThread
-\date  Feb 2019
+\note  spawnDiagnosticsThread
+\date  Oct. 2026
  
 \remarks 
  
-spawns off a thread to do non-real-time communication with gripper
+spawns off a low-priority thread that evaluates the Coriolis forces and
+mass matrix of the Franka model for status() and data collection
  
 *******************************************************************************
 Function Parameters: [in]=input,[out]=output
@@ -1260,34 +4148,26 @@ none
  
 ******************************************************************************/
 static void
-spawnGripperThread(void) 
+spawnDiagnosticsThread(void) 
 {
-  int err = 0;
   int rc;
-  pthread_attr_t pth_attr;
-  size_t stack_size = 0;
 
-  err = pthread_attr_init(&pth_attr);
-  pthread_attr_getstacksize(&pth_attr, &stack_size);
-  double reqd = 1024*1024*8;
-  if (stack_size < reqd)
-    pthread_attr_setstacksize(&pth_attr, reqd);
-
-  // initialize a thread for blocking gripper commands
-  run_gripper_thread_flag = TRUE;
-  if ((rc=pthread_create( &cthread, &pth_attr, gripperThread, NULL)))
+  // the thread demotes itself to the background role of panda4_rt
+  if ((rc=pthread_create( &dthread, NULL, diagnosticsThread, NULL)))
       printf("pthread_create returned with %d\n",rc);
 
 }
 
 /*!*****************************************************************************
 *******************************************************************************
-\note  gripperThread
-\date  Feb 2019
+\note  diagnosticsThread
+\date  Oct. 2026
  
 \remarks 
  
-non-realtime thread for gripper communication
+non-realtime thread for the model diagnostics, running at diag_rate. It
+also compares the gravity torques of the SL model with those of the
+Franka model.
  
 *******************************************************************************
 Function Parameters: [in]=input,[out]=output
@@ -1295,82 +4175,53 @@ Function Parameters: [in]=input,[out]=output
 none
  
 ******************************************************************************/
-#ifdef ROBOTIQ2F
-#define  ROBOTIQ_TIMEOUT 5.0  // in seconds
-#include "robotiq_2f_gripper.h"
-#include "robotiq_2f_gripper_serial.h"
-using robotiq_2f_gripper::Robotiq2fGripperSerial;
-#endif
-
 static void *
-gripperThread(void *) 
+diagnosticsThread(void *) 
 {
-  long   last_panda_servo_calls = panda_servo_calls;
-  double gripper_position=0.0,gripper_force=0.0;
-
-  try {
-
-#ifdef ROBOTIQ2F
-    char port_name[] = "/dev/ttyUSB1";
-    Robotiq2fGripperSerial gripper(0.085, 0., 0.15, 220.,port_name);
-    gripper.GripperInitialization();
-#else
-    franka::Gripper gripper(ip_string);
-#endif
-
-    while (run_gripper_thread_flag) {
-
-      
-      while (last_panda_servo_calls == panda_servo_calls) {
-	taskDelay(ns2ticks(10000000)); // wait 10ms
+  int                 arm,i;
+  franka::RobotState *state;
+  std::array<double, N_DOFS_PER_ROBOT> franka_grav;
+  std::array<double, N_DOFS_PER_ROBOT> sl_grav;
+  static Calibration  c;
+  int                 calib_ok;
+  static DiagResult   d[N_ARMS+1];   // owned by this thread, published to diag_result
+
+  panda4_rtThread(RT_ROLE_BACKGROUND,-1);
+
+  while (run_arms_flag) {
+
+    taskDelay(ns2ticks((long)(1.e9/diag_rate)));
+
+    // a copy of the calibration, as the servo must never wait for this thread
+    calib_ok = readCalibration(&c,NULL);
+
+    for (arm=first_arm; arm<=last_arm; ++arm) {
+      if (!readSlot(&diag_slot[arm],&state))
+	continue;
+
+      d[arm].coriolis = diag_model[arm]->coriolis(*state);
+      d[arm].mass     = diag_model[arm]->mass(*state);
+
+      // cross-check of the SL gravity model with the Franka model, whose
+      // maximum starts over after every status()
+      if (gravity_err_reset[arm].exchange(FALSE))
+	d[arm].gravity_err_max = 0.0;
+      if (calib_ok) {
+	franka_grav = diag_model[arm]->gravity(*state);
+	sl_arm_gravity(arm,&c,state->q.data(),sl_grav.data());
+	for (i=0; i<N_DOFS_PER_ROBOT; ++i) {
+	  d[arm].gravity_err[i] = sl_grav[i] - franka_grav[i];
+	  if (fabs(d[arm].gravity_err[i]) > d[arm].gravity_err_max)
+	    d[arm].gravity_err_max = fabs(d[arm].gravity_err[i]);
+	}
       }
-      last_panda_servo_calls = panda_servo_calls;
-      
-      switch (gripper_task) {
-
-      case MOVE:
-	raw_misc_sensors[gripper_indices[robot_id]+1] = TRUE; //G_MOTION
-#ifdef ROBOTIQ2F
-	gripper.GripperControlCommandBlocking(width, speed, 10, ROBOTIQ_TIMEOUT);	
-#else
-	gripper.move(width,speed);
-#endif	
-	raw_misc_sensors[gripper_indices[robot_id]+1] = FALSE; //G_MOTION
-	gripper_task = READ_STATE;
-	break;
-	
-      case GRASP:
-	raw_misc_sensors[gripper_indices[robot_id]+1] = TRUE;  //G_MOTION
-#ifdef ROBOTIQ2F
-	gripper.GripperControlCommandBlocking(width, speed, force, ROBOTIQ_TIMEOUT);		
-#else
-	gripper.grasp(width,speed,force,eps_in,eps_out);
-#endif		
-	raw_misc_sensors[gripper_indices[robot_id]+1] = FALSE; //G_MOTION
-	gripper_task = READ_STATE;
-	break;
-	
-      case READ_STATE:
-      default: // read the gripper state
-#ifdef ROBOTIQ2F
-	gripper.GetGripperStatus(&gripper_position, &gripper_force, ROBOTIQ_TIMEOUT);
-	raw_misc_sensors[gripper_indices[robot_id]] = gripper_position;	//G_WIDTH
-#else
-	franka::GripperState gripper_state = gripper.readOnce();
-	raw_misc_sensors[gripper_indices[robot_id]] = gripper_state.width; //G_WIDTH
-#endif
 
-      }
-      
+      panda4_seqlockBeginWrite(&diag_seq[arm]);
+      diag_result[arm] = d[arm];
+      panda4_seqlockEndWrite(&diag_seq[arm]);
     }
-    
-  } catch (const franka::Exception& ex) {
+    ++diag_updates;
 
-    std::cerr << "gripperThread:" << std::endl;
-    std::cerr << ex.what() << std::endl;
-    std::cout << "Press Enter to continue..." << std::endl;
-    std::cin.ignore();
-    
   }
 
   return NULL;
@@ -1378,117 +4229,134 @@ gripperThread(void *)
 }
 
 /*!*****************************************************************************
- *******************************************************************************
-\note  checkForMessages
-\date  Feb 2019
-   
+*******************************************************************************
+\note  readDiagResult
+\date  Oct. 2026
+ 
 \remarks 
-
-      Messages can be given to the servo for hard-coded tasks.This allows
-      some information passing between the different processes on variables
-      of common interest, e.g., the endeffector specs, object information,
-      etc.
-
- *******************************************************************************
- Function Parameters: [in]=input,[out]=output
-
-   none
-
- ******************************************************************************/
+ 
+copies the latest complete results of the diagnostics thread for one arm
+ 
+*******************************************************************************
+Function Parameters: [in]=input,[out]=output
+ 
+\param[in]     arm : the arm ID
+\param[out]    d   : the results
+ 
+returns TRUE if a complete copy was read, FALSE if all attempts were torn,
+in which case d is unchanged
+ 
+******************************************************************************/
 static int
-checkForMessages(void)
+readDiagResult(int arm, DiagResult *d)
 {
-  int i,j,k;
-  char name[20];
-
-  // check whether a message is available
-  if (semTake(sm_simulation_message_ready_sem,NO_WAIT) == ERROR) {
-    return FALSE;
-  }
-
-  // receive the message
-  if (semTake(sm_simulation_message_sem,ns2ticks(TIME_OUT_NS)) == ERROR) {
-    printf("Couldn't take simulation message semaphore\n");
-    return FALSE;
-  }
+  int          n;
+  unsigned int s1,s2;
+  DiagResult   tmp;
 
+  for (n=1; n<=N_SEQLOCK_RETRIES; ++n) {
 
-  for (k=1; k<=sm_simulation_message->n_msgs; ++k) {
+    s1 = __atomic_load_n(&diag_seq[arm],__ATOMIC_ACQUIRE);
+    if (s1 & 1)
+      continue;
 
-    // get the name of this message
-    strcpy(name,sm_simulation_message->name[k]);
+    memcpy(&tmp,&diag_result[arm],sizeof(tmp));
 
-    // act according to the message name
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    s2 = __atomic_load_n(&diag_seq[arm],__ATOMIC_RELAXED);
+    if (s1 != s2)
+      continue;
 
-    // -------------------------------------------------------------------------
-    if (strcmp(name,"graspGripper") == 0) { // trigger a grasp movement
-      float  buf[5+1];
-      
-      memcpy(&(buf[1]),sm_simulation_message->buf+sm_simulation_message->moff[k],
-	     sizeof(float)*(5));
-      j = 0;
-      width   = buf[++j];
-      speed   = buf[++j];
-      force   = buf[++j];
-      eps_in  = buf[++j];
-      eps_out = buf[++j];
+    *d = tmp;
 
-      gripper_task = GRASP;
+    return TRUE;
+  }
 
-      
-    // -------------------------------------------------------------------------
-    } else if (strcmp(name,"moveGripper") == 0) { // trigger a gripper movement
-      float  buf[2+1];
-      
-      memcpy(&(buf[1]),sm_simulation_message->buf+sm_simulation_message->moff[k],
-	     sizeof(float)*(2));
-      j = 0;
-      width   = buf[++j];
-      speed   = buf[++j];
+  return FALSE;
+}
 
-      gripper_task = MOVE;
+/*!*****************************************************************************
+*******************************************************************************
+\note  spawnPublishThread
+\date  Oct. 2026
+ 
+\remarks 
+ 
+spawns off the non-real-time thread that keeps the semaphore-protected SL
+shared memory of the joint states and misc sensors up to date
+ 
+*******************************************************************************
+Function Parameters: [in]=input,[out]=output
+ 
+none
+ 
+******************************************************************************/
+static void
+spawnPublishThread(void) 
+{
+  int rc;
 
-      
-      // ---------------------------------------------------------------------------
-    } else if (strcmp(name,"changeEndeffector") == 0) {
-      float buf[n_endeffs*10+1];
-      int count = 0;
-      
-      memcpy(&(buf[1]),sm_simulation_message->buf+sm_simulation_message->moff[k],
-	     sizeof(float)*(10*n_endeffs));
-      
-      for (i=1; i<=n_endeffs; ++i) {
-	endeff[i].m = buf[++count];
-	for (j=1; j<=N_CART; ++j)
-	  endeff[i].mcm[j] = buf[++count];
-	for (j=1; j<=N_CART; ++j)
-	  endeff[i].x[j] = buf[++count];
-	for (j=1; j<=N_CART; ++j)
-	  endeff[i].a[j] = buf[++count];
-      }
+  // the thread demotes itself to the background role of panda4_rt
+  if ((rc=pthread_create( &pthread_sl, NULL, publishThread, NULL)))
+      printf("pthread_create returned with %d\n",rc);
 
-      // ---------------------------------------------------------------------------
-    } else if (strcmp(name,"calibrateFT") == 0) { 
+}
 
-      sendCommandLineCmd((char *)"calibrate_cFT");
-      
-    // ---------------------------------------------------------------------------
-    } else if (strcmp(name,"status") == 0) { 
-      
-      status();
-      
+/*!*****************************************************************************
+*******************************************************************************
+\note  publishThread
+\date  Oct. 2026
+ 
+\remarks 
+ 
+non-realtime thread that copies the seqlock blocks of the arms into the
+SL shared memory every millisecond, such that the servo never waits for
+the SL semaphores of the other processes
+ 
+*******************************************************************************
+Function Parameters: [in]=input,[out]=output
+ 
+none
+ 
+******************************************************************************/
+static void *
+publishThread(void *) 
+{
+  int               arm,n;
+  double            ts = 0;
+  double            last_ts = -1.0;
+  Panda4ArmState    b;
+  static SL_Jstate  state[N_DOFS+1];
+  static double     misc[N_MISC_SENSORS+1];
+
+  panda4_rtThread(RT_ROLE_BACKGROUND,-1);
+
+  while (run_arms_flag) {
+
+    taskDelay(ns2ticks(1000000));
+
+    n = 0;
+    for (arm=first_arm; arm<=last_arm; ++arm) {
+      if (!panda4_readArmBlock(arm,&b))
+	continue;
+      memcpy(&state[(arm-1)*N_DOFS_PER_ROBOT+1],&b.state[1],
+	     sizeof(SL_Jstate)*N_DOFS_PER_ROBOT);
+      memcpy(&misc[(arm-1)*N_MISC_PER_ARM+1],&b.misc[1],
+	     sizeof(double)*N_MISC_PER_ARM);
+      ts = b.ts;
+      ++n;
     }
-    // ---------------------------------------------------------------------------
-    
-    
-  }
 
-  // give back semaphore
-  sm_simulation_message->n_msgs = 0;
-  sm_simulation_message->n_bytes_used = 0;
-  semGive(sm_simulation_message_sem);
+    // nothing new since the last publish
+    if (n == 0 || ts == last_ts)
+      continue;
+    last_ts = ts;
 
+    send_sim_state(state,ts);
+    send_misc_sensors(misc,ts);
 
-  return TRUE;
-}
+  }
 
+  return NULL;
+  
+}
@@ -0,0 +1,450 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_shm.c
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  Seqlock-protected shared memory between the Panda servo(s) and the motor
+  servo, which replaces the semaphore-protected joint_sim_state,
+  misc_sim_sensor and des_commands exchange for the real robot.
+
+  A writer increments the sequence number to an odd value, writes the
+  sample, and increments the sequence number to an even value again. A
+  reader copies the sample and accepts it only if the sequence number was
+  even and unchanged during the copy. Thus, writers never block or drop a
+  sample, and readers always get the latest complete sample. The GCC
+  __atomic builtins are used, as this file is shared by C and C++ code.
+
+  ============================================================================*/
+
+// SL general includes of system headers
+#include "SL_system_headers.h"
+#include <unistd.h>
+
+// private includes
+#include "SL.h"
+#include "SL_user.h"
+#include "SL_common.h"
+#include "SL_unix_common.h"
+#include "utility.h"
+#include "panda4_shm.h"
+
+// global variables
+Panda4Shm *sm_panda4 = NULL;
+
+// local variables
+#define STAMP_WAIT_US  100000  //!< bound on the wait for the layout of another process
+#define STAMP_POLL_US     100
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_initSharedState
+\date  Oct. 2026
+
+\remarks
+
+ creates or attaches to the shared memory block of the Panda servos, and
+ checks that its layout is the one of this build: a servo and a motor
+ servo of different builds would otherwise exchange garbage
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ returns TRUE on success
+
+ ******************************************************************************/
+int
+panda4_initSharedState(void)
+{
+  if (sm_panda4 != NULL)
+    return TRUE;
+
+  sm_panda4 = (Panda4Shm *) smMemCalloc((char *)"smPanda4State",0,1,sizeof(Panda4Shm));
+  if (sm_panda4 == NULL) {
+    printf("Couldn't create shared memory for the Panda state\n");
+    return FALSE;
+  }
+
+  if (!panda4_stampSegment(&sm_panda4->magic,&sm_panda4->version,&sm_panda4->size,
+			   PANDA4_SHM_MAGIC,PANDA4_SHM_VERSION,sizeof(Panda4Shm))) {
+    printf("Panda state segment has version %d with %d bytes instead of %d with %d -- restart all processes\n",
+	   sm_panda4->version,sm_panda4->size,PANDA4_SHM_VERSION,(int)sizeof(Panda4Shm));
+    sm_panda4 = NULL;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_stampSegment
+\date  Oct. 2026
+
+\remarks
+
+ the first process that attaches to a shared memory segment stamps its
+ layout: the magic number, then the size, and last the version. All other
+ processes check the stamp. As they may attach while the first one is
+ between the magic number and the version, they wait a bounded time for
+ the version to be published before they compare.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in,out] magic      : the magic number of the segment
+ \param[in,out] version    : the version of the segment
+ \param[in,out] size       : the size of the segment
+ \param[in]     my_magic   : the magic number of this build
+ \param[in]     my_version : the version of this build
+ \param[in]     my_size    : the size of this build
+
+ returns TRUE if the segment has the layout of this build
+
+ ******************************************************************************/
+int
+panda4_stampSegment(unsigned int *magic, unsigned int *version, unsigned int *size,
+		    unsigned int my_magic, unsigned int my_version, unsigned int my_size)
+{
+  int          t;
+  unsigned int m = 0;
+
+  if (__atomic_compare_exchange_n(magic,&m,my_magic,FALSE,__ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE)) {
+    *size = my_size;
+    __atomic_store_n(version,my_version,__ATOMIC_RELEASE);
+    return TRUE;
+  }
+
+  if (m != my_magic)
+    return FALSE;
+
+  for (t=0; t<STAMP_WAIT_US && __atomic_load_n(version,__ATOMIC_ACQUIRE) == 0; t+=STAMP_POLL_US)
+    usleep(STAMP_POLL_US);
+
+  return __atomic_load_n(version,__ATOMIC_ACQUIRE) == my_version && *size == my_size;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_seqlockBeginWrite
+\date  Oct. 2026
+
+\remarks
+
+ marks the start of a write: the sequence number becomes odd, and no
+ write of the sample can be reordered before this
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in,out] seq : the sequence number of the block
+
+ ******************************************************************************/
+void
+panda4_seqlockBeginWrite(unsigned int *seq)
+{
+  __atomic_store_n(seq,*seq+1,__ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_seqlockEndWrite
+\date  Oct. 2026
+
+\remarks
+
+ marks the end of a write: the sequence number becomes even again after
+ all writes of the sample
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in,out] seq : the sequence number of the block
+
+ ******************************************************************************/
+void
+panda4_seqlockEndWrite(unsigned int *seq)
+{
+  __atomic_store_n(seq,*seq+1,__ATOMIC_RELEASE);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_writeArmState
+\date  Oct. 2026
+
+\remarks
+
+ publishes the state of one arm
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : the arm ID (1 to N_ARMS)
+ \param[in]     ts    : the servo time of the sample
+ \param[in]     stamp : when the arm took the sample
+ \param[in]     state : joint states of the entire robot (1 to N_DOFS)
+ \param[in]     misc  : misc sensors of the entire robot (1 to N_MISC_SENSORS)
+
+ ******************************************************************************/
+void
+panda4_writeArmState(int arm, double ts, Panda4ArmStamp *stamp,
+		     SL_Jstate *state, double *misc)
+{
+  Panda4ArmState *b = &(sm_panda4->arm[arm]);
+
+  panda4_seqlockBeginWrite(&b->seq);
+
+  b->ts    = ts;
+  b->stamp = *stamp;
+  memcpy(&(b->state[1]),&(state[(arm-1)*N_DOFS_PER_ROBOT+1]),
+	 sizeof(SL_Jstate)*N_DOFS_PER_ROBOT);
+  memcpy(&(b->misc[1]),&(misc[(arm-1)*N_MISC_PER_ARM+1]),
+	 sizeof(double)*N_MISC_PER_ARM);
+
+  panda4_seqlockEndWrite(&b->seq);
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_readArmState
+\date  Oct. 2026
+
+\remarks
+
+ reads the latest complete state of one arm. Only the th, thd, thdd, load
+ and uff elements of the joint states are copied.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : the arm ID (1 to N_ARMS)
+ \param[out]    ts    : the servo time of the sample
+ \param[out]    stamp : when the arm took the sample, or NULL
+ \param[out]    state : joint states of the entire robot (1 to N_DOFS)
+ \param[out]    misc  : misc sensors of the entire robot (1 to N_MISC_SENSORS)
+
+ returns TRUE if a complete sample was read, FALSE if the arm has not
+ published yet or all attempts were torn, in which case the outputs are
+ unchanged
+
+ ******************************************************************************/
+int
+panda4_readArmState(int arm, double *ts, Panda4ArmStamp *stamp,
+		    SL_Jstate *state, double *misc)
+{
+  int             i,n;
+  unsigned int    s1,s2;
+  Panda4ArmState *b = &(sm_panda4->arm[arm]);
+  SL_Jstate       js[N_DOFS_PER_ROBOT+1];
+  double          ms[N_MISC_PER_ARM+1];
+  double          t;
+  Panda4ArmStamp  st;
+
+  for (n=1; n<=N_SEQLOCK_RETRIES; ++n) {
+
+    s1 = __atomic_load_n(&b->seq,__ATOMIC_ACQUIRE);
+    if (s1 == 0)
+      return FALSE;
+    if (s1 & 1)
+      continue;
+
+    t  = b->ts;
+    st = b->stamp;
+    memcpy(js,b->state,sizeof(js));
+    memcpy(ms,b->misc,sizeof(ms));
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    s2 = __atomic_load_n(&b->seq,__ATOMIC_RELAXED);
+    if (s1 != s2)
+      continue;
+
+    *ts = t;
+    if (stamp != NULL)
+      *stamp = st;
+    for (i=1; i<=N_DOFS_PER_ROBOT; ++i) {
+      SL_Jstate *s = &(state[(arm-1)*N_DOFS_PER_ROBOT+i]);
+      s->th   = js[i].th;
+      s->thd  = js[i].thd;
+      s->thdd = js[i].thdd;
+      s->load = js[i].load;
+      s->uff  = js[i].uff;
+    }
+    for (i=1; i<=N_MISC_PER_ARM; ++i)
+      misc[(arm-1)*N_MISC_PER_ARM+i] = ms[i];
+
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_readArmBlock
+\date  Oct. 2026
+
+\remarks
+
+ reads the latest complete block of one arm as it was published, i.e.,
+ with all elements of the joint states
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : the arm ID (1 to N_ARMS)
+ \param[out]    block : the copy of the block
+
+ returns TRUE if a complete block was read, FALSE if the arm has not
+ published yet or all attempts were torn
+
+ ******************************************************************************/
+int
+panda4_readArmBlock(int arm, Panda4ArmState *block)
+{
+  int             n;
+  unsigned int    s1,s2;
+  Panda4ArmState *b = &(sm_panda4->arm[arm]);
+
+  for (n=1; n<=N_SEQLOCK_RETRIES; ++n) {
+
+    s1 = __atomic_load_n(&b->seq,__ATOMIC_ACQUIRE);
+    if (s1 == 0)
+      return FALSE;
+    if (s1 & 1)
+      continue;
+
+    memcpy(block,b,sizeof(Panda4ArmState));
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    s2 = __atomic_load_n(&b->seq,__ATOMIC_RELAXED);
+    if (s1 == s2)
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_writeCommands
+\date  Oct. 2026
+
+\remarks
+
+ publishes the commands of all arms
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     ts        : the servo time of the commands
+ \param[in]     state     : joint states with the total command u
+ \param[in]     des_state : desired joint states with the feedforward command uff
+ \param[in]     traj      : the command trajectory of each DOF (or NULL for a
+                            constant u)
+
+ ******************************************************************************/
+void
+panda4_writeCommands(double ts, SL_Jstate *state, SL_DJstate *des_state,
+		     Panda4CmdTraj *traj)
+{
+  int             i;
+  Panda4Commands *b = &(sm_panda4->commands);
+
+  panda4_seqlockBeginWrite(&b->seq);
+
+  b->ts = ts;
+  for (i=1; i<=N_DOFS; ++i) {
+    b->u[i]   = state[i].u;
+    b->uff[i] = des_state[i].uff;
+    if (traj != NULL) {
+      b->traj[i] = traj[i];
+    } else {
+      memset(&b->traj[i],0,sizeof(Panda4CmdTraj));
+      b->traj[i].u0 = state[i].u;
+    }
+  }
+
+  panda4_seqlockEndWrite(&b->seq);
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_readCommands
+\date  Oct. 2026
+
+\remarks
+
+ reads the latest complete commands of a range of arms into the u and uff
+ elements of the joint states, and optionally the command trajectories
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     first_arm : the first arm to read
+ \param[in]     last_arm  : the last arm to read
+ \param[out]    ts        : the servo time of the commands
+ \param[out]    state     : joint states of the entire robot (1 to N_DOFS)
+ \param[out]    traj      : command trajectories of the entire robot (1 to
+                            N_DOFS), or NULL if not needed
+
+ returns TRUE if complete commands were read, FALSE if the motor servo has
+ not published yet or all attempts were torn, in which case the outputs are
+ unchanged
+
+ ******************************************************************************/
+int
+panda4_readCommands(int first_arm, int last_arm, double *ts, SL_Jstate *state,
+		    Panda4CmdTraj *traj)
+{
+  int             i,n;
+  int             first = (first_arm-1)*N_DOFS_PER_ROBOT+1;
+  int             last  = last_arm*N_DOFS_PER_ROBOT;
+  unsigned int    s1,s2;
+  Panda4Commands *b = &(sm_panda4->commands);
+  double          u[N_DOFS+1],uff[N_DOFS+1];
+  Panda4CmdTraj   tr[N_DOFS+1];
+  double          t;
+
+  for (n=1; n<=N_SEQLOCK_RETRIES; ++n) {
+
+    s1 = __atomic_load_n(&b->seq,__ATOMIC_ACQUIRE);
+    if (s1 == 0)
+      return FALSE;
+    if (s1 & 1)
+      continue;
+
+    t = b->ts;
+    for (i=first; i<=last; ++i) {
+      u[i]   = b->u[i];
+      uff[i] = b->uff[i];
+    }
+    if (traj != NULL)
+      memcpy(&tr[first],&b->traj[first],sizeof(Panda4CmdTraj)*(last-first+1));
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    s2 = __atomic_load_n(&b->seq,__ATOMIC_RELAXED);
+    if (s1 != s2)
+      continue;
+
+    *ts = t;
+    for (i=first; i<=last; ++i) {
+      state[i].u   = u[i];
+      state[i].uff = uff[i];
+    }
+    if (traj != NULL)
+      memcpy(&traj[first],&tr[first],sizeof(Panda4CmdTraj)*(last-first+1));
+
+    return TRUE;
+  }
+
+  return FALSE;
+}
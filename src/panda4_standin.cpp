@@ -0,0 +1,540 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_standin.cpp
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  The local stand-in for libfranka, see panda4_standin.h. Like the Panda
+  itself, the simulated arm compensates gravity internally, i.e., the
+  torque command of the control callback excludes gravity, and tau_J is
+  the total joint torque.
+
+  ============================================================================*/
+
+// system includes
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <time.h>
+
+#include "SL_system_headers.h"
+
+// private includes
+#include "utility.h"
+#include "SL.h"
+#include "SL_common.h"
+#include "SL_user.h"
+#include "panda4_dynamics.h"
+#include "panda4_standin.h"
+
+namespace franka {
+
+// local functions
+static void standinJointState(int arm, const RobotState &state, SL_Jstate *js);
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  standinJointState
+\date  Oct. 2026
+
+\remarks
+
+ fills the joint state of one arm in an SL joint state array of the entire
+ robot, with all other arms at zero
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : the arm ID (1 to N_ARMS)
+ \param[in]     state : the robot state of this arm
+ \param[out]    js    : the joint states of the entire robot (1 to N_DOFS)
+
+ ******************************************************************************/
+static void
+standinJointState(int arm, const RobotState &state, SL_Jstate *js)
+{
+  int j;
+  int dof = (arm-1)*N_DOFS_PER_ROBOT;
+
+  bzero((void *)js,sizeof(SL_Jstate)*(N_DOFS+1));
+  for (j=1; j<=N_DOFS_PER_ROBOT; ++j) {
+    js[dof+j].th  = state.q[j-1];
+    js[dof+j].thd = state.dq[j-1];
+  }
+}
+
+Torques::Torques(std::initializer_list<double> torques)
+{
+  size_t i = 0;
+
+  for (double t : torques)
+    if (i < tau_J.size())
+      tau_J[i++] = t;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  Model::gravity
+\date  Oct. 2026
+
+\remarks
+
+ the gravity torques of the arm from the SL model
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     state : the robot state
+
+ ******************************************************************************/
+std::array<double, 7>
+Model::gravity(const RobotState &state) const
+{
+  int                   j;
+  SL_Jstate             js[N_DOFS+1];
+  double                qdd[N_DOFS_PER_ROBOT+1];
+  double                tau[N_DOFS_PER_ROBOT+1];
+  SL_endeff             eff[N_ENDEFFS+1];
+  std::array<double, 7> g;
+
+  standinJointState(arm_,state,js);
+  for (j=1; j<=N_DOFS_PER_ROBOT; ++j) {
+    js[(arm_-1)*N_DOFS_PER_ROBOT+j].thd = 0.0;
+    qdd[j] = 0.0;
+  }
+
+  getEndeffectorSnapshot(eff);
+  panda4_armInvDyn(arm_,js,qdd,eff,tau);
+
+  for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+    g[j-1] = tau[j];
+
+  return g;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  Model::coriolis
+\date  Oct. 2026
+
+\remarks
+
+ the Coriolis and centripetal torques of the arm from the SL model
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     state : the robot state
+
+ ******************************************************************************/
+std::array<double, 7>
+Model::coriolis(const RobotState &state) const
+{
+  int                   i,j;
+  SL_Jstate             js[N_DOFS+1];
+  double                C[N_DOFS_PER_ROBOT+1][N_DOFS_PER_ROBOT+1];
+  SL_endeff             eff[N_ENDEFFS+1];
+  std::array<double, 7> c;
+
+  standinJointState(arm_,state,js);
+  getEndeffectorSnapshot(eff);
+  panda4_armCoriolisMatrix(arm_,js,eff,C,NULL);
+
+  for (i=1; i<=N_DOFS_PER_ROBOT; ++i) {
+    c[i-1] = 0.0;
+    for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+      c[i-1] += C[i][j]*state.dq[j-1];
+  }
+
+  return c;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  Model::mass
+\date  Oct. 2026
+
+\remarks
+
+ the inertia matrix of the arm from the SL model, in column-major order
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     state : the robot state
+
+ ******************************************************************************/
+std::array<double, 49>
+Model::mass(const RobotState &state) const
+{
+  int                    i,j;
+  SL_Jstate              js[N_DOFS+1];
+  double                 C[N_DOFS_PER_ROBOT+1][N_DOFS_PER_ROBOT+1];
+  double                 M[N_DOFS_PER_ROBOT+1][N_DOFS_PER_ROBOT+1];
+  SL_endeff              eff[N_ENDEFFS+1];
+  std::array<double, 49> m;
+
+  standinJointState(arm_,state,js);
+  getEndeffectorSnapshot(eff);
+  panda4_armCoriolisMatrix(arm_,js,eff,C,M);
+
+  for (i=1; i<=N_DOFS_PER_ROBOT; ++i)
+    for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+      m[(j-1)*N_DOFS_PER_ROBOT+i-1] = M[i][j];
+
+  return m;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  Robot::Robot
+\date  Oct. 2026
+
+\remarks
+
+ creates a stand-in arm at the default posture of SL
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     address : "standin_<arm ID>"
+
+ ******************************************************************************/
+Robot::Robot(const std::string &address)
+{
+  int j;
+
+  if (sscanf(address.c_str(),"standin_%d",&arm_) != 1 || arm_ < 1 || arm_ > N_ARMS)
+    throw NetworkException("stand-in robot address must be standin_<arm ID>: " + address);
+
+  for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+    state_.q[j-1] = state_.q_d[j-1] = joint_default_state[(arm_-1)*N_DOFS_PER_ROBOT+j].th;
+  state_.O_T_EE[0] = state_.O_T_EE[5] = state_.O_T_EE[10] = state_.O_T_EE[15] = 1.0;
+  state_.control_command_success_rate = 1.0;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  Robot::control
+\date  Oct. 2026
+
+\remarks
+
+ runs the control callback at 1kHz from the monotonic clock until the
+ callback finishes the motion. Every tick, the returned torques plus the
+ gravity compensation of the arm drive the SL forward dynamics, which are
+ integrated with semi-implicit Euler. A callback that overruns its tick
+ shows up in the period of the next tick, as on the robot.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     control_callback : the torque control callback
+ \param[in]     limit_rate       : ignored
+ \param[in]     cutoff_frequency : ignored
+
+ ******************************************************************************/
+void
+Robot::control(std::function<Torques(const RobotState&, Duration)> control_callback,
+	       bool limit_rate, double cutoff_frequency)
+{
+  int             j;
+  int             dof = (arm_-1)*N_DOFS_PER_ROBOT;
+  const double    dt  = 0.001;
+  const long      tick_ns = 1000000;
+  uint64_t        ticks,last_ticks = 0;
+  struct timespec t0,next;
+  SL_Jstate       js[N_DOFS+1];
+  SL_endeff       eff[N_ENDEFFS+1];
+  Model           model(arm_);
+
+  clock_gettime(CLOCK_MONOTONIC,&t0);
+  next = t0;
+  state_.robot_mode = RobotMode::kMove;
+
+  for (;;) {
+
+    // the next tick, skipping ticks that were missed entirely
+    next.tv_nsec += tick_ns;
+    if (next.tv_nsec >= 1000000000) {
+      next.tv_nsec -= 1000000000;
+      ++next.tv_sec;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&next,NULL);
+
+    ticks = ((next.tv_sec - t0.tv_sec)*1000000000L + (next.tv_nsec - t0.tv_nsec))/tick_ns;
+    state_.time = Duration(ticks);
+
+    Torques tau = control_callback(state_,Duration(last_ticks == 0 ? 0 : ticks-last_ticks));
+    last_ticks = ticks;
+
+    // the robot compensates gravity itself
+    std::array<double, 7> g = model.gravity(state_);
+
+    standinJointState(arm_,state_,js);
+    for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+      js[dof+j].u = tau.tau_J[j-1] + g[j-1];
+
+    getEndeffectorSnapshot(eff);
+    panda4_armForDyn(arm_,js,eff);
+
+    for (j=1; j<=N_DOFS_PER_ROBOT; ++j) {
+      state_.dq[j-1]     += js[dof+j].thdd*dt;
+      state_.q[j-1]      += state_.dq[j-1]*dt;
+      state_.dtau_J[j-1]  = (js[dof+j].u - state_.tau_J[j-1])/dt;
+      state_.tau_J[j-1]   = js[dof+j].u;
+      state_.q_d[j-1]     = state_.q[j-1];
+      state_.dq_d[j-1]    = state_.dq[j-1];
+    }
+
+    if (tau.motion_finished)
+      break;
+
+    // a callback that took longer than a tick loses the missed ticks
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+    if ((now.tv_sec - next.tv_sec)*1000000000L + (now.tv_nsec - next.tv_nsec) > tick_ns)
+      next = now;
+
+  }
+
+  state_.robot_mode = RobotMode::kIdle;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  Gripper::Gripper
+\date  Oct. 2026
+
+\remarks
+
+ creates a stand-in gripper, which is open
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     address : ignored
+
+ ******************************************************************************/
+Gripper::Gripper(const std::string &address)
+  : start_(std::chrono::steady_clock::now()), start_width_(0.08), target_width_(0.08),
+    speed_(0.1), moving_(false), stopped_(false), grasped_(false)
+{
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  Gripper::widthAt
+\date  Oct. 2026
+
+\remarks
+
+ the width of the gripper at a given time, moving linearly with the
+ commanded speed from the start width to the target width. The mutex
+ must be held.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     t : the time
+
+ ******************************************************************************/
+double
+Gripper::widthAt(std::chrono::steady_clock::time_point t) const
+{
+  double d = speed_*std::chrono::duration<double>(t - start_).count();
+  double delta = target_width_ - start_width_;
+
+  if (d >= fabs(delta))
+    return target_width_;
+
+  return start_width_ + (delta > 0 ? d : -d);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  Gripper::moveTo
+\date  Oct. 2026
+
+\remarks
+
+ moves the gripper and blocks until the target width is reached or the
+ motion is stopped
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     width : the target width
+ \param[in]     speed : the speed
+
+ returns false if the motion was stopped
+
+ ******************************************************************************/
+bool
+Gripper::moveTo(double width, double speed)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto                         now = std::chrono::steady_clock::now();
+
+  if (width < 0 || width > 0.08 || speed <= 0)
+    throw CommandException("stand-in gripper: invalid width or speed");
+
+  start_width_  = widthAt(now);
+  target_width_ = width;
+  speed_        = speed;
+  start_        = now;
+  moving_       = true;
+  stopped_      = false;
+  grasped_      = false;
+
+  auto done = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>
+    (std::chrono::duration<double>(fabs(target_width_ - start_width_)/speed_));
+  cv_.wait_until(lock,done,[this]{ return stopped_; });
+
+  moving_ = false;
+
+  return !stopped_;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  Gripper::homing
+\date  Oct. 2026
+
+\remarks
+
+ opens the gripper completely
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+bool
+Gripper::homing()
+{
+  return moveTo(0.08,0.1);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  Gripper::move
+\date  Oct. 2026
+
+\remarks
+
+ moves the gripper to a width
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     width : the target width
+ \param[in]     speed : the speed
+
+ ******************************************************************************/
+bool
+Gripper::move(double width, double speed)
+{
+  return moveTo(width,speed);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  Gripper::grasp
+\date  Oct. 2026
+
+\remarks
+
+ closes the gripper to the grasp width, which always succeeds unless the
+ grasp is stopped
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     width         : the grasp width
+ \param[in]     speed         : the speed
+ \param[in]     force         : ignored
+ \param[in]     epsilon_inner : ignored
+ \param[in]     epsilon_outer : ignored
+
+ ******************************************************************************/
+bool
+Gripper::grasp(double width, double speed, double force,
+	       double epsilon_inner, double epsilon_outer)
+{
+  bool success = moveTo(width,speed);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  grasped_ = success;
+
+  return success;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  Gripper::stop
+\date  Oct. 2026
+
+\remarks
+
+ stops a motion of the gripper at its current width
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+bool
+Gripper::stop()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto                        now = std::chrono::steady_clock::now();
+
+  if (moving_) {
+    start_width_ = target_width_ = widthAt(now);
+    start_       = now;
+    stopped_     = true;
+    cv_.notify_all();
+  }
+
+  return true;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  Gripper::readOnce
+\date  Oct. 2026
+
+\remarks
+
+ the current state of the gripper
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+GripperState
+Gripper::readOnce() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  GripperState                state;
+  auto                        now = std::chrono::steady_clock::now();
+
+  state.width      = widthAt(now);
+  state.is_grasped = grasped_;
+  state.time       = Duration((uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>
+			      (now.time_since_epoch()).count());
+
+  return state;
+}
+
+}  // namespace franka
@@ -0,0 +1,415 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_startup.c
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  The parallel startup of the Panda servos. The launcher (xrrobot) starts
+  all robot servos at once and announces how many there are. Every servo
+  brings up its robots, reports itself ready, and waits for the other
+  servos at the startup barrier, such that all arms go into torque
+  control together.
+
+  The configuration files that all servos parse identically are parsed
+  only by the first servo that asks for them, and the others copy the
+  result from shared memory. The cache is keyed by the modification time
+  in ns, the inode and the size of the files, i.e., an edited or replaced
+  file is parsed again at the next start. A servo that waits for the parse
+  of another one takes over after a time-out, in case the other one died.
+  Every parse is owned by a new generation in the lock word of the cache,
+  such that a servo that was taken over cannot publish anymore. The owner
+  parses into its own memory and publishes the result under its generation
+  into one of two seqlocked slots, and the readers copy the slot of the
+  generation that they saw ready, and retry if the generation changed
+  under them.
+
+  ============================================================================*/
+
+// SL general includes of system headers
+#include "SL_system_headers.h"
+#include <unistd.h>
+#include <sys/stat.h>
+
+// private includes
+#include "SL.h"
+#include "SL_user.h"
+#include "SL_common.h"
+#include "SL_unix_common.h"
+#include "utility.h"
+#include "panda4_startup.h"
+#include "panda4_shm.h"
+#include "panda4_timing.h"
+
+// global variables
+Panda4Startup *sm_panda4_startup = NULL;
+
+// local variables
+static long          config_stamp[N_CONFIG_STAMPS*N_CONFIG_CACHE_FILES];
+static unsigned long config_owner = 0;    // our lock word while we parse
+
+// local functions
+static int readConfigSlot(unsigned long lock, Panda4ConfigCache *config);
+
+//! polling period of the waits in us
+#define STARTUP_POLL_US 1000
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_initStartup
+\date  Oct. 2026
+
+\remarks
+
+ creates or attaches to the shared memory of the startup
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ returns TRUE on success
+
+ ******************************************************************************/
+int
+panda4_initStartup(void)
+{
+
+  if (sm_panda4_startup != NULL)
+    return TRUE;
+
+  sm_panda4_startup = (Panda4Startup *)
+    smMemCalloc((char *)"smPanda4Startup",0,1,sizeof(Panda4Startup));
+  if (sm_panda4_startup == NULL) {
+    printf("Couldn't create shared memory for the Panda startup\n");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_launchServos
+\date  Oct. 2026
+
+\remarks
+
+ the launcher announces the number of robot servos before it starts them
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     n_servos : the number of robot servos
+
+ ******************************************************************************/
+void
+panda4_launchServos(int n_servos)
+{
+
+  if (!panda4_initStartup())
+    return;
+
+  __atomic_store_n(&sm_panda4_startup->n_ready,0,__ATOMIC_RELAXED);
+  __atomic_store_n(&sm_panda4_startup->t_launch,panda4_timeNs(),__ATOMIC_RELAXED);
+  __atomic_store_n(&sm_panda4_startup->n_servos,n_servos,__ATOMIC_RELEASE);
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_servoReady
+\date  Oct. 2026
+
+\remarks
+
+ a robot servo reports that its robots are initialized
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_servoReady(void)
+{
+
+  if (sm_panda4_startup == NULL)
+    return;
+
+  __atomic_fetch_add(&sm_panda4_startup->n_ready,1,__ATOMIC_ACQ_REL);
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_waitForServos
+\date  Oct. 2026
+
+\remarks
+
+ waits until all robot servos of the launch are ready. Without a
+ launcher, i.e., for a servo that was started by hand, there is nothing to
+ wait for.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     timeout : maximal wait in s
+
+ returns TRUE if all servos are ready, FALSE after the time-out
+
+ ******************************************************************************/
+int
+panda4_waitForServos(double timeout)
+{
+  unsigned long t0 = panda4_timeNs();
+
+  if (sm_panda4_startup == NULL)
+    return TRUE;
+
+  while (__atomic_load_n(&sm_panda4_startup->n_ready,__ATOMIC_ACQUIRE) <
+	 __atomic_load_n(&sm_panda4_startup->n_servos,__ATOMIC_ACQUIRE)) {
+    if ((double)(panda4_timeNs()-t0)*1.e-9 > timeout)
+      return FALSE;
+    usleep(STARTUP_POLL_US);
+  }
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_launchTime
+\date  Oct. 2026
+
+\remarks
+
+ the time since the launch of the robot servos
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ returns the time in s, or 0 without launcher
+
+ ******************************************************************************/
+double
+panda4_launchTime(void)
+{
+  unsigned long t;
+
+  if (sm_panda4_startup == NULL ||
+      __atomic_load_n(&sm_panda4_startup->n_servos,__ATOMIC_ACQUIRE) == 0)
+    return 0.0;
+
+  t = __atomic_load_n(&sm_panda4_startup->t_launch,__ATOMIC_RELAXED);
+
+  return (double)(panda4_timeNs()-t)*1.e-9;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_lockConfigCache
+\date  Oct. 2026
+
+\remarks
+
+ decides whether the caller parses the configuration files and fills the
+ cache, or copies the cache. The cache is valid if it was filled from the
+ files as they are now. If another servo is parsing the files, the caller
+ waits for it, and takes the parse over if this servo does not finish it
+ within the time-out.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     files   : the path names of the files
+ \param[in]     n_files : number of files (at most N_CONFIG_CACHE_FILES)
+ \param[in]     timeout : maximal wait for another servo in s
+ \param[out]    config  : the cached parse, only for CONFIG_CACHED
+
+ returns CONFIG_LOAD if the caller needs to parse the files and to call
+ panda4_unlockConfigCache() afterwards, or CONFIG_CACHED
+
+ ******************************************************************************/
+int
+panda4_lockConfigCache(char files[][100], int n_files, double timeout,
+		       Panda4ConfigCache *config)
+{
+  int           i;
+  int           rc;
+  int           state;
+  long         *stamp;
+  struct stat   st;
+  unsigned long lock,mine;
+  unsigned long seen = 0;
+  unsigned long t0 = panda4_timeNs();
+
+  config_owner = 0;
+
+  if (!panda4_initStartup())
+    return CONFIG_LOAD;
+
+  memset(config_stamp,0,sizeof(config_stamp));
+  for (i=0; i<n_files && i<N_CONFIG_CACHE_FILES; ++i)
+    if (stat(files[i],&st) == 0) {
+      stamp    = &config_stamp[N_CONFIG_STAMPS*i];
+      stamp[0] = (long) st.st_mtim.tv_sec;
+      stamp[1] = (long) st.st_mtim.tv_nsec;
+      stamp[2] = (long) st.st_ino;
+      stamp[3] = (long) st.st_size;
+    }
+
+  while (TRUE) {
+
+    lock  = __atomic_load_n(&sm_panda4_startup->config_lock,__ATOMIC_ACQUIRE);
+    state = (int)(lock & CONFIG_STATE_MASK);
+
+    if (state == CONFIG_READY) {
+      rc = readConfigSlot(lock,config);
+      if (rc == CONFIG_READY)
+	return CONFIG_CACHED;
+      if (rc == CONFIG_LOADING) {
+	// republished while we copied: read the new generation
+	usleep(STARTUP_POLL_US);
+	continue;
+      }
+    }
+
+    // the time-out starts anew whenever another servo takes over
+    if (lock != seen) {
+      seen = lock;
+      t0   = panda4_timeNs();
+    }
+
+    if (state != CONFIG_LOADING || (double)(panda4_timeNs()-t0)*1.e-9 > timeout) {
+      // empty, outdated, or the other servo is gone: parse the files as a
+      // new generation
+      mine = (((lock >> CONFIG_STATE_BITS) + 1) << CONFIG_STATE_BITS) | CONFIG_LOADING;
+      if (__atomic_compare_exchange_n(&sm_panda4_startup->config_lock,&lock,mine,
+				      FALSE,__ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE)) {
+	config_owner = mine;
+	return CONFIG_LOAD;
+      }
+      continue;
+    }
+
+    usleep(STARTUP_POLL_US);
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_unlockConfigCache
+\date  Oct. 2026
+
+\remarks
+
+ publishes the parse of the caller into the slot of its generation,
+ unless another servo took the parse over in the meantime
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     ok     : TRUE if the files were parsed successfully
+ \param[in]     config : the parse of the caller
+
+ ******************************************************************************/
+void
+panda4_unlockConfigCache(int ok, Panda4ConfigCache *config)
+{
+
+  unsigned long     lock = config_owner;
+  unsigned long     done;
+  Panda4ConfigSlot *slot;
+
+  if (sm_panda4_startup == NULL || config_owner == 0)
+    return;
+
+  config_owner = 0;
+
+  if (__atomic_load_n(&sm_panda4_startup->config_lock,__ATOMIC_ACQUIRE) != lock) {
+    printf("Another servo took over the parse of the configuration files\n");
+    return;
+  }
+
+  if (ok) {
+    // the slot of the previous generation stays intact for its readers
+    slot = &(sm_panda4_startup->config_slot[(lock >> CONFIG_STATE_BITS) & 1]);
+    panda4_seqlockBeginWrite(&slot->seq);
+    memcpy(slot->stamp,config_stamp,sizeof(config_stamp));
+    memcpy(&slot->config,config,sizeof(Panda4ConfigCache));
+    panda4_seqlockEndWrite(&slot->seq);
+    done = (lock & ~CONFIG_STATE_MASK) | CONFIG_READY;
+  } else {
+    done = (lock & ~CONFIG_STATE_MASK) | CONFIG_EMPTY;
+  }
+
+  // only the owner of the parse may publish it
+  if (!__atomic_compare_exchange_n(&sm_panda4_startup->config_lock,&lock,done,
+				   FALSE,__ATOMIC_ACQ_REL,__ATOMIC_RELAXED))
+    printf("Another servo took over the parse of the configuration files\n");
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  readConfigSlot
+\date  Oct. 2026
+
+\remarks
+
+ copies the slot of a ready generation of the cache, and checks that the
+ generation is still the published one after the copy
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     lock   : the ready lock word that the caller saw
+ \param[out]    config : the cached parse
+
+ returns CONFIG_READY if the copy is valid for the files as they are now,
+ CONFIG_LOADING if the slot changed during the copy, or CONFIG_EMPTY if
+ the cache is outdated
+
+ ******************************************************************************/
+static int
+readConfigSlot(unsigned long lock, Panda4ConfigCache *config)
+{
+  int               n;
+  unsigned int      s1,s2;
+  long              stamp[N_CONFIG_STAMPS*N_CONFIG_CACHE_FILES];
+  Panda4ConfigSlot *slot;
+
+  slot = &(sm_panda4_startup->config_slot[(lock >> CONFIG_STATE_BITS) & 1]);
+
+  for (n=1; n<=N_SEQLOCK_RETRIES; ++n) {
+
+    s1 = __atomic_load_n(&slot->seq,__ATOMIC_ACQUIRE);
+    if (s1 & 1)
+      continue;
+
+    memcpy(stamp,slot->stamp,sizeof(stamp));
+    memcpy(config,&slot->config,sizeof(Panda4ConfigCache));
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    s2 = __atomic_load_n(&slot->seq,__ATOMIC_RELAXED);
+    if (s1 != s2)
+      continue;
+
+    // a newer generation may have reused the slot in the meantime
+    if (__atomic_load_n(&sm_panda4_startup->config_lock,__ATOMIC_ACQUIRE) != lock)
+      return CONFIG_LOADING;
+
+    if (memcmp(stamp,config_stamp,sizeof(config_stamp)) != 0)
+      return CONFIG_EMPTY;
+
+    return CONFIG_READY;
+  }
+
+  return CONFIG_LOADING;
+}
@@ -0,0 +1,328 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_telemetry.c
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  Shared-memory telemetry of the servo processes. Every servo (xrprobot,
+  xmotor, xtask, xsimulation) claims a slot of the segment by its name at
+  initialization and publishes its counters once per tick with a seqlock,
+  i.e., the servo never blocks, and a reader like xtelemetry never
+  interferes with the servo. A servo that is restarted reuses the slot of
+  its name.
+
+  The periods of the servo are counted in a histogram with the logarithmic
+  buckets and linear sub-buckets of the latency histograms of the Panda
+  servo (panda4_timing.c), whose percentiles are computed by the reader.
+
+  ============================================================================*/
+
+// SL general includes of system headers
+#include "SL_system_headers.h"
+#include <unistd.h>
+
+// private includes
+#include "SL.h"
+#include "SL_user.h"
+#include "SL_common.h"
+#include "SL_unix_common.h"
+#include "utility.h"
+#include "panda4_shm.h"
+#include "panda4_telemetry.h"
+#include "panda4_timing.h"
+
+// global variables
+Panda4Telemetry *sm_panda4_telemetry = NULL;
+
+// local variables
+static Panda4TelemetrySlot *my_slot = NULL;
+static unsigned long        overrun_ns = 0;
+static unsigned long        t_begin = 0;
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_attachTelemetry
+\date  Oct. 2026
+
+\remarks
+
+ creates or attaches to the telemetry segment, and checks that its layout
+ is the one of this build
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ returns TRUE on success
+
+ ******************************************************************************/
+int
+panda4_attachTelemetry(void)
+{
+  if (sm_panda4_telemetry != NULL)
+    return TRUE;
+
+  sm_panda4_telemetry = (Panda4Telemetry *)
+    smMemCalloc((char *)"smPanda4Telemetry",0,1,sizeof(Panda4Telemetry));
+  if (sm_panda4_telemetry == NULL) {
+    printf("Couldn't create shared memory for the telemetry\n");
+    return FALSE;
+  }
+
+  if (!panda4_stampSegment(&sm_panda4_telemetry->magic,&sm_panda4_telemetry->version,
+			   &sm_panda4_telemetry->size,PANDA4_TELEMETRY_MAGIC,
+			   PANDA4_TELEMETRY_VERSION,sizeof(Panda4Telemetry))) {
+    printf("Telemetry segment has version %d instead of %d -- restart all processes\n",
+	   sm_panda4_telemetry->version,PANDA4_TELEMETRY_VERSION);
+    sm_panda4_telemetry = NULL;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_initTelemetry
+\date  Oct. 2026
+
+\remarks
+
+ claims the slot of a servo process: the slot with the same name if the
+ servo was restarted, and otherwise a free one
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     name : the name of the servo
+ \param[in]     rate : the nominal servo rate in Hz
+
+ returns TRUE on success
+
+ ******************************************************************************/
+int
+panda4_initTelemetry(const char *name, int rate)
+{
+  int                  i;
+  int                  pid = (int) getpid();
+  int                  free_pid;
+  Panda4TelemetrySlot *s = NULL;
+
+  if (!panda4_attachTelemetry())
+    return FALSE;
+
+  for (i=1; i<=N_TELEMETRY_SLOTS; ++i) {
+    Panda4TelemetrySlot *c = &(sm_panda4_telemetry->slot[i]);
+    if (__atomic_load_n(&c->pid,__ATOMIC_ACQUIRE) != 0 &&
+	strncmp(c->name,name,N_TELEMETRY_NAME-1) == 0) {
+      __atomic_store_n(&c->pid,pid,__ATOMIC_RELEASE);
+      s = c;
+      break;
+    }
+  }
+
+  for (i=1; i<=N_TELEMETRY_SLOTS && s == NULL; ++i) {
+    Panda4TelemetrySlot *c = &(sm_panda4_telemetry->slot[i]);
+    free_pid = 0;
+    if (__atomic_compare_exchange_n(&c->pid,&free_pid,pid,FALSE,
+				    __ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE))
+      s = c;
+  }
+
+  if (s == NULL) {
+    printf("No free telemetry slot for %s\n",name);
+    return FALSE;
+  }
+
+  panda4_seqlockBeginWrite(&s->seq);
+  strncpy(s->name,name,N_TELEMETRY_NAME-1);
+  s->name[N_TELEMETRY_NAME-1] = '\0';
+  s->rate           = rate;
+  s->servo_time     = 0;
+  s->t_update       = 0;
+  s->ticks          = 0;
+  s->errors         = 0;
+  s->overruns       = 0;
+  s->last_period_ns = 0;
+  s->max_period_ns  = 0;
+  s->last_busy_ns   = 0;
+  s->max_busy_ns    = 0;
+  memset(s->period_hist,0,sizeof(s->period_hist));
+  panda4_seqlockEndWrite(&s->seq);
+
+  overrun_ns = (rate > 0) ? (unsigned long)(TELEMETRY_OVERRUN_FACTOR*1.e9/(double)rate) : 0;
+  my_slot = s;
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_telemetryBeginTick
+\date  Oct. 2026
+
+\remarks
+
+ marks the start of a servo tick. The period of the servo is the time
+ between the starts of two ticks.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_telemetryBeginTick(void)
+{
+  t_begin = panda4_timeNs();
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_telemetryEndTick
+\date  Oct. 2026
+
+\remarks
+
+ publishes the counters of the servo tick that started with the last
+ panda4_telemetryBeginTick(). Never blocks.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     servo_time : the servo time of the tick
+ \param[in]     errors     : the servo errors of the process so far
+
+ ******************************************************************************/
+void
+panda4_telemetryEndTick(double servo_time, long errors)
+{
+  Panda4TelemetrySlot *s = my_slot;
+  unsigned long        t = panda4_timeNs();
+  unsigned long        period,busy;
+
+  if (s == NULL || t_begin == 0)
+    return;
+
+  busy = t - t_begin;
+
+  panda4_seqlockBeginWrite(&s->seq);
+
+  if (s->t_update != 0) {
+    period = t_begin - s->t_update;
+    s->last_period_ns = period;
+    if (period > s->max_period_ns)
+      s->max_period_ns = period;
+    if (overrun_ns > 0 && period > overrun_ns)
+      ++s->overruns;
+    ++s->period_hist[panda4_timingBucket(period)];
+  }
+
+  s->servo_time   = servo_time;
+  s->t_update     = t_begin;
+  s->errors       = errors > 0 ? (unsigned long) errors : 0;
+  s->last_busy_ns = busy;
+  if (busy > s->max_busy_ns)
+    s->max_busy_ns = busy;
+  ++s->ticks;
+
+  panda4_seqlockEndWrite(&s->seq);
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_readTelemetry
+\date  Oct. 2026
+
+\remarks
+
+ reads the latest complete counters of a slot
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     slot : the slot (1 to N_TELEMETRY_SLOTS)
+ \param[out]    s    : the counters
+
+ returns TRUE if a complete sample was read, FALSE if the slot is free or
+ all attempts were torn
+
+ ******************************************************************************/
+int
+panda4_readTelemetry(int slot, Panda4TelemetrySlot *s)
+{
+  int                  n;
+  unsigned int         s1,s2;
+  Panda4TelemetrySlot *b;
+
+  if (sm_panda4_telemetry == NULL)
+    return FALSE;
+
+  b = &(sm_panda4_telemetry->slot[slot]);
+
+  for (n=1; n<=N_SEQLOCK_RETRIES; ++n) {
+
+    s1 = __atomic_load_n(&b->seq,__ATOMIC_ACQUIRE);
+    if (s1 == 0 || __atomic_load_n(&b->pid,__ATOMIC_RELAXED) == 0)
+      return FALSE;
+    if (s1 & 1)
+      continue;
+
+    memcpy(s,b,sizeof(Panda4TelemetrySlot));
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    s2 = __atomic_load_n(&b->seq,__ATOMIC_RELAXED);
+    if (s1 == s2)
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_telemetryPercentile
+\date  Oct. 2026
+
+\remarks
+
+ a percentile of the periods of a slot
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     s : the counters of the slot
+ \param[in]     p : the percentile (0 to 100)
+
+ returns the upper end of the bucket of the percentile in microseconds
+
+ ******************************************************************************/
+unsigned long
+panda4_telemetryPercentile(Panda4TelemetrySlot *s, double p)
+{
+  int           b;
+  unsigned long n = 0,c = 0,target;
+
+  for (b=0; b<N_TIMING_BUCKETS; ++b)
+    n += s->period_hist[b];
+  if (n == 0)
+    return 0;
+
+  target = (unsigned long)(p/100.*(double)n + 0.5);
+  if (target < 1)
+    target = 1;
+
+  for (b=0; b<N_TIMING_BUCKETS; ++b) {
+    c += s->period_hist[b];
+    if (c >= target)
+      return panda4_timingBucketValue(b)/1000;
+  }
+
+  return panda4_timingBucketValue(N_TIMING_BUCKETS-1)/1000;
+}
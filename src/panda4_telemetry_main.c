@@ -0,0 +1,150 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_telemetry_main.c
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  xtelemetry: displays the telemetry of all servo processes live. It only
+  reads the shared memory and never interferes with the servos.
+
+  usage: xtelemetry [-rate <Hz>] [-once]
+
+  ============================================================================*/
+
+// SL general includes of system headers
+#include "SL_system_headers.h"
+#include <time.h>
+#include <unistd.h>
+
+// private includes
+#include "SL.h"
+#include "SL_user.h"
+#include "SL_common.h"
+#include "SL_unix_common.h"
+#include "utility.h"
+#include "panda4_telemetry.h"
+
+// global variables
+int    servo_enabled = FALSE;
+double servo_time = 0;
+
+//! a servo without a tick for longer than this is shown as stale
+#define TELEMETRY_STALE_S 1.0
+
+// local functions
+static void printTelemetry(void);
+
+/*!*****************************************************************************
+*******************************************************************************
+\note  main
+\date  Oct. 2026
+
+\remarks
+
+attaches to the telemetry segment and prints it at the display rate
+
+*******************************************************************************
+Function Parameters: [in]=input,[out]=output
+
+\param[in]     argc : number of elements in argv
+\param[in]     argv : array of argc character strings
+
+******************************************************************************/
+int
+main(int argc, char**argv)
+{
+  int    i;
+  int    once = FALSE;
+  double rate = 2.0;
+
+  for (i=1; i<argc; ++i) {
+    if (strcmp(argv[i],"-rate")==0 && i+1 < argc) {
+      sscanf(argv[i+1],"%lf",&rate);
+      ++i;
+    } else if (strcmp(argv[i],"-once")==0) {
+      once = TRUE;
+    } else {
+      printf("usage: xtelemetry [-rate <Hz>] [-once]\n");
+      return FALSE;
+    }
+  }
+  if (rate <= 0)
+    rate = 2.0;
+
+  if (!panda4_attachTelemetry())
+    return FALSE;
+
+  while (TRUE) {
+    if (!once)
+      printf("\033[H\033[2J");
+    printTelemetry();
+    fflush(stdout);
+    if (once)
+      break;
+    usleep((useconds_t)(1.e6/rate));
+  }
+
+  return TRUE;
+}
+
+/*!*****************************************************************************
+*******************************************************************************
+\note  printTelemetry
+\date  Oct. 2026
+
+\remarks
+
+prints one line per servo process
+
+*******************************************************************************
+Function Parameters: [in]=input,[out]=output
+
+none
+
+******************************************************************************/
+static void
+printTelemetry(void)
+{
+  int                 i;
+  Panda4TelemetrySlot s;
+  struct timespec     t;
+  unsigned long       now;
+  double              age;
+
+  clock_gettime(CLOCK_MONOTONIC,&t);
+  now = (unsigned long)t.tv_sec*1000000000UL + (unsigned long)t.tv_nsec;
+
+  printf("%-16s %7s %5s %10s %10s %8s %8s | %-24s | %-15s | %s\n",
+	 "servo","pid","rate","time[s]","ticks","errors","overruns",
+	 "period p50/p99/max [us]","busy/max [us]","age");
+
+  for (i=1; i<=N_TELEMETRY_SLOTS; ++i) {
+
+    if (!panda4_readTelemetry(i,&s))
+      continue;
+
+    age = (s.t_update > 0 && now > s.t_update) ? (double)(now - s.t_update)*1.e-9 : 0.0;
+
+    printf("%-16s %7d %5d %10.3f %10lu %8lu %8lu | %6lu/%6lu/%8.0f | %6.0f/%8.0f | ",
+	   s.name,s.pid,s.rate,s.servo_time,s.ticks,s.errors,s.overruns,
+	   panda4_telemetryPercentile(&s,50.),
+	   panda4_telemetryPercentile(&s,99.),
+	   (double)s.max_period_ns*1.e-3,
+	   (double)s.last_busy_ns*1.e-3,
+	   (double)s.max_busy_ns*1.e-3);
+
+    if (s.t_update == 0)
+      printf("no ticks\n");
+    else if (age > TELEMETRY_STALE_S)
+      printf("STALE %.1f s\n",age);
+    else
+      printf("%.1f ms\n",age*1.e3);
+
+  }
+
+}
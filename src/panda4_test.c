@@ -0,0 +1,1273 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_test.c
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  xpanda4_test: unit tests of the Panda modules that need no robot and no
+  running SL processes. Every test is run by its name, and all tests are
+  run without a name. The exit status is 0 if all tests passed.
+
+  seqlock  : a writer thread publishes arm states and commands as fast as
+             possible, and no read may see a torn sample
+  gravity  : the gravity kernel of an arm equals its inverse dynamics at
+             zero velocities and accelerations
+  fixedbase: the fixed-base inverse dynamics, inertia matrix, link
+             information and Jacobian equal the generated kernels of SL
+  coriolis : C*qd of the Coriolis matrix equals the velocity terms of the
+             inverse dynamics, and Mdot-2C is skew symmetric
+  fkbatch  : the batched sine, cosine and forward kinematics equal their
+             scalar counterparts, also in a partially filled batch
+  centroidal: mass, COM, COM Jacobian and centroidal momentum of the arms
+             and the cell equal those summed over the individual bodies
+  buckets  : the boundaries of the latency and telemetry histogram buckets
+  messages : the hash table lookup and dispatch of servo messages
+
+  usage: xpanda4_test [seqlock|gravity|fixedbase|coriolis|fkbatch|
+                      centroidal|buckets|messages]
+
+  ============================================================================*/
+
+// SL general includes of system headers
+#include "SL_system_headers.h"
+#include <pthread.h>
+
+// private includes
+#include "SL.h"
+#include "SL_user.h"
+#include "SL_common.h"
+#include "SL_shared_memory.h"
+#include "SL_dynamics.h"
+#include "SL_kinematics.h"
+#include "utility.h"
+#include "panda4_shm.h"
+#include "panda4_dynamics.h"
+#include "panda4_timing.h"
+#include "panda4_telemetry.h"
+#include "panda4_messages.h"
+
+// global variables
+int    servo_enabled = FALSE;
+double servo_time = 0;
+
+// local variables
+#define N_SEQLOCK_READS     1000000
+#define N_GRAVITY_POSES     100
+#define N_FIXEDBASE_STATES  20
+#define N_CORIOLIS_STATES   20
+#define N_FKBATCH_CONFIGS   (4*N_FK_LANES+3)
+#define N_FKBATCH_OCTANTS   16
+#define N_CENTROIDAL_STATES 10
+#define SEQLOCK_ARM         2
+
+static Panda4Shm  test_shm;
+static int        stop_writer = FALSE;
+static int        handled_arg = 0;
+static float      handled_value = 0;
+
+// local functions
+static int   testSeqlock(void);
+static int   testGravity(void);
+static int   testFixedBase(void);
+static int   testCoriolis(void);
+static int   testFKBatch(void);
+static int   testCentroidal(void);
+static int   testBuckets(void);
+static int   testMessages(void);
+static void *seqlockWriter(void *arg);
+static void  testHandler(const float *buf, int arg);
+static double randomValue(void);
+static void  randomParameters(void);
+static void  maxDifference(double a, double b, double *err, double *mag);
+static void  armMomentum(int arm, SL_Jstate *state, SL_Jstate *state_p,
+			 SL_Jstate *state_m, double h, double *mass, double *com,
+			 double *hO);
+static void  momentumAtPoint(double *hO, double *x, double *hx);
+static void  crossProduct(double *a, double *b, double *c);
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  main
+\date  Oct. 2026
+
+\remarks
+
+ runs the test of the given name, or all tests
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     argc : number of elements in argv
+ \param[in]     argv : array of argc character strings
+
+ ******************************************************************************/
+int
+main(int argc, char **argv)
+{
+  int   i;
+  int   n_failed = 0;
+  char *names[] = {"seqlock","gravity","fixedbase","coriolis","fkbatch",
+		   "centroidal","buckets","messages"};
+  int (*tests[])(void) = {testSeqlock,testGravity,testFixedBase,testCoriolis,
+			   testFKBatch,testCentroidal,testBuckets,testMessages};
+
+  for (i=0; i<(int)(sizeof(names)/sizeof(names[0])); ++i) {
+    if (argc > 1 && strcmp(argv[1],names[i]) != 0)
+      continue;
+    if ((*tests[i])()) {
+      printf("%-10s passed\n",names[i]);
+    } else {
+      printf("%-10s FAILED\n",names[i]);
+      ++n_failed;
+    }
+  }
+
+  return n_failed == 0 ? 0 : 1;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  seqlockWriter
+\date  Oct. 2026
+
+\remarks
+
+ publishes arm states and commands whose elements all equal a counter,
+ until stop_writer is set
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arg : not used
+
+ ******************************************************************************/
+static void *
+seqlockWriter(void *arg)
+{
+  int            i;
+  long           k = 0;
+  Panda4ArmStamp stamp;
+  static SL_Jstate     state[N_DOFS+1];
+  static SL_DJstate    des_state[N_DOFS+1];
+  static double        misc[N_MISC_SENSORS+1];
+  static Panda4CmdTraj traj[N_DOFS+1];
+
+  (void) arg;
+
+  while (!__atomic_load_n(&stop_writer,__ATOMIC_ACQUIRE)) {
+    ++k;
+    for (i=1; i<=N_DOFS; ++i) {
+      state[i].th = state[i].thd = state[i].thdd = state[i].load = k;
+      state[i].u  = k;
+      des_state[i].uff = k;
+      traj[i].u0 = traj[i].th = traj[i].thd = k;
+    }
+    for (i=1; i<=N_MISC_SENSORS; ++i)
+      misc[i] = k;
+    stamp.t_mono  = (unsigned long) k;
+    stamp.t_robot = k;
+
+    panda4_writeArmState(SEQLOCK_ARM,k,&stamp,state,misc);
+    panda4_writeCommands(k,state,des_state,traj);
+  }
+
+  return NULL;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  testSeqlock
+\date  Oct. 2026
+
+\remarks
+
+ reads the arm state and the commands while the writer thread publishes
+ them, and counts the reads whose elements do not all belong to the same
+ sample
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ returns TRUE if no read was torn
+
+ ******************************************************************************/
+static int
+testSeqlock(void)
+{
+  int            i,n,rc;
+  long           n_ok = 0, n_torn = 0;
+  double         ts;
+  pthread_t      writer;
+  Panda4ArmStamp stamp;
+  static SL_Jstate     state[N_DOFS+1];
+  static double        misc[N_MISC_SENSORS+1];
+  static Panda4CmdTraj traj[N_DOFS+1];
+  int            i0 = (SEQLOCK_ARM-1)*N_DOFS_PER_ROBOT+1;
+  int            i1 = SEQLOCK_ARM*N_DOFS_PER_ROBOT;
+  int            m0 = (SEQLOCK_ARM-1)*N_MISC_PER_ARM+1;
+  int            m1 = SEQLOCK_ARM*N_MISC_PER_ARM;
+
+  // the segment is private to this test
+  bzero((void *)&test_shm,sizeof(test_shm));
+  sm_panda4 = &test_shm;
+  stop_writer = FALSE;
+
+  if ((rc=pthread_create(&writer,NULL,seqlockWriter,NULL))) {
+    printf("pthread_create returned with %d\n",rc);
+    return FALSE;
+  }
+
+  for (n=1; n<=N_SEQLOCK_READS; ++n) {
+
+    if (panda4_readArmState(SEQLOCK_ARM,&ts,&stamp,state,misc)) {
+      ++n_ok;
+      rc = stamp.t_robot == ts && stamp.t_mono == (unsigned long) ts;
+      for (i=i0; i<=i1; ++i)
+	rc = rc && state[i].th == ts && state[i].thd == ts && state[i].thdd == ts &&
+	  state[i].load == ts;
+      for (i=m0; i<=m1; ++i)
+	rc = rc && misc[i] == ts;
+      if (!rc)
+	++n_torn;
+    }
+
+    if (panda4_readCommands(1,N_ARMS,&ts,state,traj)) {
+      ++n_ok;
+      rc = TRUE;
+      for (i=1; i<=N_DOFS; ++i)
+	rc = rc && state[i].u == ts && state[i].uff == ts && traj[i].u0 == ts &&
+	  traj[i].th == ts && traj[i].thd == ts;
+      if (!rc)
+	++n_torn;
+    }
+
+  }
+
+  __atomic_store_n(&stop_writer,TRUE,__ATOMIC_RELEASE);
+  pthread_join(writer,NULL);
+  sm_panda4 = NULL;
+
+  printf("seqlock: %ld complete reads, %ld torn\n",n_ok,n_torn);
+
+  return n_ok > 0 && n_torn == 0;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  randomValue
+\date  Oct. 2026
+
+\remarks
+
+ a uniform random value in [-1,1]
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+static double
+randomValue(void)
+{
+  return 2.0*(double)rand()/(double)RAND_MAX - 1.0;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  randomParameters
+\date  Oct. 2026
+
+\remarks
+
+ sets random link and endeffector parameters of all arms, and the gravity
+ constant
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+static void
+randomParameters(void)
+{
+  int i,j,k;
+
+  gravity = 9.81;
+
+  for (i=0; i<=N_DOFS; ++i) {
+    links[i].m = 1.0 + 0.5*randomValue();
+    for (j=1; j<=N_CART; ++j)
+      links[i].mcm[j] = 0.3*randomValue();
+    for (j=1; j<=N_CART; ++j)
+      for (k=1; k<=N_CART; ++k)
+	links[i].inertia[j][k] = j == k ? 0.5 : 0.01;
+  }
+
+  for (i=1; i<=N_ENDEFFS; ++i) {
+    endeff[i].m = 0.7;
+    for (j=1; j<=N_CART; ++j) {
+      endeff[i].mcm[j] = 0.1*randomValue();
+      endeff[i].x[j]   = 0.2*randomValue();
+      endeff[i].a[j]   = randomValue();
+    }
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  maxDifference
+\date  Oct. 2026
+
+\remarks
+
+ updates the largest difference and the largest magnitude of a comparison
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     a   : the tested value
+ \param[in]     b   : the reference value
+ \param[in,out] err : the largest difference so far
+ \param[in,out] mag : the largest magnitude of the reference so far
+
+ ******************************************************************************/
+static void
+maxDifference(double a, double b, double *err, double *mag)
+{
+  if (fabs(a-b) > *err)
+    *err = fabs(a-b);
+  if (fabs(b) > *mag)
+    *mag = fabs(b);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  testGravity
+\date  Oct. 2026
+
+\remarks
+
+ compares panda4_armGravity with panda4_armInvDyn at zero joint velocities
+ and accelerations, for random link and endeffector parameters and random
+ poses of all arms
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ returns TRUE if both agree to numerical precision
+
+ ******************************************************************************/
+static int
+testGravity(void)
+{
+  int    i,j,n,arm;
+  double q[N_DOFS_PER_ROBOT+1];
+  double qdd[N_DOFS_PER_ROBOT+1];
+  double tau_invdyn[N_DOFS_PER_ROBOT+1];
+  double tau_gravity[N_DOFS_PER_ROBOT+1];
+  double err = 0, mag = 0;
+  static SL_Jstate state[N_DOFS+1];
+
+  srand(7);
+  randomParameters();
+
+  for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+    qdd[j] = 0.0;
+
+  for (n=1; n<=N_GRAVITY_POSES; ++n) {
+
+    for (i=1; i<=N_DOFS; ++i) {
+      state[i].th  = 2.0*randomValue();
+      state[i].thd = 0.0;
+    }
+
+    for (arm=1; arm<=N_ARMS; ++arm) {
+      panda4_armInvDyn(arm,state,qdd,endeff,tau_invdyn);
+      for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+	q[j] = state[(arm-1)*N_DOFS_PER_ROBOT+j].th;
+      panda4_armGravity(arm,q,endeff,gravity,tau_gravity);
+      for (j=1; j<=N_DOFS_PER_ROBOT; ++j) {
+	if (fabs(tau_invdyn[j]-tau_gravity[j]) > err)
+	  err = fabs(tau_invdyn[j]-tau_gravity[j]);
+	if (fabs(tau_invdyn[j]) > mag)
+	  mag = fabs(tau_invdyn[j]);
+      }
+    }
+
+  }
+
+  printf("gravity: max. difference %g Nm at torques up to %g Nm\n",err,mag);
+
+  return mag > 0 && err <= 1.e-9*mag;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  testFixedBase
+\date  Oct. 2026
+
+\remarks
+
+ compares the fixed-base kernels panda4_InvDynNE, panda4_InertiaMatrix,
+ panda4_linkInformation and panda4_Jacobian with the generated whole-body
+ kernels of SL, for random link and endeffector parameters and random
+ states, with the base frozen away from the origin
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ returns TRUE if all kernels agree to numerical precision
+
+ ******************************************************************************/
+static int
+testFixedBase(void)
+{
+  int    i,j,k,n;
+  int    ok = TRUE;
+  double err[4+1], mag[4+1];
+  char  *what[] = {"","InvDynNE","InertiaMatrix","linkInformation","Jacobian"};
+  SL_Cstate cbase;
+  SL_quat   obase;
+  static SL_Jstate  state[N_DOFS+1];
+  static SL_DJstate sl_state[N_DOFS+1];
+  static SL_DJstate p4_state[N_DOFS+1];
+  static int    firsttime = TRUE;
+  static Matrix sl_M, p4_M, sl_J, p4_J;
+  static Matrix sl_X[4+1], p4_X[4+1];
+  static double ***sl_Ahmat, ***p4_Ahmat, ***sl_Ahmatdof, ***p4_Ahmatdof;
+
+  if (firsttime) {
+    firsttime = FALSE;
+    sl_M = my_matrix(1,N_DOFS+2*N_CART,1,N_DOFS+2*N_CART);
+    p4_M = my_matrix(1,N_DOFS,1,N_DOFS);
+    sl_J = my_matrix(1,2*N_CART*N_ENDEFFS,1,N_DOFS);
+    p4_J = my_matrix(1,2*N_CART*N_ENDEFFS,1,N_DOFS);
+    for (i=1; i<=4; ++i) {
+      sl_X[i] = my_matrix(0,i == 4 ? N_LINKS : N_DOFS,1,N_CART);
+      p4_X[i] = my_matrix(0,i == 4 ? N_LINKS : N_DOFS,1,N_CART);
+    }
+    sl_Ahmat    = (double ***) my_calloc(N_LINKS+1,sizeof(Matrix),MY_STOP);
+    p4_Ahmat    = (double ***) my_calloc(N_LINKS+1,sizeof(Matrix),MY_STOP);
+    sl_Ahmatdof = (double ***) my_calloc(N_DOFS+1,sizeof(Matrix),MY_STOP);
+    p4_Ahmatdof = (double ***) my_calloc(N_DOFS+1,sizeof(Matrix),MY_STOP);
+    for (i=0; i<=N_LINKS; ++i) {
+      sl_Ahmat[i] = my_matrix(1,4,1,4);
+      p4_Ahmat[i] = my_matrix(1,4,1,4);
+    }
+    for (i=0; i<=N_DOFS; ++i) {
+      sl_Ahmatdof[i] = my_matrix(1,4,1,4);
+      p4_Ahmatdof[i] = my_matrix(1,4,1,4);
+    }
+  }
+
+  srand(11);
+  randomParameters();
+
+  // a frozen base without rotation, which need not be at the origin
+  freeze_base = TRUE;
+  bzero((void *)&cbase,sizeof(cbase));
+  bzero((void *)&obase,sizeof(obase));
+  obase.q[_Q0_] = 1.0;
+  for (i=1; i<=N_CART; ++i)
+    cbase.x[i] = 0.5*randomValue();
+
+  for (i=1; i<=4; ++i)
+    err[i] = mag[i] = 0.0;
+
+  for (n=1; n<=N_FIXEDBASE_STATES; ++n) {
+
+    for (i=1; i<=N_DOFS; ++i) {
+      state[i].th  = 2.0*randomValue();
+      state[i].thd = 2.0*randomValue();
+      sl_state[i].th   = state[i].th;
+      sl_state[i].thd  = state[i].thd;
+      sl_state[i].thdd = 3.0*randomValue();
+      sl_state[i].uex  = randomValue();
+    }
+    memcpy((void *)p4_state,(void *)sl_state,sizeof(p4_state));
+
+    // inverse dynamics, including the external joint torques
+    SL_InvDynNE(NULL,sl_state,endeff,&cbase,&obase);
+    panda4_InvDynNE(NULL,p4_state,endeff,&cbase,&obase,gravity);
+    for (i=1; i<=N_DOFS; ++i)
+      maxDifference(p4_state[i].uff,sl_state[i].uff,&err[1],&mag[1]);
+
+    // inertia matrix, which has no coupling between the arms
+    SL_InertiaMatrix(state,&cbase,&obase,endeff,sl_M);
+    panda4_InertiaMatrix(state,&cbase,&obase,endeff,p4_M);
+    for (i=1; i<=N_DOFS; ++i)
+      for (j=1; j<=N_DOFS; ++j)
+	maxDifference(p4_M[i][j],sl_M[i][j],&err[2],&mag[2]);
+
+    // link information: Xmcog, Xaxis, Xorigin and Xlink in this order
+    linkInformation(state,&cbase,&obase,endeff,sl_X[1],sl_X[2],sl_X[3],sl_X[4],
+		    sl_Ahmat,sl_Ahmatdof);
+    panda4_linkInformation(state,&cbase,&obase,endeff,p4_X[1],p4_X[2],p4_X[3],
+			   p4_X[4],p4_Ahmat,p4_Ahmatdof);
+    for (k=1; k<=4; ++k)
+      for (i=0; i<=(k == 4 ? N_LINKS : N_DOFS); ++i)
+	for (j=1; j<=N_CART; ++j)
+	  maxDifference(p4_X[k][i][j],sl_X[k][i][j],&err[3],&mag[3]);
+    for (i=0; i<=N_LINKS; ++i)
+      for (j=1; j<=4; ++j)
+	for (k=1; k<=4; ++k)
+	  maxDifference(p4_Ahmat[i][j][k],sl_Ahmat[i][j][k],&err[3],&mag[3]);
+    for (i=0; i<=N_DOFS; ++i)
+      for (j=1; j<=4; ++j)
+	for (k=1; k<=4; ++k)
+	  maxDifference(p4_Ahmatdof[i][j][k],sl_Ahmatdof[i][j][k],&err[3],&mag[3]);
+
+    // Jacobian of all endeffectors from the link information of SL
+    jacobian(sl_X[4],sl_X[3],sl_X[2],sl_J);
+    panda4_Jacobian(state,&cbase,&obase,endeff,p4_J);
+    for (i=1; i<=2*N_CART*N_ENDEFFS; ++i)
+      for (j=1; j<=N_DOFS; ++j)
+	maxDifference(p4_J[i][j],sl_J[i][j],&err[4],&mag[4]);
+
+  }
+
+  for (i=1; i<=4; ++i) {
+    printf("fixedbase: %s max. difference %g at values up to %g\n",what[i],err[i],mag[i]);
+    if (!(mag[i] > 0 && err[i] <= 1.e-9*mag[i]))
+      ok = FALSE;
+  }
+
+  return ok;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  testCoriolis
+\date  Oct. 2026
+
+\remarks
+
+ checks the Coriolis matrices of panda4_armCoriolisMatrix at random states:
+ C*qd must equal the inverse dynamics at zero accelerations minus the
+ gravity torques, and Mdot-2C must be skew symmetric, where Mdot is the
+ central difference of the inertia matrix along qd
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ returns TRUE if both properties hold
+
+ ******************************************************************************/
+static int
+testCoriolis(void)
+{
+  int    i,j,k,n,arm;
+  int    dof;
+  double h = 1.e-6;
+  double q[N_DOFS_PER_ROBOT+1];
+  double qdd[N_DOFS_PER_ROBOT+1];
+  double tau_invdyn[N_DOFS_PER_ROBOT+1];
+  double tau_gravity[N_DOFS_PER_ROBOT+1];
+  double C[N_DOFS_PER_ROBOT+1][N_DOFS_PER_ROBOT+1];
+  double Mp[N_DOFS_PER_ROBOT+1][N_DOFS_PER_ROBOT+1];
+  double Mm[N_DOFS_PER_ROBOT+1][N_DOFS_PER_ROBOT+1];
+  double N[N_DOFS_PER_ROBOT+1][N_DOFS_PER_ROBOT+1];
+  double aux;
+  double err_c = 0, mag_c = 0;
+  double err_n = 0, mag_n = 0;
+  static SL_Jstate state[N_DOFS+1];
+  static SL_Jstate state_p[N_DOFS+1];
+  static SL_Jstate state_m[N_DOFS+1];
+
+  srand(13);
+  randomParameters();
+
+  for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+    qdd[j] = 0.0;
+
+  for (n=1; n<=N_CORIOLIS_STATES; ++n) {
+
+    for (i=1; i<=N_DOFS; ++i) {
+      state[i].th  = 2.0*randomValue();
+      state[i].thd = 2.0*randomValue();
+      state_p[i] = state_m[i] = state[i];
+      state_p[i].th += h*state[i].thd;
+      state_m[i].th -= h*state[i].thd;
+    }
+
+    for (arm=1; arm<=N_ARMS; ++arm) {
+
+      dof = (arm-1)*N_DOFS_PER_ROBOT;
+      panda4_armCoriolisMatrix(arm,state,endeff,C,NULL);
+
+      // C*qd are the velocity terms of the inverse dynamics
+      panda4_armInvDyn(arm,state,qdd,endeff,tau_invdyn);
+      for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+	q[j] = state[dof+j].th;
+      panda4_armGravity(arm,q,endeff,gravity,tau_gravity);
+      for (i=1; i<=N_DOFS_PER_ROBOT; ++i) {
+	aux = 0.0;
+	for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+	  aux += C[i][j]*state[dof+j].thd;
+	maxDifference(aux,tau_invdyn[i]-tau_gravity[i],&err_c,&mag_c);
+      }
+
+      // Mdot-2C with the time derivative of M along the motion
+      panda4_armCoriolisMatrix(arm,state_p,endeff,N,Mp);
+      panda4_armCoriolisMatrix(arm,state_m,endeff,N,Mm);
+      for (i=1; i<=N_DOFS_PER_ROBOT; ++i)
+	for (j=1; j<=N_DOFS_PER_ROBOT; ++j)
+	  N[i][j] = (Mp[i][j]-Mm[i][j])/(2.0*h) - 2.0*C[i][j];
+      for (i=1; i<=N_DOFS_PER_ROBOT; ++i)
+	for (k=1; k<=N_DOFS_PER_ROBOT; ++k)
+	  maxDifference(N[i][k],-N[k][i],&err_n,&mag_n);
+
+    }
+
+  }
+
+  printf("coriolis: C*qd max. difference %g Nm at torques up to %g Nm\n",err_c,mag_c);
+  printf("coriolis: Mdot-2C max. asymmetry %g at elements up to %g\n",err_n,mag_n);
+
+  // the central difference is accurate to about h^2 and to the rounding
+  // error of M divided by h
+  return mag_c > 0 && err_c <= 1.e-9*mag_c && mag_n > 0 && err_n <= 1.e-6*mag_n;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  testFKBatch
+\date  Oct. 2026
+
+\remarks
+
+ checks the batched sine and cosine against sin() and cos(), and the
+ frames of panda4_FKBatch against panda4_linkInformation for random
+ configurations of all arms. The number of configurations is not a
+ multiple of N_FK_LANES, and the unused lanes of the last batch hold
+ arbitrary angles, which must not leak into the other lanes.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ returns TRUE if all results agree to numerical precision
+
+ ******************************************************************************/
+static int
+testFKBatch(void)
+{
+  int    i,j,k,l,n,f,arm;
+  int    dof;
+  double x[N_FK_LANES];
+  double s[N_FK_LANES];
+  double c[N_FK_LANES];
+  double err_sc = 0, mag_sc = 0;
+  double err_fk = 0, mag_fk = 0;
+  double **A;
+  SL_Cstate cbase;
+  SL_quat   obase;
+  static SL_Jstate state[N_DOFS+1];
+  static double th[N_FKBATCH_CONFIGS+1][N_DOFS+1];
+  static double thb[N_DOFS+1][N_FK_LANES];
+  static double pos[N_ARMS+1][N_FK_FRAMES+1][N_CART+1][N_FK_LANES];
+  static double rot[N_ARMS+1][N_FK_FRAMES+1][N_CART+1][N_CART+1][N_FK_LANES];
+  static int    firsttime = TRUE;
+  static Matrix Xmcog, Xaxis, Xorigin, Xlink;
+  static double ***Ahmat, ***Ahmatdof;
+
+  if (firsttime) {
+    firsttime = FALSE;
+    Xmcog    = my_matrix(0,N_DOFS,1,N_CART);
+    Xaxis    = my_matrix(0,N_DOFS,1,N_CART);
+    Xorigin  = my_matrix(0,N_DOFS,1,N_CART);
+    Xlink    = my_matrix(0,N_LINKS,1,N_CART);
+    Ahmat    = (double ***) my_calloc(N_LINKS+1,sizeof(Matrix),MY_STOP);
+    Ahmatdof = (double ***) my_calloc(N_DOFS+1,sizeof(Matrix),MY_STOP);
+    for (i=0; i<=N_LINKS; ++i)
+      Ahmat[i] = my_matrix(1,4,1,4);
+    for (i=0; i<=N_DOFS; ++i)
+      Ahmatdof[i] = my_matrix(1,4,1,4);
+  }
+
+  srand(17);
+  randomParameters();
+
+  // sine and cosine at the octant boundaries, where the reduction switches
+  // polynomials, and at random angles beyond the joint ranges
+  for (n=-N_FKBATCH_OCTANTS; n<=N_FKBATCH_OCTANTS; ++n) {
+    for (l=0; l<N_FK_LANES; ++l) {
+      x[l] = n*PI/4.0 + 1.e-12*(l-N_FK_LANES/2);
+      if (l == N_FK_LANES-1)
+	x[l] = 8.0*randomValue();
+    }
+    panda4_sinCosBatch(x,s,c);
+    for (l=0; l<N_FK_LANES; ++l) {
+      maxDifference(s[l],sin(x[l]),&err_sc,&mag_sc);
+      maxDifference(c[l],cos(x[l]),&err_sc,&mag_sc);
+    }
+  }
+
+  // the kinematics of the frozen base at the origin
+  freeze_base = TRUE;
+  bzero((void *)&cbase,sizeof(cbase));
+  bzero((void *)&obase,sizeof(obase));
+  obase.q[_Q0_] = 1.0;
+
+  for (n=1; n<=N_FKBATCH_CONFIGS; ++n)
+    for (i=1; i<=N_DOFS; ++i)
+      th[n][i] = 2.0*randomValue();
+
+  for (k=0; k<N_FKBATCH_CONFIGS; k+=N_FK_LANES) {
+
+    for (l=0; l<N_FK_LANES; ++l)
+      for (i=1; i<=N_DOFS; ++i)
+	thb[i][l] = k+l < N_FKBATCH_CONFIGS ? th[k+l+1][i] : 100.0*randomValue();
+
+    panda4_FKBatch(thb,endeff,pos,rot);
+
+    for (l=0; l<N_FK_LANES && k+l<N_FKBATCH_CONFIGS; ++l) {
+
+      for (i=1; i<=N_DOFS; ++i)
+	state[i].th = th[k+l+1][i];
+      panda4_linkInformation(state,&cbase,&obase,endeff,Xmcog,Xaxis,Xorigin,Xlink,
+			     Ahmat,Ahmatdof);
+
+      // the joint frames, and the endeffector frame in the last frame
+      for (arm=1; arm<=N_ARMS; ++arm) {
+	for (f=1; f<=N_FK_FRAMES; ++f) {
+	  dof = (arm-1)*N_DOFS_PER_ROBOT+f;
+	  A = f == N_FK_FRAMES ? Ahmat[link2endeffmap[arm]] : Ahmatdof[dof];
+	  for (i=1; i<=N_CART; ++i) {
+	    maxDifference(pos[arm][f][i][l],A[i][4],&err_fk,&mag_fk);
+	    for (j=1; j<=N_CART; ++j)
+	      maxDifference(rot[arm][f][i][j][l],A[i][j],&err_fk,&mag_fk);
+	  }
+	}
+      }
+
+    }
+
+  }
+
+  printf("fkbatch: sin/cos max. difference %g\n",err_sc);
+  printf("fkbatch: frames max. difference %g at values up to %g\n",err_fk,mag_fk);
+
+  return err_sc <= 1.e-15 && mag_fk > 0 && err_fk <= 1.e-9*mag_fk;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  testCentroidal
+\date  Oct. 2026
+
+\remarks
+
+ checks panda4_armCentroidal and panda4_Centroidal at random states
+ against the mass-weighted centers of mass of the links and endeffectors,
+ against the central difference of the COM for the COM Jacobian, and
+ against the momenta of the individual bodies, whose velocities are the
+ central differences of their frames along qd
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ returns TRUE if all quantities agree
+
+ ******************************************************************************/
+static int
+testCentroidal(void)
+{
+  int    i,j,n,r,arm;
+  int    dof;
+  double h = 1.e-6;
+  double m,m_ref,m_cell,m_cell_ref;
+  double com[N_CART+1], com_ref[N_CART+1], com_p[N_CART+1], com_m[N_CART+1];
+  double com_cell[N_CART+1], com_cell_ref[N_CART+1];
+  double Jcom[N_CART+1][N_DOFS_PER_ROBOT+1];
+  double hG[2*N_CART+1], hG_cell[2*N_CART+1];
+  double hO[2*N_CART+1], hO_cell[2*N_CART+1];
+  double acom[N_ARMS+1][N_CART+1];
+  double acom_ref[N_ARMS+1][N_CART+1];
+  double err_c = 0, mag_c = 0;
+  double err_j = 0, mag_j = 0;
+  double err_h = 0, mag_h = 0;
+  static SL_Jstate state[N_DOFS+1];
+  static SL_Jstate state_p[N_DOFS+1];
+  static SL_Jstate state_m[N_DOFS+1];
+
+  srand(19);
+  randomParameters();
+
+  for (n=1; n<=N_CENTROIDAL_STATES; ++n) {
+
+    for (i=1; i<=N_DOFS; ++i) {
+      state[i].th  = 2.0*randomValue();
+      state[i].thd = 2.0*randomValue();
+    }
+
+    m_cell_ref = 0.0;
+    for (r=1; r<=2*N_CART; ++r)
+      hO_cell[r] = 0.0;
+    for (r=1; r<=N_CART; ++r)
+      com_cell_ref[r] = 0.0;
+
+    for (arm=1; arm<=N_ARMS; ++arm) {
+
+      dof = (arm-1)*N_DOFS_PER_ROBOT;
+      panda4_armCentroidal(arm,state,endeff,&m,com,Jcom,hG);
+
+      // mass and COM
+      armMomentum(arm,state,state,state,h,&m_ref,com_ref,hO);
+      maxDifference(m,m_ref,&err_c,&mag_c);
+      for (r=1; r<=N_CART; ++r)
+	maxDifference(com[r],com_ref[r],&err_c,&mag_c);
+
+      m_cell_ref += m_ref;
+      for (r=1; r<=N_CART; ++r) {
+	com_cell_ref[r] += m_ref*com_ref[r];
+	acom_ref[arm][r] = com_ref[r];
+      }
+
+      // COM Jacobian by central differences of the COM
+      for (j=1; j<=N_DOFS_PER_ROBOT; ++j) {
+	memcpy((void *)state_p,(void *)state,sizeof(state_p));
+	memcpy((void *)state_m,(void *)state,sizeof(state_m));
+	state_p[dof+j].th += h;
+	state_m[dof+j].th -= h;
+	armMomentum(arm,state_p,state_p,state_p,h,&m_ref,com_p,hO);
+	armMomentum(arm,state_m,state_m,state_m,h,&m_ref,com_m,hO);
+	for (r=1; r<=N_CART; ++r)
+	  maxDifference(Jcom[r][j],(com_p[r]-com_m[r])/(2.0*h),&err_j,&mag_j);
+      }
+
+      // momentum of the bodies, moved from the origin to the COM
+      for (i=1; i<=N_DOFS; ++i) {
+	state_p[i] = state_m[i] = state[i];
+	state_p[i].th += h*state[i].thd;
+	state_m[i].th -= h*state[i].thd;
+      }
+      armMomentum(arm,state,state_p,state_m,h,&m_ref,com_ref,hO);
+      for (r=1; r<=2*N_CART; ++r)
+	hO_cell[r] += hO[r];
+      momentumAtPoint(hO,com_ref,hO);
+      for (r=1; r<=2*N_CART; ++r)
+	maxDifference(hG[r],hO[r],&err_h,&mag_h);
+
+    }
+
+    // the entire cell
+    panda4_Centroidal(state,endeff,&m_cell,com_cell,hG_cell,acom);
+    maxDifference(m_cell,m_cell_ref,&err_c,&mag_c);
+    for (arm=1; arm<=N_ARMS; ++arm)
+      for (r=1; r<=N_CART; ++r)
+	maxDifference(acom[arm][r],acom_ref[arm][r],&err_c,&mag_c);
+    for (r=1; r<=N_CART; ++r) {
+      com_cell_ref[r] /= m_cell_ref;
+      maxDifference(com_cell[r],com_cell_ref[r],&err_c,&mag_c);
+    }
+    momentumAtPoint(hO_cell,com_cell_ref,hO_cell);
+    for (r=1; r<=2*N_CART; ++r)
+      maxDifference(hG_cell[r],hO_cell[r],&err_h,&mag_h);
+
+  }
+
+  printf("centroidal: mass and COM max. difference %g at values up to %g\n",err_c,mag_c);
+  printf("centroidal: Jcom max. difference %g at values up to %g\n",err_j,mag_j);
+  printf("centroidal: hG max. difference %g at values up to %g\n",err_h,mag_h);
+
+  // the central differences are accurate to about 1e-9
+  return mag_c > 0 && err_c <= 1.e-9*mag_c && mag_j > 0 && err_j <= 1.e-6*mag_j &&
+    mag_h > 0 && err_h <= 1.e-6*mag_h;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  armMomentum
+\date  Oct. 2026
+
+\remarks
+
+ mass, COM and spatial momentum about the world origin of one arm, summed
+ over its links and its endeffector, with the frames of all bodies from
+ panda4_linkInformation. The link inertias are given about the joint
+ origins, and the endeffector has no rotational inertia about its own
+ origin. The body velocities are the central differences of the frames
+ between two states.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm     : which arm (1 to N_ARMS)
+ \param[in]     state   : the joint state of the entire robot
+ \param[in]     state_p : the state at a time step h ahead
+ \param[in]     state_m : the state at a time step h back
+ \param[in]     h       : the time step
+ \param[out]    mass    : the total mass of the arm
+ \param[out]    com     : the COM of the arm
+ \param[out]    hO      : the momentum as [angular about the origin; linear]
+
+ ******************************************************************************/
+static void
+armMomentum(int arm, SL_Jstate *state, SL_Jstate *state_p, SL_Jstate *state_m,
+	    double h, double *mass, double *com, double *hO)
+{
+  int    i,b,r,c,k;
+  int    dof;
+  double m;
+  double mcm[N_CART+1];
+  double I[N_CART+1][N_CART+1];
+  double R[N_CART+1][N_CART+1];
+  double p[N_CART+1];
+  double v[N_CART+1];
+  double w[N_CART+1];
+  double W[N_CART+1][N_CART+1];
+  double mc[N_CART+1];
+  double Iw[N_CART+1];
+  double l[N_CART+1];
+  double L[N_CART+1];
+  double pl[N_CART+1];
+  double **A, **Ap, **Am;
+  SL_Cstate cbase;
+  SL_quat   obase;
+  static int    firsttime = TRUE;
+  static Matrix Xmcog, Xaxis, Xorigin, Xlink;
+  static double ***Ahmat[3+1], ***Ahmatdof[3+1];
+
+  if (firsttime) {
+    firsttime = FALSE;
+    Xmcog   = my_matrix(0,N_DOFS,1,N_CART);
+    Xaxis   = my_matrix(0,N_DOFS,1,N_CART);
+    Xorigin = my_matrix(0,N_DOFS,1,N_CART);
+    Xlink   = my_matrix(0,N_LINKS,1,N_CART);
+    for (k=1; k<=3; ++k) {
+      Ahmat[k]    = (double ***) my_calloc(N_LINKS+1,sizeof(Matrix),MY_STOP);
+      Ahmatdof[k] = (double ***) my_calloc(N_DOFS+1,sizeof(Matrix),MY_STOP);
+      for (i=0; i<=N_LINKS; ++i)
+	Ahmat[k][i] = my_matrix(1,4,1,4);
+      for (i=0; i<=N_DOFS; ++i)
+	Ahmatdof[k][i] = my_matrix(1,4,1,4);
+    }
+  }
+
+  // the frozen base at the origin
+  freeze_base = TRUE;
+  bzero((void *)&cbase,sizeof(cbase));
+  bzero((void *)&obase,sizeof(obase));
+  obase.q[_Q0_] = 1.0;
+
+  panda4_linkInformation(state,&cbase,&obase,endeff,Xmcog,Xaxis,Xorigin,Xlink,
+			 Ahmat[1],Ahmatdof[1]);
+  panda4_linkInformation(state_p,&cbase,&obase,endeff,Xmcog,Xaxis,Xorigin,Xlink,
+			 Ahmat[2],Ahmatdof[2]);
+  panda4_linkInformation(state_m,&cbase,&obase,endeff,Xmcog,Xaxis,Xorigin,Xlink,
+			 Ahmat[3],Ahmatdof[3]);
+
+  *mass = 0.0;
+  for (r=1; r<=N_CART; ++r)
+    com[r] = 0.0;
+  for (r=1; r<=2*N_CART; ++r)
+    hO[r] = 0.0;
+
+  for (b=1; b<=N_DOFS_PER_ROBOT+1; ++b) {
+
+    // parameters and frames of the link or the endeffector
+    dof = (arm-1)*N_DOFS_PER_ROBOT+b;
+    if (b <= N_DOFS_PER_ROBOT) {
+      m = links[dof].m;
+      for (r=1; r<=N_CART; ++r) {
+	mcm[r] = links[dof].mcm[r];
+	for (c=1; c<=N_CART; ++c)
+	  I[r][c] = (r <= c) ? links[dof].inertia[r][c] : links[dof].inertia[c][r];
+      }
+      A  = Ahmatdof[1][dof];
+      Ap = Ahmatdof[2][dof];
+      Am = Ahmatdof[3][dof];
+    } else {
+      m = endeff[arm].m;
+      for (r=1; r<=N_CART; ++r) {
+	mcm[r] = endeff[arm].mcm[r];
+	for (c=1; c<=N_CART; ++c)
+	  I[r][c] = 0.0;
+      }
+      A  = Ahmat[1][link2endeffmap[arm]];
+      Ap = Ahmat[2][link2endeffmap[arm]];
+      Am = Ahmat[3][link2endeffmap[arm]];
+    }
+
+    // world frame, origin velocity and angular velocity of this body
+    for (r=1; r<=N_CART; ++r) {
+      p[r] = A[r][4];
+      v[r] = (Ap[r][4]-Am[r][4])/(2.0*h);
+      for (c=1; c<=N_CART; ++c)
+	R[r][c] = A[r][c];
+    }
+    for (r=1; r<=N_CART; ++r)
+      for (c=1; c<=N_CART; ++c) {
+	W[r][c] = 0.0;
+	for (k=1; k<=N_CART; ++k)
+	  W[r][c] += (Ap[r][k]-Am[r][k])/(2.0*h)*R[c][k];
+      }
+    w[1] = W[3][2];
+    w[2] = W[1][3];
+    w[3] = W[2][1];
+
+    // first mass moment and inertia times angular velocity in world
+    // coordinates, both about the origin of the body
+    for (r=1; r<=N_CART; ++r) {
+      mc[r] = 0.0;
+      for (c=1; c<=N_CART; ++c)
+	mc[r] += R[r][c]*mcm[c];
+    }
+    for (r=1; r<=N_CART; ++r) {
+      Iw[r] = 0.0;
+      for (c=1; c<=N_CART; ++c)
+	for (k=1; k<=N_CART; ++k)
+	  Iw[r] += R[r][c]*I[c][k]*(R[1][k]*w[1] + R[2][k]*w[2] + R[3][k]*w[3]);
+    }
+
+    // linear momentum m*v + w x mc, angular momentum Iw + mc x v about the
+    // body origin, and p x l to move it to the world origin
+    crossProduct(w,mc,l);
+    crossProduct(mc,v,L);
+    for (r=1; r<=N_CART; ++r) {
+      l[r] += m*v[r];
+      L[r] += Iw[r];
+    }
+    crossProduct(p,l,pl);
+    for (r=1; r<=N_CART; ++r) {
+      hO[r]        += L[r] + pl[r];
+      hO[N_CART+r] += l[r];
+      com[r]       += m*p[r] + mc[r];
+    }
+    *mass += m;
+
+  }
+
+  for (r=1; r<=N_CART; ++r)
+    com[r] /= *mass;
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  momentumAtPoint
+\date  Oct. 2026
+
+\remarks
+
+ moves a spatial momentum from the world origin to a point: the angular
+ momentum about the point is the one about the origin minus x times the
+ linear momentum
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     hO  : the momentum as [angular about the origin; linear]
+ \param[in]     x   : the point
+ \param[out]    hx  : the momentum as [angular about x; linear], may be hO
+
+ ******************************************************************************/
+static void
+momentumAtPoint(double *hO, double *x, double *hx)
+{
+  int    r;
+  double xl[N_CART+1];
+
+  crossProduct(x,&hO[N_CART],xl);
+  for (r=1; r<=2*N_CART; ++r)
+    hx[r] = hO[r] - (r <= N_CART ? xl[r] : 0.0);
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  crossProduct
+\date  Oct. 2026
+
+\remarks
+
+ c = a x b of 3-vectors
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     a   : first vector
+ \param[in]     b   : second vector
+ \param[out]    c   : the cross product
+
+ ******************************************************************************/
+static void
+crossProduct(double *a, double *b, double *c)
+{
+  c[1] = a[2]*b[3] - a[3]*b[2];
+  c[2] = a[3]*b[1] - a[1]*b[3];
+  c[3] = a[1]*b[2] - a[2]*b[1];
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  testBuckets
+\date  Oct. 2026
+
+\remarks
+
+ checks that every bucket of the latency histograms ends where the next
+ one starts, that small values have their own buckets, that large values
+ saturate in the last bucket, and that the telemetry percentiles, which
+ use the same buckets, resolve a period to 1/N_TIMING_SUB_BUCKETS
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ returns TRUE if all boundaries are right
+
+ ******************************************************************************/
+static int
+testBuckets(void)
+{
+  int                 b,ok = TRUE;
+  unsigned long       v,p;
+  static Panda4TelemetrySlot s;
+
+  for (v=0; v<N_TIMING_SUB_BUCKETS; ++v)
+    if (panda4_timingBucket(v) != (int) v) {
+      printf("buckets: %ld ns is in bucket %d\n",v,panda4_timingBucket(v));
+      ok = FALSE;
+    }
+
+  for (b=0; b<N_TIMING_BUCKETS-1; ++b) {
+    v = panda4_timingBucketValue(b);
+    if (panda4_timingBucket(v) != b || panda4_timingBucket(v+1) != b+1) {
+      printf("buckets: bucket %d ends at %ld ns, which is in bucket %d, and %ld ns in %d\n",
+	     b,v,panda4_timingBucket(v),v+1,panda4_timingBucket(v+1));
+      ok = FALSE;
+    }
+  }
+
+  if (panda4_timingBucket(~0UL) != N_TIMING_BUCKETS-1) {
+    printf("buckets: the largest value is in bucket %d\n",panda4_timingBucket(~0UL));
+    ok = FALSE;
+  }
+
+  // a servo with a period of exactly 1ms
+  bzero((void *)&s,sizeof(s));
+  s.period_hist[panda4_timingBucket(1000000)] = 100;
+  p = panda4_telemetryPercentile(&s,50.);
+  if (p < 1000 || p > 1000 + 1000/N_TIMING_SUB_BUCKETS) {
+    printf("buckets: the median of 1000us periods is %ld us\n",p);
+    ok = FALSE;
+  }
+
+  return ok;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  testHandler
+\date  Oct. 2026
+
+\remarks
+
+ the handler of the test messages, which keeps what it got
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     buf : the payload
+ \param[in]     arg : the argument of the registration
+
+ ******************************************************************************/
+static void
+testHandler(const float *buf, int arg)
+{
+  handled_arg   = arg;
+  handled_value = buf[0];
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  testMessages
+\date  Oct. 2026
+
+\remarks
+
+ fills a message table up to its load limit, such that probe sequences
+ collide, and checks that every name resolves to its own ID, that unknown
+ and duplicate names are rejected, and that a dispatch hands the payload
+ and the argument to the handler
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ returns TRUE if all lookups are right
+
+ ******************************************************************************/
+static int
+testMessages(void)
+{
+  int                i,j,ok = TRUE;
+  int                ids[N_MESSAGE_SLOTS];
+  int                n = N_MESSAGE_SLOTS/2;
+  char               name[20];
+  float              value = 3.5;
+  Panda4MessageTable t;
+  static SL_message  msg;
+
+  panda4_initMessages(&t);
+
+  for (i=0; i<n; ++i) {
+    sprintf(name,"msg%d",i);
+    ids[i] = panda4_addMessage(&t,name,testHandler,i);
+    if (ids[i] <= 0 || ids[i] >= N_MESSAGE_SLOTS) {
+      printf("messages: >%s< got ID %d\n",name,ids[i]);
+      ok = FALSE;
+    }
+    for (j=0; j<i; ++j)
+      if (ids[j] == ids[i]) {
+	printf("messages: >msg%d< and >%s< share ID %d\n",j,name,ids[i]);
+	ok = FALSE;
+      }
+  }
+
+  if (panda4_addMessage(&t,"one_too_many",testHandler,0) != 0) {
+    printf("messages: the full table took another message\n");
+    ok = FALSE;
+  }
+  if (panda4_addMessage(&t,"msg3",testHandler,0) != 0) {
+    printf("messages: a duplicate name was registered\n");
+    ok = FALSE;
+  }
+
+  for (i=0; i<n; ++i) {
+    sprintf(name,"msg%d",i);
+    if (panda4_findMessage(&t,name) != ids[i]) {
+      printf("messages: >%s< resolves to %d instead of %d\n",name,
+	     panda4_findMessage(&t,name),ids[i]);
+      ok = FALSE;
+    }
+  }
+
+  if (panda4_findMessage(&t,"unknown") != 0 || panda4_findMessage(&t,"msg") != 0) {
+    printf("messages: an unknown name resolved\n");
+    ok = FALSE;
+  }
+
+  // the payload of a message in the shared message buffer
+  bzero((void *)&msg,sizeof(msg));
+  sm_simulation_message = &msg;
+  msg.moff[1] = 8;
+  memcpy(msg.buf+8,&value,sizeof(value));
+  if (!panda4_dispatchMessage(&t,"msg7",1) || handled_arg != 7 || handled_value != value) {
+    printf("messages: dispatch of >msg7< gave arg %d and value %f\n",handled_arg,handled_value);
+    ok = FALSE;
+  }
+  if (panda4_dispatchMessage(&t,"unknown",1)) {
+    printf("messages: an unknown message was dispatched\n");
+    ok = FALSE;
+  }
+  sm_simulation_message = NULL;
+
+  return ok;
+}
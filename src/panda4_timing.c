@@ -0,0 +1,401 @@
+/*!=============================================================================
+  ==============================================================================
+
+  \file    panda4_timing.c
+
+  \author  Stefan Schaal
+  \date    Oct. 2026
+
+  ==============================================================================
+  \remarks
+
+  Per-stage latency histograms of the Panda servo. Every stage of the torque
+  callback of each arm (index 1 to N_ARMS), and every stage of the servo
+  that publishes the state of the cell (index 0), adds its duration to an
+  HDR-style histogram with logarithmic buckets and linear sub-buckets, such
+  that the relative resolution is constant from nanoseconds to several
+  milliseconds. The buckets are updated with atomic adds, i.e., without
+  locks, and can be read at any time. The telemetry of the servo processes
+  uses the same buckets for its period histograms.
+
+  In addition, the stage durations of the last N_TIMING_RECENT ticks are
+  kept, which shows which stage ate the time budget when the robot faults.
+
+  ============================================================================*/
+
+// SL general includes of system headers
+#include "SL_system_headers.h"
+#include <time.h>
+
+// private includes
+#include "SL.h"
+#include "SL_user.h"
+#include "utility.h"
+#include "panda4_timing.h"
+
+// global variables
+char timing_stage_names[][20]= {
+  {"dummy"},
+  {"model"},
+  {"state"},
+  {"callback"},
+  {"translate"},
+  {"publish"},
+  {"flush"},
+  {"receive"},
+  {"messages"},
+  {"collect"},
+  {"servo"}
+};
+
+// local variables
+typedef struct {
+  unsigned long count[N_TIMING_BUCKETS];
+  unsigned long n;
+  unsigned long sum;
+  unsigned long max;
+} TimingHistogram;
+
+static TimingHistogram timing_hist[N_ARMS+1][N_TIMING_STAGES+1];
+static unsigned long   timing_recent[N_ARMS+1][N_TIMING_RECENT][N_TIMING_STAGES+1];
+static int             timing_head[N_ARMS+1];
+
+// local functions
+static unsigned long timingPercentile(TimingHistogram *h, double p);
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_initTiming
+\date  Oct. 2026
+
+\remarks
+
+ clears all histograms and recent ticks
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_initTiming(void)
+{
+  bzero((void *)timing_hist,sizeof(timing_hist));
+  bzero((void *)timing_recent,sizeof(timing_recent));
+  bzero((void *)timing_head,sizeof(timing_head));
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_timeNs
+\date  Oct. 2026
+
+\remarks
+
+ returns a monotonic time stamp in nanoseconds
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+unsigned long
+panda4_timeNs(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC,&t);
+
+  return (unsigned long)t.tv_sec*1000000000UL + (unsigned long)t.tv_nsec;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_timingBucket
+\date  Oct. 2026
+
+\remarks
+
+ the histogram bucket of a duration: values below N_TIMING_SUB_BUCKETS
+ have their own bucket, and every further power of two is split into
+ N_TIMING_SUB_BUCKETS linear sub-buckets
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     ns : the duration in nanoseconds
+
+ ******************************************************************************/
+int
+panda4_timingBucket(unsigned long ns)
+{
+  int msb,b;
+
+  if (ns < N_TIMING_SUB_BUCKETS)
+    return (int) ns;
+
+  msb = 63 - __builtin_clzl(ns);  // >= 4
+  b   = (msb-3)*N_TIMING_SUB_BUCKETS + (int)((ns >> (msb-4)) & (N_TIMING_SUB_BUCKETS-1));
+
+  return b < N_TIMING_BUCKETS ? b : N_TIMING_BUCKETS-1;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_timingBucketValue
+\date  Oct. 2026
+
+\remarks
+
+ the upper end of the value range of a histogram bucket
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     b : the bucket
+
+ ******************************************************************************/
+unsigned long
+panda4_timingBucketValue(int b)
+{
+  int msb;
+
+  if (b < N_TIMING_SUB_BUCKETS)
+    return (unsigned long) b;
+
+  msb = b/N_TIMING_SUB_BUCKETS + 3;
+
+  return ((unsigned long)(N_TIMING_SUB_BUCKETS + b%N_TIMING_SUB_BUCKETS + 1) << (msb-4)) - 1;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_addTiming
+\date  Oct. 2026
+
+\remarks
+
+ adds the duration of a stage to its histogram and to the current tick
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : the arm (1 to N_ARMS), or 0 for the servo stages
+ \param[in]     stage : the stage (see TimingStages)
+ \param[in]     ns    : the duration in nanoseconds
+
+ ******************************************************************************/
+void
+panda4_addTiming(int arm, int stage, unsigned long ns)
+{
+  TimingHistogram *h = &timing_hist[arm][stage];
+  unsigned long    m;
+
+  __atomic_fetch_add(&h->count[panda4_timingBucket(ns)],1,__ATOMIC_RELAXED);
+  __atomic_fetch_add(&h->n,1,__ATOMIC_RELAXED);
+  __atomic_fetch_add(&h->sum,ns,__ATOMIC_RELAXED);
+
+  m = __atomic_load_n(&h->max,__ATOMIC_RELAXED);
+  while (ns > m && !__atomic_compare_exchange_n(&h->max,&m,ns,0,__ATOMIC_RELAXED,
+						__ATOMIC_RELAXED))
+    ;
+
+  timing_recent[arm][timing_head[arm]][stage] = ns;
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_endTimingTick
+\date  Oct. 2026
+
+\remarks
+
+ advances the recent ticks of an arm to the next tick
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : the arm (1 to N_ARMS), or 0 for the servo stages
+
+ ******************************************************************************/
+void
+panda4_endTimingTick(int arm)
+{
+  int next = (timing_head[arm]+1)%N_TIMING_RECENT;
+
+  bzero((void *)timing_recent[arm][next],sizeof(timing_recent[arm][next]));
+  timing_head[arm] = next;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  timingPercentile
+\date  Oct. 2026
+
+\remarks
+
+ the value below which the given fraction of the samples of a histogram
+ falls, at the resolution of the histogram
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     h : the histogram
+ \param[in]     p : the fraction (0 to 1)
+
+ ******************************************************************************/
+static unsigned long
+timingPercentile(TimingHistogram *h, double p)
+{
+  int           b;
+  unsigned long n = 0;
+  unsigned long target = (unsigned long)(p*(double)h->n + 0.5);
+
+  if (target < 1)
+    target = 1;
+
+  for (b=0; b<N_TIMING_BUCKETS; ++b) {
+    n += h->count[b];
+    if (n >= target)
+      return panda4_timingBucketValue(b);
+  }
+
+  return h->max;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_worstTimingStage
+\date  Oct. 2026
+
+\remarks
+
+ the stage with the longest duration in the recent ticks of an arm,
+ excluding the stages that contain other stages
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     arm   : the arm (1 to N_ARMS), or 0 for the servo stages
+ \param[out]    ns    : the duration of this stage in nanoseconds
+
+ returns the stage, or 0 if no stage was timed
+
+ ******************************************************************************/
+int
+panda4_worstTimingStage(int arm, unsigned long *ns)
+{
+  int i,j,stage = 0;
+
+  *ns = 0;
+  for (i=0; i<N_TIMING_RECENT; ++i)
+    for (j=1; j<=N_TIMING_STAGES; ++j) {
+      if (j == TIMING_CALLBACK || j == TIMING_SERVO)
+	continue;
+      if (timing_recent[arm][i][j] > *ns) {
+	*ns   = timing_recent[arm][i][j];
+	stage = j;
+      }
+    }
+
+  return stage;
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_printTiming
+\date  Oct. 2026
+
+\remarks
+
+ prints the percentiles of all stages that were timed, in microseconds
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ none
+
+ ******************************************************************************/
+void
+panda4_printTiming(void)
+{
+  int              i,j;
+  TimingHistogram *h;
+
+  printf("            %-6s %-10s %10s %8s %8s %8s %8s %8s\n","Arm","Stage","n",
+	 "mean","p50","p99","p99.9","max");
+
+  for (i=0; i<=N_ARMS; ++i) {
+    for (j=1; j<=N_TIMING_STAGES; ++j) {
+      h = &timing_hist[i][j];
+      if (h->n == 0)
+	continue;
+      printf("            %-6d %-10s %10ld %8.1f %8.1f %8.1f %8.1f %8.1f\n",i,
+	     timing_stage_names[j],h->n,(double)h->sum/(double)h->n/1000.,
+	     timingPercentile(h,0.5)/1000.,timingPercentile(h,0.99)/1000.,
+	     timingPercentile(h,0.999)/1000.,h->max/1000.);
+    }
+  }
+
+}
+
+/*!*****************************************************************************
+ *******************************************************************************
+\note  panda4_dumpTiming
+\date  Oct. 2026
+
+\remarks
+
+ writes all histograms and the stage durations of the recent ticks to an
+ ASCII file. Histogram lines are "arm stage bucket_max_ns count" for all
+ non-empty buckets, and recent tick lines are "arm tick" followed by the
+ durations of all stages in ns, with the oldest tick first.
+
+ *******************************************************************************
+ Function Parameters: [in]=input,[out]=output
+
+ \param[in]     fname : the file name
+
+ returns TRUE on success
+
+ ******************************************************************************/
+int
+panda4_dumpTiming(char *fname)
+{
+  int   i,j,k,t;
+  FILE *fp;
+
+  fp = fopen(fname,"w");
+  if (fp == NULL) {
+    printf("Couldn't open file >%s< for writing\n",fname);
+    return FALSE;
+  }
+
+  fprintf(fp,"# histograms: arm stage bucket_max_ns count\n");
+  for (i=0; i<=N_ARMS; ++i)
+    for (j=1; j<=N_TIMING_STAGES; ++j)
+      for (k=0; k<N_TIMING_BUCKETS; ++k)
+	if (timing_hist[i][j].count[k] > 0)
+	  fprintf(fp,"%d %s %ld %ld\n",i,timing_stage_names[j],
+		  panda4_timingBucketValue(k),timing_hist[i][j].count[k]);
+
+  fprintf(fp,"# recent ticks: arm tick");
+  for (j=1; j<=N_TIMING_STAGES; ++j)
+    fprintf(fp," %s",timing_stage_names[j]);
+  fprintf(fp,"\n");
+  for (i=0; i<=N_ARMS; ++i)
+    for (k=1; k<=N_TIMING_RECENT; ++k) {
+      t = (timing_head[i]+k)%N_TIMING_RECENT;
+      fprintf(fp,"%d %d",i,k);
+      for (j=1; j<=N_TIMING_STAGES; ++j)
+	fprintf(fp," %ld",timing_recent[i][t][j]);
+      fprintf(fp,"\n");
+    }
+
+  fclose(fp);
+
+  return TRUE;
+}